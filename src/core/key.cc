@@ -10,6 +10,8 @@
 #include "crypto/blake2/blake2.h"
 #include "ed25519-donna/ed25519.h"
 
+#include <algorithm>
+#include <cstring>
 #include <boost/multiprecision/cpp_int.hpp>
 #include <boost/property_tree/json_parser.hpp>
 
@@ -198,9 +200,98 @@ bool SymEncrypting(const utils::uint256& input, const std::string& password, uti
   return true;
 }
 
+//little endian group order L and field prime p of ed25519
+static const uint8_t kGroupOrder[32] = {
+  0xed, 0xd3, 0xf5, 0x5c, 0x1a, 0x63, 0x12, 0x58, 0xd6, 0x9c, 0xf7, 0xa2, 0xde, 0xf9, 0xde, 0x14,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10};
+static const uint8_t kFieldPrime[32] = {
+  0xed, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x7f};
+
+static bool LittleEndianLess(const uint8_t* a, const uint8_t* b){
+  for(int i = 31; i >= 0; i--){
+    if(a[i] != b[i]){
+      return a[i] < b[i];
+    }
+  }
+  return false;
+}
+
+bool SignIsCanonical(const Signature& sign){
+  const uint8_t* rs = sign.bytes().data();
+  if(!LittleEndianLess(rs+32, kGroupOrder)){
+    return false;
+  }
+  uint8_t y[32];
+  memcpy(y, rs, sizeof(y));
+  y[31] &= 0x7f;
+  if(!LittleEndianLess(y, kFieldPrime)){
+    return false;
+  }
+  //x is 0 for y = 1 or y = p-1, it's never packed with sign bit
+  if(rs[31] & 0x80){
+    uint8_t y_tmp[32];
+    memcpy(y_tmp, y, sizeof(y_tmp));
+    y_tmp[0] ^= 1;
+    bool is_one = std::all_of(y_tmp, y_tmp+32, [](uint8_t item){return item == 0;});
+    memcpy(y_tmp, kFieldPrime, sizeof(y_tmp));
+    y_tmp[0] -= 1;
+    if(is_one || memcmp(y, y_tmp, sizeof(y)) == 0){
+      return false;
+    }
+  }
+  return true;
+}
+
 bool SignIsValidate(const uint8_t* buf, size_t length, const PublicKey& pub_key, const Signature& sign){
+  if(!SignIsCanonical(sign)){
+    return false;
+  }
   return 0 == ed25519_sign_open(buf, length, pub_key.bytes().data (), sign.bytes().data ());
 }
 
+bool SignIsValidateBatch(const std::vector<const uint8_t*>& buf_list,
+                         const std::vector<size_t>& length_list,
+                         const std::vector<PublicKey>& pub_key_list,
+                         const std::vector<Signature>& sign_list,
+                         std::vector<bool>* valid_list){
+  size_t count = buf_list.size();
+  if(length_list.size() != count || pub_key_list.size() != count || sign_list.size() != count){
+    if(valid_list)valid_list->assign(count, false);
+    return false;
+  }
+  //non canonical signatures are invalid as in SignIsValidate, the rest goes to batch
+  std::vector<size_t> idx_list;
+  std::vector<const unsigned char*> buf_ptr_list;
+  std::vector<size_t> length_tmp;
+  std::vector<const unsigned char*> pub_key_ptr_list;
+  std::vector<const unsigned char*> sign_ptr_list;
+  for(size_t i = 0; i < count; i++){
+    if(!SignIsCanonical(sign_list[i]))continue;
+    idx_list.push_back(i);
+    buf_ptr_list.push_back(buf_list[i]);
+    length_tmp.push_back(length_list[i]);
+    pub_key_ptr_list.push_back(pub_key_list[i].bytes().data());
+    sign_ptr_list.push_back(sign_list[i].bytes().data());
+  }
+  std::vector<int> valid(idx_list.size(), 0);
+  if(!idx_list.empty()){
+    ed25519_sign_open_batch(buf_ptr_list.data(), length_tmp.data(),
+                            pub_key_ptr_list.data(), sign_ptr_list.data(), idx_list.size(), valid.data());
+  }
+  bool rtn = (idx_list.size() == count);
+  if(valid_list){
+    valid_list->assign(count, false);
+  }
+  for(size_t i = 0; i < idx_list.size(); i++){
+    if(valid[i] != 1){
+      rtn = false;
+    }else if(valid_list){
+      (*valid_list)[idx_list[i]] = true;
+    }
+  }
+  return rtn;
+}
+
 }
 }    
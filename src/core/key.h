@@ -6,6 +6,7 @@
  **********************************************************************/
 #ifndef AMBR_CORE_KEY_H_
 #define AMBR_CORE_KEY_H_
+#include <vector>
 #include "utils/uint.h"
 
 namespace ambr {
@@ -41,6 +42,19 @@ Signature GetSignByPrivateKey(const uint8_t* buf, size_t length, const PrivateKe
 bool SymEncrypting(const utils::uint256& input, const std::string& password, utils::uint256& output);
 
 bool SignIsValidate(const uint8_t* buf, size_t length, const PublicKey& pub_key, const Signature& sign);
+
+//S < L and R is the packed form of a point, batch verification doesn't check them itself.
+//signatures of ed25519_sign always pass
+bool SignIsCanonical(const Signature& sign);
+
+//verify signatures by ed25519 batch verification, a batch failed is verified one by one.
+//signatures SignIsValidate refuses(S >= L, non canonical R) are invalid here too.
+//valid_list is in order of input, return true if all signatures are valid
+bool SignIsValidateBatch(const std::vector<const uint8_t*>& buf_list,
+                         const std::vector<size_t>& length_list,
+                         const std::vector<PublicKey>& pub_key_list,
+                         const std::vector<Signature>& sign_list,
+                         std::vector<bool>* valid_list);
 }}
 
 #endif
@@ -0,0 +1,88 @@
+/**********************************************************************
+ * Copyright (c) 2018 Ambr project
+ * Distributed under the MIT software license, see the accompanying   *
+ * file COPYING or http://www.opensource.org/licenses/mit-license.php.*
+ **********************************************************************/
+#include "signature_cache.h"
+
+ambr::core::SignatureCache::SignatureCache(size_t capacity, size_t shard_count):
+  capacity_(capacity),
+  hit_count_(0),
+  miss_count_(0){
+  if(shard_count == 0)shard_count = 1;
+  for(size_t i = 0; i < shard_count; i++){
+    shard_list_.push_back(std::unique_ptr<Shard>(new Shard()));
+  }
+}
+
+bool ambr::core::SignatureCache::Contains(const UnitHash &hash, const PublicKey &pub_key, const Signature &sign){
+  Shard& shard = GetShard(hash);
+  std::lock_guard<std::mutex> lk(shard.mutex_);
+  auto iter = shard.item_map_.find(hash);
+  if(iter == shard.item_map_.end() || iter->second.pub_key_ != pub_key || iter->second.sign_ != sign){
+    miss_count_++;
+    return false;
+  }
+  shard.lru_.splice(shard.lru_.begin(), shard.lru_, iter->second.lru_iter_);
+  hit_count_++;
+  return true;
+}
+
+void ambr::core::SignatureCache::Insert(const UnitHash &hash, const PublicKey &pub_key, const Signature &sign){
+  size_t shard_capacity = capacity_/shard_list_.size();
+  if(shard_capacity == 0){
+    return;
+  }
+  Shard& shard = GetShard(hash);
+  std::lock_guard<std::mutex> lk(shard.mutex_);
+  auto iter = shard.item_map_.find(hash);
+  if(iter != shard.item_map_.end()){
+    iter->second.pub_key_ = pub_key;
+    iter->second.sign_ = sign;
+    shard.lru_.splice(shard.lru_.begin(), shard.lru_, iter->second.lru_iter_);
+    return;
+  }
+  shard.lru_.push_front(hash);
+  Item& item = shard.item_map_[hash];
+  item.pub_key_ = pub_key;
+  item.sign_ = sign;
+  item.lru_iter_ = shard.lru_.begin();
+  EvictShard(shard, shard_capacity);
+}
+
+void ambr::core::SignatureCache::Clear(){
+  for(std::unique_ptr<Shard>& shard:shard_list_){
+    std::lock_guard<std::mutex> lk(shard->mutex_);
+    shard->lru_.clear();
+    shard->item_map_.clear();
+  }
+}
+
+void ambr::core::SignatureCache::SetCapacity(size_t capacity){
+  capacity_ = capacity;
+  size_t shard_capacity = capacity/shard_list_.size();
+  for(std::unique_ptr<Shard>& shard:shard_list_){
+    std::lock_guard<std::mutex> lk(shard->mutex_);
+    EvictShard(*shard, shard_capacity);
+  }
+}
+
+size_t ambr::core::SignatureCache::size(){
+  size_t rtn = 0;
+  for(std::unique_ptr<Shard>& shard:shard_list_){
+    std::lock_guard<std::mutex> lk(shard->mutex_);
+    rtn += shard->item_map_.size();
+  }
+  return rtn;
+}
+
+ambr::core::SignatureCache::Shard& ambr::core::SignatureCache::GetShard(const UnitHash &hash){
+  return *shard_list_[Hasher()(hash)%shard_list_.size()];
+}
+
+void ambr::core::SignatureCache::EvictShard(Shard& shard, size_t shard_capacity){
+  while(shard.item_map_.size() > shard_capacity && shard.lru_.size()){
+    shard.item_map_.erase(shard.lru_.back());
+    shard.lru_.pop_back();
+  }
+}
@@ -0,0 +1,67 @@
+/**********************************************************************
+ * Copyright (c) 2018 Ambr project
+ * Distributed under the MIT software license, see the accompanying   *
+ * file COPYING or http://www.opensource.org/licenses/mit-license.php.*
+ **********************************************************************/
+#ifndef AMBR_CORE_SIGNATURE_CACHE_H_
+#define AMBR_CORE_SIGNATURE_CACHE_H_
+#include <string.h>
+#include <memory>
+#include <list>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
+#include <core/key.h>
+namespace ambr {
+namespace core {
+
+//sharded lru set of (unit hash, public key, signature) which already passed ed25519 verify,
+//so units retried from buffer or relayed by many peers are verified only once.
+//memory: about 200 bytes per entry after malloc.
+class SignatureCache{
+public:
+  SignatureCache(size_t capacity = 128*1024, size_t shard_count = 16);
+public:
+  //true if the triple was verified before, counted in hit/miss
+  bool Contains(const UnitHash& hash, const PublicKey& pub_key, const Signature& sign);
+  //only insert triple which passed verify
+  void Insert(const UnitHash& hash, const PublicKey& pub_key, const Signature& sign);
+  void Clear();
+  //count of entries, 0 for disable cache
+  void SetCapacity(size_t capacity);
+public:
+  size_t capacity() const{return capacity_;}
+  size_t size();
+  uint64_t hit_count() const{return hit_count_;}
+  uint64_t miss_count() const{return miss_count_;}
+private:
+  struct Hasher{
+    size_t operator()(const UnitHash& hash) const{
+      size_t rtn;
+      memcpy(&rtn, hash.bytes().data(), sizeof(rtn));
+      return rtn;
+    }
+  };
+  struct Item{
+    PublicKey pub_key_;
+    Signature sign_;
+    std::list<UnitHash>::iterator lru_iter_;
+  };
+  struct Shard{
+    std::mutex mutex_;
+    std::list<UnitHash> lru_;//front is newest
+    std::unordered_map<UnitHash, Item, Hasher> item_map_;
+  };
+  Shard& GetShard(const UnitHash& hash);
+  void EvictShard(Shard& shard, size_t shard_capacity);
+private:
+  std::atomic<size_t> capacity_;
+  std::vector<std::unique_ptr<Shard>> shard_list_;
+  std::atomic<uint64_t> hit_count_;
+  std::atomic<uint64_t> miss_count_;
+};
+
+}
+}
+#endif
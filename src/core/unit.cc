@@ -7,8 +7,24 @@
 #include <boost/property_tree/ptree.hpp>
 #include "proto/unit.pb.h"
 #include <boost/property_tree/json_parser.hpp>
-#include <crypto/sha256.h>
+#include <p2p/crypto/sha256.h>
+#include <algorithm>
+#include <map>
+
+namespace{
+//append raw memory of value, the same bytes SHA256OneByOneHasher::process took
+template <typename T>
+void AppendHashData(std::vector<uint8_t>* buf, const T& value){
+  const uint8_t* ptr = reinterpret_cast<const uint8_t*>(&value);
+  buf->insert(buf->end(), ptr, ptr+sizeof(value));
+}
 
+//pick the fastest sha256 backend of this cpu once
+void InitSHA256(){
+  static const std::string impl = ambr::p2p::SHA256AutoDetect();
+  (void)impl;
+}
+}
 
 int32_t ambr::core::Unit::GetFeeSize(){
   return sizeof(version_)+
@@ -47,6 +63,127 @@ std::shared_ptr<ambr::core::Unit> ambr::core::Unit::CreateUnitByByte(const std::
   return std::shared_ptr<ambr::core::Unit>();
 }
 
+bool ambr::core::Unit::Validate(std::string *err) const{
+  if(!ValidateWithoutSign(err)){
+    return false;
+  }
+  //check signature
+  if(signature_cache().Contains(hash_, public_key_, sign_)){
+    return true;
+  }
+  if(!ambr::core::SignIsValidate(hash_.bytes().data(), hash_.bytes().size(), public_key_, sign_)){
+    if(err){
+      *err = "error signature";
+    }
+    return false;
+  }
+  signature_cache().Insert(hash_, public_key_, sign_);
+  return true;
+}
+
+bool ambr::core::Unit::ValidateBatch(const std::vector<const Unit*>& unit_list, std::vector<bool>* valid_list, std::vector<std::string>* err_list){
+  std::vector<bool> valid(unit_list.size(), false);
+  std::vector<std::string> err(unit_list.size());
+  std::vector<size_t> index_list;
+  std::vector<const uint8_t*> buf_list;
+  std::vector<size_t> length_list;
+  std::vector<PublicKey> pub_key_list;
+  std::vector<Signature> sign_list;
+  std::vector<UnitHash> hash_list;
+  CalcHashBatch(unit_list, &hash_list);
+  for(size_t i = 0; i < unit_list.size(); i++){
+    if(!unit_list[i]){
+      err[i] = "unit ptr is null";
+    }else if(!unit_list[i]->CheckVersionAndHash(hash_list[i], &err[i])){
+      continue;
+    }else if(signature_cache().Contains(unit_list[i]->hash_, unit_list[i]->public_key_, unit_list[i]->sign_)){
+      valid[i] = true;
+    }else if(!SignIsCanonical(unit_list[i]->sign_)){
+      //malleated signature never reaches batch and cache
+      err[i] = "error signature";
+    }else{
+      index_list.push_back(i);
+      buf_list.push_back(unit_list[i]->hash_.bytes().data());
+      length_list.push_back(unit_list[i]->hash_.bytes().size());
+      pub_key_list.push_back(unit_list[i]->public_key_);
+      sign_list.push_back(unit_list[i]->sign_);
+    }
+  }
+  std::vector<bool> sign_valid_list;
+  SignIsValidateBatch(buf_list, length_list, pub_key_list, sign_list, &sign_valid_list);
+  for(size_t i = 0; i < index_list.size(); i++){
+    if(sign_valid_list[i]){
+      valid[index_list[i]] = true;
+      signature_cache().Insert(unit_list[index_list[i]]->hash_, pub_key_list[i], sign_list[i]);
+    }else{
+      err[index_list[i]] = "error signature";
+    }
+  }
+  bool rtn = std::find(valid.begin(), valid.end(), false) == valid.end();
+  if(valid_list)*valid_list = valid;
+  if(err_list)*err_list = err;
+  return rtn;
+}
+
+void ambr::core::Unit::CalcHashBatch(const std::vector<const Unit*>& unit_list, std::vector<UnitHash>* hash_list){
+  InitSHA256();
+  std::vector<std::vector<uint8_t>> data_list(unit_list.size());
+  //units with the same data length are hashed together
+  std::map<size_t, std::vector<size_t>> length_map;
+  for(size_t i = 0; i < unit_list.size(); i++){
+    if(unit_list[i]){
+      unit_list[i]->GetHashData(&data_list[i]);
+      length_map[data_list[i].size()].push_back(i);
+    }
+  }
+  hash_list->assign(unit_list.size(), UnitHash());
+  std::vector<const unsigned char*> input_list;
+  std::vector<unsigned char> output;
+  for(const std::pair<const size_t, std::vector<size_t>>& item:length_map){
+    input_list.clear();
+    for(size_t idx:item.second){
+      input_list.push_back(data_list[idx].data());
+    }
+    output.resize(input_list.size()*p2p::CSHA256::OUTPUT_SIZE);
+    p2p::SHA256Multi(output.data(), input_list.data(), item.first, input_list.size());
+    for(size_t i = 0; i < item.second.size(); i++){
+      UnitHash::ArrayType array;
+      std::copy(output.begin()+i*array.size(), output.begin()+(i+1)*array.size(), array.begin());
+      (*hash_list)[item.second[i]] = UnitHash(array);
+    }
+  }
+}
+
+ambr::core::SignatureCache& ambr::core::Unit::signature_cache(){
+  static SignatureCache cache;
+  return cache;
+}
+
+ambr::core::UnitHash ambr::core::Unit::HashData(const std::vector<uint8_t>& buf){
+  InitSHA256();
+  UnitHash::ArrayType array;
+  p2p::CSHA256().Write(buf.data(), buf.size()).Finalize(array.data());
+  return UnitHash(array);
+}
+
+bool ambr::core::Unit::CheckVersionAndHash(const UnitHash& calc_hash, std::string* err) const{
+  //check version
+  if(version_ != 0x00000001){
+    if(err){
+      *err = "error version";
+    }
+    return false;
+  }
+  //check hash
+  if(hash_ != calc_hash){
+    if(err){
+      *err = "error hash";
+    }
+    return false;
+  }
+  return true;
+}
+
 ambr::core::Unit::Unit():
   version_(0x00000001),
   type_(UnitType::Invalidate),
@@ -125,9 +262,9 @@ std::vector<uint8_t> ambr::core::SendUnit::SerializeByte( ) const {
   return buf;
 }
 
-bool ambr::core::SendUnit::DeSerializeByte(const std::vector<uint8_t> &buf,size_t* used_size){
+bool ambr::core::SendUnit::DeSerializeByte(const uint8_t* buf, size_t size, size_t* used_size){
   ::ambr::protobuf::SendUnit obj;
-  google::protobuf::io::CodedInputStream stream((const uint8_t*)buf.data(),buf.size());
+  google::protobuf::io::CodedInputStream stream(buf, size);
   if(obj.ParseFromCodedStream(&stream)){
     version_= (uint32_t)obj.version_();
     type_=((ambr::core::UnitType)obj.type_());
@@ -147,19 +284,19 @@ bool ambr::core::SendUnit::DeSerializeByte(const std::vector<uint8_t> &buf,size_
   return false;
 }
 
+void ambr::core::SendUnit::GetHashData(std::vector<uint8_t>* buf) const{
+  AppendHashData(buf, version_);
+  AppendHashData(buf, type_);
+  AppendHashData(buf, public_key_);
+  AppendHashData(buf, prev_unit_);
+  AppendHashData(buf, balance_);
+  AppendHashData(buf, dest_);
+}
+
 ambr::core::UnitHash ambr::core::SendUnit::CalcHash() const {
-  crypto::SHA256OneByOneHasher hasher;
-  hasher.init();
-  hasher.process(version_);
-  hasher.process(type_);
-  hasher.process(public_key_);
-  hasher.process(prev_unit_);
-  hasher.process(balance_);
-  hasher.process(dest_);
-  hasher.finish();
-  UnitHash::ArrayType array;
-  hasher.get_hash_bytes(array.begin(), array.end());
-  return UnitHash(array);
+  std::vector<uint8_t> buf;
+  GetHashData(&buf);
+  return HashData(buf);
 }
 
 void ambr::core::SendUnit::CalcHashAndFill(){
@@ -171,28 +308,8 @@ bool ambr::core::SendUnit::SignatureAndFill(const ambr::core::PrivateKey &key){
   return true;
 }
 
-bool ambr::core::SendUnit::Validate(std::string *err) const{
-  //check version
-  if(version_ != 0x00000001){
-    if(err){
-      *err = "error version";
-    }
-    return false;
-  }
-  //check hash
-  if(hash_ != CalcHash()){
-    if(err){
-      *err = "error hash";
-    }
-    return false;
-  }
-  if(!ambr::core::SignIsValidate(hash_.bytes().data(), hash_.bytes().size(), public_key_, sign_)){
-    if(err){
-      *err = "error signature";
-    }
-    return false;
-  }
-  return true;
+bool ambr::core::SendUnit::ValidateWithoutSign(std::string *err) const{
+  return CheckVersionAndHash(CalcHash(), err);
 }
 
 int32_t ambr::core::SendUnit::GetFeeSize(){
@@ -260,9 +377,9 @@ std::vector<uint8_t> ambr::core::ReceiveUnit::SerializeByte( ) const {
   return buf;
 }
 
-bool ambr::core::ReceiveUnit::DeSerializeByte(const std::vector<uint8_t> &buf,size_t* used_size){
+bool ambr::core::ReceiveUnit::DeSerializeByte(const uint8_t* buf, size_t size, size_t* used_size){
   ::ambr::protobuf::ReceiveUnit obj;
-  google::protobuf::io::CodedInputStream stream(buf.data(),buf.size());
+  google::protobuf::io::CodedInputStream stream(buf, size);
   if(obj.ParseFromCodedStream(&stream)){
     version_= (uint32_t)obj.version_();
     type_=((ambr::core::UnitType)obj.type_());
@@ -280,19 +397,19 @@ bool ambr::core::ReceiveUnit::DeSerializeByte(const std::vector<uint8_t> &buf,si
   return false;
 }
 
+void ambr::core::ReceiveUnit::GetHashData(std::vector<uint8_t>* buf) const{
+  AppendHashData(buf, version_);
+  AppendHashData(buf, type_);
+  AppendHashData(buf, public_key_);
+  AppendHashData(buf, prev_unit_);
+  AppendHashData(buf, balance_);
+  AppendHashData(buf, from_);
+}
+
 ambr::core::UnitHash ambr::core::ReceiveUnit::CalcHash() const {
-  crypto::SHA256OneByOneHasher hasher;
-  hasher.init();
-  hasher.process(version_);
-  hasher.process(type_);
-  hasher.process(public_key_);
-  hasher.process(prev_unit_);
-  hasher.process(balance_);
-  hasher.process(from_);
-  hasher.finish();
-  UnitHash::ArrayType array;
-  hasher.get_hash_bytes(array.begin(), array.end());
-  return UnitHash(array);
+  std::vector<uint8_t> buf;
+  GetHashData(&buf);
+  return HashData(buf);
 }
 
 void ambr::core::ReceiveUnit::CalcHashAndFill(){
@@ -304,29 +421,8 @@ bool ambr::core::ReceiveUnit::SignatureAndFill(const ambr::core::PrivateKey &key
   return true;;
 }
 
-bool ambr::core::ReceiveUnit::Validate(std::string *err) const{
-  //check version
-  if(version_ != 0x00000001){
-    if(err){
-      *err = "error version";
-    }
-    return false;
-  }
-  //check hash
-  if(hash_ != CalcHash()){
-    if(err){
-      *err = "error hash";
-    }
-    return false;
-  }
-  //check signature
-  if(!ambr::core::SignIsValidate(hash_.bytes().data(), hash_.bytes().size(), public_key_, sign_)){
-    if(err){
-      *err = "error signature";
-    }
-    return false;
-  }
-  return true;
+bool ambr::core::ReceiveUnit::ValidateWithoutSign(std::string *err) const{
+  return CheckVersionAndHash(CalcHash(), err);
 }
 
 int32_t ambr::core::ReceiveUnit::GetFeeSize(){
@@ -397,9 +493,9 @@ std::vector<uint8_t> ambr::core::VoteUnit::SerializeByte( ) const {
   return buf;
 }
 
-bool ambr::core::VoteUnit::DeSerializeByte(const std::vector<uint8_t> &buf,size_t* used_size){
+bool ambr::core::VoteUnit::DeSerializeByte(const uint8_t* buf, size_t size, size_t* used_size){
   ::ambr::protobuf::VoteUnit obj;
-  google::protobuf::io::CodedInputStream stream(buf.data(),buf.size());
+  google::protobuf::io::CodedInputStream stream(buf, size);
   if(obj.ParseFromCodedStream(&stream)){
     version_= (uint32_t)obj.version_();
     type_=((ambr::core::UnitType)obj.type_());
@@ -418,20 +514,20 @@ bool ambr::core::VoteUnit::DeSerializeByte(const std::vector<uint8_t> &buf,size_
   return false;
 }
 
+void ambr::core::VoteUnit::GetHashData(std::vector<uint8_t>* buf) const{
+  AppendHashData(buf, version_);
+  AppendHashData(buf, type_);
+  AppendHashData(buf, public_key_);
+  AppendHashData(buf, prev_unit_);
+  AppendHashData(buf, balance_);
+  AppendHashData(buf, validator_unit_hash_);
+  AppendHashData(buf, accept_);
+}
+
 ambr::core::UnitHash ambr::core::VoteUnit::CalcHash() const {
-  crypto::SHA256OneByOneHasher hasher;
-  hasher.init();
-  hasher.process(version_);
-  hasher.process(type_);
-  hasher.process(public_key_);
-  hasher.process(prev_unit_);
-  hasher.process(balance_);
-  hasher.process(validator_unit_hash_);
-  hasher.process(accept_);
-  hasher.finish();
-  UnitHash::ArrayType array;
-  hasher.get_hash_bytes(array.begin(), array.end());
-  return UnitHash(array);
+  std::vector<uint8_t> buf;
+  GetHashData(&buf);
+  return HashData(buf);
 }
 
 void ambr::core::VoteUnit::CalcHashAndFill(){
@@ -443,26 +539,8 @@ bool ambr::core::VoteUnit::SignatureAndFill(const ambr::core::PrivateKey &key){
   return true;
 }
 
-bool ambr::core::VoteUnit::Validate(std::string *err) const{
-  //check version
-  if(version_ != 0x00000001){
-    if(err){
-      *err = "error version";
-    }
-    return false;
-  }
-  //check hash
-  if(hash_ != CalcHash()){
-    if(err){
-      *err = "error hash";
-    }
-    return false;
-  }
-  if(!ambr::core::SignIsValidate(hash_.bytes().data(), hash_.bytes().size(), public_key_, sign_)){
-    *err = "error signature";
-    return false;
-  }
-  return true;
+bool ambr::core::VoteUnit::ValidateWithoutSign(std::string *err) const{
+  return CheckVersionAndHash(CalcHash(), err);
 }
 
 int32_t ambr::core::VoteUnit::GetFeeSize(){
@@ -470,7 +548,7 @@ int32_t ambr::core::VoteUnit::GetFeeSize(){
 }
 
 
-ambr::core::ValidatorUnit::ValidatorUnit():Unit(){
+ambr::core::ValidatorUnit::ValidatorUnit():Unit(),percent_(0),time_stamp_(0),nonce_(0){
 
 }
 
@@ -619,13 +697,13 @@ std::vector<uint8_t> ambr::core::ValidatorUnit::SerializeByte( ) const {
   return buf;
 }
 
-bool ambr::core::ValidatorUnit::DeSerializeByte(const std::vector<uint8_t> &buf,size_t* used_size){
+bool ambr::core::ValidatorUnit::DeSerializeByte(const uint8_t* buf, size_t size, size_t* used_size){
   ::ambr::protobuf::ValidatorUnit obj;
 
   check_list_.clear();
   vote_hash_list_.clear();
   vote_list_.clear();
-  google::protobuf::io::CodedInputStream stream(buf.data(),buf.size());
+  google::protobuf::io::CodedInputStream stream(buf, size);
   if(obj.ParseFromCodedStream(&stream)){
     version_= (uint32_t)obj.version_();
     type_=((ambr::core::UnitType)obj.type_());
@@ -695,30 +773,30 @@ bool ambr::core::ValidatorUnit::DeSerializeByte(const std::vector<uint8_t> &buf,
   return false;
 }
 
-ambr::core::UnitHash ambr::core::ValidatorUnit::CalcHash() const {
-  crypto::SHA256OneByOneHasher hasher;
-  hasher.init();
-  hasher.process(version_);
-  hasher.process(type_);
-  hasher.process(public_key_);
-  hasher.process(prev_unit_);
-  hasher.process(balance_);
+void ambr::core::ValidatorUnit::GetHashData(std::vector<uint8_t>* buf) const{
+  AppendHashData(buf, version_);
+  AppendHashData(buf, type_);
+  AppendHashData(buf, public_key_);
+  AppendHashData(buf, prev_unit_);
+  AppendHashData(buf, balance_);
   for(UnitHash hash:check_list_){
-    hasher.process(hash);
+    AppendHashData(buf, hash);
   }
   for(UnitHash hash:vote_hash_list_){
-    hasher.process(hash);
+    AppendHashData(buf, hash);
   }
   for(VoteUnit unit:vote_list_){
-    hasher.process(unit.hash());
+    AppendHashData(buf, unit.hash());
   }
-  hasher.process(percent_);
-  hasher.process(time_stamp_);
-  hasher.process(nonce_);
-  hasher.finish();
-  UnitHash::ArrayType array;
-  hasher.get_hash_bytes(array.begin(), array.end());
-  return UnitHash(array);
+  AppendHashData(buf, percent_);
+  AppendHashData(buf, time_stamp_);
+  AppendHashData(buf, nonce_);
+}
+
+ambr::core::UnitHash ambr::core::ValidatorUnit::CalcHash() const {
+  std::vector<uint8_t> buf;
+  GetHashData(&buf);
+  return HashData(buf);
 }
 
 void ambr::core::ValidatorUnit::CalcHashAndFill(){
@@ -730,28 +808,8 @@ bool ambr::core::ValidatorUnit::SignatureAndFill(const ambr::core::PrivateKey &k
   return true;
 }
 
-bool ambr::core::ValidatorUnit::Validate(std::string *err) const{
-  //check version
-  if(version_ != 0x00000001){
-    if(err){
-      *err = "error version";
-    }
-    return false;
-  }
-  //check hash
-  if(hash_ != CalcHash()){
-    if(err){
-      *err = "error hash";
-    }
-    return false;
-  }
-  if(!ambr::core::SignIsValidate(hash_.bytes().data(), hash_.bytes().size(), public_key_, sign_)){
-    if(err){
-        *err = "error signature";
-    }
-    return false;
-  }
-  return true;
+bool ambr::core::ValidatorUnit::ValidateWithoutSign(std::string *err) const{
+  return CheckVersionAndHash(CalcHash(), err);
 }
 
 int32_t ambr::core::ValidatorUnit::GetFeeSize(){
@@ -821,9 +879,9 @@ std::vector<uint8_t> ambr::core::EnterValidateSetUnit::SerializeByte( ) const {
   return buf;
 }
 
-bool ambr::core::EnterValidateSetUnit::DeSerializeByte(const std::vector<uint8_t> &buf,size_t* used_size){
+bool ambr::core::EnterValidateSetUnit::DeSerializeByte(const uint8_t* buf, size_t size, size_t* used_size){
   ::ambr::protobuf::EnterValidateSetUnit obj;
-  google::protobuf::io::CodedInputStream stream(buf.data(),buf.size());
+  google::protobuf::io::CodedInputStream stream(buf, size);
   if(obj.ParseFromCodedStream(&stream)){
     version_= (uint32_t)obj.version_();
     type_=((ambr::core::UnitType)obj.type_());
@@ -840,18 +898,18 @@ bool ambr::core::EnterValidateSetUnit::DeSerializeByte(const std::vector<uint8_t
   return false;
 }
 
+void ambr::core::EnterValidateSetUnit::GetHashData(std::vector<uint8_t>* buf) const{
+  AppendHashData(buf, version_);
+  AppendHashData(buf, type_);
+  AppendHashData(buf, public_key_);
+  AppendHashData(buf, prev_unit_);
+  AppendHashData(buf, balance_);
+}
+
 ambr::core::UnitHash ambr::core::EnterValidateSetUnit::CalcHash() const {
-  crypto::SHA256OneByOneHasher hasher;
-  hasher.init();
-  hasher.process(version_);
-  hasher.process(type_);
-  hasher.process(public_key_);
-  hasher.process(prev_unit_);
-  hasher.process(balance_);
-  hasher.finish();
-  UnitHash::ArrayType array;
-  hasher.get_hash_bytes(array.begin(), array.end());
-  return UnitHash(array);
+  std::vector<uint8_t> buf;
+  GetHashData(&buf);
+  return HashData(buf);
 }
 
 void ambr::core::EnterValidateSetUnit::CalcHashAndFill(){
@@ -863,26 +921,8 @@ bool ambr::core::EnterValidateSetUnit::SignatureAndFill(const ambr::core::Privat
   return true;
 }
 
-bool ambr::core::EnterValidateSetUnit::Validate(std::string *err) const{
-  //check version
-  if(version_ != 0x00000001){
-    if(err){
-      *err = "error version";
-    }
-    return false;
-  }
-  //check hash
-  if(hash_ != CalcHash()){
-    if(err){
-      *err = "error hash";
-    }
-    return false;
-  }
-  if(!ambr::core::SignIsValidate(hash_.bytes().data(), hash_.bytes().size(), public_key_, sign_)){
-    *err = "error signature";
-    return false;
-  }
-  return true;
+bool ambr::core::EnterValidateSetUnit::ValidateWithoutSign(std::string *err) const{
+  return CheckVersionAndHash(CalcHash(), err);
 }
 
 int32_t ambr::core::EnterValidateSetUnit::GetFeeSize(){
@@ -949,9 +989,9 @@ std::vector<uint8_t> ambr::core::LeaveValidateSetUnit::SerializeByte( ) const {
   return buf;
 }
 
-bool ambr::core::LeaveValidateSetUnit::DeSerializeByte(const std::vector<uint8_t> &buf,size_t* used_size){
+bool ambr::core::LeaveValidateSetUnit::DeSerializeByte(const uint8_t* buf, size_t size, size_t* used_size){
   ::ambr::protobuf::LeaveValidateSetUnit obj;
-  google::protobuf::io::CodedInputStream stream(buf.data(),buf.size());
+  google::protobuf::io::CodedInputStream stream(buf, size);
   if(obj.ParseFromCodedStream(&stream)){
     version_= (uint32_t)obj.version_();
     type_=((ambr::core::UnitType)obj.type_());
@@ -968,18 +1008,18 @@ bool ambr::core::LeaveValidateSetUnit::DeSerializeByte(const std::vector<uint8_t
   return false;
 }
 
+void ambr::core::LeaveValidateSetUnit::GetHashData(std::vector<uint8_t>* buf) const{
+  AppendHashData(buf, version_);
+  AppendHashData(buf, type_);
+  AppendHashData(buf, public_key_);
+  AppendHashData(buf, prev_unit_);
+  AppendHashData(buf, balance_);
+}
+
 ambr::core::UnitHash ambr::core::LeaveValidateSetUnit::CalcHash() const {
-  crypto::SHA256OneByOneHasher hasher;
-  hasher.init();
-  hasher.process(version_);
-  hasher.process(type_);
-  hasher.process(public_key_);
-  hasher.process(prev_unit_);
-  hasher.process(balance_);
-  hasher.finish();
-  UnitHash::ArrayType array;
-  hasher.get_hash_bytes(array.begin(), array.end());
-  return UnitHash(array);
+  std::vector<uint8_t> buf;
+  GetHashData(&buf);
+  return HashData(buf);
 }
 
 void ambr::core::LeaveValidateSetUnit::CalcHashAndFill(){
@@ -991,26 +1031,8 @@ bool ambr::core::LeaveValidateSetUnit::SignatureAndFill(const ambr::core::Privat
   return true;
 }
 
-bool ambr::core::LeaveValidateSetUnit::Validate(std::string *err) const{
-  //check version
-  if(version_ != 0x00000001){
-    if(err){
-      *err = "error version";
-    }
-    return false;
-  }
-  //check hash
-  if(hash_ != CalcHash()){
-    if(err){
-      *err = "error hash";
-    }
-    return false;
-  }
-  if(!ambr::core::SignIsValidate(hash_.bytes().data(), hash_.bytes().size(), public_key_, sign_)){
-    *err = "error signature";
-    return false;
-  }
-  return true;
+bool ambr::core::LeaveValidateSetUnit::ValidateWithoutSign(std::string *err) const{
+  return CheckVersionAndHash(CalcHash(), err);
 }
 
 
@@ -12,6 +12,7 @@
 #include <memory>
 #include <utils/uint.h>
 #include <core/key.h>
+#include <core/signature_cache.h>
 #include <boost/date_time.hpp>
 #include <vector>
 namespace ambr {
@@ -51,15 +52,32 @@ public:
   virtual std::string SerializeJson () const = 0;
   virtual bool DeSerializeJson(const std::string& json) = 0;
   virtual std::vector<uint8_t> SerializeByte() const = 0;
-  virtual bool DeSerializeByte(const std::vector<uint8_t>& buf, size_t* used_size) = 0;
+  virtual bool DeSerializeByte(const uint8_t* buf, size_t size, size_t* used_size) = 0;
+  //bytes are parsed in place, no copy of them is kept
+  bool DeSerializeByte(const std::vector<uint8_t>& buf, size_t* used_size = nullptr){
+    return DeSerializeByte(buf.data(), buf.size(), used_size);
+  }
 
   virtual void CalcHashAndFill() = 0;
   virtual bool SignatureAndFill(const PrivateKey& key) = 0;
-  virtual bool Validate(std::string* err) const = 0;
+  //check version, hash and signature
+  virtual bool Validate(std::string* err) const;
+  //check version and hash only
+  virtual bool ValidateWithoutSign(std::string* err) const = 0;
   virtual int32_t GetFeeSize();
+  //bytes of fields hashed into unit hash
+  virtual void GetHashData(std::vector<uint8_t>* buf) const = 0;
 public:
   static std::shared_ptr<Unit> CreateUnitByJson(const std::string& json);
   static std::shared_ptr<Unit> CreateUnitByByte(const std::vector<uint8_t>& buf);
+  //Validate units with signatures verified in batch, valid_list and err_list are in order of unit_list,
+  //return true if all units are valid
+  static bool ValidateBatch(const std::vector<const Unit*>& unit_list, std::vector<bool>* valid_list, std::vector<std::string>* err_list);
+  //hash units in order of unit_list, units with the same hash data length are hashed 4 or 8 at a time
+  //when cpu supports, hash of null unit is zero
+  static void CalcHashBatch(const std::vector<const Unit*>& unit_list, std::vector<UnitHash>* hash_list);
+  //signatures already verified by Validate and ValidateBatch
+  static SignatureCache& signature_cache();
 public:
   const uint32_t& version(){
     return version_;
@@ -119,6 +137,9 @@ protected:
   Signature sign_;
 protected:
   Unit();
+  //sha256 of hash data
+  static UnitHash HashData(const std::vector<uint8_t>& buf);
+  bool CheckVersionAndHash(const UnitHash& calc_hash, std::string* err) const;
 };
 
 class SendUnit:public Unit{
@@ -134,12 +155,14 @@ public:
   virtual std::string SerializeJson () const override;
   virtual bool DeSerializeJson(const std::string& json) override;
   virtual std::vector<uint8_t> SerializeByte() const override;
-  virtual bool DeSerializeByte(const std::vector<uint8_t>& buf, size_t* used_size = nullptr) override;
+  virtual bool DeSerializeByte(const uint8_t* buf, size_t size, size_t* used_size = nullptr) override;
+  using Unit::DeSerializeByte;
 
   UnitHash CalcHash() const;
+  virtual void GetHashData(std::vector<uint8_t>* buf) const override;
   virtual void CalcHashAndFill()override;
   virtual bool SignatureAndFill(const PrivateKey& key)override;
-  virtual bool Validate(std::string* err) const override;
+  virtual bool ValidateWithoutSign(std::string* err) const override;
 public:
   const PublicKey& dest(){
     return dest_;
@@ -174,12 +197,14 @@ public:
   virtual std::string SerializeJson () const override;
   virtual bool DeSerializeJson(const std::string& json) override;
   virtual std::vector<uint8_t> SerializeByte() const override;
-  virtual bool DeSerializeByte(const std::vector<uint8_t>& buf, size_t* used_size = nullptr) override;
+  virtual bool DeSerializeByte(const uint8_t* buf, size_t size, size_t* used_size = nullptr) override;
+  using Unit::DeSerializeByte;
 
   UnitHash CalcHash() const;
+  virtual void GetHashData(std::vector<uint8_t>* buf) const override;
   virtual void CalcHashAndFill() override;
   virtual bool SignatureAndFill(const PrivateKey& key) override;
-  virtual bool Validate(std::string* err) const override;
+  virtual bool ValidateWithoutSign(std::string* err) const override;
 public:
   virtual int32_t GetFeeSize();
 public:
@@ -200,12 +225,14 @@ public:
   virtual std::string SerializeJson () const override;
   virtual bool DeSerializeJson(const std::string& json) override;
   virtual std::vector<uint8_t> SerializeByte() const override;
-  virtual bool DeSerializeByte(const std::vector<uint8_t>& buf, size_t* used_size = nullptr) override;
+  virtual bool DeSerializeByte(const uint8_t* buf, size_t size, size_t* used_size = nullptr) override;
+  using Unit::DeSerializeByte;
 
   UnitHash CalcHash() const;
+  virtual void GetHashData(std::vector<uint8_t>* buf) const override;
   virtual void CalcHashAndFill() override;
   virtual bool SignatureAndFill(const PrivateKey& key) override;
-  virtual bool Validate(std::string* err) const override;
+  virtual bool ValidateWithoutSign(std::string* err) const override;
 public:
   bool operator ==(const VoteUnit& it) const {
       if(this->version_==it.version_ && this->type_==it.type_ && this->public_key_==it.public_key_ && this->prev_unit_==it.prev_unit_
@@ -240,12 +267,14 @@ public:
   virtual std::string SerializeJson () const override;
   virtual bool DeSerializeJson(const std::string& json) override;
   virtual std::vector<uint8_t> SerializeByte() const override;
-  virtual bool DeSerializeByte(const std::vector<uint8_t>& buf, size_t* used_size = nullptr) override;
+  virtual bool DeSerializeByte(const uint8_t* buf, size_t size, size_t* used_size = nullptr) override;
+  using Unit::DeSerializeByte;
 
   UnitHash CalcHash() const;
+  virtual void GetHashData(std::vector<uint8_t>* buf) const override;
   virtual void CalcHashAndFill() override;
   virtual bool SignatureAndFill(const PrivateKey& key) override;
-  virtual bool Validate(std::string* err) const override;
+  virtual bool ValidateWithoutSign(std::string* err) const override;
 public:
   void add_check_list(const UnitHash& hash){
     check_list_.push_back(hash);
@@ -322,12 +351,14 @@ public:
   virtual std::string SerializeJson () const override;
   virtual bool DeSerializeJson(const std::string& json) override;
   virtual std::vector<uint8_t> SerializeByte() const override;
-  virtual bool DeSerializeByte(const std::vector<uint8_t>& buf, size_t* used_size = nullptr) override;
+  virtual bool DeSerializeByte(const uint8_t* buf, size_t size, size_t* used_size = nullptr) override;
+  using Unit::DeSerializeByte;
 
   UnitHash CalcHash() const;
+  virtual void GetHashData(std::vector<uint8_t>* buf) const override;
   virtual void CalcHashAndFill() override;
   virtual bool SignatureAndFill(const PrivateKey& key) override;
-  virtual bool Validate(std::string* err) const override;
+  virtual bool ValidateWithoutSign(std::string* err) const override;
 public:
   virtual int32_t GetFeeSize();
 };
@@ -339,12 +370,14 @@ public:
   virtual std::string SerializeJson () const override;
   virtual bool DeSerializeJson(const std::string& json) override;
   virtual std::vector<uint8_t> SerializeByte() const override;
-  virtual bool DeSerializeByte(const std::vector<uint8_t>& buf, size_t* used_size = nullptr) override;
+  virtual bool DeSerializeByte(const uint8_t* buf, size_t size, size_t* used_size = nullptr) override;
+  using Unit::DeSerializeByte;
 
   UnitHash CalcHash() const;
+  virtual void GetHashData(std::vector<uint8_t>* buf) const override;
   virtual void CalcHashAndFill() override;
   virtual bool SignatureAndFill(const PrivateKey& key) override;
-  virtual bool Validate(std::string* err) const override;
+  virtual bool ValidateWithoutSign(std::string* err) const override;
 public:
   virtual int32_t GetFeeSize();
 };
@@ -8,6 +8,7 @@
 #include <assert.h>
 #include <string.h>
 #include <atomic>
+#include <vector>
 
 #if defined(__x86_64__) || defined(__amd64__) || defined(__i386__)
 #if defined(USE_ASM)
@@ -29,6 +30,16 @@ namespace sha256d64_avx2
 void Transform_8way(unsigned char* out, const unsigned char* in);
 }
 
+namespace sha256_sse41
+{
+void Transform_4way(uint32_t* s, const unsigned char* const* chunk, size_t blocks);
+}
+
+namespace sha256_avx2
+{
+void Transform_8way(uint32_t* s, const unsigned char* const* chunk, size_t blocks);
+}
+
 namespace sha256d64_shani
 {
 void Transform_2way(unsigned char* out, const unsigned char* in);
@@ -416,6 +427,7 @@ void TransformD64(unsigned char* out, const unsigned char* in)
 
 typedef void (*TransformType)(uint32_t*, const unsigned char*, size_t);
 typedef void (*TransformD64Type)(unsigned char*, const unsigned char*);
+typedef void (*TransformMultiType)(uint32_t*, const unsigned char* const*, size_t);
 
 template<TransformType tr>
 void TransformD64Wrapper(unsigned char* out, const unsigned char* in)
@@ -461,6 +473,8 @@ TransformD64Type TransformD64 = sha256::TransformD64;
 TransformD64Type TransformD64_2way = nullptr;
 TransformD64Type TransformD64_4way = nullptr;
 TransformD64Type TransformD64_8way = nullptr;
+TransformMultiType Transform_4way = nullptr;
+TransformMultiType Transform_8way = nullptr;
 
 bool SelfTest() {
     // Input state (equal to the initial SHA256 state)
@@ -544,6 +558,34 @@ bool SelfTest() {
         if (!std::equal(out, out + 256, result_d64)) return false;
     }
 
+    // Test Transform_4way, if available: lane i continues result[i] with two blocks.
+    if (Transform_4way) {
+        uint32_t state[32];
+        const unsigned char* chunk[4];
+        for (int i = 0; i < 4; ++i) {
+            std::copy(result[i], result[i] + 8, state + 8 * i);
+            chunk[i] = data + 1 + 64 * i;
+        }
+        Transform_4way(state, chunk, 2);
+        for (int i = 0; i < 4; ++i) {
+            if (!std::equal(state + 8 * i, state + 8 * i + 8, result[i + 2])) return false;
+        }
+    }
+
+    // Test Transform_8way, if available: lane i continues result[i] with one block.
+    if (Transform_8way) {
+        uint32_t state[64];
+        const unsigned char* chunk[8];
+        for (int i = 0; i < 8; ++i) {
+            std::copy(result[i], result[i] + 8, state + 8 * i);
+            chunk[i] = data + 1 + 64 * i;
+        }
+        Transform_8way(state, chunk, 1);
+        for (int i = 0; i < 8; ++i) {
+            if (!std::equal(state + 8 * i, state + 8 * i + 8, result[i + 1])) return false;
+        }
+    }
+
     return true;
 }
 
@@ -570,7 +612,7 @@ bool AVXEnabled()
 } // namespace
 
 
-std::string SHA256AutoDetect()
+std::string ambr::p2p::SHA256AutoDetect()
 {
     std::string ret = "standard";
 #if defined(USE_ASM) && (defined(__x86_64__) || defined(__amd64__) || defined(__i386__))
@@ -622,6 +664,7 @@ std::string SHA256AutoDetect()
 #endif
 #if defined(ENABLE_SSE41) && !defined(BUILD_BITCOIN_INTERNAL)
         TransformD64_4way = sha256d64_sse41::Transform_4way;
+        Transform_4way = sha256_sse41::Transform_4way;
         ret += ",sse41(4way)";
 #endif
     }
@@ -629,6 +672,7 @@ std::string SHA256AutoDetect()
 #if defined(ENABLE_AVX2) && !defined(BUILD_BITCOIN_INTERNAL)
     if (have_avx2 && have_avx && enabled_avx) {
         TransformD64_8way = sha256d64_avx2::Transform_8way;
+        Transform_8way = sha256_avx2::Transform_8way;
         ret += ",avx2(8way)";
     }
 #endif
@@ -728,3 +772,48 @@ void ambr::p2p::SHA256D64(unsigned char* out, const unsigned char* in, size_t bl
         --blocks;
     }
 }
+
+void ambr::p2p::SHA256Multi(unsigned char* output, const unsigned char* const* input, size_t len, size_t count)
+{
+    // Every message has the same padded size, so lanes stay in step.
+    size_t blocks = (len + 8) / 64 + 1;
+    unsigned char sizedesc[8];
+    WriteBE64(sizedesc, (uint64_t)len << 3);
+    size_t width = Transform_8way ? 8 : (Transform_4way ? 4 : 1);
+    std::vector<unsigned char> buf(width * blocks * 64);
+    while (count) {
+        size_t lanes = width;
+        if (count < lanes) lanes = count >= 4 && Transform_4way ? 4 : 1;
+        if (lanes == 1) {
+            CSHA256().Write(input[0], len).Finalize(output);
+            output += 32;
+            ++input;
+            --count;
+            continue;
+        }
+        uint32_t s[64];
+        const unsigned char* chunk[8];
+        for (size_t i = 0; i < lanes; ++i) {
+            unsigned char* padded = buf.data() + i * blocks * 64;
+            memcpy(padded, input[i], len);
+            padded[len] = 0x80;
+            memset(padded + len + 1, 0, blocks * 64 - len - 9);
+            memcpy(padded + blocks * 64 - 8, sizedesc, 8);
+            sha256::Initialize(s + 8 * i);
+            chunk[i] = padded;
+        }
+        if (lanes == 8) {
+            Transform_8way(s, chunk, blocks);
+        } else {
+            Transform_4way(s, chunk, blocks);
+        }
+        for (size_t i = 0; i < lanes; ++i) {
+            for (size_t j = 0; j < 8; ++j) {
+                WriteBE32(output + 4 * j, s[8 * i + j]);
+            }
+            output += 32;
+        }
+        input += lanes;
+        count -= lanes;
+    }
+}
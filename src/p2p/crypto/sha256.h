@@ -40,6 +40,13 @@ std::string SHA256AutoDetect();
  */
 void SHA256D64(unsigned char* output, const unsigned char* input, size_t blocks);
 
+/** Compute SHA256's of multiple messages with the same length,
+ *  4 or 8 at a time when the detected implementation supports it.
+ *  output:  pointer to a count*32 byte output buffer
+ *  input:   pointers to count messages of len bytes
+ */
+void SHA256Multi(unsigned char* output, const unsigned char* const* input, size_t len, size_t count);
+
     };
 };
 
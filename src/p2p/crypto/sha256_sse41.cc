@@ -314,4 +314,102 @@ void Transform_4way(unsigned char* out, const unsigned char* in)
 
 }
 
+namespace sha256_sse41 {
+namespace {
+
+using namespace sha256d64_sse41;
+
+const uint32_t round_k[64] = {
+    0x428a2f98ul, 0x71374491ul, 0xb5c0fbcful, 0xe9b5dba5ul, 0x3956c25bul, 0x59f111f1ul, 0x923f82a4ul, 0xab1c5ed5ul,
+    0xd807aa98ul, 0x12835b01ul, 0x243185beul, 0x550c7dc3ul, 0x72be5d74ul, 0x80deb1feul, 0x9bdc06a7ul, 0xc19bf174ul,
+    0xe49b69c1ul, 0xefbe4786ul, 0x0fc19dc6ul, 0x240ca1ccul, 0x2de92c6ful, 0x4a7484aaul, 0x5cb0a9dcul, 0x76f988daul,
+    0x983e5152ul, 0xa831c66dul, 0xb00327c8ul, 0xbf597fc7ul, 0xc6e00bf3ul, 0xd5a79147ul, 0x06ca6351ul, 0x14292967ul,
+    0x27b70a85ul, 0x2e1b2138ul, 0x4d2c6dfcul, 0x53380d13ul, 0x650a7354ul, 0x766a0abbul, 0x81c2c92eul, 0x92722c85ul,
+    0xa2bfe8a1ul, 0xa81a664bul, 0xc24b8b70ul, 0xc76c51a3ul, 0xd192e819ul, 0xd6990624ul, 0xf40e3585ul, 0x106aa070ul,
+    0x19a4c116ul, 0x1e376c08ul, 0x2748774cul, 0x34b0bcb5ul, 0x391c0cb3ul, 0x4ed8aa4aul, 0x5b9cca4ful, 0x682e6ff3ul,
+    0x748f82eeul, 0x78a5636ful, 0x84c87814ul, 0x8cc70208ul, 0x90befffaul, 0xa4506cebul, 0xbef9a3f7ul, 0xc67178f2ul
+};
+
+__m128i inline ReadLanes(const unsigned char* const* chunk, int offset) {
+    return _mm_set_epi32(ReadBE32(chunk[0] + offset), ReadBE32(chunk[1] + offset), ReadBE32(chunk[2] + offset), ReadBE32(chunk[3] + offset));
+}
+
+__m128i inline LoadState(const uint32_t* s, int i) {
+    return _mm_set_epi32(s[0 + i], s[8 + i], s[16 + i], s[24 + i]);
+}
+
+void inline StoreState(uint32_t* s, int i, __m128i v) {
+    s[0 + i] = _mm_extract_epi32(v, 3);
+    s[8 + i] = _mm_extract_epi32(v, 2);
+    s[16 + i] = _mm_extract_epi32(v, 1);
+    s[24 + i] = _mm_extract_epi32(v, 0);
+}
+
+/** Message schedule word i, w holds the last 16 words. */
+__m128i inline __attribute__((always_inline)) Schedule(__m128i* w, int i)
+{
+    if (i < 16) return w[i];
+    return Inc(w[i & 15], sigma1(w[(i - 2) & 15]), w[(i - 7) & 15], sigma0(w[(i - 15) & 15]));
+}
+
+}
+
+/** SHA-256 transform of 4 independent messages with the same number of blocks.
+ *  s:      4 consecutive 8 word states
+ *  chunk:  4 pointers to blocks*64 bytes of input
+ */
+void Transform_4way(uint32_t* s, const unsigned char* const* chunk, size_t blocks)
+{
+    __m128i a = LoadState(s, 0);
+    __m128i b = LoadState(s, 1);
+    __m128i c = LoadState(s, 2);
+    __m128i d = LoadState(s, 3);
+    __m128i e = LoadState(s, 4);
+    __m128i f = LoadState(s, 5);
+    __m128i g = LoadState(s, 6);
+    __m128i h = LoadState(s, 7);
+    const unsigned char* in[4] = {chunk[0], chunk[1], chunk[2], chunk[3]};
+
+    while (blocks--) {
+        __m128i a0 = a, b0 = b, c0 = c, d0 = d, e0 = e, f0 = f, g0 = g, h0 = h;
+        __m128i w[16];
+        for (int i = 0; i < 16; ++i) w[i] = ReadLanes(in, 4 * i);
+
+        for (int i = 0; i < 64; i += 8) {
+            Round(a, b, c, d, e, f, g, h, Add(K(round_k[i + 0]), Schedule(w, i + 0)));
+            Round(h, a, b, c, d, e, f, g, Add(K(round_k[i + 1]), Schedule(w, i + 1)));
+            Round(g, h, a, b, c, d, e, f, Add(K(round_k[i + 2]), Schedule(w, i + 2)));
+            Round(f, g, h, a, b, c, d, e, Add(K(round_k[i + 3]), Schedule(w, i + 3)));
+            Round(e, f, g, h, a, b, c, d, Add(K(round_k[i + 4]), Schedule(w, i + 4)));
+            Round(d, e, f, g, h, a, b, c, Add(K(round_k[i + 5]), Schedule(w, i + 5)));
+            Round(c, d, e, f, g, h, a, b, Add(K(round_k[i + 6]), Schedule(w, i + 6)));
+            Round(b, c, d, e, f, g, h, a, Add(K(round_k[i + 7]), Schedule(w, i + 7)));
+        }
+
+        a = Add(a, a0);
+        b = Add(b, b0);
+        c = Add(c, c0);
+        d = Add(d, d0);
+        e = Add(e, e0);
+        f = Add(f, f0);
+        g = Add(g, g0);
+        h = Add(h, h0);
+        in[0] += 64;
+        in[1] += 64;
+        in[2] += 64;
+        in[3] += 64;
+    }
+
+    StoreState(s, 0, a);
+    StoreState(s, 1, b);
+    StoreState(s, 2, c);
+    StoreState(s, 3, d);
+    StoreState(s, 4, e);
+    StoreState(s, 5, f);
+    StoreState(s, 6, g);
+    StoreState(s, 7, h);
+}
+
+}
+
 #endif
@@ -14,7 +14,6 @@
 #include <signal.h>
 #endif
 
-CCriticalSection cs_vNodes;
 std::unique_ptr<CConnman> g_connman;
 PeerLogicValidation *peerLogic;   //TODO: protoype  std::unique_ptr<PeerLogicValidation>
 static CScheduler scheduler;
@@ -42,17 +41,49 @@ static void HandleSIGTERM(int)
 }
 #endif
 
-void ambr::p2p::SendMessage(CNode* p_node, CSerializedNetMsg&& msg){
+bool ambr::p2p::SendMessage(CNode* p_node, CSerializedNetMsg&& msg){
      assert(g_connman);
-     g_connman->PushMessage(p_node, std::forward<CSerializedNetMsg>(msg));
+     return g_connman->PushMessage(p_node, std::forward<CSerializedNetMsg>(msg));
+}
+
+bool ambr::p2p::SendMessage(CNode* p_node, CSerializedNetMsg&& msg, SendPriority priority){
+     assert(g_connman);
+     return g_connman->PushMessage(p_node, std::forward<CSerializedNetMsg>(msg), priority);
+}
+
+bool ambr::p2p::SendMessage(CNode* p_node, const std::string& command, std::vector<unsigned char>&& prefix, const CSendBuffer& data){
+     assert(g_connman);
+     CSharedNetMsg shared = g_connman->MakeSharedMessage(command, std::move(prefix), data);
+     return g_connman->PushMessage(p_node, shared, GetSendPriority(command));
 }
 
 void ambr::p2p::BroadcastMessage(CSerializedNetMsg&& msg){
     assert(g_connman);
-    LOCK(cs_vNodes);
-    for (CNode* pnode : g_connman->GetNodes()) {
-        SendMessage(pnode, std::forward<CSerializedNetMsg>(msg));
-    }
+    // serialized and checksummed once, every peer queues the same buffers
+    CSharedNetMsg shared = g_connman->MakeSharedMessage(std::move(msg));
+    SendPriority priority = GetSendPriority(shared.command);
+    g_connman->ForEachNode([&shared, priority](CNode* pnode){
+        g_connman->PushMessage(pnode, shared, priority);
+    });
+}
+
+SendQueueStatsArray ambr::p2p::GetSendQueueStats(){
+    assert(g_connman);
+    return g_connman->GetSendQueueStats();
+}
+
+void ambr::p2p::PushInventory(const CInv& inv){
+    assert(g_connman);
+    g_connman->ForEachNode([&inv](CNode* pnode){
+        pnode->PushInventory(inv);
+    });
+}
+
+void ambr::p2p::PauseReceive(CNode* p_node, bool pause){
+    assert(g_connman);
+    LOCK(p_node->cs_vProcessMsg);
+    p_node->fPauseIngest = pause;
+    p_node->fPauseRecv = pause || p_node->nProcessQueueSize > g_connman->GetReceiveFloodSize();
 }
 
 void ambr::p2p::RemoveNode(CNode* pNode){
@@ -9,8 +9,18 @@ namespace ambr{
     bool init(CConnman::Options&&);
 
     // p2p interface
-    void SendMessage(CNode* p_node, CSerializedNetMsg&& msg);
+    //false if send queue of the message's class is full and it's dropped
+    bool SendMessage(CNode* p_node, CSerializedNetMsg&& msg);
+    bool SendMessage(CNode* p_node, CSerializedNetMsg&& msg, SendPriority priority);
+    //send prefix followed by data shared with other senders, data is not copied
+    bool SendMessage(CNode* p_node, const std::string& command, std::vector<unsigned char>&& prefix, const CSendBuffer& data);
     void BroadcastMessage(CSerializedNetMsg&& msg);
+    //send queue stats of all nodes, by priority class
+    SendQueueStatsArray GetSendQueueStats();
+    //announce inventory to every node which doesn't know it
+    void PushInventory(const CInv& inv);
+    //stop or resume reading from node, for consumers of it's messages which are backed up
+    void PauseReceive(CNode* p_node, bool pause);
     void RemoveNode(CNode* pNode);
   };
 };
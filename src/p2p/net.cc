@@ -64,6 +64,15 @@
 
 #define BUFFER_SIZE 0x10000000
 
+/** Buffers sent by one sendmsg() call. */
+static const int MAX_SEND_IOV = 64;
+
+/** Bytes kept on the wire ahead of the send queues, a later urgent message waits behind no more than this. */
+static const size_t MAX_SEND_WIRE_BYTES = 64 * 1024;
+
+/** Reads of one edge triggered socket per pass of the socket handler. */
+static const int MAX_RECV_PER_PASS = 4;
+
 /** Used to pass flags to the Bind() function */
 enum BindFlags {
     BF_NONE         = 0,
@@ -710,6 +719,7 @@ void CNode::copyStats(CNodeStats &stats)
     {
         LOCK(cs_vSend);
         X(mapSendBytesPerMsgCmd);
+        X(sendQueueStats);
         X(nSendBytes);
     }
     {
@@ -876,35 +886,81 @@ const uint256& CNetMessage::GetMessageHash() const
 }
 
 // requires LOCK(cs_vSend)
+void CConnman::FillSendWire(CNode *pnode) const
+{
+    int64_t nNow = GetTimeMicros();
+    for (int i = 0; i < SEND_PRIORITY_COUNT; i++) {
+        std::deque<CNode::CQueuedNetMsg>& queue = pnode->vSendQueue[i];
+        CSendQueueStats& stats = pnode->sendQueueStats[i];
+        while (!queue.empty() && (pnode->vSendMsg.empty() || pnode->nSendWireSize < MAX_SEND_WIRE_BYTES)) {
+            const CNode::CQueuedNetMsg& queued = queue.front();
+            size_t nTotalSize = queued.msg.DataSize() + CMessageHeader::HEADER_SIZE;
+            pnode->vSendMsg.push_back(queued.msg.header);
+            if (queued.msg.prefix && !queued.msg.prefix->empty())
+                pnode->vSendMsg.push_back(queued.msg.prefix);
+            if (queued.msg.data && !queued.msg.data->empty())
+                pnode->vSendMsg.push_back(queued.msg.data);
+            pnode->nSendWireSize += nTotalSize;
+            int64_t nQueueTime = nNow - queued.nTimeQueued;
+            stats.nQueuedBytes -= nTotalSize;
+            stats.nTaken++;
+            stats.nQueueTimeTotal += nQueueTime;
+            stats.nQueueTimeMax = std::max(stats.nQueueTimeMax, nQueueTime);
+            queue.pop_front();
+        }
+    }
+}
+
 size_t CConnman::SocketSendData(CNode *pnode) const
 {
     LOCK(pnode->cs_hSocket);
-    auto it = pnode->vSendMsg.begin();
     size_t nSentSize = 0;
 
-    while (it != pnode->vSendMsg.end()) {
-        const auto &data = *it;
-        assert(data.size() > pnode->nSendOffset);
-        int nBytes = 0;
-        {
-            if (pnode->hSocket == INVALID_SOCKET)
-                break;
-            LOG(INFO)<<"Sending message, size:"<<data.size() - pnode->nSendOffset;
-            nBytes = send(pnode->hSocket, reinterpret_cast<const char*>(data.data()) + pnode->nSendOffset, data.size() - pnode->nSendOffset, MSG_DONTWAIT|MSG_NOSIGNAL);
-            LOG(INFO)<<"Sended, size:"<<nBytes;
-        }
+    while (true) {
+        // messages of higher classes go to the wire first
+        FillSendWire(pnode);
+        if (pnode->vSendMsg.empty() || pnode->hSocket == INVALID_SOCKET)
+            break;
+        // headers and payloads queued are sent by one call
+        struct iovec iov[MAX_SEND_IOV];
+        int nIov = 0;
+        size_t nWant = 0;
+        size_t nOffset = pnode->nSendOffset;
+        for (auto it = pnode->vSendMsg.begin(); it != pnode->vSendMsg.end() && nIov < MAX_SEND_IOV; ++it) {
+            const auto &data = **it;
+            assert(data.size() > nOffset);
+            iov[nIov].iov_base = const_cast<unsigned char*>(data.data()) + nOffset;
+            iov[nIov].iov_len = data.size() - nOffset;
+            nWant += iov[nIov].iov_len;
+            nOffset = 0;
+            nIov++;
+        }
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = nIov;
+        int nBytes = sendmsg(pnode->hSocket, &msg, MSG_DONTWAIT|MSG_NOSIGNAL);
         if (nBytes > 0) {
             pnode->nLastSend = GetSystemTimeInSeconds();
             pnode->nSendBytes += nBytes;
-            pnode->nSendOffset += nBytes;
             nSentSize += nBytes;
-            if (pnode->nSendOffset == data.size()) {
+            size_t nLeft = nBytes;
+            while (nLeft) {
+                const auto &data = *pnode->vSendMsg.front();
+                size_t nRemain = data.size() - pnode->nSendOffset;
+                if (nLeft < nRemain) {
+                    pnode->nSendOffset += nLeft;
+                    break;
+                }
+                nLeft -= nRemain;
                 pnode->nSendOffset = 0;
                 pnode->nSendSize -= data.size();
-                pnode->fPauseSend = pnode->nSendSize > nSendBufferMaxSize;
-                it++;
-            } else {
-                // could not send full message; stop sending more
+                pnode->nSendWireSize -= data.size();
+                pnode->vSendMsg.pop_front();
+            }
+            pnode->fPauseSend = pnode->nSendSize > nSendBufferMaxSize;
+            if ((size_t)nBytes < nWant) {
+                // could not send all; stop sending more
                 break;
             }
         } else {
@@ -915,18 +971,18 @@ size_t CConnman::SocketSendData(CNode *pnode) const
                 {
                     LogPrintf("socket send error %s\n", NetworkErrorString(nErr));
                     pnode->CloseSocketDisconnect();
-                } std::cout << "socket send error:" << NetworkErrorString(nErr) << std::endl;
+                }
             }
-            // couldn't send anything at all
-            //break;
+            // couldn't send anything at all, rest is sent by ThreadSocketHandler
+            break;
         }
     }
 
-    if (it == pnode->vSendMsg.end()) {
+    if (pnode->vSendMsg.empty() && pnode->hSocket != INVALID_SOCKET) {
         assert(pnode->nSendOffset == 0);
+        assert(pnode->nSendWireSize == 0);
         assert(pnode->nSendSize == 0);
     }
-    pnode->vSendMsg.erase(pnode->vSendMsg.begin(), it);
     return nSentSize;
 }
 
@@ -1106,7 +1162,7 @@ void CConnman::AcceptConnection(const ListenSocket& hListenSocket) {
         return;
     }
 
-    if (!IsSelectableSocket(hSocket))
+    if (!socketEvents->IsSelectable(hSocket))
     {
         LogPrintf("connection from %s dropped: non-selectable socket\n", addr.ToString());
         CloseSocket(hSocket);
@@ -1147,15 +1203,72 @@ void CConnman::AcceptConnection(const ListenSocket& hListenSocket) {
 
    // LogPrint(BCLog::NET, "connection from %s accepted\n", addr.ToString());
 
+    socketEvents->Add(hSocket, pnode);
     {
         LOCK(cs_vNodes);
         vNodes.push_back(pnode);
     }
 }
 
+int CConnman::SocketRecvData(CNode *pnode)
+{
+    // typical socket buffer is 8K-64K
+    int nBytes = 0;
+    {
+        LOCK(pnode->cs_hSocket);
+        if (pnode->hSocket == INVALID_SOCKET)
+            return -1;
+        nBytes = recv(pnode->hSocket, buffer_, BUFFER_SIZE, MSG_DONTWAIT);
+    }
+    if (nBytes > 0)
+    {
+        bool notify = false;
+        if (!pnode->ReceiveMsgBytes(buffer_, nBytes, notify))
+            pnode->CloseSocketDisconnect();
+        RecordBytesRecv(nBytes);
+        if (notify) {
+            size_t nSizeAdded = 0;
+            auto it(pnode->vRecvMsg.begin());
+            for (; it != pnode->vRecvMsg.end(); ++it) {
+                if (!it->complete())
+                    break;
+                nSizeAdded += it->vRecv.size() + CMessageHeader::HEADER_SIZE;
+            }
+            {
+                LOCK(pnode->cs_vProcessMsg);
+                pnode->vProcessMsg.splice(pnode->vProcessMsg.end(), pnode->vRecvMsg, pnode->vRecvMsg.begin(), it);
+                pnode->nProcessQueueSize += nSizeAdded;
+                pnode->fPauseRecv = pnode->nProcessQueueSize > nReceiveFloodSize || pnode->fPauseIngest;
+            }
+            WakeMessageHandler(pnode);
+        }
+    }
+    else if (nBytes == 0)
+    {
+        // socket closed gracefully
+        if (!pnode->fDisconnect) {
+            LogPrint(BCLog::NET, "socket closed\n");
+        }
+        pnode->CloseSocketDisconnect();
+    }
+    else if (nBytes < 0)
+    {
+        // error
+        int nErr = WSAGetLastError();
+        if (nErr != WSAEWOULDBLOCK && nErr != WSAEMSGSIZE && nErr != WSAEINTR && nErr != WSAEINPROGRESS)
+        {
+            if (!pnode->fDisconnect)
+                LogPrintf("socket recv error %s\n", NetworkErrorString(nErr));
+            pnode->CloseSocketDisconnect();
+        }
+    }
+    return nBytes;
+}
+
 void CConnman::ThreadSocketHandler()
 {
     unsigned int nPrevNodeCount = 0;
+    bool fMoreRecv = false;
 
     while (!interruptNet)
     {
@@ -1222,97 +1335,59 @@ void CConnman::ThreadSocketHandler()
         //
         // Find which sockets have data to receive
         //
-        struct timeval timeout;
-        timeout.tv_sec  = 0;
-        timeout.tv_usec = 50000; // frequency to poll pnode->vSend
-
-        fd_set fdsetRecv;
-        fd_set fdsetSend;
-        fd_set fdsetError;
-        FD_ZERO(&fdsetRecv);
-        FD_ZERO(&fdsetSend);
-        FD_ZERO(&fdsetError);
-        SOCKET hSocketMax = 0;
-        bool have_fds = false;
-
-        for (const ListenSocket& hListenSocket : vhListenSocket) {
-            FD_SET(hListenSocket.socket, &fdsetRecv);
-            hSocketMax = std::max(hSocketMax, hListenSocket.socket);
-            have_fds = true;
-        }
-
+        // Hand off all complete messages to the processor, to be handled without
+        // blocking here. A paused node isn't read until the processor has room.
+        // select() is given all sockets on each pass, epoll only returns the
+        // ready ones.
+        CSocketEvents::SocketList vSelect;
+        if (socketEvents->GetMode() == SOCKETEVENTS_SELECT)
         {
+            for (const ListenSocket& hListenSocket : vhListenSocket)
+                vSelect.emplace_back(hListenSocket.socket, (void*)&hListenSocket);
+
             LOCK(cs_vNodes);
             for (CNode* pnode : vNodes)
             {
-                // Implement the following logic:
-                // * If there is data to send, select() for sending data. As this only
-                //   happens when optimistic write failed, we choose to first drain the
-                //   write buffer in this case before receiving more. This avoids
-                //   needlessly queueing received data, if the remote peer is not themselves
-                //   receiving data. This means properly utilizing TCP flow control signalling.
-                // * Otherwise, if there is space left in the receive buffer, select() for
-                //   receiving data.
-                // * Hand off all complete messages to the processor, to be handled without
-                //   blocking here.
-
-                bool select_recv = !pnode->fPauseRecv;
-                /*bool select_send = true;
-                {
-                    LOCK(pnode->cs_vSend);
-                    select_send = !pnode->vSendMsg.empty();
-                }*/
-
+                if (pnode->fPauseRecv)
+                    continue;
                 LOCK(pnode->cs_hSocket);
                 if (pnode->hSocket == INVALID_SOCKET)
                     continue;
-
-                FD_SET(pnode->hSocket, &fdsetError);
-                hSocketMax = std::max(hSocketMax, pnode->hSocket);
-                have_fds = true;
-
-                /*if (select_send) {
-                    FD_SET(pnode->hSocket, &fdsetSend);
-                    continue;
-                }*/
-                if (select_recv) {
-                    FD_SET(pnode->hSocket, &fdsetRecv);
-                }
+                vSelect.emplace_back(pnode->hSocket, pnode);
             }
         }
 
-        int nSelect = select(have_fds ? hSocketMax + 1 : 0,
-                             &fdsetRecv, &fdsetSend, &fdsetError, &timeout);
-
+        // frequency to poll pnode->vSend, don't wait while edge triggered sockets are not drained
+        int nTimeoutMs = fMoreRecv ? 0 : 50;
+        fMoreRecv = false;
+        std::vector<void*> vReady;
+        if (!socketEvents->Wait(vSelect, nTimeoutMs, vReady))
+        {
+            int nErr = WSAGetLastError();
+            LogPrintf("socket %s error %s\n", GetSocketEventsModeName(socketEvents->GetMode()), NetworkErrorString(nErr));
+            for (const auto& item : vSelect)
+                vReady.push_back(item.second);
+            std::this_thread::sleep_for(std::chrono::milliseconds(nTimeoutMs));
+        }
 
         if (interruptNet)
             return;
 
-        if (nSelect == SOCKET_ERROR)
-        {
-            if (have_fds)
-            {
-                int nErr = WSAGetLastError();
-                LogPrintf("socket select error %s\n", NetworkErrorString(nErr));
-                for (unsigned int i = 0; i <= hSocketMax; i++)
-                    FD_SET(i, &fdsetRecv);
-            }
-            FD_ZERO(&fdsetSend);
-            FD_ZERO(&fdsetError);
-            std::this_thread::sleep_for(std::chrono::milliseconds(timeout.tv_usec/1000));
-           // if (!interruptNet.sleep_for(std::chrono::milliseconds(timeout.tv_usec/1000)))
-            //    return;
-        }
-
         //
         // Accept new connections
         //
-        for (const ListenSocket& hListenSocket : vhListenSocket)
+        for (void* ptr : vReady)
         {
-            if (hListenSocket.socket != INVALID_SOCKET && FD_ISSET(hListenSocket.socket, &fdsetRecv))
+            const ListenSocket* pListenSocket = nullptr;
+            for (const ListenSocket& hListenSocket : vhListenSocket)
             {
-                AcceptConnection(hListenSocket);
+                if (ptr == &hListenSocket)
+                    pListenSocket = &hListenSocket;
             }
+            if (!pListenSocket)
+                static_cast<CNode*>(ptr)->fHasRecvData = true;
+            else if (pListenSocket->socket != INVALID_SOCKET)
+                AcceptConnection(*pListenSocket);
         }
 
         //
@@ -1333,78 +1408,31 @@ void CConnman::ThreadSocketHandler()
             //
             // Receive
             //
-            bool recvSet = false;
-            bool sendSet = false;
-            bool errorSet = false;
+            if (pnode->fHasRecvData)
             {
-                LOCK(pnode->cs_hSocket);
-                if (pnode->hSocket == INVALID_SOCKET)
-                    continue;
-                recvSet = FD_ISSET(pnode->hSocket, &fdsetRecv);
-                sendSet = FD_ISSET(pnode->hSocket, &fdsetSend);
-                errorSet = FD_ISSET(pnode->hSocket, &fdsetError);
-            }
-            if (recvSet || errorSet)
-            {
-                // typical socket buffer is 8K-64K
-                memset(buffer_, 0, BUFFER_SIZE);
-                int nBytes = 0;
-                {
-                    LOCK(pnode->cs_hSocket);
-                    if (pnode->hSocket == INVALID_SOCKET)
-                        continue;
-                    nBytes = recv(pnode->hSocket, buffer_, BUFFER_SIZE, MSG_DONTWAIT);
-                }
-                if (nBytes > 0)
-                {
-                    bool notify = false;
-                    if (!pnode->ReceiveMsgBytes(buffer_, nBytes, notify))
-                        pnode->CloseSocketDisconnect();
-                    RecordBytesRecv(nBytes);
-                    if (notify) {
-                        size_t nSizeAdded = 0;
-                        auto it(pnode->vRecvMsg.begin());
-                        for (; it != pnode->vRecvMsg.end(); ++it) {
-                            if (!it->complete())
-                                break;
-                            nSizeAdded += it->vRecv.size() + CMessageHeader::HEADER_SIZE;
-                        }
-                        {
-                            LOCK(pnode->cs_vProcessMsg);
-                            pnode->vProcessMsg.splice(pnode->vProcessMsg.end(), pnode->vRecvMsg, pnode->vRecvMsg.begin(), it);
-                            pnode->nProcessQueueSize += nSizeAdded;
-                            pnode->fPauseRecv = pnode->nProcessQueueSize > nReceiveFloodSize;
-                        }
-                        WakeMessageHandler();
-                    }
-                }
-                else if (nBytes == 0)
+                if (socketEvents->GetMode() == SOCKETEVENTS_SELECT)
                 {
-                    // socket closed gracefully
-                    if (!pnode->fDisconnect) {
-                        LogPrint(BCLog::NET, "socket closed\n");
-                    }
-                    pnode->CloseSocketDisconnect();
+                    pnode->fHasRecvData = false;
+                    SocketRecvData(pnode);
                 }
-                else if (nBytes < 0)
+                else if (!pnode->fPauseRecv)
                 {
-                    // error
-                    int nErr = WSAGetLastError();
-                    if (nErr != WSAEWOULDBLOCK && nErr != WSAEMSGSIZE && nErr != WSAEINTR && nErr != WSAEINPROGRESS)
+                    // edge triggered: the socket is reported again only after it would block,
+                    // a node with more data is continued on next pass so others aren't starved
+                    for (int i = 0; i < MAX_RECV_PER_PASS && pnode->fHasRecvData && !pnode->fPauseRecv; i++)
                     {
-                        if (!pnode->fDisconnect)
-                            LogPrintf("socket recv error %s\n", NetworkErrorString(nErr));
-                        pnode->CloseSocketDisconnect();
+                        if (SocketRecvData(pnode) <= 0)
+                            pnode->fHasRecvData = false;
                     }
+                    if (pnode->fHasRecvData && !pnode->fPauseRecv)
+                        fMoreRecv = true;
                 }
             }
 
             //
             // Send
             //
-            //if (sendSet)
             //always send, if pause ,resume later
-            (void)sendSet;
             {
                 LOCK(pnode->cs_vSend);
                 size_t nBytes =
@@ -1461,9 +1489,27 @@ void CConnman::WakeMessageHandler()
 {
     {
         std::lock_guard<std::mutex> lock(mutexMsgProc);
-        fMsgProcWake = true;
+        std::fill(vMsgProcWake.begin(), vMsgProcWake.end(), true);
+    }
+    condMsgProc.notify_all();
+}
+
+void CConnman::WakeMessageHandler(const CNode* pnode)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutexMsgProc);
+        if (vMsgProcWake.empty())
+            return;
+        vMsgProcWake[GetMessageHandlerThread(pnode)] = true;
     }
-    condMsgProc.notify_one();
+    // threads share condMsgProc, the others go back to wait
+    condMsgProc.notify_all();
+}
+
+unsigned int CConnman::GetMessageHandlerThread(const CNode* pnode) const
+{
+    // a peer always belongs to the same thread, so its messages are processed in order
+    return pnode->GetId() % nMessageHandlerThreads;
 }
 
 
@@ -2019,21 +2065,27 @@ void CConnman::OpenNetworkConnection(const CAddress& addrConnect, bool fCountFai
 
     pnode->fClient = true;
     m_msgproc->InitializeNode(pnode);
+    {
+        LOCK(pnode->cs_hSocket);
+        socketEvents->Add(pnode->hSocket, pnode);
+    }
     {
         LOCK(cs_vNodes);
         vNodes.push_back(pnode);
     }
 }
 
-void CConnman::ThreadMessageHandler()
+void CConnman::ThreadMessageHandler(unsigned int nThread)
 {
     while (!flagInterruptMsgProc)
     {
         std::vector<CNode*> vNodesCopy;
         {
             LOCK(cs_vNodes);
-            vNodesCopy = vNodes;
-            for (CNode* pnode : vNodesCopy) {
+            for (CNode* pnode : vNodes) {
+                if (GetMessageHandlerThread(pnode) != nThread)
+                    continue;
+                vNodesCopy.push_back(pnode);
                 pnode->AddRef();
             }
         }
@@ -2068,9 +2120,9 @@ void CConnman::ThreadMessageHandler()
 
         std::unique_lock<std::mutex> lock(mutexMsgProc);
         if (!fMoreWork) {
-            condMsgProc.wait_until(lock, std::chrono::steady_clock::now() + std::chrono::milliseconds(100), [this] { return fMsgProcWake; });
+            condMsgProc.wait_until(lock, std::chrono::steady_clock::now() + std::chrono::milliseconds(100), [this, nThread] { return vMsgProcWake[nThread] || flagInterruptMsgProc; });
         }
-        fMsgProcWake = false;
+        vMsgProcWake[nThread] = false;
     }
 }
 
@@ -2283,10 +2335,16 @@ bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
         nMaxOutboundCycleStartTime = 0;
     }
 
+    socketEvents.reset(new CSocketEvents(connOptions.socketEventsMode));
+    socketEvents->Init();
+    LogPrintf("Using %s for socket events\n", GetSocketEventsModeName(socketEvents->GetMode()));
+
     if (fListen && !InitBinds(connOptions.vBinds, connOptions.vWhiteBinds)) {
 
         return false;
     }
+    for (const ListenSocket& hListenSocket : vhListenSocket)
+        socketEvents->Add(hListenSocket.socket, (void*)&hListenSocket, false);
 
     for (const auto& strDest : connOptions.vSeedNodes) {
         AddOneShot(strDest);
@@ -2346,7 +2404,7 @@ bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
 
     {
         std::unique_lock<std::mutex> lock(mutexMsgProc);
-        fMsgProcWake = false;
+        vMsgProcWake.assign(nMessageHandlerThreads, false);
     }
 
 
@@ -2366,8 +2424,9 @@ bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
         threadOpenConnections = std::thread(&TraceThread<std::function<void()> >, "opencon", std::function<void()>(std::bind(&CConnman::ThreadOpenConnections, this, connOptions.m_specified_outgoing)));
 
 
-    // Process messages
-   threadMessageHandler = std::thread(&TraceThread<std::function<void()> >, "msghand", std::function<void()>(std::bind(&CConnman::ThreadMessageHandler, this)));
+    // Process messages, peers are spread over the threads
+    for (unsigned int i = 0; i < nMessageHandlerThreads; i++)
+        vThreadMessageHandler.push_back(std::thread(&TraceThread<std::function<void()> >, "msghand", std::function<void()>(std::bind(&CConnman::ThreadMessageHandler, this, i))));
 
     /*
     // Dump network addresses
@@ -2417,8 +2476,10 @@ void CConnman::Interrupt()
 
 void CConnman::Stop()
 {
-    if (threadMessageHandler.joinable())
-        threadMessageHandler.join();
+    for (std::thread& threadMessageHandler : vThreadMessageHandler)
+        if (threadMessageHandler.joinable())
+            threadMessageHandler.join();
+    vThreadMessageHandler.clear();
     if (threadOpenConnections.joinable())
         threadOpenConnections.join();
     if (threadOpenAddedConnections.joinable())
@@ -2452,6 +2513,7 @@ void CConnman::Stop()
     vNodes.clear();
     vNodesDisconnected.clear();
     vhListenSocket.clear();
+    socketEvents.reset();
     semOutbound.reset();
     semAddnode.reset();
 }
@@ -2702,7 +2764,7 @@ CNode::CNode(NodeId idIn, ServiceFlags nLocalServicesIn, int nMyStartingHeightIn
     fInbound(fInboundIn),
     nKeyedNetGroup(nKeyedNetGroupIn),
     addrKnown(5000, 0.001),
-   // filterInventoryKnown(50000, 0.000001),
+    filterInventoryKnown(50000, 0.000001),
     id(idIn),
     nLocalHostNonce(nLocalHostNonceIn),
     nLocalServices(nLocalServicesIn),
@@ -2732,6 +2794,7 @@ CNode::CNode(NodeId idIn, ServiceFlags nLocalServicesIn, int nMyStartingHeightIn
     fDisconnect = false;
     nRefCount = 0;
     nSendSize = 0;
+    nSendWireSize = 0;
     nSendOffset = 0;
     hashContinue = uint256();
     nStartingHeight = -1;
@@ -2753,6 +2816,8 @@ CNode::CNode(NodeId idIn, ServiceFlags nLocalServicesIn, int nMyStartingHeightIn
     nextSendTimeFeeFilter = 0;
     fPauseRecv = false;
     fPauseSend = false;
+    fPauseIngest = false;
+    fHasRecvData = false;
     nProcessQueueSize = 0;
 
 // for runtime error, add this
@@ -2836,24 +2901,69 @@ bool CConnman::NodeFullyConnected(const CNode* pnode)
     return pnode && pnode->fSuccessfullyConnected && !pnode->fDisconnect;
 }
 
-void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
+CSharedNetMsg CConnman::MakeSharedMessage(CSerializedNetMsg&& msg) const
 {
-    LOG(INFO)<<"start send message to "<<pnode->GetAddrName()<<", command is "<<msg.command;
-    size_t nMessageSize = msg.data.size();
-    size_t nTotalSize = nMessageSize + CMessageHeader::HEADER_SIZE;
-    LogPrint(BCLog::NET, "sending %s (%d bytes) peer=%d\n",  SanitizeString(msg.command.c_str()), nMessageSize, pnode->GetId());
+    CSendBuffer data;
+    if (!msg.data.empty())
+        data = std::make_shared<const std::vector<unsigned char>>(std::move(msg.data));
+    return MakeSharedMessage(msg.command, std::vector<unsigned char>(), data);
+}
 
+CSharedNetMsg CConnman::MakeSharedMessage(const std::string& command, std::vector<unsigned char>&& prefix, const CSendBuffer& data) const
+{
+    size_t nMessageSize = prefix.size() + (data ? data->size() : 0);
     std::vector<unsigned char> serializedHeader;
     serializedHeader.reserve(CMessageHeader::HEADER_SIZE);
-    uint256 hash = Hash(msg.data.data(), msg.data.data() + nMessageSize);
-    CMessageHeader hdr(Params().MessageStart(), msg.command.c_str(), nMessageSize);
+    uint256 hash;
+    CHash256 hasher;
+    hasher.Write(prefix.data(), prefix.size());
+    if (data)
+        hasher.Write(data->data(), data->size());
+    hasher.Finalize((unsigned char*)&hash);
+    CMessageHeader hdr(Params().MessageStart(), command.c_str(), nMessageSize);
     memcpy(hdr.pchChecksum, hash.begin(), CMessageHeader::CHECKSUM_SIZE);
 
     CVectorWriter{SER_NETWORK, INIT_PROTO_VERSION, serializedHeader, 0, hdr};
 
+    CSharedNetMsg shared;
+    shared.command = command;
+    shared.header = std::make_shared<const std::vector<unsigned char>>(std::move(serializedHeader));
+    if (!prefix.empty())
+        shared.prefix = std::make_shared<const std::vector<unsigned char>>(std::move(prefix));
+    if (data && !data->empty())
+        shared.data = data;
+    return shared;
+}
+
+bool CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
+{
+    SendPriority priority = GetSendPriority(msg.command);
+    return PushMessage(pnode, MakeSharedMessage(std::move(msg)), priority);
+}
+
+bool CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg, SendPriority priority)
+{
+    return PushMessage(pnode, MakeSharedMessage(std::move(msg)), priority);
+}
+
+bool CConnman::PushMessage(CNode* pnode, const CSharedNetMsg& msg, SendPriority priority)
+{
+    LOG(INFO)<<"start send message to "<<pnode->GetAddrName()<<", command is "<<msg.command;
+    size_t nMessageSize = msg.DataSize();
+    size_t nTotalSize = nMessageSize + CMessageHeader::HEADER_SIZE;
+    LogPrint(BCLog::NET, "sending %s (%d bytes) peer=%d\n",  SanitizeString(msg.command.c_str()), nMessageSize, pnode->GetId());
+
     size_t nBytesSent = 0;
     {
         LOCK(pnode->cs_vSend);
+        CSendQueueStats& stats = pnode->sendQueueStats[priority];
+        // the first waiting message of a class is always taken, so a message above the limit isn't refused forever
+        if (stats.nQueuedBytes && stats.nQueuedBytes + nTotalSize > vSendQueueLimit[priority]) {
+            stats.nDropped++;
+            LogPrintf("send queue %s of peer=%d is full, %s (%d bytes) dropped\n",
+                GetSendPriorityName(priority), pnode->GetId(), SanitizeString(msg.command), nMessageSize);
+            return false;
+        }
         bool optimisticSend(pnode->vSendMsg.empty());
         //log total amount of bytes per command
         pnode->mapSendBytesPerMsgCmd[msg.command] += nTotalSize;
@@ -2862,21 +2972,61 @@ void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
         if (pnode->nSendSize > nSendBufferMaxSize)
             pnode->fPauseSend = true;
 
-        if((msg.command == NetMsgType::REQUESTDYNASTY ||
-           msg.command == NetMsgType::RESPONCEDYNASTY||
-           msg.command == NetMsgType::NEWUNIT) && pnode->vSendMsg.size() > 10){
-
-        }else{
-          pnode->vSendMsg.push_back(std::move(serializedHeader));
-          if (nMessageSize)
-              pnode->vSendMsg.push_back(std::move(msg.data));
-        }
+        pnode->vSendQueue[priority].push_back(CNode::CQueuedNetMsg{msg, GetTimeMicros()});
+        stats.nQueuedBytes += nTotalSize;
+        stats.nQueued++;
         // If write queue empty, attempt "optimistic write"
         if (optimisticSend == true)
           nBytesSent = SocketSendData(pnode);
     }
     if (nBytesSent)
         RecordBytesSent(nBytesSent);
+    return true;
+}
+
+SendQueueStatsArray CConnman::GetSendQueueStats() const
+{
+    SendQueueStatsArray rtn;
+    ForEachNode([&rtn](CNode* pnode) {
+        LOCK(pnode->cs_vSend);
+        for (int i = 0; i < SEND_PRIORITY_COUNT; i++)
+            rtn[i].Add(pnode->sendQueueStats[i]);
+    });
+    return rtn;
+}
+
+SendPriority GetSendPriority(const std::string& command)
+{
+    if (command == NetMsgType::RESPONCEDYNASTY ||
+        command == NetMsgType::RESPONCEDYNASTIES ||
+        command == NetMsgType::RESPONCEVALIDATORS)
+        return SEND_PRIORITY_BULK;
+    // votes and validator units are sent with SEND_PRIORITY_HIGH by their sender
+    if (command == NetMsgType::NEWUNIT ||
+        command == NetMsgType::INV ||
+        command == NetMsgType::GETDATA)
+        return SEND_PRIORITY_RELAY;
+    return SEND_PRIORITY_HIGH;
+}
+
+std::string GetSendPriorityName(SendPriority priority)
+{
+    switch (priority) {
+    case SEND_PRIORITY_HIGH: return "high";
+    case SEND_PRIORITY_RELAY: return "relay";
+    case SEND_PRIORITY_BULK: return "bulk";
+    default: return "unknown";
+    }
+}
+
+void CSendQueueStats::Add(const CSendQueueStats& other)
+{
+    nQueuedBytes += other.nQueuedBytes;
+    nQueued += other.nQueued;
+    nDropped += other.nDropped;
+    nTaken += other.nTaken;
+    nQueueTimeTotal += other.nQueueTimeTotal;
+    nQueueTimeMax = std::max(nQueueTimeMax, other.nQueueTimeMax);
 }
 
 bool CConnman::ForNode(NodeId id, std::function<bool(CNode* pnode)> func)
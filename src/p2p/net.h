@@ -21,7 +21,9 @@
 #include <sync.h>
 #include <uint256.h>
 #include <threadinterrupt.h>
+#include <socketevents.h>
 
+#include <array>
 #include <atomic>
 #include <deque>
 #include <stdint.h>
@@ -83,6 +85,12 @@ static const bool DEFAULT_BLOCKSONLY = false;
 static const bool DEFAULT_FORCEDNSSEED = false;
 static const size_t DEFAULT_MAXRECEIVEBUFFER = 5 * 1000;
 static const size_t DEFAULT_MAXSENDBUFFER    = 1 * 1000;
+/** Bytes waiting in a peer's send queue of each class, the first message of a class is always taken */
+static const size_t DEFAULT_SEND_QUEUE_HIGH  = 16 * 1000 * 1000;
+static const size_t DEFAULT_SEND_QUEUE_RELAY =  4 * 1000 * 1000;
+static const size_t DEFAULT_SEND_QUEUE_BULK  = 32 * 1000 * 1000;
+/** Default number of threads processing peer messages, messages of one peer are processed by one of them in order */
+static const unsigned int DEFAULT_MESSAGE_HANDLER_THREADS = 4;
 
 // NOTE: When adjusting this, update rpcnet:setban's help ("24h")
 static const unsigned int DEFAULT_MISBEHAVING_BANTIME = 60 * 60 * 24;  // Default 24-hour ban
@@ -113,6 +121,53 @@ struct CSerializedNetMsg
     std::string command;
 };
 
+/** Buffer queued for sending, shared by every peer it's queued on. */
+typedef std::shared_ptr<const std::vector<unsigned char>> CSendBuffer;
+
+/**
+ * Message serialized once with its header and checksum. It can be queued on
+ * any number of peers, which only take references to the same buffers.
+ */
+struct CSharedNetMsg
+{
+    std::string command;
+    CSendBuffer header;
+    CSendBuffer prefix; // bytes of this message only, sent before data, none if null
+    CSendBuffer data; // empty payload if null
+
+    size_t DataSize() const { return (prefix ? prefix->size() : 0) + (data ? data->size() : 0); }
+};
+
+/**
+ * Send queue classes of a peer. A message goes to the wire after the messages
+ * of higher classes queued before it.
+ */
+enum SendPriority
+{
+    SEND_PRIORITY_HIGH = 0, //!< votes, validator units and protocol control messages
+    SEND_PRIORITY_RELAY,    //!< other units and inventory
+    SEND_PRIORITY_BULK,     //!< sync responses
+    SEND_PRIORITY_COUNT
+};
+
+/** Class of a message whose sender didn't choose one. */
+SendPriority GetSendPriority(const std::string& command);
+std::string GetSendPriorityName(SendPriority priority);
+
+/** Counters of one send queue class. */
+struct CSendQueueStats
+{
+    size_t nQueuedBytes = 0;     //!< bytes waiting, not on the wire yet
+    uint64_t nQueued = 0;        //!< messages accepted
+    uint64_t nDropped = 0;       //!< messages refused because the queue was full
+    uint64_t nTaken = 0;         //!< messages moved to the wire
+    int64_t nQueueTimeTotal = 0; //!< usec from accept to the wire, of messages taken
+    int64_t nQueueTimeMax = 0;
+
+    void Add(const CSendQueueStats& other);
+};
+typedef std::array<CSendQueueStats, SEND_PRIORITY_COUNT> SendQueueStatsArray;
+
 class NetEventsInterface;
 class CNetMessage;
 using Ptr_Node = std::shared_ptr<CNode>;
@@ -159,6 +214,9 @@ public:
         std::function<void(CNode*)> DoDisConnect;
         std::function<bool(const CNetMessage& netmsg, CNode* p_node)> DoReceiveNewMsg;
         std::function<uint64_t()> DoGetLastNonce;
+        SocketEventsMode socketEventsMode = SOCKETEVENTS_SELECT;
+        unsigned int nMessageHandlerThreads = DEFAULT_MESSAGE_HANDLER_THREADS;
+        std::array<size_t, SEND_PRIORITY_COUNT> vSendQueueLimit{{DEFAULT_SEND_QUEUE_HIGH, DEFAULT_SEND_QUEUE_RELAY, DEFAULT_SEND_QUEUE_BULK}};
     };
 
     void Init(const Options& connOptions) {
@@ -174,6 +232,8 @@ public:
         nSendBufferMaxSize = connOptions.nSendBufferMaxSize;
         nReceiveFloodSize = connOptions.nReceiveFloodSize;
         nMaxProcessReivSize = connOptions.nMaxProcessReivSize;
+        nMessageHandlerThreads = std::max(connOptions.nMessageHandlerThreads, 1u);
+        vSendQueueLimit = connOptions.vSendQueueLimit;
         {
             LOCK(cs_totalBytesSent);
             nMaxOutboundTimeframe = connOptions.nMaxOutboundTimeframe;
@@ -202,7 +262,19 @@ public:
 
     bool ForNode(NodeId id, std::function<bool(CNode* pnode)> func);
 
-    void PushMessage(CNode* pnode, CSerializedNetMsg&& msg);
+    /**
+     * Queue msg on pnode in class priority, GetSendPriority(msg.command) if not given.
+     * False if the queue of the class is full, msg is dropped and counted.
+     */
+    bool PushMessage(CNode* pnode, CSerializedNetMsg&& msg);
+    bool PushMessage(CNode* pnode, CSerializedNetMsg&& msg, SendPriority priority);
+    bool PushMessage(CNode* pnode, const CSharedNetMsg& msg, SendPriority priority);
+    /** Send queue counters of every class, summed over connected peers. */
+    SendQueueStatsArray GetSendQueueStats() const;
+    /** Serialize header and checksum of msg, so it can be pushed to many peers. */
+    CSharedNetMsg MakeSharedMessage(CSerializedNetMsg&& msg) const;
+    /** Message of prefix followed by data, data is referenced and not copied. */
+    CSharedNetMsg MakeSharedMessage(const std::string& command, std::vector<unsigned char>&& prefix, const CSendBuffer& data) const;
 
     template<typename Callable>
     void ForEachNode(Callable&& func)
@@ -335,6 +407,8 @@ public:
     unsigned int GetMaxProcessReivSize() const;
 
     void WakeMessageHandler();
+    /** Wake only the message handler thread of pnode. */
+    void WakeMessageHandler(const CNode* pnode);
 
     /** Attempts to obfuscate tx time through exponentially distributed emitting.
         Works assuming that a single interval is used.
@@ -361,7 +435,8 @@ private:
     void AddOneShot(const std::string& strDest);
     void ProcessOneShot();
     void ThreadOpenConnections(const std::vector<std::string> connect);
-    void ThreadMessageHandler();
+    void ThreadMessageHandler(unsigned int nThread);
+    unsigned int GetMessageHandlerThread(const CNode* pnode) const;
     void AcceptConnection(const ListenSocket& hListenSocket);
     void ThreadSocketHandler();
     void ThreadDNSAddressSeed();
@@ -382,6 +457,8 @@ private:
     NodeId GetNewNodeId();
 
     size_t SocketSendData(CNode *pnode) const;
+    void FillSendWire(CNode *pnode) const;
+    int SocketRecvData(CNode *pnode);
     //!check is the banlist has unwritten changes
     bool BannedSetIsDirty();
     //!set the "dirty" flag for the banlist
@@ -418,8 +495,11 @@ private:
     unsigned int nSendBufferMaxSize;
     unsigned int nReceiveFloodSize;
     unsigned int nMaxProcessReivSize;
+    unsigned int nMessageHandlerThreads;
+    std::array<size_t, SEND_PRIORITY_COUNT> vSendQueueLimit;
 
     std::vector<ListenSocket> vhListenSocket;
+    std::unique_ptr<CSocketEvents> socketEvents;
     std::atomic<bool> fNetworkActive;
     banmap_t setBanned;
     CCriticalSection cs_setBanned;
@@ -452,8 +532,8 @@ private:
     /** SipHasher seeds for deterministic randomness */
     const uint64_t nSeed0, nSeed1;
 
-    /** flag for waking the message processor. */
-    bool fMsgProcWake;
+    /** flags for waking the message processor threads, one per thread. */
+    std::vector<bool> vMsgProcWake;
 
     std::condition_variable condMsgProc;
     std::mutex mutexMsgProc;
@@ -465,7 +545,7 @@ private:
     std::thread threadSocketHandler;
     std::thread threadOpenAddedConnections;
     std::thread threadOpenConnections;
-    std::thread threadMessageHandler;
+    std::vector<std::thread> vThreadMessageHandler;
 
     /** flag for deciding to connect to an extra outbound peer,
      *  in excess of nMaxOutbound
@@ -582,6 +662,7 @@ public:
     int nStartingHeight;
     uint64_t nSendBytes;
     mapMsgCmdSize mapSendBytesPerMsgCmd;
+    SendQueueStatsArray sendQueueStats;
     uint64_t nRecvBytes;
     mapMsgCmdSize mapRecvBytesPerMsgCmd;
     bool fWhitelisted;
@@ -651,10 +732,17 @@ public:
     // socket
     std::atomic<ServiceFlags> nServices;
     SOCKET hSocket;
-    size_t nSendSize; // total size of all vSendMsg entries
+    size_t nSendSize; // total size of all vSendQueue messages and vSendMsg entries
+    size_t nSendWireSize; // total size of all vSendMsg entries
     size_t nSendOffset; // offset inside the first vSendMsg already sent
     uint64_t nSendBytes;
-    std::deque<std::vector<unsigned char>> vSendMsg;
+    std::deque<CSendBuffer> vSendMsg; // buffers of whole messages on the wire, in order
+    struct CQueuedNetMsg {
+        CSharedNetMsg msg;
+        int64_t nTimeQueued;
+    };
+    std::array<std::deque<CQueuedNetMsg>, SEND_PRIORITY_COUNT> vSendQueue; // messages waiting for the wire
+    SendQueueStatsArray sendQueueStats;
     CCriticalSection cs_vSend;
     CCriticalSection cs_hSocket;
     CCriticalSection cs_vRecv;
@@ -706,6 +794,10 @@ public:
     const uint64_t nKeyedNetGroup;
     std::atomic_bool fPauseRecv;
     std::atomic_bool fPauseSend;
+    // Set while the consumer of our messages is backed up, keeps fPauseRecv set. Protected by cs_vProcessMsg.
+    std::atomic_bool fPauseIngest;
+    // Socket may have data to read. Only used by ThreadSocketHandler.
+    std::atomic_bool fHasRecvData;
 protected:
 
     mapMsgCmdSize mapSendBytesPerMsgCmd;
@@ -724,7 +816,7 @@ public:
     int64_t nNextLocalAddrSend;
 
     // inventory based relay
-   // CRollingBloomFilter filterInventoryKnown;
+    CRollingBloomFilter filterInventoryKnown;
     // Set of transaction ids we still have to announce.
     // They are sorted by the mempool before relay, so the order is not important.
     std::set<uint256> setInventoryTxToSend;
@@ -732,6 +824,8 @@ public:
     // There is no final sorting before sending, as they are always sent immediately
     // and in the order requested.
     std::vector<uint256> vInventoryBlockToSend;
+    // Unit hashes we still have to announce, sent in order by SendMessages.
+    std::vector<uint256> vInventoryUnitToSend;
     CCriticalSection cs_inventory;
     std::set<uint256> setAskFor;
     std::multimap<int64_t, CInv> mapAskFor;
@@ -864,6 +958,22 @@ public:
         }
     }
 
+    void AddInventoryKnown(const CInv& inv)
+    {
+        LOCK(cs_inventory);
+        filterInventoryKnown.insert(inv.hash);
+    }
+
+    // Queue a unit announcement unless the peer already knows it
+    void PushInventory(const CInv& inv)
+    {
+        LOCK(cs_inventory);
+        if (inv.type == MSG_UNIT && !filterInventoryKnown.contains(inv.hash)) {
+            filterInventoryKnown.insert(inv.hash);
+            vInventoryUnitToSend.push_back(inv.hash);
+        }
+    }
+
     void AskFor(const CInv& inv);
 
     void CloseSocketDisconnect();
@@ -990,8 +990,9 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
 
     else if (strCommand == NetMsgType::GETDATA)
     {
+        // Read a copy, unit requests are answered by DoReceiveNewMsg from the same message
         std::vector<CInv> vInv;
-        vRecv >> vInv;
+        CDataStream(vRecv) >> vInv;
         if (vInv.size() > MAX_INV_SZ)
         {
             LOCK(cs_process);
@@ -1005,7 +1006,10 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
             LogPrint(BCLog::NET, "received getdata for: %s peer=%d\n", vInv[0].ToString(), pfrom->GetId());
         }
 
-        pfrom->vRecvGetData.insert(pfrom->vRecvGetData.end(), vInv.begin(), vInv.end());
+        for (const CInv& inv : vInv) {
+            if (inv.type != MSG_UNIT)
+                pfrom->vRecvGetData.push_back(inv);
+        }
         ProcessGetData(pfrom, chainparams, connman, interruptMsgProc);
     }
 
@@ -1195,13 +1199,13 @@ bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& inter
                pfrom->vProcessMsg.front().hdr.GetCommand() == NetMsgType::NEWUNIT)){
           msgs.splice(msgs.begin(), pfrom->vProcessMsg, pfrom->vProcessMsg.begin());
           pfrom->nProcessQueueSize -= msgs.front().vRecv.size() + CMessageHeader::HEADER_SIZE;
-          pfrom->fPauseRecv = pfrom->nProcessQueueSize > connman->GetReceiveFloodSize();
+          pfrom->fPauseRecv = pfrom->nProcessQueueSize > connman->GetReceiveFloodSize() || pfrom->fPauseIngest;
         }
 
         msgs.clear();
         msgs.splice(msgs.begin(), pfrom->vProcessMsg, pfrom->vProcessMsg.begin());
         pfrom->nProcessQueueSize -= msgs.front().vRecv.size() + CMessageHeader::HEADER_SIZE;
-        pfrom->fPauseRecv = pfrom->nProcessQueueSize > connman->GetReceiveFloodSize();
+        pfrom->fPauseRecv = pfrom->nProcessQueueSize > connman->GetReceiveFloodSize() || pfrom->fPauseIngest;
         fMoreWork = !pfrom->vProcessMsg.empty();
     }
     CNetMessage& msg(msgs.front());
@@ -1474,6 +1478,25 @@ bool PeerLogicValidation::SendMessages(CNode* pto)
                 pto->vAddrToSend.shrink_to_fit();
         }
 
+        //
+        // Message: inventory
+        //
+        {
+            LOCK(pto->cs_inventory);
+            std::vector<CInv> vInv;
+            vInv.reserve(std::min<size_t>(pto->vInventoryUnitToSend.size(), MAX_INV_SZ));
+            for (const uint256& hash : pto->vInventoryUnitToSend) {
+                vInv.push_back(CInv(MSG_UNIT, hash));
+                if (vInv.size() == MAX_INV_SZ) {
+                    connman->PushMessage(pto, msgMaker.Make(NetMsgType::INV, vInv));
+                    vInv.clear();
+                }
+            }
+            pto->vInventoryUnitToSend.clear();
+            if (!vInv.empty())
+                connman->PushMessage(pto, msgMaker.Make(NetMsgType::INV, vInv));
+        }
+
         // In case there is a block that has been in flight from this peer for 2 + 0.5 * N times the block interval
         // (with N the number of peers from which we're downloading validated blocks), disconnect due to timeout.
         // We compensate for other peers to prevent killing off peers due to our own downstream link
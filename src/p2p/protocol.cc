@@ -46,6 +46,10 @@ const char *LISTENPORT="listenport";
 const char *DYNASTY = "dynasty";
 const char *REQUESTDYNASTY = "reqdynasty";
 const char *RESPONCEDYNASTY = "resdynasty";
+const char *REQUESTDYNASTIES = "reqdynasties";
+const char *RESPONCEDYNASTIES = "resdynasties";
+const char *REQUESTVALIDATORS = "reqvalidators";
+const char *RESPONCEVALIDATORS = "resvalidators";
 const char *NEWUNIT="newunit";
 } // namespace NetMsgType
 
@@ -84,6 +88,10 @@ const static std::string allNetMessageTypes[] = {
 
     NetMsgType::REQUESTDYNASTY,
     NetMsgType::RESPONCEDYNASTY,
+    NetMsgType::REQUESTDYNASTIES,
+    NetMsgType::RESPONCEDYNASTIES,
+    NetMsgType::REQUESTVALIDATORS,
+    NetMsgType::RESPONCEVALIDATORS,
     NetMsgType::NEWUNIT,
 };
 const static std::vector<std::string> allNetMessageTypesVec(allNetMessageTypes, allNetMessageTypes+ARRAYLEN(allNetMessageTypes));
@@ -195,6 +203,7 @@ std::string CInv::GetCommand() const
     case MSG_BLOCK:          return cmd.append(NetMsgType::BLOCK);
     case MSG_FILTERED_BLOCK: return cmd.append(NetMsgType::MERKLEBLOCK);
     case MSG_CMPCT_BLOCK:    return cmd.append(NetMsgType::CMPCTBLOCK);
+    case MSG_UNIT:           return cmd.append(NetMsgType::NEWUNIT);
     default:
         throw std::out_of_range(strprintf("CInv::GetCommand(): type=%d unknown type", type));
     }
@@ -248,6 +248,20 @@ extern const char *LISTENPORT;
 
 extern const char *REQUESTDYNASTY;
 extern const char *RESPONCEDYNASTY;
+/**
+ * Request a range of consecutive dynasties after an anchor validator unit:
+ * anchor hash, start position and count of dynasties.
+ * Peer should respond with "resdynasties" message.
+ */
+extern const char *REQUESTDYNASTIES;
+extern const char *RESPONCEDYNASTIES;
+/**
+ * Request validator units after an anchor validator unit, without dynasty bodies:
+ * anchor hash and count of validator units.
+ * Peer should respond with "resvalidators" message.
+ */
+extern const char *REQUESTVALIDATORS;
+extern const char *RESPONCEVALIDATORS;
 extern const char *NEWUNIT;
 
 }
@@ -393,6 +407,7 @@ enum GetDataMsg
     // The following can only occur in getdata. Invs always use TX or BLOCK.
     MSG_FILTERED_BLOCK = 3,  //!< Defined in BIP37
     MSG_CMPCT_BLOCK = 4,     //!< Defined in BIP152
+    MSG_UNIT = 5,            //!< Ambr unit, hash is the unit hash, answered by NEWUNIT
     MSG_WITNESS_BLOCK = MSG_BLOCK | MSG_WITNESS_FLAG, //!< Defined in BIP144
     MSG_WITNESS_TX = MSG_TX | MSG_WITNESS_FLAG,       //!< Defined in BIP144
     MSG_FILTERED_WITNESS_BLOCK = MSG_FILTERED_BLOCK | MSG_WITNESS_FLAG,
@@ -0,0 +1,148 @@
+/**********************************************************************
+ * Copyright (c) 2018 Ambr project
+ * Distributed under the MIT software license, see the accompanying   *
+ * file COPYING or http://www.opensource.org/licenses/mit-license.php.*
+ **********************************************************************/
+
+#include <socketevents.h>
+#include <netbase.h>
+#include <logging.h>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
+
+#include <algorithm>
+#include <string.h>
+
+/** Ready sockets taken by one epoll_wait call. */
+static const int MAX_EPOLL_EVENTS = 1024;
+
+CSocketEvents::CSocketEvents(SocketEventsMode modeIn) : mode(modeIn), epollfd(-1)
+{
+}
+
+CSocketEvents::~CSocketEvents()
+{
+#ifdef __linux__
+    if (epollfd != -1)
+        close(epollfd);
+#endif
+}
+
+bool CSocketEvents::Init()
+{
+    if (mode == SOCKETEVENTS_EPOLL) {
+#ifdef __linux__
+        epollfd = epoll_create1(EPOLL_CLOEXEC);
+        if (epollfd != -1)
+            return true;
+        LogPrintf("epoll_create1 failed: %s, falling back to select\n", NetworkErrorString(WSAGetLastError()));
+#else
+        LogPrintf("epoll is not supported on this platform, falling back to select\n");
+#endif
+        mode = SOCKETEVENTS_SELECT;
+        return false;
+    }
+    return true;
+}
+
+bool CSocketEvents::IsSelectable(SOCKET hSocket) const
+{
+    return mode == SOCKETEVENTS_EPOLL || IsSelectableSocket(hSocket);
+}
+
+bool CSocketEvents::Add(SOCKET hSocket, void* ptr, bool fEdgeTriggered)
+{
+#ifdef __linux__
+    if (mode == SOCKETEVENTS_EPOLL) {
+        struct epoll_event event;
+        memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN | EPOLLRDHUP;
+        if (fEdgeTriggered)
+            event.events |= EPOLLET;
+        event.data.ptr = ptr;
+        if (epoll_ctl(epollfd, EPOLL_CTL_ADD, hSocket, &event) == -1) {
+            LogPrintf("epoll_ctl add failed: %s\n", NetworkErrorString(WSAGetLastError()));
+            return false;
+        }
+    }
+#endif
+    return true;
+}
+
+void CSocketEvents::Remove(SOCKET hSocket)
+{
+#ifdef __linux__
+    if (mode == SOCKETEVENTS_EPOLL && hSocket != INVALID_SOCKET)
+        epoll_ctl(epollfd, EPOLL_CTL_DEL, hSocket, nullptr);
+#endif
+}
+
+bool CSocketEvents::Wait(const SocketList& vSelect, int nTimeoutMs, std::vector<void*>& vReady)
+{
+    vReady.clear();
+    if (mode == SOCKETEVENTS_EPOLL)
+        return WaitEpoll(nTimeoutMs, vReady);
+    return WaitSelect(vSelect, nTimeoutMs, vReady);
+}
+
+bool CSocketEvents::WaitSelect(const SocketList& vSelect, int nTimeoutMs, std::vector<void*>& vReady)
+{
+    struct timeval timeout;
+    timeout.tv_sec  = nTimeoutMs / 1000;
+    timeout.tv_usec = (nTimeoutMs % 1000) * 1000;
+
+    fd_set fdsetRecv;
+    fd_set fdsetError;
+    FD_ZERO(&fdsetRecv);
+    FD_ZERO(&fdsetError);
+    SOCKET hSocketMax = 0;
+    for (const auto& item : vSelect) {
+        FD_SET(item.first, &fdsetRecv);
+        FD_SET(item.first, &fdsetError);
+        hSocketMax = std::max(hSocketMax, item.first);
+    }
+
+    int nSelect = select(vSelect.empty() ? 0 : hSocketMax + 1, &fdsetRecv, nullptr, &fdsetError, &timeout);
+    if (nSelect == SOCKET_ERROR)
+        return false;
+    for (const auto& item : vSelect) {
+        if (FD_ISSET(item.first, &fdsetRecv) || FD_ISSET(item.first, &fdsetError))
+            vReady.push_back(item.second);
+    }
+    return true;
+}
+
+bool CSocketEvents::WaitEpoll(int nTimeoutMs, std::vector<void*>& vReady)
+{
+#ifdef __linux__
+    struct epoll_event events[MAX_EPOLL_EVENTS];
+    int nEvents = epoll_wait(epollfd, events, MAX_EPOLL_EVENTS, nTimeoutMs);
+    if (nEvents == -1)
+        return WSAGetLastError() == WSAEINTR;
+    for (int i = 0; i < nEvents; i++)
+        vReady.push_back(events[i].data.ptr);
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool ParseSocketEventsMode(const std::string& str, SocketEventsMode& mode)
+{
+    if (str == "select") {
+        mode = SOCKETEVENTS_SELECT;
+        return true;
+    }
+    if (str == "epoll") {
+        mode = SOCKETEVENTS_EPOLL;
+        return true;
+    }
+    return false;
+}
+
+std::string GetSocketEventsModeName(SocketEventsMode mode)
+{
+    return mode == SOCKETEVENTS_EPOLL ? "epoll" : "select";
+}
@@ -0,0 +1,72 @@
+/**********************************************************************
+ * Copyright (c) 2018 Ambr project
+ * Distributed under the MIT software license, see the accompanying   *
+ * file COPYING or http://www.opensource.org/licenses/mit-license.php.*
+ **********************************************************************/
+
+#ifndef BITCOIN_SOCKETEVENTS_H
+#define BITCOIN_SOCKETEVENTS_H
+
+#include <compat.h>
+
+#include <string>
+#include <vector>
+
+enum SocketEventsMode {
+    SOCKETEVENTS_SELECT = 0,
+    SOCKETEVENTS_EPOLL = 1,
+};
+
+/**
+ * Readiness of sockets for reading, used by the socket handler thread.
+ *
+ * select: level triggered, the sockets to wait on are passed to every Wait(),
+ * so the cost of a wakeup is linear in the number of sockets and sockets
+ * must be below FD_SETSIZE.
+ *
+ * epoll (linux only): sockets are registered once by Add() and only ready
+ * sockets are returned. Edge triggered sockets are reported once per arrival
+ * of data, the caller has to read them until WSAEWOULDBLOCK before they are
+ * reported again. A closed socket is removed by the kernel.
+ *
+ * Wait() is called by one thread, Add() and Remove() may be called by any
+ * thread after Init().
+ */
+class CSocketEvents
+{
+public:
+    typedef std::vector<std::pair<SOCKET, void*> > SocketList;
+
+    explicit CSocketEvents(SocketEventsMode modeIn);
+    ~CSocketEvents();
+
+    /** Falls back to select if epoll is not available. */
+    bool Init();
+    SocketEventsMode GetMode() const { return mode; }
+    /** Whether sockets of any number may be watched. */
+    bool IsSelectable(SOCKET hSocket) const;
+
+    /** Watch hSocket with epoll, ptr is returned when it's ready. No-op for select. */
+    bool Add(SOCKET hSocket, void* ptr, bool fEdgeTriggered = true);
+    void Remove(SOCKET hSocket);
+
+    /**
+     * Wait up to nTimeoutMs for readable or failed sockets, their ptrs are put in vReady.
+     * vSelect are the sockets to wait on with select, ignored by epoll.
+     * Returns false on error.
+     */
+    bool Wait(const SocketList& vSelect, int nTimeoutMs, std::vector<void*>& vReady);
+
+private:
+    bool WaitSelect(const SocketList& vSelect, int nTimeoutMs, std::vector<void*>& vReady);
+    bool WaitEpoll(int nTimeoutMs, std::vector<void*>& vReady);
+
+    SocketEventsMode mode;
+    int epollfd;
+};
+
+/** Parse -socketevents value, "select" or "epoll". */
+bool ParseSocketEventsMode(const std::string& str, SocketEventsMode& mode);
+std::string GetSocketEventsModeName(SocketEventsMode mode);
+
+#endif // BITCOIN_SOCKETEVENTS_H
@@ -37,14 +37,22 @@ grpc::Status RpcServer::AddReceiveUnitByJson(grpc::ServerContext *context, const
 grpc::Status RpcServer::GetWaitForReceiveUnit(grpc::ServerContext *context, const ambr::rpc::GetWaitForReceiveUnitRequest *request, ambr::rpc::GetWaitForReceiveUnitReply *response){
   ambr::core::PublicKey pub_key;
   pub_key.decode_from_hex(request->public_key());
-  std::list<ambr::core::UnitHash> unit_hash_list = store_manager_->GetWaitForReceiveList(pub_key);
   response->set_result(true);
-  for(auto iter = unit_hash_list.begin(); iter != unit_hash_list.end(); iter++){
-    ambr::core::Amount amount;
-    assert(store_manager_->GetSendAmount(*iter, amount, nullptr));
-    auto item_p = response->add_items();
-    item_p->set_hash(iter->encode_to_hex());
-    item_p->set_amount(amount.encode_to_dec());
+  //amount is stored with the hash, read page by page so no send unit is loaded
+  const size_t page_size = 1000;
+  ambr::core::UnitHash start_after;
+  for(;;){
+    std::list<std::pair<ambr::core::UnitHash, ambr::core::Amount>> page =
+        store_manager_->GetWaitForReceiveListWithAmount(pub_key, start_after, page_size);
+    for(auto iter = page.begin(); iter != page.end(); iter++){
+      auto item_p = response->add_items();
+      item_p->set_hash(iter->first.encode_to_hex());
+      item_p->set_amount(iter->second.encode_to_dec());
+    }
+    if(page.size() < page_size){
+      break;
+    }
+    start_after = page.back().first;
   }
   return grpc::Status::OK;
 }
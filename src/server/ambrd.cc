@@ -22,19 +22,14 @@
 
 namespace ambr {
 namespace server {
-int DoServer(const std::string& db_path, uint16_t rpc_port, uint16_t p2p_port, const std::string& seed_ip, uint16_t seed_port) {
+int DoServer(const std::string& db_path, uint16_t rpc_port, uint16_t p2p_port, const std::string& seed_ip, uint16_t seed_port,
+             const std::string& socket_events) {
   std::shared_ptr<ambr::store::StoreManager> p_store_manager = std::make_shared<ambr::store::StoreManager>();
   std::shared_ptr<ambr::syn::SynManager> p_syn_manager = std::make_shared<ambr::syn::SynManager>(p_store_manager);
   std::unique_ptr<ambr::rpc::RpcServer> p_rpc = std::unique_ptr<ambr::rpc::RpcServer>(new ambr::rpc::RpcServer());
 
   p_store_manager->Init(db_path);
   google::SetLogDestination(google::GLOG_INFO, (db_path+"/log.log").c_str());
-  p_store_manager->AddCallBackReceiveNewSendUnit(std::bind(&ambr::syn::SynManager::BoardCastNewUnit, p_syn_manager.get(), std::placeholders::_1));
-  p_store_manager->AddCallBackReceiveNewReceiveUnit(std::bind(&ambr::syn::SynManager::BoardCastNewUnit, p_syn_manager.get(), std::placeholders::_1));
-  p_store_manager->AddCallBackReceiveNewValidatorUnit(std::bind(&ambr::syn::SynManager::BoardCastNewUnit, p_syn_manager.get(), std::placeholders::_1));
-  p_store_manager->AddCallBackReceiveNewJoinValidatorSetUnit(std::bind(&ambr::syn::SynManager::BoardCastNewUnit, p_syn_manager.get(), std::placeholders::_1));
-  p_store_manager->AddCallBackReceiveNewLeaveValidatorSetUnit(std::bind(&ambr::syn::SynManager::BoardCastNewUnit, p_syn_manager.get(), std::placeholders::_1));
-  p_store_manager->AddCallBackReceiveNewVoteUnit(std::bind(&ambr::syn::SynManager::BoardCastNewUnit, p_syn_manager.get(), std::placeholders::_1));
 
   p_rpc->StartRpcServer(p_store_manager, rpc_port);
 
@@ -51,6 +46,7 @@ int DoServer(const std::string& db_path, uint16_t rpc_port, uint16_t p2p_port, c
   config.heart_time_ = 88;
 
   config.vec_seed_.push_back((boost::format("%s:%d")%seed_ip%seed_port).str());
+  config.socket_events_ = socket_events;
 
   CConnman::Options connOptions;
   connOptions.nMaxConnections = 12;
@@ -59,6 +55,9 @@ int DoServer(const std::string& db_path, uint16_t rpc_port, uint16_t p2p_port, c
   connOptions.nMaxAddnode = 12;
   connOptions.vSeedNodes = config.vec_seed_;
   connOptions.nListenPort = config.listen_port_;
+  if(!ParseSocketEventsMode(config.socket_events_, connOptions.socketEventsMode)){
+    LOG(WARNING) << "Unknown socket events " << config.socket_events_ << ", use select";
+  }
   connOptions.DoAccept = std::bind(&ambr::syn::SynManager::OnAcceptNode, p_syn_manager.get(), std::placeholders::_1);
   connOptions.DoConnect = std::bind(&ambr::syn::SynManager::OnConnectNode, p_syn_manager.get(), std::placeholders::_1);
   connOptions.DoDisConnect = std::bind(&ambr::syn::SynManager::OnDisConnectNode, p_syn_manager.get(), std::placeholders::_1);
@@ -53,7 +53,8 @@ std::string ambr::server::ServerInterface::HandleNodeOption(){
         vm_["rpc_port"].as<uint16_t>(),
         vm_["p2p_port"].as<uint16_t>(),
         vm_["seed_ip"].as<std::string>(),
-        vm_["seed_port"].as<uint16_t>()
+        vm_["seed_port"].as<uint16_t>(),
+        vm_["socket_events"].as<std::string>()
         );
 		return "";
 	} else if (vm_.count("get_address")) {
@@ -159,6 +160,7 @@ void ambr::server::ServerInterface::AddNodeOption() {
   ("rpc_port", po::value<uint16_t>()->default_value(10112), "Defines port for listen of grpc, default is 10112")
   ("seed_ip", po::value<std::string>()->default_value("0.0.0.0"), "Defines seed's ip")
   ("seed_port", po::value<uint16_t>()->default_value(10111), "Defines seed's ip")
+  ("socket_events", po::value<std::string>()->default_value("select"), "Defines wait of p2p sockets, select or epoll(linux), default is select")
 	("address", po::value<std::string>(), "Defines address for other use")
 	("key", po::value<std::string>(), "Defines the key for other use")
 	("wallet", po::value<std::string>(), "Defines wallet for other use")
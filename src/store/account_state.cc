@@ -0,0 +1,86 @@
+/**********************************************************************
+ * Copyright (c) 2018 Ambr project
+ * Distributed under the MIT software license, see the accompanying   *
+ * file COPYING or http://www.opensource.org/licenses/mit-license.php.*
+ **********************************************************************/
+#include "account_state.h"
+#include <string.h>
+
+ambr::store::AccountStateTable::AccountStateTable(size_t shard_count){
+  if(shard_count == 0)shard_count = 1;
+  for(size_t i = 0; i < shard_count; i++){
+    shard_list_.push_back(std::unique_ptr<Shard>(new Shard()));
+  }
+}
+
+bool ambr::store::AccountStateTable::Get(const ambr::core::PublicKey &pub_key, AccountState &state){
+  Shard& shard = GetShard(pub_key);
+  std::lock_guard<std::mutex> lk(shard.mutex_);
+  auto iter = shard.state_map_.find(pub_key);
+  if(iter == shard.state_map_.end()){
+    return false;
+  }
+  state = iter->second;
+  return true;
+}
+
+void ambr::store::AccountStateTable::Set(const ambr::core::PublicKey &pub_key, const AccountState &state){
+  Shard& shard = GetShard(pub_key);
+  std::lock_guard<std::mutex> lk(shard.mutex_);
+  shard.state_map_[pub_key] = state;
+}
+
+void ambr::store::AccountStateTable::Remove(const ambr::core::PublicKey &pub_key){
+  Shard& shard = GetShard(pub_key);
+  std::lock_guard<std::mutex> lk(shard.mutex_);
+  shard.state_map_.erase(pub_key);
+}
+
+void ambr::store::AccountStateTable::UpdateHead(const ambr::core::PublicKey &pub_key, const ambr::core::UnitHash &head, const ambr::core::Amount &balance){
+  Shard& shard = GetShard(pub_key);
+  std::lock_guard<std::mutex> lk(shard.mutex_);
+  AccountState& state = shard.state_map_[pub_key];
+  state.head_ = head;
+  state.balance_ = balance;
+  state.validated_ = false;
+}
+
+void ambr::store::AccountStateTable::AddPending(const ambr::core::PublicKey &pub_key, int32_t count){
+  Shard& shard = GetShard(pub_key);
+  std::lock_guard<std::mutex> lk(shard.mutex_);
+  AccountState& state = shard.state_map_[pub_key];
+  if(count < 0 && state.pending_count_ < (uint32_t)-count){
+    state.pending_count_ = 0;
+  }else{
+    state.pending_count_ += count;
+  }
+}
+
+void ambr::store::AccountStateTable::SetValidated(const ambr::core::PublicKey &pub_key, const ambr::core::UnitHash &hash){
+  Shard& shard = GetShard(pub_key);
+  std::lock_guard<std::mutex> lk(shard.mutex_);
+  auto iter = shard.state_map_.find(pub_key);
+  if(iter != shard.state_map_.end() && iter->second.head_ == hash){
+    iter->second.validated_ = true;
+  }
+}
+
+void ambr::store::AccountStateTable::Clear(){
+  for(std::unique_ptr<Shard>& shard:shard_list_){
+    std::lock_guard<std::mutex> lk(shard->mutex_);
+    shard->state_map_.clear();
+  }
+}
+
+size_t ambr::store::AccountStateTable::size(){
+  size_t rtn = 0;
+  for(std::unique_ptr<Shard>& shard:shard_list_){
+    std::lock_guard<std::mutex> lk(shard->mutex_);
+    rtn += shard->state_map_.size();
+  }
+  return rtn;
+}
+
+ambr::store::AccountStateTable::Shard& ambr::store::AccountStateTable::GetShard(const ambr::core::PublicKey &pub_key){
+  return *shard_list_[PublicKeyHasher()(pub_key)%shard_list_.size()];
+}
@@ -0,0 +1,63 @@
+/**********************************************************************
+ * Copyright (c) 2018 Ambr project
+ * Distributed under the MIT software license, see the accompanying   *
+ * file COPYING or http://www.opensource.org/licenses/mit-license.php.*
+ **********************************************************************/
+#ifndef AMBR_STORE_ACCOUNT_STATE_H_
+#define AMBR_STORE_ACCOUNT_STATE_H_
+#include <string.h>
+#include <memory>
+#include <vector>
+#include <mutex>
+#include <unordered_map>
+#include <core/key.h>
+#include <core/unit.h>
+namespace ambr {
+namespace store {
+
+struct AccountState{
+  core::UnitHash head_;//last unit of account, zero when account only has unit wait for receive
+  core::Amount balance_;//balance of head
+  uint32_t pending_count_ = 0;//count of send unit wait for receive
+  bool validated_ = false;//head was validated by validator set
+};
+
+//public key hash, public key is random enough to use it's bytes directly
+struct PublicKeyHasher{
+  size_t operator()(const core::PublicKey& pub_key) const{
+    size_t rtn;
+    memcpy(&rtn, pub_key.bytes().data(), sizeof(rtn));
+    return rtn;
+  }
+};
+
+//ram resident state of all account, mirror of account table, so balance and head can be read without db.
+//memory: one account's node is 8(next)+32(key)+56(AccountState)=96 bytes, 112 after malloc,
+//and 8 bytes of bucket, about 120MB per million accounts.
+class AccountStateTable{
+public:
+  AccountStateTable(size_t shard_count = 16);
+public:
+  bool Get(const core::PublicKey& pub_key, AccountState& state);
+  void Set(const core::PublicKey& pub_key, const AccountState& state);
+  void Remove(const core::PublicKey& pub_key);
+  //account append a unit, head isn't validated
+  void UpdateHead(const core::PublicKey& pub_key, const core::UnitHash& head, const core::Amount& balance);
+  void AddPending(const core::PublicKey& pub_key, int32_t count);
+  //set validated if head of account is hash
+  void SetValidated(const core::PublicKey& pub_key, const core::UnitHash& hash);
+  void Clear();
+  size_t size();
+private:
+  struct Shard{
+    std::mutex mutex_;
+    std::unordered_map<core::PublicKey, AccountState, PublicKeyHasher> state_map_;
+  };
+  Shard& GetShard(const core::PublicKey& pub_key);
+private:
+  std::vector<std::unique_ptr<Shard>> shard_list_;
+};
+
+}
+}
+#endif
@@ -3,6 +3,8 @@
 #include <rocksdb/db.h>
 #include <rocksdb/slice.h>
 #include <rocksdb/options.h>
+#include <rocksdb/slice_transform.h>
+#include <map>
 
 using namespace ambr::store;
 class KeyValueDBInterface::TableHandle:public rocksdb::ColumnFamilyHandle{};
@@ -10,14 +12,17 @@ class KeyValueDBInterface::WriteBatch::Impl{
 public:
   bool Write(KeyValueDBInterface::TableHandle* table_handle, const std::string& key, const std::string& value){
     rocksdb::Status status = batch_.Put(table_handle, key, value);
+    key_list_.push_back(std::make_pair(table_handle, key));
     return status.ok();
   }
   bool Delete(KeyValueDBInterface::TableHandle* table_handle, const std::string& key){
     rocksdb::Status status = batch_.Delete(table_handle, key);
+    key_list_.push_back(std::make_pair(table_handle, key));
     return status.ok();
   }
 public:
   ::rocksdb::WriteBatch batch_;
+  std::vector<std::pair<KeyValueDBInterface::TableHandle*, std::string>> key_list_;//for commit callback
 };
 
 bool KeyValueDBInterface::WriteBatch::Write(KeyValueDBInterface::TableHandle *table_handle, const std::string &key, const std::string &value){
@@ -25,7 +30,7 @@ bool KeyValueDBInterface::WriteBatch::Write(KeyValueDBInterface::TableHandle *ta
 }
 
 bool KeyValueDBInterface::WriteBatch::Delete(KeyValueDBInterface::TableHandle *table_handle, const std::string &key){
-  return true;
+  return impl_->Delete(table_handle, key);
 }
 
 KeyValueDBInterface::WriteBatch::WriteBatch(){
@@ -47,14 +52,25 @@ public:
 
     column_families.push_back(rocksdb::ColumnFamilyDescriptor(rocksdb::kDefaultColumnFamilyName, rocksdb::ColumnFamilyOptions()));
     for(const std::string& str_item:table_name_list){
-      column_families.push_back(rocksdb::ColumnFamilyDescriptor(str_item, rocksdb::ColumnFamilyOptions()));
+      rocksdb::ColumnFamilyOptions table_options;
+      auto prefix_iter = prefix_length_map_.find(str_item);
+      if(prefix_iter != prefix_length_map_.end()){
+        table_options.prefix_extractor.reset(rocksdb::NewFixedPrefixTransform(prefix_iter->second));
+      }
+      column_families.push_back(rocksdb::ColumnFamilyDescriptor(str_item, table_options));
     }
     rocksdb::Status status = rocksdb::DB::Open(options, path, column_families, (std::vector<rocksdb::ColumnFamilyHandle*>*)table_handle, &db_);
     return status.ok();
   }
   TableHandle* GetTable(const std::string& table_name, bool b_create);
+  void SetTablePrefixLength(const std::string& table_name, size_t length){
+    prefix_length_map_[table_name] = length;
+  }
   bool Write(KeyValueDBInterface::TableHandle* table_handle, const std::string& key, const std::string& value){
     ::rocksdb::Status status = db_->Put(rocksdb::WriteOptions(), table_handle, key, value);
+    if(status.ok() && commit_callback_){
+      commit_callback_(table_handle, key);
+    }
     return status.ok();
   }
   bool Read(KeyValueDBInterface::TableHandle* table_handle, const std::string& key, std::string& value){
@@ -64,8 +80,16 @@ public:
   // operator in brach is atom
   bool Write(WriteBatch& brach){
     ::rocksdb::Status status = db_->Write(rocksdb::WriteOptions(), &(brach.impl_->batch_));
+    if(status.ok() && commit_callback_){
+      for(const std::pair<KeyValueDBInterface::TableHandle*, std::string>& item:brach.impl_->key_list_){
+        commit_callback_(item.first, item.second);
+      }
+    }
     return status.ok();
   }
+  void SetCommitCallback(std::function<void(KeyValueDBInterface::TableHandle*, const std::string&)> callback){
+    commit_callback_ = callback;
+  }
 
   void Foreach(KeyValueDBInterface::TableHandle* table_handle,
                std::function<bool(const std::string&/*key*/,
@@ -88,6 +112,24 @@ public:
     }
     delete it;
   }
+
+  void ForeachPrefix(KeyValueDBInterface::TableHandle* table_handle,
+                     const std::string& prefix,
+                     const std::string& start_key,
+                     std::function<bool(const std::string&/*key*/,
+                                        const std::string&/*value*/)>
+                     callback){
+    rocksdb::ReadOptions read_options;
+    read_options.prefix_same_as_start = true;
+    rocksdb::Iterator* it = db_->NewIterator(read_options, table_handle);
+    for(it->Seek(start_key.empty()?prefix:start_key); it->Valid() && it->key().starts_with(prefix); it->Next()){
+      if(!callback(std::string(it->key().data(), it->key().size()),
+                   std::string(it->value().data(), it->value().size()))){
+        break;
+      }
+    }
+    delete it;
+  }
 public:
   rocksdb::DB* GetDBNavate(){
     return db_;
@@ -102,6 +144,8 @@ public:
   }
 private:
   rocksdb::DB* db_;
+  std::function<void(KeyValueDBInterface::TableHandle*, const std::string&)> commit_callback_;
+  std::map<std::string, size_t> prefix_length_map_;//table name->prefix length
 };
 
 
@@ -126,6 +170,18 @@ bool KeyValueDBInterface::Write(KeyValueDBInterface::WriteBatch &brach){
   return impl_->Write(brach);
 }
 
+void KeyValueDBInterface::SetTablePrefixLength(const std::string &table_name, size_t length){
+  impl_->SetTablePrefixLength(table_name, length);
+}
+
+void KeyValueDBInterface::ForeachPrefix(KeyValueDBInterface::TableHandle *table_handle, const std::string &prefix, const std::string &start_key, std::function<bool (const std::string &, const std::string &)> callback){
+  impl_->ForeachPrefix(table_handle, prefix, start_key, callback);
+}
+
+void KeyValueDBInterface::SetCommitCallback(std::function<void (KeyValueDBInterface::TableHandle *, const std::string &)> callback){
+  impl_->SetCommitCallback(callback);
+}
+
 KeyValueDBInterface::KeyValueDBInterface(){
   impl_=new Impl();
 }
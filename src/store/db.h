@@ -20,6 +20,11 @@ public:
    * @return  0 faild else success
    */
   bool InitDB(const std::string& path,const std::vector<std::string>& table_name_list, std::vector<TableHandle*>* table_handle);
+  /*
+    call before InitDB, keys of table are grouped by their first 'length' bytes,
+    so ForeachPrefix could seek in the group only
+  */
+  void SetTablePrefixLength(const std::string& table_name, size_t length);
   bool Write(TableHandle* table_handle, const std::string& key, const std::string& value);
   bool Read(TableHandle* table_handle, const std::string& key, std::string& value);
   /*
@@ -31,8 +36,21 @@ public:
                                   const std::string&/*value*/)>
                 callback
                );
+  /*
+    foreach keys begin with prefix, start from start_key(empty for the first key of prefix),
+    break at callback return false or iter out of prefix
+  */
+  void ForeachPrefix(TableHandle* table_handle,
+                     const std::string& prefix,
+                     const std::string& start_key,
+                     std::function<bool(const std::string&/*key*/,
+                                        const std::string&/*value*/)>
+                     callback
+                     );
   // operator in brach is atom
   bool Write(WriteBatch& brach);
+  //callback is called with every key written or deleted after it's committed
+  void SetCommitCallback(std::function<void(TableHandle*, const std::string&/*key*/)> callback);
 public:
   KeyValueDBInterface();
   ~KeyValueDBInterface();
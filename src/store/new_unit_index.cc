@@ -0,0 +1,64 @@
+/**********************************************************************
+ * Copyright (c) 2018 Ambr project
+ * Distributed under the MIT software license, see the accompanying   *
+ * file COPYING or http://www.opensource.org/licenses/mit-license.php.*
+ **********************************************************************/
+#include "new_unit_index.h"
+
+void ambr::store::NewUnitIndex::Set(const ambr::core::PublicKey &pub_key, const ambr::core::UnitHash &hash){
+  std::lock_guard<std::mutex> lk(mutex_);
+  auto iter = head_map_.find(pub_key);
+  if(iter != head_map_.end()){
+    hash_map_.erase(iter->second);
+    iter->second = hash;
+  }else{
+    head_map_[pub_key] = hash;
+  }
+  hash_map_[hash] = pub_key;
+}
+
+bool ambr::store::NewUnitIndex::Get(const ambr::core::PublicKey &pub_key, ambr::core::UnitHash &hash){
+  std::lock_guard<std::mutex> lk(mutex_);
+  auto iter = head_map_.find(pub_key);
+  if(iter == head_map_.end()){
+    return false;
+  }
+  hash = iter->second;
+  return true;
+}
+
+bool ambr::store::NewUnitIndex::GetPublicKey(const ambr::core::UnitHash &hash, ambr::core::PublicKey &pub_key){
+  std::lock_guard<std::mutex> lk(mutex_);
+  auto iter = hash_map_.find(hash);
+  if(iter == hash_map_.end()){
+    return false;
+  }
+  pub_key = iter->second;
+  return true;
+}
+
+void ambr::store::NewUnitIndex::Remove(const ambr::core::PublicKey &pub_key, const ambr::core::UnitHash &hash){
+  std::lock_guard<std::mutex> lk(mutex_);
+  auto iter = head_map_.find(pub_key);
+  if(iter == head_map_.end() || iter->second != hash){
+    return;
+  }
+  hash_map_.erase(hash);
+  head_map_.erase(iter);
+}
+
+std::unordered_map<ambr::core::PublicKey, ambr::core::UnitHash> ambr::store::NewUnitIndex::GetAll(){
+  std::lock_guard<std::mutex> lk(mutex_);
+  return std::unordered_map<core::PublicKey, core::UnitHash>(head_map_.begin(), head_map_.end());
+}
+
+void ambr::store::NewUnitIndex::Clear(){
+  std::lock_guard<std::mutex> lk(mutex_);
+  head_map_.clear();
+  hash_map_.clear();
+}
+
+size_t ambr::store::NewUnitIndex::size(){
+  std::lock_guard<std::mutex> lk(mutex_);
+  return head_map_.size();
+}
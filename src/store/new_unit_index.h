@@ -0,0 +1,39 @@
+/**********************************************************************
+ * Copyright (c) 2018 Ambr project
+ * Distributed under the MIT software license, see the accompanying   *
+ * file COPYING or http://www.opensource.org/licenses/mit-license.php.*
+ **********************************************************************/
+#ifndef AMBR_STORE_NEW_UNIT_INDEX_H_
+#define AMBR_STORE_NEW_UNIT_INDEX_H_
+#include <mutex>
+#include <unordered_map>
+#include <core/key.h>
+#include <core/unit.h>
+#include "account_state.h"
+#include "unit_cache.h"
+namespace ambr {
+namespace store {
+
+//ram index of account heads not validated by validator set, mirror of new_accout table.
+//it's indexed by public key and by head hash, so validator check list is applied without table scan.
+class NewUnitIndex{
+public:
+  //account's head changed to hash
+  void Set(const core::PublicKey& pub_key, const core::UnitHash& hash);
+  bool Get(const core::PublicKey& pub_key, core::UnitHash& hash);
+  //get account whose unvalidated head is hash
+  bool GetPublicKey(const core::UnitHash& hash, core::PublicKey& pub_key);
+  //remove if account's head is still hash
+  void Remove(const core::PublicKey& pub_key, const core::UnitHash& hash);
+  std::unordered_map<core::PublicKey, core::UnitHash> GetAll();
+  void Clear();
+  size_t size();
+private:
+  std::mutex mutex_;
+  std::unordered_map<core::PublicKey, core::UnitHash, PublicKeyHasher> head_map_;
+  std::unordered_map<core::UnitHash, core::PublicKey, UnitHashHasher> hash_map_;
+};
+
+}
+}
+#endif
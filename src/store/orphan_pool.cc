@@ -0,0 +1,120 @@
+/**********************************************************************
+ * Copyright (c) 2018 Ambr project
+ * Distributed under the MIT software license, see the accompanying   *
+ * file COPYING or http://www.opensource.org/licenses/mit-license.php.*
+ **********************************************************************/
+#include "orphan_pool.h"
+#include <algorithm>
+
+ambr::store::OrphanPool::OrphanPool(size_t max_count, size_t max_memory, size_t max_count_per_peer, std::chrono::seconds max_age):
+  max_count_(max_count),
+  max_memory_(max_memory),
+  max_count_per_peer_(max_count_per_peer),
+  max_age_(max_age),
+  memory_(0),
+  added_count_(0),
+  woken_count_(0),
+  evicted_count_(0),
+  expired_count_(0){
+}
+
+bool ambr::store::OrphanPool::Add(std::shared_ptr<core::Unit> unit, void* addtion_data, const core::UnitHash& missing, std::vector<Item>* evicted_list){
+  if(!unit || item_map_.find(unit->hash()) != item_map_.end()){
+    return false;
+  }
+  std::vector<Item> evicted = Expire(std::chrono::steady_clock::now()-max_age_);
+  core::UnitHash hash = unit->hash();
+  std::list<core::UnitHash>& peer_list = peer_map_[addtion_data];
+  Entry& entry = item_map_[hash];
+  entry.item_.unit_ = unit;
+  entry.item_.addtion_data_ = addtion_data;
+  entry.item_.missing_ = missing;
+  entry.item_.time_ = std::chrono::steady_clock::now();
+  entry.item_.charge_ = unit->SerializeByte().size()+sizeof(Entry);
+  entry.age_iter_ = age_list_.insert(age_list_.end(), hash);
+  entry.peer_iter_ = peer_list.insert(peer_list.end(), hash);
+  waiting_map_[missing].push_back(hash);
+  memory_ += entry.item_.charge_;
+  added_count_++;
+
+  //a peer can't hold more than its share
+  auto peer_iter = peer_map_.find(addtion_data);
+  while(peer_iter != peer_map_.end() && peer_iter->second.size() > max_count_per_peer_){
+    evicted.push_back(Remove(peer_iter->second.front()));
+    evicted_count_++;
+    peer_iter = peer_map_.find(addtion_data);
+  }
+  while(item_map_.size() > max_count_ || memory_ > max_memory_){
+    evicted.push_back(EvictOne());
+  }
+  if(evicted_list){
+    evicted_list->insert(evicted_list->end(), evicted.begin(), evicted.end());
+  }
+  return true;
+}
+
+std::vector<ambr::store::OrphanPool::Item> ambr::store::OrphanPool::Take(const core::UnitHash& hash){
+  std::vector<Item> rtn;
+  auto iter = waiting_map_.find(hash);
+  if(iter == waiting_map_.end()){
+    return rtn;
+  }
+  std::vector<core::UnitHash> hash_list = iter->second;
+  for(const core::UnitHash& item_hash:hash_list){
+    rtn.push_back(Remove(item_hash));
+  }
+  woken_count_ += rtn.size();
+  return rtn;
+}
+
+std::vector<ambr::store::OrphanPool::Item> ambr::store::OrphanPool::Expire(std::chrono::steady_clock::time_point time){
+  std::vector<Item> rtn;
+  while(age_list_.size() && item_map_[age_list_.front()].item_.time_ < time){
+    rtn.push_back(Remove(age_list_.front()));
+  }
+  expired_count_ += rtn.size();
+  return rtn;
+}
+
+bool ambr::store::OrphanPool::Contains(const core::UnitHash& hash) const{
+  return item_map_.find(hash) != item_map_.end();
+}
+
+void ambr::store::OrphanPool::Clear(){
+  item_map_.clear();
+  waiting_map_.clear();
+  age_list_.clear();
+  peer_map_.clear();
+  memory_ = 0;
+}
+
+ambr::store::OrphanPool::Item ambr::store::OrphanPool::Remove(const core::UnitHash& hash){
+  auto iter = item_map_.find(hash);
+  Item rtn = iter->second.item_;
+  age_list_.erase(iter->second.age_iter_);
+  auto peer_iter = peer_map_.find(rtn.addtion_data_);
+  peer_iter->second.erase(iter->second.peer_iter_);
+  if(peer_iter->second.empty()){
+    peer_map_.erase(peer_iter);
+  }
+  auto waiting_iter = waiting_map_.find(rtn.missing_);
+  std::vector<core::UnitHash>& waiting_list = waiting_iter->second;
+  waiting_list.erase(std::find(waiting_list.begin(), waiting_list.end(), hash));
+  if(waiting_list.empty()){
+    waiting_map_.erase(waiting_iter);
+  }
+  memory_ -= rtn.charge_;
+  item_map_.erase(iter);
+  return rtn;
+}
+
+ambr::store::OrphanPool::Item ambr::store::OrphanPool::EvictOne(){
+  auto largest = peer_map_.begin();
+  for(auto iter = peer_map_.begin(); iter != peer_map_.end(); iter++){
+    if(iter->second.size() > largest->second.size()){
+      largest = iter;
+    }
+  }
+  evicted_count_++;
+  return Remove(largest->second.front());
+}
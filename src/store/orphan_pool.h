@@ -0,0 +1,80 @@
+/**********************************************************************
+ * Copyright (c) 2018 Ambr project
+ * Distributed under the MIT software license, see the accompanying   *
+ * file COPYING or http://www.opensource.org/licenses/mit-license.php.*
+ **********************************************************************/
+#ifndef AMBR_STORE_ORPHAN_POOL_H_
+#define AMBR_STORE_ORPHAN_POOL_H_
+#include <memory>
+#include <list>
+#include <vector>
+#include <chrono>
+#include <unordered_map>
+#include <core/unit.h>
+#include "unit_cache.h"
+namespace ambr {
+namespace store {
+
+//units which can't be added because a unit they depend on is not stored yet,
+//indexed by that missing unit so they are woken exactly when it is added.
+//over limits, the oldest unit of the peer holding most units is evicted first,
+//so one flooding peer can't push out the others. not thread safe.
+class OrphanPool{
+public:
+  struct Item{
+    std::shared_ptr<core::Unit> unit_;
+    void* addtion_data_;//peer of unit, nullptr for local
+    core::UnitHash missing_;
+    std::chrono::steady_clock::time_point time_;
+    size_t charge_;
+  };
+  OrphanPool(size_t max_count = 4096,
+             size_t max_memory = 32*1024*1024,
+             size_t max_count_per_peer = 1024,
+             std::chrono::seconds max_age = std::chrono::seconds(600));
+public:
+  //return false if unit is already in pool, units evicted for room are appended to evicted_list
+  bool Add(std::shared_ptr<core::Unit> unit, void* addtion_data, const core::UnitHash& missing, std::vector<Item>* evicted_list);
+  //remove and return units waiting for hash, in order of adding
+  std::vector<Item> Take(const core::UnitHash& hash);
+  //remove units added before time
+  std::vector<Item> Expire(std::chrono::steady_clock::time_point time);
+  bool Contains(const core::UnitHash& hash) const;
+  void Clear();
+public:
+  size_t size() const{return item_map_.size();}
+  size_t memory() const{return memory_;}
+  size_t peer_count() const{return peer_map_.size();}
+  uint64_t added_count() const{return added_count_;}
+  uint64_t woken_count() const{return woken_count_;}
+  uint64_t evicted_count() const{return evicted_count_;}
+  uint64_t expired_count() const{return expired_count_;}
+private:
+  struct Entry{
+    Item item_;
+    std::list<core::UnitHash>::iterator age_iter_;
+    std::list<core::UnitHash>::iterator peer_iter_;
+  };
+  Item Remove(const core::UnitHash& hash);
+  //evict oldest unit of the peer which holds most units
+  Item EvictOne();
+private:
+  size_t max_count_;
+  size_t max_memory_;
+  size_t max_count_per_peer_;
+  std::chrono::seconds max_age_;
+  size_t memory_;
+  std::unordered_map<core::UnitHash, Entry, UnitHashHasher> item_map_;
+  //missing unit hash -> hash of units waiting for it
+  std::unordered_map<core::UnitHash, std::vector<core::UnitHash>, UnitHashHasher> waiting_map_;
+  std::list<core::UnitHash> age_list_;//front is oldest
+  std::unordered_map<void*, std::list<core::UnitHash>> peer_map_;//front is oldest
+  uint64_t added_count_;
+  uint64_t woken_count_;
+  uint64_t evicted_count_;
+  uint64_t expired_count_;
+};
+
+}
+}
+#endif
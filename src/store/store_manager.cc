@@ -9,13 +9,14 @@
 #include <map>
 #include <unordered_map>
 #include <set>
+#include <unordered_set>
 #include <unordered_map>
+#include <algorithm>
 #include <glog/logging.h>
 #include <core/key.h>
 #include "unit_store.h"
 //TODO: when income has cash disposit,can't enter validator set. when leave use ReceiveFromValidator to receive cash
 //TODO: handle the situation delete receive unit which receive from validator
-const static int32_t MAX_BUFFER_SIZE = 1024;
 static const int use_log = true;
 std::shared_ptr<ambr::store::StoreManager> ambr::store::StoreManager::instance_ = std::shared_ptr<ambr::store::StoreManager>();
 static const std::string init_addr = "ambr_y4bwxzwwrze3mt4i99n614njtsda6s658uqtue9ytjp7i5npg6pz47qdjhx3";
@@ -23,6 +24,10 @@ static const ambr::core::Amount init_balance=(boost::multiprecision::uint128_t)6
 static const ambr::core::Amount init_validate=(boost::multiprecision::uint128_t)100000000000*1000;
 static const std::string last_validate_key = "lv";
 static const std::string validate_set_key = "validate_set_key";
+static const std::string unit_type_version_key = "unit_type_version";
+static const std::string unit_type_version = "2";
+static const std::string wait_for_receive_version_key = "wait_for_receive_version";
+static const std::string wait_for_receive_version = "2";
 
 //TODO: db sync
 #define db_assert(expr){\
@@ -31,8 +36,51 @@ static const std::string validate_set_key = "validate_set_key";
     exit(0);\
   }\
 }
+
+//order units of a dynasty so previous unit and send unit of a receive unit come first,
+//dependencies outside of unit_list are ignored
+static std::vector<ambr::core::UnitHash> SortDynastyUnits(const std::vector<std::shared_ptr<ambr::core::Unit>>& unit_list){
+  std::unordered_map<ambr::core::UnitHash, std::shared_ptr<ambr::core::Unit>, ambr::store::UnitHashHasher> unit_map;
+  for(const std::shared_ptr<ambr::core::Unit>& unit:unit_list){
+    unit_map[unit->hash()] = unit;
+  }
+  std::vector<ambr::core::UnitHash> rtn;
+  rtn.reserve(unit_list.size());
+  std::unordered_set<ambr::core::UnitHash, ambr::store::UnitHashHasher> emitted;
+  //depth first without recursion, account chain may be long
+  std::vector<std::pair<std::shared_ptr<ambr::core::Unit>, bool/*dependencies pushed*/>> stack;
+  for(const std::shared_ptr<ambr::core::Unit>& unit:unit_list){
+    stack.push_back(std::make_pair(unit, false));
+    while(!stack.empty()){
+      std::shared_ptr<ambr::core::Unit> item = stack.back().first;
+      if(emitted.count(item->hash())){
+        stack.pop_back();
+        continue;
+      }
+      if(stack.back().second){
+        emitted.insert(item->hash());
+        rtn.push_back(item->hash());
+        stack.pop_back();
+        continue;
+      }
+      stack.back().second = true;
+      std::vector<ambr::core::UnitHash> depend_list;
+      depend_list.push_back(item->prev_unit());
+      if(item->type() == ambr::core::UnitType::receive){
+        depend_list.push_back(std::dynamic_pointer_cast<ambr::core::ReceiveUnit>(item)->from());
+      }
+      for(const ambr::core::UnitHash& depend:depend_list){
+        auto iter = unit_map.find(depend);
+        if(iter != unit_map.end() && !emitted.count(depend)){
+          stack.push_back(std::make_pair(iter->second, false));
+        }
+      }
+    }
+  }
+  return rtn;
+}
 void ambr::store::StoreManager::Init(const std::string& path){
-  LockGrade lk(mutex_);
+  ValidatorLock lk(validator_mutex_);
   std::vector<KeyValueDBInterface::TableHandle*> handle_out;
   std::vector<std::string> table_list_name = {
     "send_unit",
@@ -44,20 +92,33 @@ void ambr::store::StoreManager::Init(const std::string& path){
     "enter_validator_unit",
     "leave_validator_unit",
     "validator_set",
-    "handle_validator_balance_"
+    "handle_validator_balance_",
+    "unit_type",
+    "wait_for_receive",
+    "dynasty_manifest"
   };
+  db_.SetTablePrefixLength("wait_for_receive", sizeof(core::PublicKey));
   db_assert(db_.InitDB(path, table_list_name, &handle_out));
   handle_send_unit_ = handle_out[0];
   handle_receive_unit_ = handle_out[1];
   handle_account_ = handle_out[2];
   handle_new_account_ = handle_out[3];
-  handle_wait_for_receive_ = handle_out[4];
+  handle_wait_for_receive_old_ = handle_out[4];
   handle_validator_unit_ = handle_out[5];
   handle_enter_validator_unit_ = handle_out[6];
   handle_leave_validator_unit_ = handle_out[7];
   handle_validator_set_ = handle_out[8];
   handle_validator_balance_ = handle_out[9];
+  handle_unit_ = handle_out[10];
+  handle_wait_for_receive_ = handle_out[11];
+  handle_dynasty_manifest_ = handle_out[12];
+  db_.SetCommitCallback(std::bind(&StoreManager::OnDBCommit, this, std::placeholders::_1, std::placeholders::_2));
   //db_unit_ = db_.GetDBNavate();
+  BuildUnitTable();
+  UpgradeWaitForReceive();
+  LoadAllAccountState();
+  LoadNewUnitIndex();
+  LoadChainTip();
   {//first time init db
     core::Amount balance = core::Amount();
     core::PublicKey pub_key=ambr::core::GetPublicKeyByAddress(init_addr);
@@ -122,30 +183,23 @@ void ambr::store::StoreManager::Init(const std::string& path){
       rec_store->set_version((uint32_t)0x00000001);
       rec_store->set_is_validate(unit_validate->hash());
       std::vector<uint8_t> bytes = rec_store->SerializeByte();
-      std::array<uint8_t,sizeof(ambr::core::UnitHash::ArrayType)> hash_bytes = unit->hash().bytes();
-      batch.Write(handle_receive_unit_,
-                std::string((const char*)hash_bytes.data(), hash_bytes.size()),
-                std::string((const char*)bytes.data(), bytes.size()));
+      WriteUnitStore(unit->hash(), UnitStore::ST_ReceiveUnit, bytes, &batch);
       std::shared_ptr<EnterValidatorSetUnitStore> enter_store = std::make_shared<EnterValidatorSetUnitStore>(enter_unit);
       enter_store->set_version((uint32_t)0x00000001);
       enter_store->set_is_validate(unit_validate->hash());
       std::vector<uint8_t> enter_buf = enter_store->SerializeByte();
-      batch.Write(handle_enter_validator_unit_,
-                std::string((const char*)enter_unit->hash().bytes().data(), enter_unit->hash().bytes().size()),
-                std::string((const char*)enter_buf.data(), enter_buf.size()));
+      WriteUnitStore(enter_unit->hash(), UnitStore::ST_EnterValidatorSet, enter_buf, &batch);
       batch.Write(handle_account_,
                 std::string((const char*)unit->public_key().bytes().data(), unit->public_key().bytes().size()),
                 std::string((const char*)enter_unit->hash().bytes().data(), enter_unit->hash().bytes().size()));
       std::vector<uint8_t> validate_buf = std::make_shared<ambr::store::ValidatorUnitStore>(unit_validate)->SerializeByte();
-      batch.Write(handle_validator_unit_,
-                std::string((const char*)unit_validate->hash().bytes().data(), unit_validate->hash().bytes().size()),
-                std::string((const char*)validate_buf.data(), validate_buf.size())
-                );
+      WriteUnitStore(unit_validate->hash(), UnitStore::ST_Validator, validate_buf, &batch);
 
       batch.Write(handle_validator_unit_,
                 std::string(last_validate_key),
                 std::string((const char*)unit_validate->hash().bytes().data(), unit_validate->hash().bytes().size())
                 );
+      batch.Write(handle_unit_, unit_type_version_key, unit_type_version);
       std::vector<uint8_t> validator_set_buf = validator_store->SerializeByte();
       batch.Write(handle_validator_set_,
                 std::string(validate_set_key),
@@ -157,6 +211,8 @@ void ambr::store::StoreManager::Init(const std::string& path){
                 );
 
       db_assert(db_.Write(batch));
+      LoadAllAccountState();
+      LoadChainTip();
     }
   }
 }
@@ -210,82 +266,77 @@ bool ambr::store::StoreManager::AddUnit(std::shared_ptr<ambr::core::Unit> unit,
   return false;
 }
 
+bool ambr::store::StoreManager::AddUnits(const std::vector<std::shared_ptr<ambr::core::Unit>>& unit_list,
+                                         std::vector<bool>* result_list,
+                                         std::vector<std::string>* err_list){
+  std::vector<bool> result(unit_list.size(), false);
+  std::vector<std::string> err(unit_list.size());
+  //check hash and signature out of lock, signatures are verified in batch
+  std::vector<const core::Unit*> unit_ptr_list;
+  for(std::shared_ptr<core::Unit> unit:unit_list){
+    unit_ptr_list.push_back(unit.get());
+  }
+  std::vector<bool> valid_list;
+  core::Unit::ValidateBatch(unit_ptr_list, &valid_list, &err);
+  std::vector<size_t> index_list;
+  for(size_t i = 0; i < unit_list.size(); i++){
+    if(valid_list[i]){
+      index_list.push_back(i);
+    }
+  }
+  std::vector<size_t> order = SortUnitByDependency(unit_list, index_list);
+  size_t idx = 0;
+  while(idx < order.size()){
+    idx = AddUnitsBatch(unit_list, order, idx, result, err);
+    if(idx < order.size()){//not supported by batch, add it alone
+      result[order[idx]] = AddUnit(unit_list[order[idx]], &err[order[idx]]);
+      idx++;
+    }
+  }
+  if(result_list)*result_list = result;
+  if(err_list)*err_list = err;
+  return std::find(result.begin(), result.end(), false) == result.end();
+}
+
 
 bool ambr::store::StoreManager::AddSendUnit(std::shared_ptr<ambr::core::SendUnit> send_unit, std::string *err){
-  LockGrade lk(mutex_);
   if(!send_unit){
     if(err)*err = "Unit cast to SendUnit error.";
     return false;
   }
+  //sender's chain and receiver's wait for receive list will be changed
+  AccountLock lk(this, {send_unit->public_key(), send_unit->dest()});
   if(!send_unit->Validate(err)){
     return false;
   }
-  {//check prv unit
-    core::UnitHash last_hash;
-    if(!GetLastUnitHashByPubKey(send_unit->public_key(), last_hash)){
-      if(err){
-        *err = "Public key is not exist";
-      }
-      return false;
-    }
-    if(last_hash != send_unit->prev_unit()){
-      if(err){
-        *err = "Prv unit is not last unit of account";
-      }
-      return false;
-    }
-  }
-  {//check account address
-    core::UnitHash hash;
-    if(!GetLastUnitHashByPubKey(send_unit->public_key(), hash)){
-      if(err){
-        *err = "can't find account address";
-      }
-      return false;
-    }
-  }
-  //check balance
-  {
-    core::Amount balance;
-    if(!GetBalanceByPubKey(send_unit->public_key(), balance)){
-      if(err){
-        *err = "Can't get balance count!";
-      }
-      return false;
-    }
-    if(send_unit->balance() - balance < GetTransectionFeeCountWhenReceive(send_unit)){
-      if(err){
-        *err = "Insufficient balance!";
-      }
-      return false;
-    }
+  AccountState account_state;
+  account_state_.Get(send_unit->public_key(), account_state);
+  if(!CheckSendUnit(send_unit, account_state, err)){
+    return false;
   }
   //write to db
-  std::shared_ptr<SendUnitStore> store = std::make_shared<SendUnitStore>(send_unit);
   KeyValueDBInterface::WriteBatch batch;
-  std::vector<uint8_t> bytes = store->SerializeByte();
-  std::array<uint8_t,sizeof(ambr::core::UnitHash::ArrayType)> hash_bytes = send_unit->hash().bytes();
-  db_assert(batch.Write(handle_send_unit_, std::string((const char*)hash_bytes.data(), hash_bytes.size()),
-            std::string((const char*)bytes.data(), bytes.size())));
-  db_assert(batch.Write(handle_account_, std::string((const char*)send_unit->public_key().bytes().data(), send_unit->public_key().bytes().size()),
-            std::string((const char*)send_unit->hash().bytes().data(), send_unit->hash().bytes().size())));
-
-  db_assert(batch.Write(handle_new_account_, std::string((const char*)send_unit->public_key().bytes().data(), send_unit->public_key().bytes().size()),
-            std::string((const char*)send_unit->hash().bytes().data(), send_unit->hash().bytes().size())));
-  AddWaitForReceiveUnit(send_unit->dest(), send_unit->hash(), &batch);
+  core::Amount send_amount;
+  send_amount.set_data(account_state.balance_.data()-send_unit->balance().data()-
+                       GetTransectionFeeCountWhenReceive(send_unit));
+  WriteSendUnit(send_unit, send_amount, &batch);
   db_assert(db_.Write(batch));
+  account_state_.UpdateHead(send_unit->public_key(), send_unit->hash(), send_unit->balance());
+  account_state_.AddPending(send_unit->dest(), 1);
+  new_unit_index_.Set(send_unit->public_key(), send_unit->hash());
+  lk.unlock();
   DoReceiveNewSendUnit(send_unit);
   //std::cout << "Add Send Unit: " << send_unit->hash().encode_to_hex() << std::endl;
   return true;
 }
 
 bool ambr::store::StoreManager::AddReceiveUnit(std::shared_ptr<ambr::core::ReceiveUnit> receive_unit, std::string *err){
-  LockGrade lk(mutex_);
   KeyValueDBInterface::WriteBatch batch;
   if(!receive_unit){
     if(err)*err = "receive_unit is nullptr.";
     return false;
   }
+  AccountLock lk(this, {receive_unit->public_key()});
   if(!receive_unit->Validate(err)){
     if(err)*err = "receive_unit  is invalidate.";
     return false;
@@ -338,22 +389,8 @@ bool ambr::store::StoreManager::AddReceiveUnit(std::shared_ptr<ambr::core::Recei
       if(err)*err = "Error balance number.";
       return false;
     }
-    {// db operate
-      auto receive_unit_store = std::make_shared<ReceiveUnitStore>(receive_unit);
-      std::vector<uint8_t> bytes = receive_unit_store->SerializeByte();
-      std::array<uint8_t,sizeof(ambr::core::UnitHash::ArrayType)> hash_bytes = receive_unit->hash().bytes();
-      db_assert(batch.Write(handle_receive_unit_, std::string((const char*)hash_bytes.data(), hash_bytes.size()),
-                std::string((const char*)bytes.data(), bytes.size())));
-      db_assert(batch.Write(handle_account_, std::string((const char*)receive_unit->public_key().bytes().data(), receive_unit->public_key().bytes().size()),
-                std::string((const char*)receive_unit->hash().bytes().data(), receive_unit->hash().bytes().size())));
-      db_assert(batch.Write(handle_new_account_, std::string((const char*)receive_unit->public_key().bytes().data(), receive_unit->public_key().bytes().size()),
-                std::string((const char*)receive_unit->hash().bytes().data(), receive_unit->hash().bytes().size())));
-      send_unit_store->set_receive_unit_hash(receive_unit->hash());
-      bytes = send_unit_store->SerializeByte();
-      db_assert(batch.Write(handle_send_unit_, std::string((const char*)send_unit_store->unit()->hash().bytes().begin(), send_unit_store->unit()->hash().bytes().size()),
-                std::string((const char*)bytes.data(), bytes.size())));
-      RemoveWaitForReceiveUnit(receive_unit->public_key(), receive_unit->from(), &batch);
-    }
+    // db operate
+    WriteReceiveUnit(receive_unit, send_unit_store, &batch);
   }else if(validator_unit_store = GetValidateUnit(receive_unit->from())){
     //check receive count
     core::Amount receive_count;
@@ -390,9 +427,7 @@ bool ambr::store::StoreManager::AddReceiveUnit(std::shared_ptr<ambr::core::Recei
     {// db operate
       auto receive_unit_store = std::make_shared<ReceiveUnitStore>(receive_unit);
       std::vector<uint8_t> bytes = receive_unit_store->SerializeByte();
-      std::array<uint8_t,sizeof(ambr::core::UnitHash::ArrayType)> hash_bytes = receive_unit->hash().bytes();
-      db_assert(batch.Write(handle_receive_unit_, std::string((const char*)hash_bytes.data(), hash_bytes.size()),
-                std::string((const char*)bytes.data(), bytes.size())));
+      WriteUnitStore(receive_unit->hash(), UnitStore::ST_ReceiveUnit, bytes, &batch);
       db_assert(batch.Write(handle_account_, std::string((const char*)receive_unit->public_key().bytes().data(), receive_unit->public_key().bytes().size()),
                 std::string((const char*)receive_unit->hash().bytes().data(), receive_unit->hash().bytes().size())));
       db_assert(batch.Write(handle_new_account_, std::string((const char*)receive_unit->public_key().bytes().data(), receive_unit->public_key().bytes().size()),
@@ -408,19 +443,25 @@ bool ambr::store::StoreManager::AddReceiveUnit(std::shared_ptr<ambr::core::Recei
   }
 
   db_assert(db_.Write(batch));
+  account_state_.UpdateHead(receive_unit->public_key(), receive_unit->hash(), receive_unit->balance());
+  if(send_unit_store){
+    account_state_.AddPending(receive_unit->public_key(), -1);
+  }
+  new_unit_index_.Set(receive_unit->public_key(), receive_unit->hash());
+  lk.unlock();
   DoReceiveNewReceiveUnit(receive_unit);
   //std::cout << "Add Receive Unit: " << receive_unit->hash().encode_to_hex() << std::endl;
   return true;
 }
 
 bool ambr::store::StoreManager::AddEnterValidatorSetUnit(std::shared_ptr<ambr::core::EnterValidateSetUnit> unit, std::string *err){
-  LockGrade lk(mutex_);
   if(!unit){
     if(err){
       *err = "Unit pointer is null";
     }
     return false;
   }
+  AccountLock lk(this, {unit->public_key()});
   if(!unit->Validate(err)){
     return false;
   }
@@ -528,10 +569,7 @@ bool ambr::store::StoreManager::AddEnterValidatorSetUnit(std::shared_ptr<ambr::c
   std::shared_ptr<EnterValidatorSetUnitStore> store = std::make_shared<EnterValidatorSetUnitStore>(unit);
   std::vector<uint8_t> buf = store->SerializeByte();
   KeyValueDBInterface::WriteBatch batch;
-  db_assert(batch.Write(
-     handle_enter_validator_unit_,
-     std::string((const char*)unit->hash().bytes().data(), unit->hash().bytes().size()),
-     std::string((const char*)buf.data(), buf.size())));
+  WriteUnitStore(unit->hash(), UnitStore::ST_EnterValidatorSet, buf, &batch);
   db_assert(batch.Write(
      handle_account_,
      std::string((const char*)unit->public_key().bytes().data(), unit->public_key().bytes().size()),
@@ -541,18 +579,21 @@ bool ambr::store::StoreManager::AddEnterValidatorSetUnit(std::shared_ptr<ambr::c
      std::string((const char*)unit->public_key().bytes().data(), unit->public_key().bytes().size()),
      std::string((const char*)unit->hash().bytes().data(), unit->hash().bytes().size())));
   db_assert(db_.Write(batch));
+  account_state_.UpdateHead(unit->public_key(), unit->hash(), unit->balance());
+  new_unit_index_.Set(unit->public_key(), unit->hash());
+  lk.unlock();
   DoReceiveNewEnterValidateSetUnit(unit);
   return true;
 }
 
 bool ambr::store::StoreManager::AddLeaveValidatorSetUnit(std::shared_ptr<ambr::core::LeaveValidateSetUnit> unit, std::string *err){
-  LockGrade lk(mutex_);
   if(!unit){
     if(err){
       *err = "Unit pointer is null";
     }
     return false;
   }
+  AccountLock lk(this, {unit->public_key()});
   if(!unit->Validate(err)){
     return false;
   }
@@ -587,10 +628,7 @@ bool ambr::store::StoreManager::AddLeaveValidatorSetUnit(std::shared_ptr<ambr::c
   std::shared_ptr<LeaveValidatorSetUnitStore> store = std::make_shared<LeaveValidatorSetUnitStore>(unit);
   std::vector<uint8_t> buf = store->SerializeByte();
   KeyValueDBInterface::WriteBatch batch;
-  db_assert(batch.Write(
-     handle_leave_validator_unit_,
-     std::string((const char*)unit->hash().bytes().data(), unit->hash().bytes().size()),
-     std::string((const char*)buf.data(), buf.size())));
+  WriteUnitStore(unit->hash(), UnitStore::ST_LeaveValidatorSet, buf, &batch);
   db_assert(batch.Write(
      handle_account_,
      std::string((const char*)unit->public_key().bytes().data(), unit->public_key().bytes().size()),
@@ -600,12 +638,15 @@ bool ambr::store::StoreManager::AddLeaveValidatorSetUnit(std::shared_ptr<ambr::c
      std::string((const char*)unit->public_key().bytes().data(), unit->public_key().bytes().size()),
      std::string((const char*)unit->hash().bytes().data(), unit->hash().bytes().size())));
   db_assert(db_.Write(batch));
+  account_state_.UpdateHead(unit->public_key(), unit->hash(), unit->balance());
+  new_unit_index_.Set(unit->public_key(), unit->hash());
+  lk.unlock();
   DoReceiveNewLeaveValidateSetUnit(unit);
   return true;
 }
 
 bool ambr::store::StoreManager::AddValidateUnit(std::shared_ptr<ambr::core::ValidatorUnit> unit, std::string *err){
-  LockGrade lk(mutex_);
+  ValidatorLock lk(validator_mutex_);
   if(!unit){
     if(err){
       *err = "Unit point is null";
@@ -729,14 +770,26 @@ bool ambr::store::StoreManager::AddValidateUnit(std::shared_ptr<ambr::core::Vali
     }
   }
 
-  for(core::VoteUnit vote_unit:unit->vote_list()){
-    std::string validate_err;
-    if(!vote_unit.Validate(&validate_err)){
+  std::vector<core::VoteUnit> vote_list = unit->vote_list();
+  {//verify signatures of vote list in batch
+    std::vector<const core::Unit*> vote_ptr_list;
+    for(const core::VoteUnit& vote_unit:vote_list){
+      vote_ptr_list.push_back(&vote_unit);
+    }
+    std::vector<std::string> validate_err_list;
+    if(!core::Unit::ValidateBatch(vote_ptr_list, nullptr, &validate_err_list)){
       if(err){
-        *err = std::string("One of validate unit is not right:")+validate_err;
+        for(const std::string& validate_err:validate_err_list){
+          if(validate_err.size()){
+            *err = std::string("One of validate unit is not right:")+validate_err;
+            break;
+          }
+        }
       }
       return false;
     }
+  }
+  for(core::VoteUnit vote_unit:vote_list){
     if(!validator_set_list->IsValidator(vote_unit.public_key(), unit->nonce())){
       if(err){
         *err = "One of validate's sender is not in validator_set";
@@ -765,18 +818,12 @@ bool ambr::store::StoreManager::AddValidateUnit(std::shared_ptr<ambr::core::Vali
   //write to db
   std::vector<uint8_t> buf = std::make_shared<ValidatorUnitStore>(unit)->SerializeByte();
   KeyValueDBInterface::WriteBatch batch;
-  db_assert(batch.Write(
-     handle_validator_unit_,
-     std::string((const char*)unit->hash().bytes().data(), unit->hash().bytes().size()),
-     std::string((const char*)buf.data(), buf.size())));
+  WriteUnitStore(unit->hash(), UnitStore::ST_Validator, buf, &batch);
 
   std::shared_ptr<ValidatorUnitStore> prv_validator_store = std::make_shared<ValidatorUnitStore>(prv_validate_unit);
   prv_validator_store->set_next_validator_hash(unit->hash());
   std::vector<uint8_t> buf_prv = prv_validator_store->SerializeByte();
-  db_assert(batch.Write(
-     handle_validator_unit_,
-     std::string((const char*)prv_validate_unit->hash().bytes().data(), prv_validate_unit->hash().bytes().size()),
-     std::string((const char*)buf_prv.data(), buf_prv.size())));
+  WriteUnitStore(prv_validate_unit->hash(), UnitStore::ST_Validator, buf_prv, &batch);
 
   db_assert(batch.Write(
      handle_validator_unit_,
@@ -785,6 +832,11 @@ bool ambr::store::StoreManager::AddValidateUnit(std::shared_ptr<ambr::core::Vali
 
   //clear old vote and vote now
   ClearVote();
+  //account and hash which maybe head of account, validated by this unit
+  std::vector<std::pair<core::PublicKey, core::UnitHash>> validated_head_list;
+  bool validator_set_changed = false;
+  //units validated by prv_validate_unit now
+  std::vector<std::shared_ptr<core::Unit>> dynasty_unit_list;
   //validator now
   if(unit->percent() > PASS_PERCENT){//passed
     //set last validator unit is validated
@@ -797,10 +849,7 @@ bool ambr::store::StoreManager::AddValidateUnit(std::shared_ptr<ambr::core::Vali
         prv_validator_store->set_next_validator_hash(unit->hash());
       }
       std::vector<uint8_t> buf_prv = prv_validator_store->SerializeByte();
-      db_assert(batch.Write(
-         handle_validator_unit_,
-         std::string((const char*)prv_validator_store->GetUnit()->hash().bytes().data(), prv_validator_store->GetUnit()->hash().bytes().size()),
-         std::string((const char*)buf_prv.data(), buf_prv.size())));
+      WriteUnitStore(prv_validator_store->GetUnit()->hash(), UnitStore::ST_Validator, buf_prv, &batch);
       prv_validator_store = std::dynamic_pointer_cast<ValidatorUnitStore>(GetValidateUnit(prv_validator_store->GetUnit()->prev_unit()));
     }
 
@@ -812,16 +861,10 @@ bool ambr::store::StoreManager::AddValidateUnit(std::shared_ptr<ambr::core::Vali
     ambr::core::Amount all_balance_count = 0;
     for(const ambr::core::UnitHash& hash: checked_list){
       std::shared_ptr<ambr::store::UnitStore> unit_tmp = GetUnit(hash);
-      std::string new_unit_hash_tmp;
-      if(db_.Read(handle_new_account_,
-               std::string((char*)unit_tmp->GetUnit()->public_key().bytes().data(), unit_tmp->GetUnit()->public_key().bytes().size()),
-                  new_unit_hash_tmp)){
-        ambr::core::UnitHash hash_tmp;
-        memcpy(&hash_tmp, new_unit_hash_tmp.data(), sizeof(hash_tmp));
-
-        if(unit_tmp->GetUnit()->hash() == hash_tmp){
-          batch.Delete(handle_new_account_, std::string((char*)unit_tmp->GetUnit()->public_key().bytes().data(), unit_tmp->GetUnit()->public_key().bytes().size()));
-        }
+      validated_head_list.push_back(std::make_pair(unit_tmp->GetUnit()->public_key(), hash));
+      ambr::core::UnitHash hash_tmp;
+      if(new_unit_index_.Get(unit_tmp->GetUnit()->public_key(), hash_tmp) && unit_tmp->GetUnit()->hash() == hash_tmp){
+        batch.Delete(handle_new_account_, std::string((char*)unit_tmp->GetUnit()->public_key().bytes().data(), unit_tmp->GetUnit()->public_key().bytes().size()));
       }
       while(unit_tmp){
         db_assert(unit_tmp->GetUnit());
@@ -838,11 +881,9 @@ bool ambr::store::StoreManager::AddValidateUnit(std::shared_ptr<ambr::core::Vali
                 break;
               }
               send_unit->set_is_validate(prv_validate_unit->hash());
+              dynasty_unit_list.push_back(send_unit->GetUnit());
               std::vector<uint8_t> buf = send_unit->SerializeByte();
-              db_assert(batch.Write(
-                    handle_send_unit_,
-                    std::string((const char*)send_unit->unit()->hash().bytes().data(), send_unit->unit()->hash().bytes().size()),
-                    std::string((const char*)buf.data(), buf.size())));
+              WriteUnitStore(send_unit->unit()->hash(), UnitStore::ST_SendUnit, buf, &batch);
               unit_tmp = GetUnit(send_unit->GetUnit()->prev_unit());
               break;
             }
@@ -854,11 +895,9 @@ bool ambr::store::StoreManager::AddValidateUnit(std::shared_ptr<ambr::core::Vali
                 break;
               }
               receive_unit->set_is_validate(prv_validate_unit->hash());
+              dynasty_unit_list.push_back(receive_unit->GetUnit());
               std::vector<uint8_t> buf = receive_unit->SerializeByte();
-              db_assert(batch.Write(
-                    handle_receive_unit_,
-                    std::string((const char*)receive_unit->unit()->hash().bytes().data(), receive_unit->unit()->hash().bytes().size()),
-                    std::string((const char*)buf.data(), buf.size())));
+              WriteUnitStore(receive_unit->unit()->hash(), UnitStore::ST_ReceiveUnit, buf, &batch);
               unit_tmp = GetUnit(receive_unit->GetUnit()->prev_unit());
               break;
             }
@@ -870,11 +909,9 @@ bool ambr::store::StoreManager::AddValidateUnit(std::shared_ptr<ambr::core::Vali
                 break;
               }
               enter_unit->set_is_validate(prv_validate_unit->hash());
+              dynasty_unit_list.push_back(enter_unit->GetUnit());
               std::vector<uint8_t> buf = enter_unit->SerializeByte();
-              db_assert(batch.Write(
-                    handle_enter_validator_unit_,
-                    std::string((const char*)enter_unit->unit()->hash().bytes().data(), enter_unit->unit()->hash().bytes().size()),
-                    std::string((const char*)buf.data(), buf.size())));
+              WriteUnitStore(enter_unit->unit()->hash(), UnitStore::ST_EnterValidatorSet, buf, &batch);
 
               core::Amount new_balance = enter_unit->unit()->balance();
               unit_tmp = GetUnit(enter_unit->GetUnit()->prev_unit());
@@ -885,6 +922,7 @@ bool ambr::store::StoreManager::AddValidateUnit(std::shared_ptr<ambr::core::Vali
               validator_item.enter_nonce_ = unit->nonce()+2;
               validator_item.leave_nonce_ = 0;
               validator_set_list->JoinValidator(validator_item);
+              validator_set_changed = true;
               //save cash disopsit to income
               ValidatorBalanceStore store_out;
               core::Amount amount_tmp;
@@ -908,14 +946,13 @@ bool ambr::store::StoreManager::AddValidateUnit(std::shared_ptr<ambr::core::Vali
                 break;
               }
               leave_unit->set_is_validate(prv_validate_unit->hash());
+              dynasty_unit_list.push_back(leave_unit->GetUnit());
               std::vector<uint8_t> buf = leave_unit->SerializeByte();
-              db_assert(batch.Write(
-                    handle_leave_validator_unit_,
-                    std::string((const char*)leave_unit->unit()->hash().bytes().data(), leave_unit->unit()->hash().bytes().size()),
-                    std::string((const char*)buf.data(), buf.size())));
+              WriteUnitStore(leave_unit->unit()->hash(), UnitStore::ST_LeaveValidatorSet, buf, &batch);
               unit_tmp = GetUnit(leave_unit->GetUnit()->prev_unit());
               validator_set_list->LeaveValidator(leave_unit->unit()->public_key(), prv_validate_unit->nonce());
               validator_set_list->Update(prv_validate_unit->nonce());
+              validator_set_changed = true;
               break;
             }
           default:
@@ -925,6 +962,9 @@ bool ambr::store::StoreManager::AddValidateUnit(std::shared_ptr<ambr::core::Vali
       }
     }
     DispositionTransectionFee(prv_validate_unit->hash(), all_balance_count, &batch);
+    std::vector<core::UnitHash> manifest = SortDynastyUnits(dynasty_unit_list);
+    manifest.push_back(prv_validate_unit->hash());
+    WriteDynastyManifest(prv_validate_unit->hash(), manifest, &batch);
   }
 
   //write validator_set to db
@@ -933,12 +973,27 @@ bool ambr::store::StoreManager::AddValidateUnit(std::shared_ptr<ambr::core::Vali
                      std::string(validate_set_key),
                      std::string((const char*)validator_set_buf.data(), validator_set_buf.size())));
   db_.Write(batch);
+  for(const std::pair<core::PublicKey, core::UnitHash>& item:validated_head_list){
+    account_state_.SetValidated(item.first, item.second);
+    new_unit_index_.Remove(item.first, item.second);
+  }
+  std::shared_ptr<ChainTip> tip = std::make_shared<ChainTip>(*GetChainTip());
+  tip->last_validator_hash_ = unit->hash();
+  tip->last_validator_nonce_ = unit->nonce();
+  if(unit->percent() > PASS_PERCENT){
+    tip->last_confirmed_hash_ = unit->prev_unit();
+  }
+  if(validator_set_changed){
+    tip->validator_set_version_++;
+  }
+  std::atomic_store(&chain_tip_, std::shared_ptr<const ChainTip>(tip));
+  //slots may publish vote or add unit, don't hold validator lock
+  lk.unlock();
   DoReceiveNewValidatorUnit(unit);
   return true;
 }
 
 bool ambr::store::StoreManager::AddVote(std::shared_ptr<ambr::core::VoteUnit> unit, std::string *err){
-  LockGrade lk(mutex_);
   if(!unit){
     if(err){
       *err = "Vote Unit is null";
@@ -977,106 +1032,204 @@ bool ambr::store::StoreManager::AddVote(std::shared_ptr<ambr::core::VoteUnit> un
     }
     return false;
   }
-  for(std::shared_ptr<core::VoteUnit> vote_unit:vote_list_){
-    if(vote_unit->public_key() == unit->public_key()){
-      if(err){
-        *err = "Voter was voted";
+  {
+    std::lock_guard<std::mutex> vote_lk(vote_mutex_);
+    for(std::shared_ptr<core::VoteUnit> vote_unit:vote_list_){
+      if(vote_unit->public_key() == unit->public_key()){
+        if(err){
+          *err = "Voter was voted";
+        }
+        return false;
       }
-      return false;
     }
+    vote_list_.push_back(unit);
   }
-  vote_list_.push_back(unit);
   DoReceiveNewVoteUnit(unit);
   return true;
 }
 
 void ambr::store::StoreManager::ClearVote(){
-  LockGrade lk(mutex_);
+  std::lock_guard<std::mutex> lk(vote_mutex_);
   vote_list_.clear();
 }
 
 void ambr::store::StoreManager::UpdateNewUnitMap(const std::vector<core::UnitHash> &validator_check_list){
-  LockGrade lk(mutex_);
-  std::list<ambr::core::PublicKey> will_remove;
-  db_.Foreach(handle_new_account_, [&](const std::string& key, const std::string& value)->bool{
-    ambr::core::PublicKey pub_key;
-    ambr::core::UnitHash unit_hash;
-    pub_key.set_bytes(key.data(), key.size());
-    unit_hash.set_bytes(value.data(), value.size());
-    if(std::find(validator_check_list.begin(), validator_check_list.end(), unit_hash) != validator_check_list.end()){
-      will_remove.push_back(pub_key);
+  ValidatorLock lk(validator_mutex_);
+  std::list<std::pair<core::PublicKey, core::UnitHash>> will_remove;
+  for(const core::UnitHash& hash:validator_check_list){
+    core::PublicKey pub_key;
+    if(new_unit_index_.GetPublicKey(hash, pub_key)){
+      will_remove.push_back(std::make_pair(pub_key, hash));
     }
-    return true;
-  });
+  }
   KeyValueDBInterface::WriteBatch batch;
-  for(const core::PublicKey& pub_key:will_remove){
+  for(const std::pair<core::PublicKey, core::UnitHash>& item:will_remove){
     db_assert(batch.Delete(
          handle_new_account_,
-         std::string((const char*)pub_key.bytes().data(), pub_key.bytes().size())));
+         std::string((const char*)item.first.bytes().data(), item.first.bytes().size())));
   }
   db_assert(db_.Write(batch));
+  for(const std::pair<core::PublicKey, core::UnitHash>& item:will_remove){
+    new_unit_index_.Remove(item.first, item.second);
+  }
 }
 
 void ambr::store::StoreManager::AddUnitToBuffer(std::shared_ptr<ambr::core::Unit> unit, void* addtion_data){
-  bool need_flush = false;
+  if(!unit){
+    return;
+  }
   std::lock_guard<std::mutex> lk(unit_buffer_mutex_);
-  std::string err;
-  if(AddUnit(unit, &err)){
-    need_flush = true;
+  std::list<core::UnitHash> added_list;
+  if(AddUnit(unit, nullptr)){
     buffer_handle_callback_(unit, addtion_data, true);
+    added_list.push_back(unit->hash());
   }else{
-    if(!GetUnit(unit->hash())){
-      unit_buffer_.push_back(std::make_pair(unit, addtion_data));
-      if(unit_buffer_.size() > MAX_BUFFER_SIZE){
-        auto pop_item = unit_buffer_.front();
-        buffer_handle_callback_(pop_item.first, pop_item.second, false);
-        unit_buffer_.pop_front();
-      }
+    BufferUnit(unit, addtion_data, added_list);
+  }
+  WakeOrphanUnit(added_list);
+}
+
+void ambr::store::StoreManager::AddUnitsToBuffer(const std::vector<std::shared_ptr<ambr::core::Unit>>& unit_list, void* addtion_data){
+  std::lock_guard<std::mutex> lk(unit_buffer_mutex_);
+  std::vector<bool> result_list;
+  AddUnits(unit_list, &result_list, nullptr);
+  std::list<core::UnitHash> added_list;
+  for(size_t i = 0; i < unit_list.size(); i++){
+    if(!unit_list[i]){
+      continue;
+    }
+    if(result_list[i]){
+      buffer_handle_callback_(unit_list[i], addtion_data, true);
+      added_list.push_back(unit_list[i]->hash());
+    }else{
+      BufferUnit(unit_list[i], addtion_data, added_list);
+    }
+  }
+  WakeOrphanUnit(added_list);
+}
+
+boost::signals2::connection ambr::store::StoreManager::AddBufferHandleBack(
+    std::function<void(std::shared_ptr<ambr::core::Unit>, void*, bool)> callback){
+  return buffer_handle_callback_.connect(callback);
+}
+
+boost::signals2::connection ambr::store::StoreManager::AddCallBackOrphanUnit(
+    std::function<void(std::shared_ptr<ambr::core::Unit>, void*, const ambr::core::UnitHash&)> callback){
+  return orphan_callback_.connect(callback);
+}
+
+size_t ambr::store::StoreManager::GetOrphanCount(){
+  std::lock_guard<std::mutex> lk(unit_buffer_mutex_);
+  return orphan_pool_.size();
+}
+
+size_t ambr::store::StoreManager::GetOrphanMemory(){
+  std::lock_guard<std::mutex> lk(unit_buffer_mutex_);
+  return orphan_pool_.memory();
+}
+
+uint64_t ambr::store::StoreManager::GetOrphanWokenCount(){
+  std::lock_guard<std::mutex> lk(unit_buffer_mutex_);
+  return orphan_pool_.woken_count();
+}
+
+uint64_t ambr::store::StoreManager::GetOrphanEvictedCount(){
+  std::lock_guard<std::mutex> lk(unit_buffer_mutex_);
+  return orphan_pool_.evicted_count()+orphan_pool_.expired_count();
+}
+
+bool ambr::store::StoreManager::GetMissingDependency(std::shared_ptr<core::Unit> unit, core::UnitHash& missing){
+  std::vector<core::UnitHash> dependency_list;
+  if(!unit->prev_unit().is_zero()){
+    dependency_list.push_back(unit->prev_unit());
+  }
+  switch(unit->type()){
+  case core::UnitType::receive:
+    dependency_list.push_back(std::dynamic_pointer_cast<core::ReceiveUnit>(unit)->from());
+    break;
+  case core::UnitType::Vote:
+    dependency_list.push_back(std::dynamic_pointer_cast<core::VoteUnit>(unit)->validator_unit_hash());
+    break;
+  case core::UnitType::Validator:{
+    const std::vector<core::UnitHash>& check_list = std::dynamic_pointer_cast<core::ValidatorUnit>(unit)->check_list();
+    dependency_list.insert(dependency_list.end(), check_list.begin(), check_list.end());
+    break;
+  }
+  default:
+    break;
+  }
+  for(const core::UnitHash& hash:dependency_list){
+    if(!GetUnit(hash)){
+      missing = hash;
+      return true;
     }
-    else{
-      bool fordebug;
-      fordebug=true;
+  }
+  return false;
+}
+
+void ambr::store::StoreManager::BufferUnit(std::shared_ptr<core::Unit> unit, void* addtion_data, std::list<core::UnitHash>& added_list){
+  if(orphan_pool_.Contains(unit->hash()) || GetUnit(unit->hash())){
+    return;
+  }
+  core::UnitHash missing;
+  if(!GetMissingDependency(unit, missing)){
+    //dependency maybe added just now by others, otherwise unit is invalid and dropped
+    if(AddUnit(unit, nullptr)){
+      buffer_handle_callback_(unit, addtion_data, true);
+      added_list.push_back(unit->hash());
+    }else{
+      buffer_handle_callback_(unit, addtion_data, false);
     }
+    return;
   }
-  while(need_flush == true){
-    need_flush = false;
-    for(auto iter = unit_buffer_.begin(); iter != unit_buffer_.end(); iter++){
-      if(AddUnit(iter->first, nullptr)){
-        need_flush = true;
-        buffer_handle_callback_(iter->first, iter->second, true);
-        unit_buffer_.erase(iter);
-        break;
+  std::vector<OrphanPool::Item> evicted_list;
+  if(orphan_pool_.Add(unit, addtion_data, missing, &evicted_list) && !orphan_pool_.Contains(missing)){
+    orphan_callback_(unit, addtion_data, missing);
+  }
+  for(OrphanPool::Item& item:evicted_list){
+    buffer_handle_callback_(item.unit_, item.addtion_data_, false);
+  }
+  //missing unit was added out of buffer after the check
+  if(GetUnit(missing)){
+    added_list.push_back(missing);
+  }
+}
+
+void ambr::store::StoreManager::WakeOrphanUnit(std::list<core::UnitHash>& added_list){
+  while(added_list.size()){
+    core::UnitHash hash = added_list.front();
+    added_list.pop_front();
+    for(OrphanPool::Item& item:orphan_pool_.Take(hash)){
+      if(AddUnit(item.unit_, nullptr)){
+        buffer_handle_callback_(item.unit_, item.addtion_data_, true);
+        added_list.push_back(item.unit_->hash());
+      }else{
+        BufferUnit(item.unit_, item.addtion_data_, added_list);
       }
     }
   }
 }
 
 bool ambr::store::StoreManager::GetLastValidateUnit(core::UnitHash& hash){
-  LockGrade lk(mutex_);
-  std::string value_get;
-  if(!db_.Read(
-       handle_validator_unit_,
-       std::string(last_validate_key), value_get)){
+  std::shared_ptr<const ChainTip> tip = GetChainTip();
+  if(tip->last_validator_hash_.is_zero()){
     return false;
   }
-  hash.set_bytes(value_get.data(), value_get.size());
+  hash = tip->last_validator_hash_;
   return true;
 }
 
+//validator units were verified before stored, so the newest one is returned directly
 ambr::utils::uint64 ambr::store::StoreManager::GetLastValidatedUnitNonce(){
-  std::shared_ptr<core::ValidatorUnit> validator_unit = std::dynamic_pointer_cast<core::ValidatorUnit>(GetLastestValidateUnit()->GetUnit());
-  while(!validator_unit->Validate(nullptr)){
-    validator_unit = std::dynamic_pointer_cast<core::ValidatorUnit>(GetValidateUnit(validator_unit->prev_unit()));
-  }
-  return validator_unit->nonce();
+  return GetChainTip()->last_validator_nonce_;
 }
 
 ambr::core::UnitHash ambr::store::StoreManager::GetLastValidatedUnitHash(){
-  std::shared_ptr<core::ValidatorUnit> validator_unit = std::dynamic_pointer_cast<core::ValidatorUnit>(GetLastestValidateUnit()->GetUnit());
-  while(!validator_unit->Validate(nullptr)){
-    validator_unit = std::dynamic_pointer_cast<core::ValidatorUnit>(GetValidateUnit(validator_unit->prev_unit()));
-  }
-  return validator_unit->hash();
+  return GetChainTip()->last_validator_hash_;
+}
+
+std::shared_ptr<const ambr::store::ChainTip> ambr::store::StoreManager::GetChainTip(){
+  return std::atomic_load(&chain_tip_);
 }
 
 ambr::core::UnitHash ambr::store::StoreManager::GetNextValidatorHash(const ambr::core::UnitHash &hash){
@@ -1088,22 +1241,22 @@ ambr::core::UnitHash ambr::store::StoreManager::GetNextValidatorHash(const ambr:
 }
 
 std::list<std::shared_ptr<ambr::core::Unit> > ambr::store::StoreManager::GetAllUnitByValidatorUnitHash(const ambr::core::UnitHash &hash){
-  boost::posix_time::ptime start = boost::posix_time::microsec_clock::local_time();
-
   std::list<std::shared_ptr<core::Unit>> rtn;
+  std::vector<core::UnitHash> manifest;
+  if(GetDynastyManifest(hash, manifest)){
+    for(const core::UnitHash& unit_hash:manifest){
+      std::shared_ptr<UnitStore> unit_store = GetUnit(unit_hash);
+      if(!unit_store){//removed after manifest was read
+        return std::list<std::shared_ptr<core::Unit>>();
+      }
+      rtn.push_back(unit_store->GetUnit());
+    }
+    return rtn;
+  }
 
-  struct Item{
-    Item(std::shared_ptr<core::Unit> unit):unit_(unit){}
-    std::shared_ptr<core::Unit> unit_;
-    std::set<core::UnitHash> depends_list_;
-    //std::set<core::UnitHash> child_list_;
-  };
-  std::function<bool(std::shared_ptr<Item>, std::shared_ptr<Item>)> compare_func =
-       [](std::shared_ptr<Item> item1, std::shared_ptr<Item> item2){
-     return item1->depends_list_.size() < item2->depends_list_.size();
-  };
-  std::map<ambr::core::UnitHash, std::shared_ptr<Item>> item_list;
-  std::unordered_map<core::UnitHash, std::set<ambr::core::UnitHash>> depends_list;
+  //no manifest for dynasty passed before manifest table or by a later validator unit, build it from account chains
+  //hold validator_mutex_ shared, so validated hash of units and the manifest written can't race with validator apply or remove
+  std::shared_lock<std::shared_timed_mutex> lk(validator_mutex_);
   std::shared_ptr<ambr::store::ValidatorUnitStore> validator_store = GetValidateUnit(hash);
   if(!validator_store){
     return rtn;
@@ -1111,7 +1264,8 @@ std::list<std::shared_ptr<ambr::core::Unit> > ambr::store::StoreManager::GetAllU
   //validated_hash, if this validator_unit is not effective, validated unit is not this unit's hash
   core::UnitHash validated_unit_hash;
   bool b_first = true;
-
+  std::vector<std::shared_ptr<core::Unit>> unit_list;
+  std::unordered_set<core::UnitHash, UnitHashHasher> unit_set;
   for(core::UnitHash item_hash: validator_store->unit()->check_list()){
     while(1){
       std::shared_ptr<ambr::store::UnitStore> unit_store = GetUnit(item_hash);
@@ -1122,83 +1276,51 @@ std::list<std::shared_ptr<ambr::core::Unit> > ambr::store::StoreManager::GetAllU
         validated_unit_hash = unit_store->validated_hash();
         b_first = false;
       }
-      if(validated_unit_hash != unit_store->validated_hash()){
+      if(validated_unit_hash != unit_store->validated_hash() || !unit_set.insert(item_hash).second){
         break;
       }
-      //add previous unit has to depends
       std::shared_ptr<ambr::core::Unit> unit = unit_store->GetUnit();
       db_assert(unit);
-      std::shared_ptr<Item> item = std::make_shared<Item>(unit);
-      if(!unit->prev_unit().is_zero()){
-        std::shared_ptr<store::UnitStore> unit_store_prv = GetUnit(unit->prev_unit());
-        db_assert(unit_store_prv);
-        core::UnitHash prv_unit_hash = unit->prev_unit();
-        if(unit_store_prv->validated_hash() == validated_unit_hash){
-          item->depends_list_.insert(prv_unit_hash);
-          depends_list[prv_unit_hash].insert(item->unit_->hash());
-        }
-      }
-
-      if(unit_store->type() == store::UnitStore::ST_ReceiveUnit){
-        std::shared_ptr<core::ReceiveUnit> receive_unit = std::dynamic_pointer_cast<core::ReceiveUnit>(unit_store->GetUnit());
-        db_assert(receive_unit);
-        core::UnitHash hash_from = receive_unit->from();
-        std::shared_ptr<store::UnitStore> unit_tmp;
-        unit_tmp = GetUnit(hash_from);
-        db_assert(unit_tmp);
-        if(item->unit_->hash() == ambr::core::UnitHash("C4F5BF9CABF57BBB1EB49420F5FAEC8E66BE5166E80EA3F93F417C124423230C")){
-          int fordebug;
-          fordebug = 1;
-        }
-        if(unit_tmp->validated_hash() == validated_unit_hash){
-          item->depends_list_.insert(hash_from);
-          depends_list[hash_from].insert(item->unit_->hash());
-        }
-      }
+      unit_list.push_back(unit);
       item_hash = unit->prev_unit();
-      item_list.insert(std::make_pair(item->unit_->hash(), item));
     }
   }
-  LOG(INFO)<<__FUNCTION__<<"step 1 use time:"<<(boost::posix_time::microsec_clock::local_time()-start).total_microseconds();
-  LOG(INFO)<<"All Unit:";
-  for(auto xxx: item_list){
-    LOG(INFO)<<xxx.first.encode_to_hex();
+  for(const core::UnitHash& unit_hash:SortDynastyUnits(unit_list)){
+    rtn.push_back(GetUnit(unit_hash)->GetUnit());
   }
-  std::list<std::shared_ptr<Item>> zero_item;
-  for(const std::pair<ambr::core::UnitHash, std::shared_ptr<Item>> &item:item_list){
-    if(item.second->depends_list_.size() == 0){
-      zero_item.push_back(item.second);
-    }
-  }
-  while(zero_item.size()){
-    std::shared_ptr<Item> item = zero_item.front();
-    zero_item.pop_front();
-    rtn.push_back(item->unit_);
-    for(const ambr::core::UnitHash& child_item:depends_list[item->unit_->hash()]){
-      item_list[child_item]->depends_list_.erase(item->unit_->hash());
-      if(item_list[child_item]->depends_list_.size()==0){
-        zero_item.push_back(item_list[child_item]);
-      }
+  rtn.push_back(validator_store->GetUnit());
+  if(validator_store->is_validate() && !validated_unit_hash.is_zero()){
+    //units of validated dynasty will not change, keep it for next request
+    std::vector<core::UnitHash> hash_list;
+    for(const std::shared_ptr<core::Unit>& unit:rtn){
+      hash_list.push_back(unit->hash());
     }
+    KeyValueDBInterface::WriteBatch batch;
+    WriteDynastyManifest(hash, hash_list, &batch);
+    db_.Write(batch);
   }
-  LOG(INFO)<<"rtn Unit:";
-  for(auto xxx: rtn){
-    LOG(INFO)<<xxx->hash().encode_to_hex();
-  }
-  LOG(INFO)<<item_list.size();
-  LOG(INFO)<<rtn.size();
-  rtn.push_back(validator_store->GetUnit());
-  LOG(INFO)<<__FUNCTION__<<"step 2 use time:"<<(boost::posix_time::microsec_clock::local_time()-start).total_microseconds();
   return rtn;
 }
 
-/*std::list<std::shared_ptr<ambr::core::Unit> > ambr::store::StoreManager::GetMoreAllUnitByValidatorUnitHash(const ambr::core::UnitHash &hash, uint32_t validator_unit_count){
-  if(validator_unit_count > 10)validator_unit_count=10;
-  GetNextValidatorHash(hash)
-}*/
+bool ambr::store::StoreManager::GetDynastyManifest(const ambr::core::UnitHash& hash, std::vector<ambr::core::UnitHash>& hash_list){
+  std::string value_get;
+  if(!db_.Read(handle_dynasty_manifest_,
+               std::string((const char*)hash.bytes().data(), hash.bytes().size()),
+               value_get)){
+    return false;
+  }
+  size_t hash_size = sizeof(core::UnitHash);
+  if(value_get.size()%hash_size){
+    return false;
+  }
+  hash_list.resize(value_get.size()/hash_size);
+  for(size_t i = 0; i < hash_list.size(); i++){
+    hash_list[i].set_bytes(value_get.data()+i*hash_size, hash_size);
+  }
+  return true;
+}
 
 std::list<std::shared_ptr<ambr::core::ValidatorUnit> > ambr::store::StoreManager::GetValidateHistory(size_t count){
-  LockGrade lk(mutex_);
   std::list<std::shared_ptr<ambr::core::ValidatorUnit> > rtn;
   core::UnitHash unit_hash;
   if(!GetLastValidateUnit(unit_hash)){
@@ -1220,50 +1342,28 @@ std::list<std::shared_ptr<ambr::core::ValidatorUnit> > ambr::store::StoreManager
 }
 
 bool ambr::store::StoreManager::GetLastUnitHashByPubKey(const ambr::core::PublicKey &pub_key, ambr::core::UnitHash& hash){
-  LockGrade lk(mutex_);
-  std::string value_get;
-  if(db_.Read(
-        handle_account_,
-        std::string((const char*)pub_key.bytes().data(), pub_key.bytes().size()),
-       value_get)){
-    hash.set_bytes(value_get.data(), value_get.size());
-    return true;
+  AccountState state;
+  if(!account_state_.Get(pub_key, state) || state.head_.is_zero()){
+    return false;
   }
-  return false;
+  hash = state.head_;
+  return true;
 }
 
 bool ambr::store::StoreManager::GetBalanceByPubKey(const ambr::core::PublicKey &pub_key, core::Amount &balance){
-  LockGrade lk(mutex_);
-  ambr::core::UnitHash hash;
-  if(GetLastUnitHashByPubKey(pub_key, hash)){
-    std::shared_ptr<UnitStore> store = GetUnit(hash);
-    if(store->type() == UnitStore::ST_SendUnit){
-      std::shared_ptr<SendUnitStore> send_store = std::dynamic_pointer_cast<SendUnitStore>(store);
-      if(!send_store){
-        return false;
-      }
-      balance = send_store->unit()->balance();
-      return true;
-    }else if(store->type() == UnitStore::ST_ReceiveUnit){
-      std::shared_ptr<ReceiveUnitStore> receive_store = std::dynamic_pointer_cast<ReceiveUnitStore>(store);
-      if(!receive_store){
-        return false;
-      }
-      balance = receive_store->unit()->balance();
-      return true;
-    }else if(store->type() == UnitStore::ST_EnterValidatorSet){
-      balance = store->GetUnit()->balance();
-      return true;
-    }else if(store->type() == UnitStore::ST_LeaveValidatorSet){
-      balance = store->GetUnit()->balance();
-      return true;
-    }
+  AccountState state;
+  if(!account_state_.Get(pub_key, state) || state.head_.is_zero()){
+    return false;
   }
-  return false;
+  balance = state.balance_;
+  return true;
+}
+
+bool ambr::store::StoreManager::GetAccountState(const ambr::core::PublicKey &pub_key, AccountState &state){
+  return account_state_.Get(pub_key, state);
 }
 
 bool ambr::store::StoreManager::GetNextValidatorHashByHash(const ambr::core::UnitHash &hash_input, ambr::core::UnitHash &hash_output, std::string *err){
-  LockGrade lk(mutex_);
   std::shared_ptr<ambr::store::ValidatorUnitStore> unit_store = GetValidateUnit(hash_input);
   if(!unit_store){
     if(err){
@@ -1282,7 +1382,6 @@ bool ambr::store::StoreManager::GetNextValidatorHashByHash(const ambr::core::Uni
 }
 
 std::list<std::shared_ptr<ambr::store::UnitStore> > ambr::store::StoreManager::GetTradeHistoryByPubKey(const ambr::core::PublicKey &pub_key, size_t count){
-  LockGrade lk(mutex_);
   std::list<std::shared_ptr<ambr::store::UnitStore> > unit_list;
   ambr::core::UnitHash hash_iter;
   std::shared_ptr<ambr::store::UnitStore> unit_ptr;
@@ -1302,7 +1401,6 @@ std::list<std::shared_ptr<ambr::store::UnitStore> > ambr::store::StoreManager::G
 }
 
 bool ambr::store::StoreManager::GetSendAmount(const ambr::core::UnitHash &unit_hash, ambr::core::Amount &amount, std::string *err){
-  LockGrade lk(mutex_);
   core::Amount balance_send;
   std::shared_ptr<SendUnitStore> send_store = GetSendUnit(unit_hash);
   if(!send_store){
@@ -1324,7 +1422,6 @@ bool ambr::store::StoreManager::GetSendAmount(const ambr::core::UnitHash &unit_h
 }
 
 bool ambr::store::StoreManager::GetSendAmountWithTransactionFee(const ambr::core::UnitHash &unit_hash, ambr::core::Amount &amount, std::string *err){
-  LockGrade lk(mutex_);
   core::Amount balance_send;
   std::shared_ptr<SendUnitStore> send_store = GetSendUnit(unit_hash);
   if(!send_store){
@@ -1345,7 +1442,6 @@ bool ambr::store::StoreManager::GetSendAmountWithTransactionFee(const ambr::core
 }
 
 bool ambr::store::StoreManager::GetReceiveAmount(const ambr::core::UnitHash &unit_hash, ambr::core::Amount &amount, std::string *err){
-  LockGrade lk(mutex_);
   core::Amount balance_now;
   std::shared_ptr<ReceiveUnitStore> receive_store = GetReceiveUnit(unit_hash);
   if(!receive_store){
@@ -1366,21 +1462,10 @@ bool ambr::store::StoreManager::GetReceiveAmount(const ambr::core::UnitHash &uni
 }
 
 std::unordered_map<ambr::core::PublicKey, ambr::core::UnitHash> ambr::store::StoreManager::GetNewUnitMap(){
-  LockGrade lk(mutex_);
-  std::unordered_map<ambr::core::PublicKey, ambr::core::UnitHash> rtn;
-  db_.Foreach(handle_new_account_, [&](const std::string& key, const std::string& value)->bool{
-    ambr::core::PublicKey pub_key;
-    ambr::core::UnitHash unit_hash;
-    pub_key.set_bytes(key.data(), key.size());
-    unit_hash.set_bytes(value.data(), value.size());
-    rtn[pub_key] = unit_hash;
-    return true;
-  });
-  return rtn;
+  return new_unit_index_.GetAll();
 }
 
 std::shared_ptr<ambr::store::ValidatorSetStore> ambr::store::StoreManager::GetValidatorSet(){
-  LockGrade lk(mutex_);
   std::string value_get;
   db_.Read(handle_validator_set_,
         std::string(validate_set_key), value_get);
@@ -1399,7 +1484,6 @@ bool ambr::store::StoreManager::SendToAddressWithContract(
     ambr::core::UnitHash *tx_hash,
     std::shared_ptr<ambr::core::Unit> &unit_sended,
     std::string *err){
-  LockGrade lk(mutex_);
   std::shared_ptr<core::SendUnit> unit = std::shared_ptr<core::SendUnit>(new core::SendUnit());
   core::PublicKey pub_key = ambr::core::GetPublicKeyByPrivateKey(prv_key);
   core::UnitHash prev_hash;
@@ -1491,7 +1575,6 @@ bool ambr::store::StoreManager::ReceiveFromUnitHash(
     core::UnitHash* tx_hash,
     std::shared_ptr<ambr::core::Unit>& unit_received,
     std::string* err){
-  LockGrade lk(mutex_);
   std::shared_ptr<core::ReceiveUnit> unit = std::shared_ptr<core::ReceiveUnit>(new core::ReceiveUnit());
   core::PublicKey pub_key = ambr::core::GetPublicKeyByPrivateKey(pri_key);
   core::UnitHash prev_hash;
@@ -1540,7 +1623,6 @@ bool ambr::store::StoreManager::ReceiveFromValidator(
     core::UnitHash* tx_hash,
     std::shared_ptr<ambr::core::Unit>& unit_received,
     std::string* err){
-  LockGrade lk(mutex_);
   std::shared_ptr<core::ReceiveUnit> unit = std::shared_ptr<core::ReceiveUnit>(new core::ReceiveUnit());
   core::PublicKey pub_key = ambr::core::GetPublicKeyByPrivateKey(pri_key);
   core::UnitHash prev_hash;
@@ -1580,7 +1662,6 @@ bool ambr::store::StoreManager::JoinValidatorSet(const core::PrivateKey& pri_key
                                                  core::UnitHash* tx_hash,
                                                  std::shared_ptr<ambr::core::Unit>& unit_join,
                                                  std::string* err){
-  LockGrade lk(mutex_);
   std::shared_ptr<ambr::core::EnterValidateSetUnit> unit = std::make_shared<ambr::core::EnterValidateSetUnit>();
   core::PublicKey pub_key = core::GetPublicKeyByPrivateKey(pri_key);
   core::UnitHash last_hash;
@@ -1626,7 +1707,6 @@ bool ambr::store::StoreManager::LeaveValidatorSet(const core::PrivateKey& pri_ke
                                                   std::shared_ptr<ambr::core::Unit>& unit_leave,
                                                   std::string* err)
 {
-  LockGrade lk(mutex_);
   std::shared_ptr<ambr::core::LeaveValidateSetUnit> unit = std::make_shared<ambr::core::LeaveValidateSetUnit>();
   core::PublicKey pub_key = core::GetPublicKeyByPrivateKey(pri_key);
   core::UnitHash last_hash;
@@ -1667,7 +1747,6 @@ bool ambr::store::StoreManager::PublishValidator(
     std::shared_ptr<ambr::core::ValidatorUnit>& unit_validator,
     std::string* err
     ){
-  LockGrade lk(mutex_);
   std::shared_ptr<core::ValidatorUnit> unit = std::make_shared<core::ValidatorUnit>();
   unit->set_version((uint32_t)0x000000001);
   unit->set_type(core::UnitType::Validator);
@@ -1714,14 +1793,26 @@ bool ambr::store::StoreManager::PublishValidator(
     }
   }
 
-  for(core::VoteUnit vote_unit:unit->vote_list()){
-    std::string validate_err;
-    if(!vote_unit.Validate(&validate_err)){
+  std::vector<core::VoteUnit> vote_unit_list = unit->vote_list();
+  {//verify signatures of vote list in batch
+    std::vector<const core::Unit*> vote_ptr_list;
+    for(const core::VoteUnit& vote_unit:vote_unit_list){
+      vote_ptr_list.push_back(&vote_unit);
+    }
+    std::vector<std::string> validate_err_list;
+    if(!core::Unit::ValidateBatch(vote_ptr_list, nullptr, &validate_err_list)){
       if(err){
-        *err = std::string("One of validate unit is not right:")+validate_err;
+        for(const std::string& validate_err:validate_err_list){
+          if(validate_err.size()){
+            *err = std::string("One of validate unit is not right:")+validate_err;
+            break;
+          }
+        }
       }
       return false;
     }
+  }
+  for(core::VoteUnit vote_unit:vote_unit_list){
     ValidatorItem item;
     if(!validator_set->GetValidator(vote_unit.public_key(), item) ||
        !validator_set->IsValidator(vote_unit.public_key(), unit->nonce())){
@@ -1772,7 +1863,6 @@ bool ambr::store::StoreManager::PublishVote(const core::PrivateKey& pri_key,
                                             bool accept,
                                             std::shared_ptr<ambr::core::VoteUnit>& unit_vote,
                                             std::string* err){
-  LockGrade lk(mutex_);
   std::shared_ptr<core::VoteUnit> unit = std::make_shared<core::VoteUnit>();
   unit->set_version(0x00000001);
   unit->set_type(core::UnitType::Vote);
@@ -1813,92 +1903,109 @@ bool ambr::store::StoreManager::PublishVote(const core::PrivateKey& pri_key,
 
 
 std::list<ambr::core::UnitHash> ambr::store::StoreManager::GetWaitForReceiveList(const ambr::core::PublicKey &pub_key){
-  LockGrade lk(mutex_);
-  //TODO Improve efficiency
-  std::string string_readed;
-  db_.Read(
-             handle_wait_for_receive_,
-             std::string((const char*)pub_key.bytes().data(), pub_key.bytes().size()),
-             string_readed);
-
-  size_t idx = 0;
   std::list<ambr::core::UnitHash> rtn;
-  while(idx+sizeof(core::UnitHash) <= string_readed.size()){
-    //std::array<uint8_t, sizeof(core::UnitHash)> xxx = *(std::array<uint8_t, sizeof(core::UnitHash)>*)(string_readed.data()+idx);
-    rtn.push_back(core::UnitHash(*(std::array<uint8_t, sizeof(core::UnitHash)>*)(string_readed.data()+idx)));
-    idx += sizeof(core::UnitHash);
+  db_.ForeachPrefix(handle_wait_for_receive_,
+                    std::string((const char*)pub_key.bytes().data(), pub_key.bytes().size()),
+                    std::string(),
+                    [&](const std::string& key, const std::string& value)->bool{
+    core::UnitHash hash;
+    hash.set_bytes(key.data()+sizeof(core::PublicKey), key.size()-sizeof(core::PublicKey));
+    rtn.push_back(hash);
+    return true;
+  });
+  return rtn;
+}
+
+std::list<std::pair<ambr::core::UnitHash, ambr::core::Amount>> ambr::store::StoreManager::GetWaitForReceiveListWithAmount(
+    const ambr::core::PublicKey &pub_key,
+    const ambr::core::UnitHash &start_after,
+    size_t count){
+  std::list<std::pair<core::UnitHash, core::Amount>> rtn;
+  std::string prefix((const char*)pub_key.bytes().data(), pub_key.bytes().size());
+  std::string start_key;
+  if(!start_after.is_zero()){
+    start_key = prefix+std::string((const char*)start_after.bytes().data(), start_after.bytes().size());
   }
+  db_.ForeachPrefix(handle_wait_for_receive_, prefix, start_key,
+                    [&](const std::string& key, const std::string& value)->bool{
+    if(rtn.size() >= count){
+      return false;
+    }
+    core::UnitHash hash;
+    hash.set_bytes(key.data()+sizeof(core::PublicKey), key.size()-sizeof(core::PublicKey));
+    if(hash == start_after){//start key is inclusive
+      return true;
+    }
+    core::Amount amount;
+    amount.set_bytes(value.data(), value.size());
+    rtn.push_back(std::make_pair(hash, amount));
+    return true;
+  });
   return rtn;
 }
 
-std::shared_ptr<ambr::store::UnitStore> ambr::store::StoreManager::GetUnit(const ambr::core::UnitHash &hash){
-  std::shared_ptr<ambr::store::UnitStore> unit;
-  if(unit = GetSendUnit(hash)){
-    return unit;
-  }else if(unit = GetReceiveUnit(hash)){
-    return unit;
-  }else if(unit = GetEnterValidatorSetUnit(hash)){
-    return unit;
-  }else if(unit = GetLeaveValidatorSetUnit(hash)){
-    return unit;
-  }else if(unit = GetValidateUnit(hash)){
-    return unit;
-  }else{
-    return nullptr;
+//copy of cached unit store, caller may modify it
+static std::shared_ptr<ambr::store::UnitStore> CopyUnitStore(const std::shared_ptr<const ambr::store::UnitStore>& store){
+  if(auto send_store = std::dynamic_pointer_cast<const ambr::store::SendUnitStore>(store)){
+    return std::make_shared<ambr::store::SendUnitStore>(*send_store);
   }
+  if(auto receive_store = std::dynamic_pointer_cast<const ambr::store::ReceiveUnitStore>(store)){
+    return std::make_shared<ambr::store::ReceiveUnitStore>(*receive_store);
+  }
+  if(auto enter_store = std::dynamic_pointer_cast<const ambr::store::EnterValidatorSetUnitStore>(store)){
+    return std::make_shared<ambr::store::EnterValidatorSetUnitStore>(*enter_store);
+  }
+  if(auto leave_store = std::dynamic_pointer_cast<const ambr::store::LeaveValidatorSetUnitStore>(store)){
+    return std::make_shared<ambr::store::LeaveValidatorSetUnitStore>(*leave_store);
+  }
+  if(auto validator_store = std::dynamic_pointer_cast<const ambr::store::ValidatorUnitStore>(store)){
+    return std::make_shared<ambr::store::ValidatorUnitStore>(*validator_store);
+  }
+  return nullptr;
 }
 
-std::shared_ptr<ambr::store::SendUnitStore> ambr::store::StoreManager::GetSendUnit(const ambr::core::UnitHash &hash){
-  std::shared_ptr<ambr::store::SendUnitStore> rtn;
+std::shared_ptr<ambr::store::UnitStore> ambr::store::StoreManager::GetUnit(const ambr::core::UnitHash &hash){
+  //unit in cache is found by hash, without reading db
+  std::shared_ptr<const UnitStore> cached = unit_cache_.Get(hash);
+  if(cached){
+    return CopyUnitStore(cached);
+  }
+  uint64_t generation = unit_cache_.GetGeneration(hash);
   std::string string_readed;
-  if(!db_.Read(handle_send_unit_,
+  if(!db_.Read(handle_unit_,
                std::string((const char*)hash.bytes().data(), hash.bytes().size()),
-               string_readed)){
-    return rtn;
+               string_readed) || string_readed.empty()){
+    return nullptr;
   }
-  rtn = std::make_shared<ambr::store::SendUnitStore>(nullptr);
-  if(rtn->DeSerializeByte(std::vector<uint8_t>(string_readed.begin(), string_readed.end()))){
-    return rtn;
+  switch((UnitStore::StoreType)string_readed[0]){
+    case UnitStore::ST_SendUnit:
+      return ParseUnitStore<SendUnitStore>(hash, string_readed, generation);
+    case UnitStore::ST_ReceiveUnit:
+      return ParseUnitStore<ReceiveUnitStore>(hash, string_readed, generation);
+    case UnitStore::ST_EnterValidatorSet:
+      return ParseUnitStore<EnterValidatorSetUnitStore>(hash, string_readed, generation);
+    case UnitStore::ST_LeaveValidatorSet:
+      return ParseUnitStore<LeaveValidatorSetUnitStore>(hash, string_readed, generation);
+    case UnitStore::ST_Validator:
+      return ParseUnitStore<ValidatorUnitStore>(hash, string_readed, generation);
+    default:
+      return nullptr;
   }
-  return std::shared_ptr<ambr::store::SendUnitStore>();
+}
+
+std::shared_ptr<ambr::store::SendUnitStore> ambr::store::StoreManager::GetSendUnit(const ambr::core::UnitHash &hash){
+  return GetUnitStore<SendUnitStore>(UnitStore::ST_SendUnit, hash);
 }
 
 std::shared_ptr<ambr::store::ReceiveUnitStore> ambr::store::StoreManager::GetReceiveUnit(const ambr::core::UnitHash &hash){
-  LockGrade lk(mutex_);
-  std::shared_ptr<ambr::store::ReceiveUnitStore> rtn;
-  std::string string_readed;
-  if(!db_.Read(
-        handle_receive_unit_,
-        std::string((const char*)hash.bytes().data(), hash.bytes().size()),
-        string_readed)){
-    return rtn;
-  }
-  rtn = std::make_shared<ambr::store::ReceiveUnitStore>(nullptr);
-  if(rtn->DeSerializeByte(std::vector<uint8_t>(string_readed.begin(), string_readed.end()))){
-    return rtn;
-  }
-  return std::shared_ptr<ambr::store::ReceiveUnitStore>();
+  return GetUnitStore<ReceiveUnitStore>(UnitStore::ST_ReceiveUnit, hash);
 }
 
 std::shared_ptr<ambr::store::ValidatorUnitStore> ambr::store::StoreManager::GetValidateUnit(const ambr::core::UnitHash &hash){
-  LockGrade lk(mutex_);
-  std::shared_ptr<ambr::store::ValidatorUnitStore> rtn;
-  std::string string_readed;
-  if(!db_.Read(
-        handle_validator_unit_,
-        std::string((const char*)hash.bytes().data(), hash.bytes().size()),
-        string_readed)){
-    return rtn;
-  }
-  rtn = std::make_shared<ambr::store::ValidatorUnitStore>();
-  if(rtn->DeSerializeByte(std::vector<uint8_t>(string_readed.begin(), string_readed.end()))){
-    return rtn;
-  }
-  return std::shared_ptr<ambr::store::ValidatorUnitStore>();
+  return GetUnitStore<ValidatorUnitStore>(UnitStore::ST_Validator, hash);
 }
 
 std::shared_ptr<ambr::store::ValidatorUnitStore> ambr::store::StoreManager::GetLastestValidateUnit(){
-  LockGrade lk(mutex_);
   core::UnitHash last_validate_unit_hash;
   if(!GetLastValidateUnit(last_validate_unit_hash)){
     return nullptr;
@@ -1911,40 +2018,15 @@ std::shared_ptr<ambr::store::ValidatorUnitStore> ambr::store::StoreManager::GetL
 }
 
 std::shared_ptr<ambr::store::EnterValidatorSetUnitStore> ambr::store::StoreManager::GetEnterValidatorSetUnit(const ambr::core::UnitHash &hash){
-  LockGrade lk(mutex_);
-  std::shared_ptr<EnterValidatorSetUnitStore> rtn;
-  std::string string_readed;
-  if(!db_.Read(
-      handle_enter_validator_unit_,
-      std::string((const char*)hash.bytes().data(), hash.bytes().size()),
-      string_readed)){
-    return rtn;
-  }
-  rtn = std::make_shared<EnterValidatorSetUnitStore>();
-  if(rtn->DeSerializeByte(std::vector<uint8_t>(string_readed.begin(), string_readed.end()))){
-    return rtn;
-  }
-  return std::shared_ptr<EnterValidatorSetUnitStore>();
+  return GetUnitStore<EnterValidatorSetUnitStore>(UnitStore::ST_EnterValidatorSet, hash);
 }
 
 std::shared_ptr<ambr::store::LeaveValidatorSetUnitStore> ambr::store::StoreManager::GetLeaveValidatorSetUnit(const ambr::core::UnitHash &hash){
-  LockGrade lk(mutex_);
-  std::shared_ptr<LeaveValidatorSetUnitStore> rtn;
-  std::string string_readed;
-  if(!db_.Read(
-      handle_leave_validator_unit_,
-      std::string((const char*)hash.bytes().data(), hash.bytes().size()),
-      string_readed)){
-    return rtn;
-  }
-  rtn = std::make_shared<LeaveValidatorSetUnitStore>();
-  if(rtn->DeSerializeByte(std::vector<uint8_t>(string_readed.begin(), string_readed.end()))){
-    return rtn;
-  }
-  return std::shared_ptr<ambr::store::LeaveValidatorSetUnitStore>();
+  return GetUnitStore<LeaveValidatorSetUnitStore>(UnitStore::ST_LeaveValidatorSet, hash);
 }
 
 std::list<std::shared_ptr<ambr::core::VoteUnit>> ambr::store::StoreManager::GetVoteList(){
+  std::lock_guard<std::mutex> lk(vote_mutex_);
   return vote_list_;
 }
 
@@ -1963,6 +2045,7 @@ bool ambr::store::StoreManager::GetValidatorIncome(const core::PublicKey& pub_ke
 }
 
 bool ambr::store::StoreManager::RemoveUnit(const ambr::core::UnitHash &hash, std::string* err){
+  ValidatorLock lk(validator_mutex_);
   std::map<core::UnitHash, std::shared_ptr<core::Unit>> unit_for_remove;
   std::list<std::shared_ptr<core::Unit>> will_remove;
 
@@ -1979,6 +2062,8 @@ bool ambr::store::StoreManager::RemoveUnit(const ambr::core::UnitHash &hash, std
   std::map<core::PublicKey,  std::pair<std::set<core::UnitHash>, std::set<core::UnitHash> > > wait_remove_list;
   std::map<core::UnitHash, std::shared_ptr<store::UnitStore>> receive_is_removed;
   std::map<core::UnitHash, std::shared_ptr<store::UnitStore>> send_is_removed;
+  //account whose state should be reload after removed
+  std::set<core::PublicKey> changed_account;
 
   while(will_remove.size()){
     core::UnitHash after_item_hash;
@@ -2000,7 +2085,7 @@ bool ambr::store::StoreManager::RemoveUnit(const ambr::core::UnitHash &hash, std
             case core::UnitType::send:{
                 //unit
                 if(unit_for_remove.find(core_unit->hash()) == unit_for_remove.end()){
-                  db_assert(batch.Delete(handle_send_unit_, std::string((const char*)core_unit->hash().bytes().data(), core_unit->hash().bytes().size())));
+                  RemoveUnitStore(core_unit->hash(), &batch);
 
                   //account
                   if(!core_unit->prev_unit().is_zero()){
@@ -2022,9 +2107,7 @@ bool ambr::store::StoreManager::RemoveUnit(const ambr::core::UnitHash &hash, std
             case core::UnitType::receive:{
                 //unit
                 if(unit_for_remove.find(core_unit->hash()) == unit_for_remove.end()){
-                  db_assert(batch.Delete(
-                           handle_receive_unit_,
-                           std::string((const char*)core_unit->hash().bytes().data(), core_unit->hash().bytes().size())));
+                  RemoveUnitStore(core_unit->hash(), &batch);
                   //account
                   if(!core_unit->prev_unit().is_zero()){
                     db_assert(batch.Write(handle_account_,
@@ -2045,9 +2128,7 @@ bool ambr::store::StoreManager::RemoveUnit(const ambr::core::UnitHash &hash, std
             case core::UnitType::EnterValidateSet:{
                 //unit
                 if(unit_for_remove.find(core_unit->hash()) == unit_for_remove.end()){
-                  db_assert(batch.Delete(
-                           handle_enter_validator_unit_,
-                           std::string((const char*)core_unit->hash().bytes().data(), core_unit->hash().bytes().size())));
+                  RemoveUnitStore(core_unit->hash(), &batch);
                   //account
                   if(!core_unit->prev_unit().is_zero()){
                     db_assert(batch.Write(
@@ -2065,9 +2146,7 @@ bool ambr::store::StoreManager::RemoveUnit(const ambr::core::UnitHash &hash, std
             case core::UnitType::LeaveValidateSet:{
                 if(unit_for_remove.find(core_unit->hash()) == unit_for_remove.end()){
                   //unit
-                  db_assert(batch.Delete(
-                           handle_leave_validator_unit_,
-                           std::string((const char*)core_unit->hash().bytes().data(), core_unit->hash().bytes().size())));
+                  RemoveUnitStore(core_unit->hash(), &batch);
 
                   //account
                   if(!core_unit->prev_unit().is_zero()){
@@ -2091,6 +2170,7 @@ bool ambr::store::StoreManager::RemoveUnit(const ambr::core::UnitHash &hash, std
           }
 
           unit_for_remove.insert(std::pair<core::UnitHash, std::shared_ptr<core::Unit>>(core_unit->hash(), core_unit));
+          changed_account.insert(core_unit->public_key());
 
           if(unit->type() == store::UnitStore::StoreType::ST_SendUnit){
             std::shared_ptr<store::SendUnitStore> send_store = std::dynamic_pointer_cast<store::SendUnitStore>(unit);
@@ -2140,8 +2220,9 @@ bool ambr::store::StoreManager::RemoveUnit(const ambr::core::UnitHash &hash, std
 
         if(validator_unit->percent() < GetPassPercent() || validator_unit->hash() == remove_item->hash()){
           if(unit_for_remove.find(validator_unit->hash()) == unit_for_remove.end()){
+            RemoveUnitStore(validator_unit->hash(), &batch);
             db_assert(batch.Delete(
-                     handle_validator_unit_,
+                     handle_dynasty_manifest_,
                      std::string((const char*)validator_unit->hash().bytes().data(), validator_unit->hash().bytes().size())));
             db_assert(batch.Write(
                      handle_validator_unit_,
@@ -2159,10 +2240,7 @@ bool ambr::store::StoreManager::RemoveUnit(const ambr::core::UnitHash &hash, std
           hash_null.clear();
           final_store->set_next_validator_hash(hash_null);
           std::vector<uint8_t> buf = final_store->SerializeByte();
-          db_assert(batch.Write(
-                   handle_validator_unit_,
-                   std::string((const char*)final_store->unit()->hash().bytes().data(), final_store->unit()->hash().bytes().size()),
-                   std::string((const char*)buf.data(), buf.size())));
+          WriteUnitStore(final_store->unit()->hash(), UnitStore::ST_Validator, buf, &batch);
           break;
         }
         std::shared_ptr<ValidatorUnitStore> validator_unit_store = GetValidateUnit(validator_unit->prev_unit());
@@ -2175,7 +2253,6 @@ bool ambr::store::StoreManager::RemoveUnit(const ambr::core::UnitHash &hash, std
   }
 
   //std::map<core::UnitHash, std::shared_ptr<store::SendUnitStore>> receive_is_removed;
-  std::map<core::PublicKey, std::list<ambr::core::UnitHash>> wait_change;
   for(const std::pair<core::UnitHash, std::shared_ptr<store::UnitStore>>& item:receive_is_removed){
     //std::shared_ptr<store::ReceiveUnitStore> receive_store = std::dynamic_pointer_cast<store::ReceiveUnitStore>(item.second);
     std::shared_ptr<core::ReceiveUnit> receive_unit = std::dynamic_pointer_cast<core::ReceiveUnit>(item.second->GetUnit());
@@ -2183,41 +2260,26 @@ bool ambr::store::StoreManager::RemoveUnit(const ambr::core::UnitHash &hash, std
       std::shared_ptr<store::SendUnitStore> send_store = GetSendUnit(receive_unit->from());
       send_store->set_receive_unit_hash(core::UnitHash());
       std::vector<uint8_t> buf = send_store->SerializeByte();
-      if(wait_change.find(receive_unit->public_key()) == wait_change.end()){
-        wait_change[receive_unit->public_key()] = GetWaitForReceiveList(receive_unit->public_key());
-      }
-      wait_change[receive_unit->public_key()].push_back(send_store->GetUnit()->hash());
-      db_assert(batch.Write(
-               handle_send_unit_,
-               std::string((const char*)send_store->GetUnit()->hash().bytes().data(), send_store->GetUnit()->hash().bytes().size()),
-               std::string((const char*)buf.data(), buf.size())));
+      core::Amount amount;
+      db_assert(GetSendAmount(receive_unit->from(), amount, nullptr));
+      AddWaitForReceiveUnit(receive_unit->public_key(), receive_unit->from(), amount, &batch);
+      changed_account.insert(receive_unit->public_key());
+      WriteUnitStore(send_store->GetUnit()->hash(), UnitStore::ST_SendUnit, buf, &batch);
     }
   }
 
   for(const std::pair<core::UnitHash, std::shared_ptr<store::UnitStore>>& item:send_is_removed){
     //std::shared_ptr<store::ReceiveUnitStore> receive_store = std::dynamic_pointer_cast<store::ReceiveUnitStore>(item.second);
     std::shared_ptr<core::SendUnit> send_unit = std::dynamic_pointer_cast<core::SendUnit>(item.second->GetUnit());
-    if(wait_change.find(send_unit->dest()) == wait_change.end()){
-      wait_change[send_unit->dest()] = GetWaitForReceiveList(send_unit->dest());
-    }
-    auto iter = std::find(wait_change[send_unit->dest()].begin(), wait_change[send_unit->dest()].end(), send_unit->hash());
-    if(iter != wait_change[send_unit->dest()].end()){
-      wait_change[send_unit->dest()].erase(iter);
-    }
-  }
-
-  for(const std::pair<core::PublicKey, std::list<ambr::core::UnitHash>>& item: wait_change){
-    std::string db_str;
-    for(const ambr::core::UnitHash& hash: item.second){
-      db_str.insert(db_str.end(), hash.bytes().begin(), hash.bytes().end());
-    }
-    db_assert(batch.Write(
-             handle_wait_for_receive_,
-             std::string((const char*)item.first.bytes().data(), item.first.bytes().size()),
-             db_str));
+    RemoveWaitForReceiveUnit(send_unit->dest(), send_unit->hash(), &batch);
+    changed_account.insert(send_unit->dest());
   }
 
   db_assert(db_.Write(batch));
+  for(const core::PublicKey& pub_key:changed_account){
+    LoadAccountState(pub_key);
+  }
+  LoadChainTip();
   return true;
 }
 
@@ -2234,7 +2296,6 @@ uint64_t ambr::store::StoreManager::GetTransectionFeeCountWhenReceive(std::share
 }
 
 std::list<ambr::core::UnitHash> ambr::store::StoreManager::GetAccountListFromAccountForDebug(){
-  LockGrade lk(mutex_);
   std::list<ambr::core::UnitHash> rtn_list;
   db_.Foreach(handle_account_, [&](const std::string& key, const std::string& value)->bool{
     ambr::core::UnitHash hash;
@@ -2246,19 +2307,19 @@ std::list<ambr::core::UnitHash> ambr::store::StoreManager::GetAccountListFromAcc
 }
 
 std::list<ambr::core::PublicKey> ambr::store::StoreManager::GetAccountListFromWaitForReceiveForDebug(){
-  LockGrade lk(mutex_);
-  std::list<ambr::core::UnitHash> rtn_list;
+  std::list<ambr::core::PublicKey> rtn_list;
   db_.Foreach(handle_wait_for_receive_, [&](const std::string& key, const std::string& value)->bool{
-    ambr::core::UnitHash hash;
-    hash.set_bytes(key.data(), key.size());
-    rtn_list.push_back(hash);
+    ambr::core::PublicKey pub_key;
+    pub_key.set_bytes(key.data(), sizeof(core::PublicKey));
+    if(rtn_list.empty() || rtn_list.back() != pub_key){//keys of one account are adjacent
+      rtn_list.push_back(pub_key);
+    }
     return true;
   });
   return rtn_list;
 }
 
 std::list<std::pair<ambr::core::PublicKey, ambr::store::ValidatorBalanceStore> > ambr::store::StoreManager::GetValidatorIncomeListForDebug(){
-  LockGrade lk(mutex_);
   std::list<std::pair<ambr::core::PublicKey, ambr::store::ValidatorBalanceStore> > rtn_list;
   db_.Foreach(handle_validator_balance_, [&](const std::string& key, const std::string& value)->bool{
     ambr::core::PublicKey pub_key;
@@ -2280,16 +2341,12 @@ ambr::core::Amount ambr::store::StoreManager::GetBalanceAllForDebug(){
       rtn += tmp;
     }
   }
-  std::list<ambr::core::UnitHash> wait_list =  GetAccountListFromWaitForReceiveForDebug();
-  for(ambr::core::PublicKey pub_key: wait_list){
-    std::list<ambr::core::UnitHash> wait_list_for_pubkey = GetWaitForReceiveList(pub_key);
-    for(ambr::core::UnitHash hash:wait_list_for_pubkey){
-      ambr::core::Amount amount_tmp;
-      if(GetSendAmount(hash, amount_tmp, nullptr)){
-        rtn += amount_tmp;
-      }
-    }
-  }
+  db_.Foreach(handle_wait_for_receive_, [&](const std::string& key, const std::string& value)->bool{
+    ambr::core::Amount amount_tmp;
+    amount_tmp.set_bytes(value.data(), value.size());
+    rtn += amount_tmp;
+    return true;
+  });
   std::list<std::pair<core::PublicKey, store::ValidatorBalanceStore>> validator_income_list = GetValidatorIncomeListForDebug();
   for(std::pair<core::PublicKey, store::ValidatorBalanceStore> item:validator_income_list){
     rtn += item.second.balance_;
@@ -2297,51 +2354,471 @@ ambr::core::Amount ambr::store::StoreManager::GetBalanceAllForDebug(){
   return rtn;
 }
 
-void ambr::store::StoreManager::AddWaitForReceiveUnit(const ambr::core::PublicKey &pub_key, const ambr::core::UnitHash &hash, KeyValueDBInterface::WriteBatch* batch){
-  LockGrade lk(mutex_);
-  //TODO Improve efficiency
-  std::string string_readed;
-  db_.Read(
-    handle_wait_for_receive_,
-    std::string((const char*)pub_key.bytes().data(), pub_key.bytes().size()),
-    string_readed);
-
-  std::vector<uint8_t> vec_for_write(string_readed.begin(), string_readed.end());
-  vec_for_write.insert(vec_for_write.end(), hash.bytes().begin(), hash.bytes().end());
+void ambr::store::StoreManager::AddWaitForReceiveUnit(const ambr::core::PublicKey &pub_key, const ambr::core::UnitHash &hash, const ambr::core::Amount& amount, KeyValueDBInterface::WriteBatch* batch){
+  std::string key((const char*)pub_key.bytes().data(), pub_key.bytes().size());
+  key.append((const char*)hash.bytes().data(), hash.bytes().size());
+  std::string value((const char*)amount.bytes().data(), amount.bytes().size());
   if(batch){
-    db_assert(batch->Write(handle_wait_for_receive_,
-                        std::string((const char*)pub_key.bytes().data(), pub_key.bytes().size()),
-                        std::string((const char*)vec_for_write.data(), vec_for_write.size())));
+    db_assert(batch->Write(handle_wait_for_receive_, key, value));
   }else{
-    db_assert(db_.Write(handle_wait_for_receive_,
-                      std::string((const char*)pub_key.bytes().data(), pub_key.bytes().size()),
-                      std::string((const char*)vec_for_write.data(), vec_for_write.size())));
+    db_assert(db_.Write(handle_wait_for_receive_, key, value));
   }
 }
 
 void ambr::store::StoreManager::RemoveWaitForReceiveUnit(const ambr::core::PublicKey &pub_key, const ambr::core::UnitHash &hash, KeyValueDBInterface::WriteBatch *batch){
-  LockGrade lk(mutex_);
-  std::list<core::UnitHash> hash_list = GetWaitForReceiveList(pub_key);
-  hash_list.remove(hash);
-  std::vector<uint8_t> vec_for_write;
-  for(std::list<core::UnitHash>::iterator iter = hash_list.begin(); iter != hash_list.end(); iter++){
-    vec_for_write.insert(vec_for_write.end(), iter->bytes().begin(), iter->bytes().end());
+  std::string key((const char*)pub_key.bytes().data(), pub_key.bytes().size());
+  key.append((const char*)hash.bytes().data(), hash.bytes().size());
+  if(batch){
+    db_assert(batch->Delete(handle_wait_for_receive_, key));
+  }else{
+    KeyValueDBInterface::WriteBatch batch_tmp;
+    db_assert(batch_tmp.Delete(handle_wait_for_receive_, key));
+    db_assert(db_.Write(batch_tmp));
   }
+}
 
-  if(batch){
-    db_assert(batch->Write(handle_wait_for_receive_,
-                        std::string((const char*)pub_key.bytes().data(), pub_key.bytes().size()),
-                        std::string((const char*)vec_for_write.data(), vec_for_write.size())));
+void ambr::store::StoreManager::UpgradeWaitForReceive(){
+  std::string version_readed;
+  if(db_.Read(handle_wait_for_receive_old_, wait_for_receive_version_key, version_readed) && version_readed == wait_for_receive_version){
+    return;
+  }
+  KeyValueDBInterface::WriteBatch batch;
+  size_t count = 0, skip_count = 0;
+  db_.Foreach(handle_wait_for_receive_old_, [&](const std::string& key, const std::string& value)->bool{
+    if(key.size() != sizeof(core::PublicKey)){
+      return true;
+    }
+    ambr::core::PublicKey pub_key;
+    pub_key.set_bytes(key.data(), key.size());
+    for(size_t idx = 0; idx+sizeof(core::UnitHash) <= value.size(); idx += sizeof(core::UnitHash)){
+      core::UnitHash hash;
+      core::Amount amount;
+      hash.set_bytes(value.data()+idx, sizeof(core::UnitHash));
+      //entry of old database may be inconsistent, it can't be received anyway
+      if(!GetSendAmount(hash, amount, nullptr)){
+        LOG(WARNING)<<"Skip wait for receive unit of "<<pub_key.encode_to_hex()<<", send unit is not found:"<<hash.encode_to_hex();
+        skip_count++;
+        continue;
+      }
+      AddWaitForReceiveUnit(pub_key, hash, amount, &batch);
+      count++;
+    }
+    db_assert(batch.Delete(handle_wait_for_receive_old_, key));
+    return true;
+  });
+  if(!db_.Write(batch)){
+    LOG(ERROR)<<"Upgrade wait for receive list failed, retry at next start";
+    return;
+  }
+  //marked only after entries are committed, so interrupted upgrade is run again
+  db_assert(db_.Write(handle_wait_for_receive_old_, wait_for_receive_version_key, wait_for_receive_version));
+  if(count || skip_count){
+    LOG(INFO)<<"Upgrade wait for receive list, count:"<<count<<", skipped:"<<skip_count;
+  }
+}
+
+template<class T>
+std::shared_ptr<T> ambr::store::StoreManager::GetUnitStore(UnitStore::StoreType type, const ambr::core::UnitHash& hash){
+  std::shared_ptr<const T> cached = std::dynamic_pointer_cast<const T>(unit_cache_.Get(hash));
+  if(cached){//caller may modify it
+    return std::make_shared<T>(*cached);
+  }
+  uint64_t generation = unit_cache_.GetGeneration(hash);
+  std::string string_readed;
+  if(!db_.Read(handle_unit_,
+               std::string((const char*)hash.bytes().data(), hash.bytes().size()),
+               string_readed) || string_readed.empty() || string_readed[0] != (char)type){
+    return std::shared_ptr<T>();
+  }
+  return ParseUnitStore<T>(hash, string_readed, generation);
+}
+
+template<class T>
+std::shared_ptr<T> ambr::store::StoreManager::ParseUnitStore(const ambr::core::UnitHash& hash, const std::string& value, uint64_t generation){
+  std::shared_ptr<T> rtn = std::make_shared<T>();
+  if(!rtn->DeSerializeByte(std::vector<uint8_t>(value.begin()+1, value.end()))){
+    return std::shared_ptr<T>();
+  }
+  unit_cache_.Insert(hash, std::make_shared<T>(*rtn), value.size()-1+sizeof(T), generation);
+  return rtn;
+}
+
+void ambr::store::StoreManager::OnDBCommit(KeyValueDBInterface::TableHandle* table_handle, const std::string& key){
+  if(key.size() != sizeof(core::UnitHash)){
+    return;
+  }
+  if(table_handle == handle_unit_){
+    core::UnitHash hash;
+    hash.set_bytes(key.data(), key.size());
+    unit_cache_.Invalidate(hash);
+  }
+}
+
+void ambr::store::StoreManager::LoadAccountState(const ambr::core::PublicKey& pub_key){
+  AccountState state;
+  std::string value_get;
+  if(db_.Read(handle_account_,
+              std::string((const char*)pub_key.bytes().data(), pub_key.bytes().size()),
+              value_get)){
+    state.head_.set_bytes(value_get.data(), value_get.size());
+    std::shared_ptr<UnitStore> store = GetUnit(state.head_);
+    db_assert(store);
+    state.balance_ = store->GetUnit()->balance();
+    state.validated_ = store->is_validate();
+  }
+  db_.ForeachPrefix(handle_wait_for_receive_,
+                    std::string((const char*)pub_key.bytes().data(), pub_key.bytes().size()),
+                    std::string(),
+                    [&](const std::string& key, const std::string& value)->bool{
+    state.pending_count_++;
+    return true;
+  });
+  if(state.head_.is_zero() && !state.pending_count_){
+    account_state_.Remove(pub_key);
   }else{
-    db_assert(db_.Write(
-                       handle_wait_for_receive_,
-                       std::string((const char*)pub_key.bytes().data(), pub_key.bytes().size()),
-                       std::string((const char*)vec_for_write.data(), vec_for_write.size())));
+    account_state_.Set(pub_key, state);
   }
 }
 
+void ambr::store::StoreManager::LoadAllAccountState(){
+  account_state_.Clear();
+  db_.Foreach(handle_account_, [&](const std::string& key, const std::string& value)->bool{
+    ambr::core::PublicKey pub_key;
+    AccountState state;
+    pub_key.set_bytes(key.data(), key.size());
+    state.head_.set_bytes(value.data(), value.size());
+    std::shared_ptr<UnitStore> store = GetUnit(state.head_);
+    db_assert(store);
+    state.balance_ = store->GetUnit()->balance();
+    state.validated_ = store->is_validate();
+    account_state_.Set(pub_key, state);
+    return true;
+  });
+  db_.Foreach(handle_wait_for_receive_, [&](const std::string& key, const std::string& value)->bool{
+    ambr::core::PublicKey pub_key;
+    pub_key.set_bytes(key.data(), sizeof(core::PublicKey));
+    account_state_.AddPending(pub_key, 1);
+    return true;
+  });
+  LOG(INFO)<<"Load account state, account count:"<<account_state_.size();
+}
+
+void ambr::store::StoreManager::LoadChainTip(){
+  std::shared_ptr<const ChainTip> old_tip = GetChainTip();
+  std::shared_ptr<ChainTip> tip = std::make_shared<ChainTip>();
+  //validator set may be changed by removed units, readers compare version only
+  tip->validator_set_version_ = old_tip->validator_set_version_+1;
+  std::string value_get;
+  if(db_.Read(handle_validator_unit_, std::string(last_validate_key), value_get)){
+    tip->last_validator_hash_.set_bytes(value_get.data(), value_get.size());
+    std::shared_ptr<ValidatorUnitStore> validator_store = GetValidateUnit(tip->last_validator_hash_);
+    if(validator_store){
+      tip->last_validator_nonce_ = validator_store->unit()->nonce();
+    }
+    while(validator_store && !validator_store->is_validate()){
+      validator_store = GetValidateUnit(validator_store->unit()->prev_unit());
+    }
+    if(validator_store){
+      tip->last_confirmed_hash_ = validator_store->unit()->hash();
+    }
+  }
+  std::atomic_store(&chain_tip_, std::shared_ptr<const ChainTip>(tip));
+}
+
+void ambr::store::StoreManager::LoadNewUnitIndex(){
+  new_unit_index_.Clear();
+  db_.Foreach(handle_new_account_, [&](const std::string& key, const std::string& value)->bool{
+    ambr::core::PublicKey pub_key;
+    ambr::core::UnitHash unit_hash;
+    pub_key.set_bytes(key.data(), key.size());
+    unit_hash.set_bytes(value.data(), value.size());
+    new_unit_index_.Set(pub_key, unit_hash);
+    return true;
+  });
+  LOG(INFO)<<"Load new unit index, count:"<<new_unit_index_.size();
+}
+
+std::vector<size_t> ambr::store::StoreManager::SortUnitByDependency(const std::vector<std::shared_ptr<ambr::core::Unit>>& unit_list,
+                                                                    const std::vector<size_t>& index_list){
+  //a unit depends on it's previous unit and on the send unit it receives
+  std::unordered_map<core::UnitHash, size_t, UnitHashHasher> hash_map;
+  for(size_t i:index_list){
+    hash_map.insert(std::make_pair(unit_list[i]->hash(), i));
+  }
+  std::unordered_map<size_t, size_t> depend_count;
+  std::unordered_map<size_t, std::vector<size_t>> child_map;
+  for(size_t i:index_list){
+    std::vector<core::UnitHash> depend_list = {unit_list[i]->prev_unit()};
+    if(unit_list[i]->type() == core::UnitType::receive){
+      std::shared_ptr<core::ReceiveUnit> receive_unit = std::dynamic_pointer_cast<core::ReceiveUnit>(unit_list[i]);
+      if(receive_unit)depend_list.push_back(receive_unit->from());
+    }
+    depend_count[i] = 0;
+    for(const core::UnitHash& hash:depend_list){
+      auto iter = hash_map.find(hash);
+      if(iter != hash_map.end() && iter->second != i){
+        depend_count[i]++;
+        child_map[iter->second].push_back(i);
+      }
+    }
+  }
+  //keep input order between independent units
+  std::vector<size_t> rtn;
+  std::set<size_t> ready;
+  for(size_t i:index_list){
+    if(!depend_count[i])ready.insert(i);
+  }
+  while(ready.size()){
+    size_t i = *ready.begin();
+    ready.erase(ready.begin());
+    rtn.push_back(i);
+    for(size_t child:child_map[i]){
+      if(!--depend_count[child])ready.insert(child);
+    }
+  }
+  //circular dependency, they will fail at prev unit check
+  for(size_t i:index_list){
+    if(depend_count[i])rtn.push_back(i);
+  }
+  return rtn;
+}
+
+size_t ambr::store::StoreManager::AddUnitsBatch(const std::vector<std::shared_ptr<ambr::core::Unit>>& unit_list,
+                                                const std::vector<size_t>& order,
+                                                size_t begin,
+                                                std::vector<bool>& result,
+                                                std::vector<std::string>& err){
+  std::vector<core::PublicKey> pub_key_list;
+  for(size_t idx = begin; idx < order.size(); idx++){
+    pub_key_list.push_back(unit_list[order[idx]]->public_key());
+    if(unit_list[order[idx]]->type() == core::UnitType::send){
+      std::shared_ptr<core::SendUnit> send_unit = std::dynamic_pointer_cast<core::SendUnit>(unit_list[order[idx]]);
+      if(send_unit)pub_key_list.push_back(send_unit->dest());
+    }
+  }
+  AccountLock lk(this, pub_key_list);
+  //pending writes of batch, units are checked against them before the db
+  std::unordered_map<core::PublicKey, AccountState, PublicKeyHasher> state_overlay;
+  std::unordered_map<core::UnitHash, std::pair<std::shared_ptr<SendUnitStore>, core::Amount>, UnitHashHasher> send_overlay;
+  std::unordered_set<core::UnitHash, UnitHashHasher> received_set;
+  auto get_state = [&](const core::PublicKey& pub_key)->AccountState&{
+    auto iter = state_overlay.find(pub_key);
+    if(iter == state_overlay.end()){
+      AccountState state;
+      account_state_.Get(pub_key, state);
+      iter = state_overlay.insert(std::make_pair(pub_key, state)).first;
+    }
+    return iter->second;
+  };
+
+  KeyValueDBInterface::WriteBatch batch;
+  std::vector<std::shared_ptr<core::Unit>> staged_list;
+  size_t idx = begin;
+  for(; idx < order.size(); idx++){
+    size_t i = order[idx];
+    if(unit_list[i]->type() == core::UnitType::send){
+      std::shared_ptr<core::SendUnit> send_unit = std::dynamic_pointer_cast<core::SendUnit>(unit_list[i]);
+      if(!send_unit){
+        err[i] = "Unit cast to SendUnit error.";
+        continue;
+      }
+      AccountState& state = get_state(send_unit->public_key());
+      if(!CheckSendUnit(send_unit, state, &err[i])){
+        continue;
+      }
+      core::Amount send_amount;
+      send_amount.set_data(state.balance_.data()-send_unit->balance().data()-
+                           GetTransectionFeeCountWhenReceive(send_unit));
+      WriteSendUnit(send_unit, send_amount, &batch);
+      state.head_ = send_unit->hash();
+      state.balance_ = send_unit->balance();
+      send_overlay[send_unit->hash()] = std::make_pair(std::make_shared<SendUnitStore>(send_unit), send_amount);
+    }else if(unit_list[i]->type() == core::UnitType::receive){
+      std::shared_ptr<core::ReceiveUnit> receive_unit = std::dynamic_pointer_cast<core::ReceiveUnit>(unit_list[i]);
+      if(!receive_unit){
+        err[i] = "receive_unit is nullptr.";
+        continue;
+      }
+      std::shared_ptr<SendUnitStore> send_unit_store;
+      core::Amount send_amount;
+      auto iter = send_overlay.find(receive_unit->from());
+      if(iter != send_overlay.end()){
+        send_unit_store = iter->second.first;
+        send_amount = iter->second.second;
+      }else if(received_set.find(receive_unit->from()) != received_set.end()){
+        err[i] = "Send unit is received.";
+        continue;
+      }else{
+        send_unit_store = GetSendUnit(receive_unit->from());
+        if(!send_unit_store){//receive of validator income or missing send unit, add it alone
+          break;
+        }
+        if(!send_unit_store->receive_unit_hash().is_zero()){
+          err[i] = "Send unit is received.";
+          continue;
+        }
+        if(!GetSendAmount(receive_unit->from(), send_amount, &err[i])){
+          continue;
+        }
+      }
+      if(send_unit_store->unit()->dest() != receive_unit->public_key()){
+        err[i] = "This receiver is not right.";
+        continue;
+      }
+      AccountState& state = get_state(receive_unit->public_key());
+      if(state.head_ != receive_unit->prev_unit()){
+        err[i] = "Prv unit is not last unit of account";
+        continue;
+      }
+      if(receive_unit->balance().data()-state.balance_.data() != send_amount.data()){
+        err[i] = "Error balance number.";
+        continue;
+      }
+      WriteReceiveUnit(receive_unit, send_unit_store, &batch);
+      send_overlay.erase(receive_unit->from());
+      received_set.insert(receive_unit->from());
+      state.head_ = receive_unit->hash();
+      state.balance_ = receive_unit->balance();
+    }else{
+      break;
+    }
+    result[i] = true;
+    staged_list.push_back(unit_list[i]);
+  }
+  if(staged_list.empty()){
+    return idx;
+  }
+
+  db_assert(db_.Write(batch));
+  for(std::shared_ptr<core::Unit> unit:staged_list){
+    account_state_.UpdateHead(unit->public_key(), unit->hash(), unit->balance());
+    new_unit_index_.Set(unit->public_key(), unit->hash());
+    if(unit->type() == core::UnitType::send){
+      account_state_.AddPending(std::dynamic_pointer_cast<core::SendUnit>(unit)->dest(), 1);
+    }else{
+      account_state_.AddPending(unit->public_key(), -1);
+    }
+  }
+  lk.unlock();
+  for(std::shared_ptr<core::Unit> unit:staged_list){
+    if(unit->type() == core::UnitType::send){
+      DoReceiveNewSendUnit(std::dynamic_pointer_cast<core::SendUnit>(unit));
+    }else{
+      DoReceiveNewReceiveUnit(std::dynamic_pointer_cast<core::ReceiveUnit>(unit));
+    }
+  }
+  return idx;
+}
+
+bool ambr::store::StoreManager::CheckSendUnit(std::shared_ptr<ambr::core::SendUnit> send_unit, const AccountState& account_state, std::string* err){
+  {//check prv unit
+    if(account_state.head_.is_zero()){
+      if(err){
+        *err = "Public key is not exist";
+      }
+      return false;
+    }
+    if(account_state.head_ != send_unit->prev_unit()){
+      if(err){
+        *err = "Prv unit is not last unit of account";
+      }
+      return false;
+    }
+  }
+  //check balance
+  {
+    if(send_unit->balance() - account_state.balance_ < GetTransectionFeeCountWhenReceive(send_unit)){
+      if(err){
+        *err = "Insufficient balance!";
+      }
+      return false;
+    }
+  }
+  return true;
+}
+
+void ambr::store::StoreManager::WriteSendUnit(std::shared_ptr<ambr::core::SendUnit> send_unit, const ambr::core::Amount& send_amount, KeyValueDBInterface::WriteBatch* batch){
+  std::shared_ptr<SendUnitStore> store = std::make_shared<SendUnitStore>(send_unit);
+  std::vector<uint8_t> bytes = store->SerializeByte();
+  WriteUnitStore(send_unit->hash(), UnitStore::ST_SendUnit, bytes, batch);
+  db_assert(batch->Write(handle_account_, std::string((const char*)send_unit->public_key().bytes().data(), send_unit->public_key().bytes().size()),
+            std::string((const char*)send_unit->hash().bytes().data(), send_unit->hash().bytes().size())));
+
+  db_assert(batch->Write(handle_new_account_, std::string((const char*)send_unit->public_key().bytes().data(), send_unit->public_key().bytes().size()),
+            std::string((const char*)send_unit->hash().bytes().data(), send_unit->hash().bytes().size())));
+  AddWaitForReceiveUnit(send_unit->dest(), send_unit->hash(), send_amount, batch);
+}
+
+void ambr::store::StoreManager::WriteReceiveUnit(std::shared_ptr<ambr::core::ReceiveUnit> receive_unit, std::shared_ptr<SendUnitStore> send_unit_store, KeyValueDBInterface::WriteBatch* batch){
+  auto receive_unit_store = std::make_shared<ReceiveUnitStore>(receive_unit);
+  std::vector<uint8_t> bytes = receive_unit_store->SerializeByte();
+  WriteUnitStore(receive_unit->hash(), UnitStore::ST_ReceiveUnit, bytes, batch);
+  db_assert(batch->Write(handle_account_, std::string((const char*)receive_unit->public_key().bytes().data(), receive_unit->public_key().bytes().size()),
+            std::string((const char*)receive_unit->hash().bytes().data(), receive_unit->hash().bytes().size())));
+  db_assert(batch->Write(handle_new_account_, std::string((const char*)receive_unit->public_key().bytes().data(), receive_unit->public_key().bytes().size()),
+            std::string((const char*)receive_unit->hash().bytes().data(), receive_unit->hash().bytes().size())));
+  send_unit_store->set_receive_unit_hash(receive_unit->hash());
+  bytes = send_unit_store->SerializeByte();
+  WriteUnitStore(send_unit_store->unit()->hash(), UnitStore::ST_SendUnit, bytes, batch);
+  RemoveWaitForReceiveUnit(receive_unit->public_key(), receive_unit->from(), batch);
+}
+
+void ambr::store::StoreManager::WriteUnitStore(const ambr::core::UnitHash& hash, UnitStore::StoreType type, const std::vector<uint8_t>& buf, KeyValueDBInterface::WriteBatch* batch){
+  std::string value(1, (char)type);
+  value.append((const char*)buf.data(), buf.size());
+  db_assert(batch->Write(handle_unit_,
+                         std::string((const char*)hash.bytes().data(), hash.bytes().size()),
+                         value));
+}
+
+void ambr::store::StoreManager::WriteDynastyManifest(const ambr::core::UnitHash& hash, const std::vector<ambr::core::UnitHash>& hash_list, KeyValueDBInterface::WriteBatch* batch){
+  std::string value;
+  value.reserve(hash_list.size()*sizeof(core::UnitHash));
+  for(const core::UnitHash& unit_hash:hash_list){
+    value.append((const char*)unit_hash.bytes().data(), unit_hash.bytes().size());
+  }
+  db_assert(batch->Write(handle_dynasty_manifest_,
+                         std::string((const char*)hash.bytes().data(), hash.bytes().size()),
+                         value));
+}
+
+void ambr::store::StoreManager::RemoveUnitStore(const ambr::core::UnitHash& hash, KeyValueDBInterface::WriteBatch* batch){
+  db_assert(batch->Delete(handle_unit_,
+                          std::string((const char*)hash.bytes().data(), hash.bytes().size())));
+}
+
+void ambr::store::StoreManager::BuildUnitTable(){
+  std::string version_readed;
+  if(db_.Read(handle_unit_, unit_type_version_key, version_readed) && version_readed == unit_type_version){
+    return;
+  }
+  LOG(INFO)<<"Build unit table";
+  std::vector<std::pair<KeyValueDBInterface::TableHandle*, UnitStore::StoreType>> table_list = {
+    {handle_send_unit_, UnitStore::ST_SendUnit},
+    {handle_receive_unit_, UnitStore::ST_ReceiveUnit},
+    {handle_enter_validator_unit_, UnitStore::ST_EnterValidatorSet},
+    {handle_leave_validator_unit_, UnitStore::ST_LeaveValidatorSet},
+    {handle_validator_unit_, UnitStore::ST_Validator}
+  };
+  KeyValueDBInterface::WriteBatch batch;
+  size_t count = 0;
+  for(const std::pair<KeyValueDBInterface::TableHandle*, UnitStore::StoreType>& table:table_list){
+    db_.Foreach(table.first, [&](const std::string& key, const std::string& value)->bool{
+      if(key.size() != sizeof(core::UnitHash)){//last_validate_key
+        return true;
+      }
+      db_assert(batch.Write(handle_unit_, key, std::string(1, (char)table.second)+value));
+      db_assert(batch.Delete(table.first, key));
+      count++;
+      return true;
+    });
+  }
+  db_assert(batch.Write(handle_unit_, unit_type_version_key, unit_type_version));
+  db_assert(db_.Write(batch));
+  LOG(INFO)<<"Build unit table finished, unit count:"<<count;
+}
+
 void ambr::store::StoreManager::DispositionTransectionFee(const ambr::core::UnitHash& validator_hash, const ambr::core::Amount& count, KeyValueDBInterface::WriteBatch* batch){
-  LockGrade lk(mutex_);
   ambr::core::Amount count_for_disposition = count;
   std::shared_ptr<ambr::store::ValidatorSetStore> validator_set = GetValidatorSet();
 
@@ -2382,6 +2859,39 @@ ambr::store::StoreManager::StoreManager(){
   //Init();
 }
 
+ambr::store::StoreManager::AccountLock::AccountLock(StoreManager* manager, const std::vector<core::PublicKey>& pub_key_list):
+  manager_(manager),
+  validator_lk_(manager->validator_mutex_){
+  for(const core::PublicKey& pub_key:pub_key_list){
+    stripe_list_.push_back(GetAccountStripe(pub_key));
+  }
+  //always lock by order of stripe, avoid dead lock between two accounts which send to each other
+  std::sort(stripe_list_.begin(), stripe_list_.end());
+  stripe_list_.erase(std::unique(stripe_list_.begin(), stripe_list_.end()), stripe_list_.end());
+  for(size_t stripe:stripe_list_){
+    manager_->account_mutex_[stripe].lock();
+  }
+}
+
+ambr::store::StoreManager::AccountLock::~AccountLock(){
+  unlock();
+}
+
+void ambr::store::StoreManager::AccountLock::unlock(){
+  for(auto iter = stripe_list_.rbegin(); iter != stripe_list_.rend(); iter++){
+    manager_->account_mutex_[*iter].unlock();
+  }
+  stripe_list_.clear();
+  if(validator_lk_.owns_lock()){
+    validator_lk_.unlock();
+  }
+}
+
+size_t ambr::store::StoreManager::GetAccountStripe(const ambr::core::PublicKey& pub_key){
+  const std::array<uint8_t, sizeof(ambr::core::PublicKey::ArrayType)>& bytes = pub_key.bytes();
+  return (bytes[0] | (bytes[1]<<8))%ACCOUNT_LOCK_STRIPES;
+}
+
 ambr::store::StoreManager::~StoreManager(){
 }
 
@@ -14,11 +14,25 @@
 #include <store/unit_store.h>
 #include <thread>
 #include <mutex>
+#include <shared_mutex>
+#include <array>
+#include <vector>
 #include "db.h"
-typedef std::lock_guard<std::recursive_mutex> LockGrade;
+#include "unit_cache.h"
+#include "account_state.h"
+#include "new_unit_index.h"
+#include "orphan_pool.h"
 
 namespace ambr {
 namespace store {
+//newest state of validator chain, replaced as a whole so readers get a consistent snapshot without store lock
+struct ChainTip{
+  core::UnitHash last_validator_hash_;//newest validator unit
+  uint64_t last_validator_nonce_ = 0;
+  core::UnitHash last_confirmed_hash_;//newest validator unit passed by votes of a later one
+  uint64_t validator_set_version_ = 0;//increased when validator set may have changed
+};
+
 
 
 class StoreManager{
@@ -36,6 +50,12 @@ public:
   boost::signals2::connection AddCallBackReceiveNewVoteUnit(std::function<void(std::shared_ptr<core::VoteUnit>)> callback);
 public:
   bool AddUnit(std::shared_ptr<core::Unit> unit, std::string* err);
+  //add units in order of dependency, send and receive units are checked against the batch's
+  //own pending writes and committed in one write batch, other units are added one by one.
+  //result_list and err_list are in order of unit_list, return true if all units are added
+  bool AddUnits(const std::vector<std::shared_ptr<core::Unit>>& unit_list,
+                std::vector<bool>* result_list,
+                std::vector<std::string>* err_list);
   bool AddSendUnit(std::shared_ptr<core::SendUnit> send_unit, std::string* err);
   bool AddReceiveUnit(std::shared_ptr<core::ReceiveUnit> receive_unit, std::string* err);
   bool AddEnterValidatorSetUnit(std::shared_ptr<core::EnterValidateSetUnit> unit, std::string* err);
@@ -45,25 +65,47 @@ public:
   void ClearVote();
   void UpdateNewUnitMap(const std::vector<core::UnitHash>& validator_check_list);
 
+  //add unit, if a unit it depends on is not stored yet, keep it in orphan pool until that unit is added.
+  //addtion_data is the peer of unit, passed back by buffer handle callback
   void AddUnitToBuffer(std::shared_ptr<core::Unit> unit, void* addtion_data = nullptr);
+  //add units by AddUnits, units failed are buffered as AddUnitToBuffer
+  void AddUnitsToBuffer(const std::vector<std::shared_ptr<core::Unit>>& unit_list, void* addtion_data = nullptr);
+  size_t GetOrphanCount();
+  size_t GetOrphanMemory();
+  uint64_t GetOrphanWokenCount();
+  uint64_t GetOrphanEvictedCount();
   boost::signals2::connection AddBufferHandleBack(
       std::function<void(
         std::shared_ptr<core::Unit>,
         void*/*addtion_data*/,
         bool/*result*/)>
       callback);
+  //unit is kept in orphan pool waiting for missing, called with unit buffer locked.
+  //not called if missing is in orphan pool too, it's own missing unit was reported
+  boost::signals2::connection AddCallBackOrphanUnit(
+      std::function<void(
+        std::shared_ptr<core::Unit>,
+        void*/*addtion_data*/,
+        const core::UnitHash&/*missing*/)>
+      callback);
 
   bool GetLastValidateUnit(core::UnitHash& hash);
+  //read from chain tip, no db read or signature verify, safe for network thread
   ambr::utils::uint64 GetLastValidatedUnitNonce();
   ambr::core::UnitHash GetLastValidatedUnitHash();
+  std::shared_ptr<const ChainTip> GetChainTip();
   //get next validator hash for syn
   core::UnitHash GetNextValidatorHash(const core::UnitHash& hash);
   // get all unit validated by which validator unit hash is 'hash'
+  //units validated by validator unit of hash in dependency order, validator unit is the last one
   std::list<std::shared_ptr<core::Unit>> GetAllUnitByValidatorUnitHash(const core::UnitHash& hash);
-  std::list<std::shared_ptr<core::Unit>> GetMoreAllUnitByValidatorUnitHash(const core::UnitHash& hash, uint32_t validator_unit_count);
+  //read manifest of dynasty which was written when validator unit of hash was passed
+  bool GetDynastyManifest(const core::UnitHash& hash, std::vector<core::UnitHash>& hash_list);
   std::list<std::shared_ptr<core::ValidatorUnit>> GetValidateHistory(size_t count);
   bool GetLastUnitHashByPubKey(const core::PublicKey& pub_key, core::UnitHash& hash);
   bool GetBalanceByPubKey(const core::PublicKey& pub_key, core::Amount& balance);
+  //head, balance, pending count and validated flag of account, read from memory
+  bool GetAccountState(const core::PublicKey& pub_key, AccountState& state);
   //hash_input is input hash of validator,hash_output is hash for out put
   bool GetNextValidatorHashByHash(const ambr::core::UnitHash &hash_input, ambr::core::UnitHash &hash_output, std::string *err);
 
@@ -136,6 +178,12 @@ public:
                    std::shared_ptr<ambr::core::VoteUnit>& unit_vote,
                    std::string* err);
   std::list<core::UnitHash> GetWaitForReceiveList(const core::PublicKey& pub_key);
+  //send unit hash and amount wait for receive, paged by send unit hash.
+  //start_after is the last hash of previous page, zero for first page
+  std::list<std::pair<core::UnitHash, core::Amount>> GetWaitForReceiveListWithAmount(
+      const core::PublicKey& pub_key,
+      const core::UnitHash& start_after = core::UnitHash(),
+      size_t count = (size_t)-1);
   //get unit(send_unit and receive_unit)
   std::shared_ptr<UnitStore> GetUnit(const core::UnitHash& hash);
   std::shared_ptr<SendUnitStore> GetSendUnit(const core::UnitHash& hash);
@@ -157,7 +205,10 @@ public:
   uint32_t GetValidateUnitInterval(){return validate_unit_interval_;}
   uint64_t GetPassPercent(){return PASS_PERCENT;}
   uint64_t GetNonceByNowTime();
-  std::recursive_mutex& GetMutex(){return mutex_;}
+  //cache of decoded unit store, capacity is bytes of memory, 0 to disable
+  void SetUnitCacheCapacity(size_t capacity){unit_cache_.SetCapacity(capacity);}
+  uint64_t GetUnitCacheHitCount(){return unit_cache_.hit_count();}
+  uint64_t GetUnitCacheMissCount(){return unit_cache_.miss_count();}
   static uint64_t GetTransectionFeeBase(){return 1;}
   static const ambr::core::Amount GetMinValidatorBalance() { return (boost::multiprecision::uint128_t)100000000*1000;}
   uint64_t GetTransectionFeeCountWhenReceive(std::shared_ptr<core::Unit> send_unit);
@@ -176,32 +227,96 @@ public:
     return instance_;
   }
 private:
-  void AddWaitForReceiveUnit(const core::PublicKey& pub_key, const core::UnitHash& hash, KeyValueDBInterface::WriteBatch* batch);
+  void AddWaitForReceiveUnit(const core::PublicKey& pub_key, const core::UnitHash& hash, const core::Amount& amount, KeyValueDBInterface::WriteBatch* batch);
   void RemoveWaitForReceiveUnit(const core::PublicKey& pub_key, const core::UnitHash& hash, KeyValueDBInterface::WriteBatch* batch);
+  //move wait for receive list of old format to one entry per send unit
+  void UpgradeWaitForReceive();
+  bool CheckSendUnit(std::shared_ptr<core::SendUnit> send_unit, const AccountState& account_state, std::string* err);
+  void WriteSendUnit(std::shared_ptr<core::SendUnit> send_unit, const core::Amount& send_amount, KeyValueDBInterface::WriteBatch* batch);
+  void WriteReceiveUnit(std::shared_ptr<core::ReceiveUnit> receive_unit, std::shared_ptr<SendUnitStore> send_unit_store, KeyValueDBInterface::WriteBatch* batch);
+  //index of unit_list, ordered by previous unit and receive's send unit in unit_list
+  static std::vector<size_t> SortUnitByDependency(const std::vector<std::shared_ptr<core::Unit>>& unit_list,
+                                                  const std::vector<size_t>& index_list);
+  //stage units of order from begin in one write batch and commit,
+  //return index of order that is not supported by batch
+  size_t AddUnitsBatch(const std::vector<std::shared_ptr<core::Unit>>& unit_list,
+                       const std::vector<size_t>& order,
+                       size_t begin,
+                       std::vector<bool>& result,
+                       std::vector<std::string>& err);
+private:
+  //units of all types are in unit table with their type as the first byte of value,
+  //so GetUnit resolves a unit by one read
+  void WriteUnitStore(const core::UnitHash& hash, UnitStore::StoreType type, const std::vector<uint8_t>& buf, KeyValueDBInterface::WriteBatch* batch);
+  void RemoveUnitStore(const core::UnitHash& hash, KeyValueDBInterface::WriteBatch* batch);
+  //move units of per type tables into unit table, for database which was created before it
+  void BuildUnitTable();
+  //read unit store of type through unit_cache_
+  template<class T>
+  std::shared_ptr<T> GetUnitStore(UnitStore::StoreType type, const core::UnitHash& hash);
+  //decode value of unit table and put it in unit_cache_
+  template<class T>
+  std::shared_ptr<T> ParseUnitStore(const core::UnitHash& hash, const std::string& value, uint64_t generation);
+  void OnDBCommit(KeyValueDBInterface::TableHandle* table_handle, const std::string& key);
+  //read account's state from db into account_state_
+  void LoadAccountState(const core::PublicKey& pub_key);
+  void LoadAllAccountState();
+  //read new_accout table into new_unit_index_, the table is only read at startup
+  void LoadNewUnitIndex();
+  //rebuild chain_tip_ from validator table
+  void LoadChainTip();
+  void WriteDynastyManifest(const core::UnitHash& hash, const std::vector<core::UnitHash>& hash_list, KeyValueDBInterface::WriteBatch* batch);
 private:
   void DispositionTransectionFee(const ambr::core::UnitHash& validator_hash, const ambr::core::Amount& count, KeyValueDBInterface::WriteBatch* batch);
+private:
+  //lock the stripes of all accounts touched by an append,
+  //and hold validator_mutex_ shared so validator unit can't be applied at the same time
+  class AccountLock{
+  public:
+    AccountLock(StoreManager* manager, const std::vector<core::PublicKey>& pub_key_list);
+    ~AccountLock();
+    //release before firing signals, listeners may add units of other accounts
+    void unlock();
+  private:
+    StoreManager* manager_;
+    std::shared_lock<std::shared_timed_mutex> validator_lk_;
+    std::vector<size_t> stripe_list_;
+  };
+  typedef std::unique_lock<std::shared_timed_mutex> ValidatorLock;
+  static size_t GetAccountStripe(const core::PublicKey& pub_key);
 private:
   static std::shared_ptr<StoreManager> instance_;
 
 private:
   //rocksdb::DB* db_unit_;
   KeyValueDBInterface db_;
-  KeyValueDBInterface::TableHandle* handle_send_unit_;//unit_hash->SendUnitStore
-  KeyValueDBInterface::TableHandle* handle_receive_unit_;//unit_hash->ReceiveUnitStore
+  KeyValueDBInterface::TableHandle* handle_send_unit_;//unit_hash->SendUnitStore, old format only read by BuildUnitTable
+  KeyValueDBInterface::TableHandle* handle_receive_unit_;//unit_hash->ReceiveUnitStore, old format only read by BuildUnitTable
   KeyValueDBInterface::TableHandle* handle_account_;//AccoutPublicKey->LastUnitHash
   KeyValueDBInterface::TableHandle* handle_new_account_;//AccoutPublic(not validated by validator set)->last unit hash
-  KeyValueDBInterface::TableHandle* handle_wait_for_receive_;//AccountPublic->ReceiveList
-  KeyValueDBInterface::TableHandle* handle_validator_unit_;//unit_hash->validate unit
-  KeyValueDBInterface::TableHandle* handle_enter_validator_unit_;//unit_hash->EnterValidatorUnitStore
-  KeyValueDBInterface::TableHandle* handle_leave_validator_unit_;//unit_hash->LeaveValidatorUnitStore
+  KeyValueDBInterface::TableHandle* handle_wait_for_receive_old_;//AccountPublic->ReceiveList, old format only read by upgrade
+  KeyValueDBInterface::TableHandle* handle_wait_for_receive_;//AccountPublic+SendUnitHash->amount, prefix is AccountPublic
+  KeyValueDBInterface::TableHandle* handle_validator_unit_;//last_validate_key->last validate unit hash, unit_hash->validate unit of old format
+  KeyValueDBInterface::TableHandle* handle_enter_validator_unit_;//unit_hash->EnterValidatorUnitStore, old format only read by BuildUnitTable
+  KeyValueDBInterface::TableHandle* handle_leave_validator_unit_;//unit_hash->LeaveValidatorUnitStore, old format only read by BuildUnitTable
   KeyValueDBInterface::TableHandle* handle_validator_set_;//unit_hash->validator_set
   KeyValueDBInterface::TableHandle* handle_validator_balance_;//validator_hash->balance
+  KeyValueDBInterface::TableHandle* handle_unit_;//unit_hash->UnitStore::StoreType(one byte)+serialized unit store, table is named unit_type
+  KeyValueDBInterface::TableHandle* handle_dynasty_manifest_;//validator_unit_hash->hash list of units validated by it
+  UnitCache unit_cache_;
+  AccountStateTable account_state_;
+  NewUnitIndex new_unit_index_;
+  //only replaced under validator lock, read by std::atomic_load
+  std::shared_ptr<const ChainTip> chain_tip_ = std::make_shared<ChainTip>();
   std::list<std::shared_ptr<core::VoteUnit>> vote_list_;
   const uint64_t PERCENT_MAX=10000u;
   const uint64_t PASS_PERCENT=10000u*7/10;
   uint64_t genesis_time_;
   uint32_t validate_unit_interval_ = 3000u;//2s
-  std::recursive_mutex mutex_;
+  static const size_t ACCOUNT_LOCK_STRIPES = 256;
+  std::array<std::mutex, ACCOUNT_LOCK_STRIPES> account_mutex_;//account's stripe->mutex
+  std::shared_timed_mutex validator_mutex_;//exclusive when apply validator unit or remove unit
+  std::mutex vote_mutex_;//for vote_list_
 private:
   boost::signals2::signal<void(std::shared_ptr<core::SendUnit>)> DoReceiveNewSendUnit;
   boost::signals2::signal<void(std::shared_ptr<core::ReceiveUnit>)> DoReceiveNewReceiveUnit;
@@ -215,7 +330,18 @@ private://for unit buffer
       std::shared_ptr<core::Unit>,
       void*/*addtion_data*/,
       bool/*result*/)> buffer_handle_callback_;
-  std::list<std::pair<std::shared_ptr<core::Unit>, void* /*addtion_data*/>> unit_buffer_;
+  boost::signals2::signal<void(
+      std::shared_ptr<core::Unit>,
+      void*/*addtion_data*/,
+      const core::UnitHash&/*missing*/)> orphan_callback_;
+  OrphanPool orphan_pool_;
+  //functions below need unit_buffer_mutex_ locked
+  //first unit which unit depends on and is not stored
+  bool GetMissingDependency(std::shared_ptr<core::Unit> unit, core::UnitHash& missing);
+  //keep unit failed to add in orphan pool, hash of units added meanwhile are appended to added_list
+  void BufferUnit(std::shared_ptr<core::Unit> unit, void* addtion_data, std::list<core::UnitHash>& added_list);
+  //add units waiting for units in added_list, recursively
+  void WakeOrphanUnit(std::list<core::UnitHash>& added_list);
 };
 }
 }
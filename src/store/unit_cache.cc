@@ -0,0 +1,115 @@
+/**********************************************************************
+ * Copyright (c) 2018 Ambr project
+ * Distributed under the MIT software license, see the accompanying   *
+ * file COPYING or http://www.opensource.org/licenses/mit-license.php.*
+ **********************************************************************/
+#include "unit_cache.h"
+#include <string.h>
+
+ambr::store::UnitCache::UnitCache(size_t capacity, size_t shard_count):
+  capacity_(capacity),
+  hit_count_(0),
+  miss_count_(0){
+  if(shard_count == 0)shard_count = 1;
+  for(size_t i = 0; i < shard_count; i++){
+    shard_list_.push_back(std::unique_ptr<Shard>(new Shard()));
+  }
+}
+
+std::shared_ptr<const ambr::store::UnitStore> ambr::store::UnitCache::Get(const ambr::core::UnitHash &hash){
+  Shard& shard = GetShard(hash);
+  std::lock_guard<std::mutex> lk(shard.mutex_);
+  auto iter = shard.item_map_.find(hash);
+  if(iter == shard.item_map_.end()){
+    miss_count_++;
+    return nullptr;
+  }
+  shard.lru_.splice(shard.lru_.begin(), shard.lru_, iter->second.lru_iter_);
+  hit_count_++;
+  return iter->second.store_;
+}
+
+uint64_t ambr::store::UnitCache::GetGeneration(const ambr::core::UnitHash &hash){
+  Shard& shard = GetShard(hash);
+  std::lock_guard<std::mutex> lk(shard.mutex_);
+  return shard.generation_;
+}
+
+void ambr::store::UnitCache::Insert(const ambr::core::UnitHash &hash, std::shared_ptr<const UnitStore> store, size_t charge, uint64_t generation){
+  size_t shard_capacity = capacity_/shard_list_.size();
+  if(!store || charge > shard_capacity){
+    return;
+  }
+  Shard& shard = GetShard(hash);
+  std::lock_guard<std::mutex> lk(shard.mutex_);
+  if(shard.generation_ != generation){//invalidated while reading, store maybe old
+    return;
+  }
+  auto iter = shard.item_map_.find(hash);
+  if(iter != shard.item_map_.end()){
+    shard.usage_ -= iter->second.charge_;
+    shard.lru_.erase(iter->second.lru_iter_);
+    shard.item_map_.erase(iter);
+  }
+  shard.lru_.push_front(hash);
+  Item item;
+  item.store_ = store;
+  item.charge_ = charge;
+  item.lru_iter_ = shard.lru_.begin();
+  shard.item_map_[hash] = item;
+  shard.usage_ += charge;
+  EvictShard(shard, shard_capacity);
+}
+
+void ambr::store::UnitCache::Invalidate(const ambr::core::UnitHash &hash){
+  Shard& shard = GetShard(hash);
+  std::lock_guard<std::mutex> lk(shard.mutex_);
+  shard.generation_++;
+  auto iter = shard.item_map_.find(hash);
+  if(iter != shard.item_map_.end()){
+    shard.usage_ -= iter->second.charge_;
+    shard.lru_.erase(iter->second.lru_iter_);
+    shard.item_map_.erase(iter);
+  }
+}
+
+void ambr::store::UnitCache::Clear(){
+  for(std::unique_ptr<Shard>& shard:shard_list_){
+    std::lock_guard<std::mutex> lk(shard->mutex_);
+    shard->generation_++;
+    shard->usage_ = 0;
+    shard->lru_.clear();
+    shard->item_map_.clear();
+  }
+}
+
+void ambr::store::UnitCache::SetCapacity(size_t capacity){
+  capacity_ = capacity;
+  size_t shard_capacity = capacity/shard_list_.size();
+  for(std::unique_ptr<Shard>& shard:shard_list_){
+    std::lock_guard<std::mutex> lk(shard->mutex_);
+    EvictShard(*shard, shard_capacity);
+  }
+}
+
+size_t ambr::store::UnitCache::usage(){
+  size_t rtn = 0;
+  for(std::unique_ptr<Shard>& shard:shard_list_){
+    std::lock_guard<std::mutex> lk(shard->mutex_);
+    rtn += shard->usage_;
+  }
+  return rtn;
+}
+
+ambr::store::UnitCache::Shard& ambr::store::UnitCache::GetShard(const ambr::core::UnitHash &hash){
+  return *shard_list_[UnitHashHasher()(hash)%shard_list_.size()];
+}
+
+void ambr::store::UnitCache::EvictShard(Shard& shard, size_t shard_capacity){
+  while(shard.usage_ > shard_capacity && shard.lru_.size()){
+    auto iter = shard.item_map_.find(shard.lru_.back());
+    shard.usage_ -= iter->second.charge_;
+    shard.item_map_.erase(iter);
+    shard.lru_.pop_back();
+  }
+}
@@ -0,0 +1,71 @@
+/**********************************************************************
+ * Copyright (c) 2018 Ambr project
+ * Distributed under the MIT software license, see the accompanying   *
+ * file COPYING or http://www.opensource.org/licenses/mit-license.php.*
+ **********************************************************************/
+#ifndef AMBR_STORE_UNIT_CACHE_H_
+#define AMBR_STORE_UNIT_CACHE_H_
+#include <string.h>
+#include <memory>
+#include <list>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
+#include <core/unit.h>
+#include "unit_store.h"
+namespace ambr {
+namespace store {
+//std::hash of UnitHash encode to hex, unit hash is random enough to use it's bytes directly
+struct UnitHashHasher{
+  size_t operator()(const core::UnitHash& hash) const{
+    size_t rtn;
+    memcpy(&rtn, hash.bytes().data(), sizeof(rtn));
+    return rtn;
+  }
+};
+
+//sharded lru cache of decoded unit store, charged by serialized size.
+//stored object is never modified, Get returns the shared object, caller should copy before modify it.
+class UnitCache{
+public:
+  UnitCache(size_t capacity = 64*1024*1024, size_t shard_count = 16);
+public:
+  std::shared_ptr<const UnitStore> Get(const core::UnitHash& hash);
+  //take it before read db, and pass it to Insert,
+  //store will not be inserted if hash's shard was invalidated during read
+  uint64_t GetGeneration(const core::UnitHash& hash);
+  void Insert(const core::UnitHash& hash, std::shared_ptr<const UnitStore> store, size_t charge, uint64_t generation);
+  void Invalidate(const core::UnitHash& hash);
+  void Clear();
+  //0 for disable cache
+  void SetCapacity(size_t capacity);
+public:
+  size_t capacity() const{return capacity_;}
+  size_t usage();
+  uint64_t hit_count() const{return hit_count_;}
+  uint64_t miss_count() const{return miss_count_;}
+private:
+  struct Item{
+    std::shared_ptr<const UnitStore> store_;
+    size_t charge_;
+    std::list<core::UnitHash>::iterator lru_iter_;
+  };
+  struct Shard{
+    std::mutex mutex_;
+    uint64_t generation_ = 0;
+    size_t usage_ = 0;
+    std::list<core::UnitHash> lru_;//front is newest
+    std::unordered_map<core::UnitHash, Item, UnitHashHasher> item_map_;
+  };
+  Shard& GetShard(const core::UnitHash& hash);
+  void EvictShard(Shard& shard, size_t shard_capacity);
+private:
+  std::atomic<size_t> capacity_;
+  std::vector<std::unique_ptr<Shard>> shard_list_;
+  std::atomic<uint64_t> hit_count_;
+  std::atomic<uint64_t> miss_count_;
+};
+}
+}
+#endif
@@ -0,0 +1,90 @@
+/**********************************************************************
+ * Copyright (c) 2018 Ambr project
+ * Distributed under the MIT software license, see the accompanying   *
+ * file COPYING or http://www.opensource.org/licenses/mit-license.php.*
+ **********************************************************************/
+#include "dynasty_cache.h"
+
+ambr::syn::DynastyCache::DynastyCache(size_t capacity):capacity_(capacity){
+}
+
+ambr::syn::DynastyCache::Payload ambr::syn::DynastyCache::Get(const ambr::core::UnitHash &hash, const std::function<Payload ()> &encode_func){
+  std::unique_lock<std::mutex> lk(mutex_);
+  while(true){
+    auto iter = item_map_.find(hash);
+    if(iter != item_map_.end()){
+      lru_.splice(lru_.begin(), lru_, iter->second.lru_iter_);
+      hit_count_++;
+      return iter->second.payload_;
+    }
+    if(!encoding_set_.count(hash)){
+      break;
+    }
+    encode_cond_.wait(lk);
+  }
+  miss_count_++;
+  encoding_set_.insert(hash);
+  lk.unlock();
+  Payload payload;
+  try{
+    payload = encode_func();
+  }catch(...){
+    lk.lock();
+    encoding_set_.erase(hash);
+    encode_cond_.notify_all();
+    throw;
+  }
+  lk.lock();
+  encoding_set_.erase(hash);
+  if(payload && payload->size() <= capacity_){
+    lru_.push_front(hash);
+    Item& item = item_map_[hash];
+    item.payload_ = payload;
+    item.lru_iter_ = lru_.begin();
+    usage_ += payload->size();
+    Evict(capacity_);
+  }
+  //waiters encode by themselves if payload was too large to cache
+  encode_cond_.notify_all();
+  return payload;
+}
+
+void ambr::syn::DynastyCache::Clear(){
+  std::lock_guard<std::mutex> lk(mutex_);
+  Evict(0);
+}
+
+void ambr::syn::DynastyCache::SetCapacity(size_t capacity){
+  std::lock_guard<std::mutex> lk(mutex_);
+  capacity_ = capacity;
+  Evict(capacity_);
+}
+
+size_t ambr::syn::DynastyCache::capacity(){
+  std::lock_guard<std::mutex> lk(mutex_);
+  return capacity_;
+}
+
+size_t ambr::syn::DynastyCache::usage(){
+  std::lock_guard<std::mutex> lk(mutex_);
+  return usage_;
+}
+
+uint64_t ambr::syn::DynastyCache::hit_count(){
+  std::lock_guard<std::mutex> lk(mutex_);
+  return hit_count_;
+}
+
+uint64_t ambr::syn::DynastyCache::miss_count(){
+  std::lock_guard<std::mutex> lk(mutex_);
+  return miss_count_;
+}
+
+void ambr::syn::DynastyCache::Evict(size_t capacity){
+  while(usage_ > capacity && !lru_.empty()){
+    auto iter = item_map_.find(lru_.back());
+    usage_ -= iter->second.payload_->size();
+    item_map_.erase(iter);
+    lru_.pop_back();
+  }
+}
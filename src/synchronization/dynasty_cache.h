@@ -0,0 +1,59 @@
+/**********************************************************************
+ * Copyright (c) 2018 Ambr project
+ * Distributed under the MIT software license, see the accompanying   *
+ * file COPYING or http://www.opensource.org/licenses/mit-license.php.*
+ **********************************************************************/
+#ifndef AMBR_SYN_DYNASTY_CACHE_H_
+#define AMBR_SYN_DYNASTY_CACHE_H_
+#include <memory>
+#include <list>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+#include <core/key.h>
+#include <store/unit_cache.h>
+namespace ambr {
+namespace syn {
+
+//lru cache of encoded RESPONCEDYNASTY payload keyed by validator unit hash, charged by payload size.
+//dynasty is immutable once validated, so payload is shared by all peers requesting it without copy-on-write.
+//peers requesting a dynasty which is being encoded wait for that encode instead of encoding again.
+class DynastyCache{
+public:
+  typedef std::shared_ptr<const std::vector<uint8_t>> Payload;
+  DynastyCache(size_t capacity = 64*1024*1024);
+public:
+  //return cached payload, or call encode_func once for all callers and cache its result
+  Payload Get(const core::UnitHash& hash, const std::function<Payload()>& encode_func);
+  void Clear();
+  //0 for disable cache
+  void SetCapacity(size_t capacity);
+public:
+  size_t capacity();
+  size_t usage();
+  uint64_t hit_count();
+  uint64_t miss_count();
+private:
+  struct Item{
+    Payload payload_;
+    std::list<core::UnitHash>::iterator lru_iter_;
+  };
+  void Evict(size_t capacity);
+private:
+  std::mutex mutex_;
+  std::condition_variable encode_cond_;
+  size_t capacity_;
+  size_t usage_ = 0;
+  std::list<core::UnitHash> lru_;//front is newest
+  std::unordered_map<core::UnitHash, Item, store::UnitHashHasher> item_map_;
+  std::unordered_set<core::UnitHash, store::UnitHashHasher> encoding_set_;
+  uint64_t hit_count_ = 0;
+  uint64_t miss_count_ = 0;
+};
+
+}
+}
+#endif
@@ -0,0 +1,702 @@
+/**********************************************************************
+ * Copyright (c) 2018 Ambr project
+ * Distributed under the MIT software license, see the accompanying   *
+ * file COPYING or http://www.opensource.org/licenses/mit-license.php.*
+ **********************************************************************/
+#include "dynasty_sync.h"
+#include <string.h>
+#include <algorithm>
+#include <unordered_set>
+#include <store/store_manager.h>
+#include <store/unit_cache.h>
+#include <store/account_state.h>
+
+//compact size of p2p serialize.h, which prefixes data of message
+static void AppendCompactSize(std::vector<uint8_t>& buf, uint64_t size){
+  if(size < 253){
+    buf.push_back((uint8_t)size);
+  }else if(size <= 0xffff){
+    uint16_t size16 = size;
+    buf.push_back(253);
+    buf.insert(buf.end(), (const uint8_t*)&size16, (const uint8_t*)(&size16+1));
+  }else if(size <= 0xffffffff){
+    uint32_t size32 = size;
+    buf.push_back(254);
+    buf.insert(buf.end(), (const uint8_t*)&size32, (const uint8_t*)(&size32+1));
+  }else{
+    buf.push_back(255);
+    buf.insert(buf.end(), (const uint8_t*)&size, (const uint8_t*)(&size+1));
+  }
+}
+
+ambr::syn::DynastySync::DynastySync(uint32_t window, uint32_t max_in_flight)
+  :window_(window?window:1), max_in_flight_(max_in_flight?max_in_flight:1){
+  start_time_ = Clock::now();
+}
+
+void ambr::syn::DynastySync::Start(const ambr::core::UnitHash &anchor){
+  anchor_ = anchor;
+  last_hash_ = anchor;
+  next_pop_ = 0;
+  next_request_ = 0;
+  failed_ = false;
+  headers_mode_ = false;
+  headers_done_ = false;
+  header_list_.clear();
+  peer_map_.clear();
+  in_flight_.clear();
+  retry_.clear();
+  ready_.clear();
+  applied_dynasty_count_ = 0;
+  applied_unit_count_ = 0;
+  stolen_count_ = 0;
+  start_time_ = Clock::now();
+}
+
+void ambr::syn::DynastySync::AddPeer(PeerId peer){
+  Peer& peer_state = peer_map_[peer];
+  peer_state.stalled_ = false;
+}
+
+void ambr::syn::DynastySync::RemovePeer(PeerId peer){
+  auto peer_iter = peer_map_.find(peer);
+  if(peer_iter == peer_map_.end()){
+    return;
+  }
+  std::list<Range> range_list;
+  for(auto iter = in_flight_.begin(); iter != in_flight_.end();){
+    if(iter->peer_ == peer){
+      range_list.push_back(iter->range_);
+      iter = in_flight_.erase(iter);
+    }else{
+      iter++;
+    }
+  }
+  peer_map_.erase(peer_iter);
+  for(const Range& range:range_list){
+    Retry(range);
+  }
+}
+
+bool ambr::syn::DynastySync::HasPeer(PeerId peer) const{
+  return peer_map_.find(peer) != peer_map_.end();
+}
+
+void ambr::syn::DynastySync::AddHeaders(const HeaderList &header_list){
+  headers_mode_ = true;
+  header_list_.insert(header_list_.end(), header_list.begin(), header_list.end());
+}
+
+uint32_t ambr::syn::DynastySync::MaxInFlightCount(PeerId peer) const{
+  uint32_t rtn = 0;
+  for(const InFlight& item:in_flight_){
+    if(item.peer_ == peer){
+      rtn = std::max(rtn, item.range_.count_);
+    }
+  }
+  return rtn;
+}
+
+size_t ambr::syn::DynastySync::MaxResponseSize(PeerId peer) const{
+  uint32_t count = MaxInFlightCount(peer);
+  if(count > MAX_DYNASTIES_PER_RESPONSE){
+    count = MAX_DYNASTIES_PER_RESPONSE;
+  }
+  return sizeof(uint32_t)*2+(size_t)count*(sizeof(uint64_t)+MAX_DYNASTY_SIZE);
+}
+
+ambr::core::UnitHash ambr::syn::DynastySync::PrevHash(uint32_t position) const{
+  if(position == 0){
+    return anchor_;
+  }
+  if(position <= header_list_.size()){
+    return header_list_[position-1]->hash();
+  }
+  if(position == next_pop_){
+    return last_hash_;
+  }
+  return core::UnitHash();
+}
+
+std::shared_ptr<ambr::core::ValidatorUnit> ambr::syn::DynastySync::last_header() const{
+  if(header_list_.empty()){
+    return nullptr;
+  }
+  return header_list_.back();
+}
+
+std::vector<ambr::syn::DynastySync::Range> ambr::syn::DynastySync::NextRequests(PeerId peer, Clock::time_point now){
+  std::vector<Range> rtn;
+  auto peer_iter = peer_map_.find(peer);
+  if(failed_ || peer_iter == peer_map_.end() || peer_iter->second.stalled_){
+    return rtn;
+  }
+  Peer& peer_state = peer_iter->second;
+  uint32_t end = RequestEnd(peer_state);
+  //bound dynasties buffered behind a slow range
+  size_t max_ahead = (size_t)window_*max_in_flight_*std::max<size_t>(peer_map_.size(), 1)*2;
+  while(peer_state.in_flight_ < max_in_flight_){
+    Range range;
+    bool found = false;
+    //1.range failed or answered partly
+    for(auto iter = retry_.begin(); iter != retry_.end();){
+      range = *iter;
+      if(!TrimRange(range)){
+        iter = retry_.erase(iter);
+        continue;
+      }
+      if(range.start_ < end){
+        retry_.erase(iter);
+        found = true;
+        break;
+      }
+      iter++;
+    }
+    if(found){
+      SendRange(peer, peer_state, range, false, now);
+      rtn.push_back(range);
+      continue;
+    }
+    //2.new range
+    if(next_request_ < end && next_request_-next_pop_ < max_ahead){
+      range.start_ = next_request_;
+      range.count_ = headers_mode_?std::min(window_, end-next_request_):window_;
+      next_request_ += range.count_;
+      SendRange(peer, peer_state, range, false, now);
+      rtn.push_back(range);
+      continue;
+    }
+    //3.steal the lowest range which is waited too long from another peer
+    InFlight* victim = nullptr;
+    for(InFlight& item:in_flight_){
+      if(item.peer_ == peer || item.stolen_ || item.range_.start_ >= end ||
+         now-item.send_time_ < steal_time_){
+        continue;
+      }
+      if(!victim || item.range_.start_ < victim->range_.start_){
+        victim = &item;
+      }
+    }
+    if(!victim){
+      break;
+    }
+    victim->stolen_ = true;
+    range = victim->range_;
+    if(TrimRange(range)){
+      SendRange(peer, peer_state, range, true, now);
+      stolen_count_++;
+      rtn.push_back(range);
+    }
+  }
+  return rtn;
+}
+
+bool ambr::syn::DynastySync::OnResponse(PeerId peer, uint32_t start, std::vector<Dynasty> &&dynasty_list, Clock::time_point now){
+  auto iter = std::find_if(in_flight_.begin(), in_flight_.end(), [peer, start](const InFlight& item){
+    return item.peer_ == peer && item.range_.start_ == start;
+  });
+  if(iter == in_flight_.end() || dynasty_list.size() > iter->range_.count_){
+    return false;
+  }
+  for(size_t i = 0; headers_mode_ && i < dynasty_list.size(); i++){
+    if(start+i >= header_list_.size() || !CheckDynasty(*header_list_[start+i], dynasty_list[i])){
+      RemovePeer(peer);
+      return false;
+    }
+  }
+  Range range = iter->range_;
+  in_flight_.erase(iter);
+  Peer& peer_state = peer_map_[peer];
+  FinishInFlight(peer_state, now);
+  peer_state.dynasty_count_ += dynasty_list.size();
+  if(dynasty_list.empty()){
+    peer_state.exhausted_at_ = std::min(peer_state.exhausted_at_, start);
+    //other peer may have it
+    Retry(range);
+    return true;
+  }
+  for(size_t i = 0; i < dynasty_list.size(); i++){
+    if(start+i >= next_pop_ && !ready_.count(start+i)){
+      ready_[start+i] = std::move(dynasty_list[i]);
+    }
+  }
+  if(dynasty_list.size() < range.count_){
+    Range tail;
+    tail.start_ = range.start_+dynasty_list.size();
+    tail.count_ = range.count_-dynasty_list.size();
+    Retry(tail);
+  }
+  return true;
+}
+
+std::vector<ambr::syn::DynastySync::PeerId> ambr::syn::DynastySync::Expire(Clock::time_point now){
+  std::vector<PeerId> rtn;
+  for(const InFlight& item:in_flight_){
+    if(now-item.send_time_ > stall_time_ &&
+       std::find(rtn.begin(), rtn.end(), item.peer_) == rtn.end()){
+      rtn.push_back(item.peer_);
+    }
+  }
+  for(PeerId peer:rtn){
+    std::list<Range> range_list;
+    for(auto iter = in_flight_.begin(); iter != in_flight_.end();){
+      if(iter->peer_ == peer){
+        range_list.push_back(iter->range_);
+        iter = in_flight_.erase(iter);
+      }else{
+        iter++;
+      }
+    }
+    Peer& peer_state = peer_map_[peer];
+    peer_state.stalled_ = true;
+    peer_state.busy_time_ += now-peer_state.busy_since_;
+    peer_state.in_flight_ = 0;
+    for(const Range& range:range_list){
+      Retry(range);
+    }
+  }
+  return rtn;
+}
+
+bool ambr::syn::DynastySync::PopReady(Dynasty &dynasty){
+  if(failed_){
+    return false;
+  }
+  auto iter = ready_.find(next_pop_);
+  if(iter == ready_.end()){
+    return false;
+  }
+  Dynasty& item = iter->second;
+  if(item.empty() ||
+     item.back()->type() != core::UnitType::Validator ||
+     item.back()->prev_unit() != last_hash_){
+    failed_ = true;
+    ready_.clear();
+    return false;
+  }
+  dynasty = std::move(item);
+  ready_.erase(iter);
+  last_hash_ = dynasty.back()->hash();
+  next_pop_++;
+  applied_dynasty_count_++;
+  applied_unit_count_ += dynasty.size();
+  return true;
+}
+
+bool ambr::syn::DynastySync::finished() const{
+  if(failed_){
+    return true;
+  }
+  if(!in_flight_.empty() || (headers_mode_ && !headers_done_)){
+    return false;
+  }
+  for(const std::pair<const PeerId, Peer>& item:peer_map_){
+    if(item.second.stalled_){
+      continue;
+    }
+    uint32_t end = RequestEnd(item.second);
+    if(next_request_ < end){
+      return false;
+    }
+    for(Range range:retry_){
+      if(TrimRange(range) && range.start_ < end){
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+double ambr::syn::DynastySync::DynastyRate() const{
+  double second = std::chrono::duration<double>(Clock::now()-start_time_).count();
+  return second > 0?applied_dynasty_count_/second:0;
+}
+
+double ambr::syn::DynastySync::UnitRate() const{
+  double second = std::chrono::duration<double>(Clock::now()-start_time_).count();
+  return second > 0?applied_unit_count_/second:0;
+}
+
+double ambr::syn::DynastySync::PeerRate(PeerId peer) const{
+  auto iter = peer_map_.find(peer);
+  if(iter == peer_map_.end()){
+    return 0;
+  }
+  Clock::duration busy_time = iter->second.busy_time_;
+  if(iter->second.in_flight_){
+    busy_time += Clock::now()-iter->second.busy_since_;
+  }
+  double second = std::chrono::duration<double>(busy_time).count();
+  return second > 0?iter->second.dynasty_count_/second:0;
+}
+
+uint32_t ambr::syn::DynastySync::RequestEnd(const Peer &peer_state) const{
+  if(headers_mode_){
+    return std::min<uint32_t>(peer_state.exhausted_at_, header_list_.size());
+  }
+  return peer_state.exhausted_at_;
+}
+
+bool ambr::syn::DynastySync::TrimRange(Range &range) const{
+  while(range.count_ && (range.start_ < next_pop_ || ready_.count(range.start_))){
+    range.start_++;
+    range.count_--;
+  }
+  return range.count_ != 0;
+}
+
+void ambr::syn::DynastySync::Retry(const Range &range){
+  Range range_trim = range;
+  if(!TrimRange(range_trim)){
+    return;
+  }
+  for(const InFlight& item:in_flight_){
+    if(item.range_.start_ == range_trim.start_){//still requested from another peer
+      return;
+    }
+  }
+  //lowest range first, it blocks applying
+  auto iter = retry_.begin();
+  while(iter != retry_.end() && iter->start_ < range_trim.start_){
+    iter++;
+  }
+  retry_.insert(iter, range_trim);
+}
+
+void ambr::syn::DynastySync::SendRange(PeerId peer, Peer &peer_state, const Range &range, bool stolen, Clock::time_point now){
+  InFlight item;
+  item.range_ = range;
+  item.peer_ = peer;
+  item.send_time_ = now;
+  item.stolen_ = stolen;
+  in_flight_.push_back(item);
+  if(peer_state.in_flight_++ == 0){
+    peer_state.busy_since_ = now;
+  }
+}
+
+void ambr::syn::DynastySync::FinishInFlight(Peer &peer_state, Clock::time_point now){
+  if(peer_state.in_flight_ && --peer_state.in_flight_ == 0){
+    peer_state.busy_time_ += now-peer_state.busy_since_;
+  }
+}
+
+std::vector<uint8_t> ambr::syn::DynastySync::EncodeDynasty(const std::list<std::shared_ptr<ambr::core::Unit> > &unit_list){
+  std::vector<uint8_t> rtn;
+  for(std::shared_ptr<core::Unit> unit_item: unit_list){
+    std::vector<uint8_t> unit_buf = unit_item->SerializeByte();
+    uint32_t type = (uint32_t)unit_item->type();
+    uint64_t len = unit_buf.size()+sizeof(type);
+    rtn.insert(rtn.end(), (const uint8_t*)&len, (const uint8_t*)(&len+1));
+    rtn.insert(rtn.end(), (const uint8_t*)&type, (const uint8_t*)(&type+1));
+    rtn.insert(rtn.end(), unit_buf.begin(), unit_buf.end());
+  }
+  return rtn;
+}
+
+bool ambr::syn::DynastySync::DecodeDynasty(const uint8_t *data, size_t size, Dynasty &unit_list){
+  size_t idx = 0;
+  while(idx < size){
+    uint64_t len = 0;
+    uint32_t type = 0;
+    if(size-idx < sizeof(len))return false;
+    memcpy(&len, data+idx, sizeof(len));
+    idx += sizeof(len);
+    if(len <= sizeof(type) || size-idx < len)return false;
+    memcpy(&type, data+idx, sizeof(type));
+    std::shared_ptr<core::Unit> unit;
+    switch((core::UnitType)type){
+      case core::UnitType::send:unit = std::make_shared<core::SendUnit>();break;
+      case core::UnitType::receive:unit = std::make_shared<core::ReceiveUnit>();break;
+      case core::UnitType::Vote:unit = std::make_shared<core::VoteUnit>();break;
+      case core::UnitType::Validator:unit = std::make_shared<core::ValidatorUnit>();break;
+      case core::UnitType::EnterValidateSet:unit = std::make_shared<core::EnterValidateSetUnit>();break;
+      case core::UnitType::LeaveValidateSet:unit = std::make_shared<core::LeaveValidateSetUnit>();break;
+      default:
+        return false;
+    }
+    if(!unit->DeSerializeByte(data+idx+sizeof(type), len-sizeof(type), nullptr)){
+      return false;
+    }
+    idx += len;
+    unit_list.push_back(unit);
+  }
+  return true;
+}
+
+ambr::syn::DynastyCache::Payload ambr::syn::DynastySync::GetDynastyPayload(ambr::store::StoreManager *store, DynastyCache *cache, const ambr::core::UnitHash &hash){
+  return cache->Get(hash, [store, hash](){
+    return std::make_shared<const std::vector<uint8_t>>(EncodeDynasty(store->GetAllUnitByValidatorUnitHash(hash)));
+  });
+}
+
+void ambr::syn::DynastySync::EncodeResponse(ambr::store::StoreManager *store, DynastyCache *cache,
+                                            const ambr::core::UnitHash &prev_hash, uint32_t start, uint32_t count,
+                                            std::vector<std::vector<uint8_t>>& chunk_list){
+  count = std::min(count, MAX_DYNASTIES_PER_RESPONSE);
+  core::UnitHash validator_hash = prev_hash;
+  std::vector<DynastyCache::Payload> payload_list;
+  std::vector<uint64_t> len_list;
+  size_t total = sizeof(start)+sizeof(count);
+  while(payload_list.size() < count && !validator_hash.is_zero()){
+    validator_hash = store->GetNextValidatorHash(validator_hash);
+    if(validator_hash.is_zero())break;
+    std::shared_ptr<store::ValidatorUnitStore> validator_store = store->GetValidateUnit(validator_hash);
+    if(!validator_store || !validator_store->is_validate())break;
+    DynastyCache::Payload payload = GetDynastyPayload(store, cache, validator_hash);
+    //peer requests the rest again
+    if(payload_list.size() && total+sizeof(uint64_t)+payload->size() > MAX_RESPONSE_SIZE)break;
+    total += sizeof(uint64_t)+payload->size();
+    payload_list.push_back(payload);
+  }
+  uint32_t sended = payload_list.size();
+  len_list.reserve(payload_list.size());
+  //pieces of response in order
+  std::vector<std::pair<const uint8_t*, size_t>> piece_list;
+  piece_list.push_back(std::make_pair((const uint8_t*)&start, sizeof(start)));
+  piece_list.push_back(std::make_pair((const uint8_t*)&sended, sizeof(sended)));
+  for(const DynastyCache::Payload& payload:payload_list){
+    len_list.push_back(payload->size());
+    piece_list.push_back(std::make_pair((const uint8_t*)&len_list.back(), sizeof(uint64_t)));
+    piece_list.push_back(std::make_pair(payload->data(), payload->size()));
+  }
+
+  chunk_list.clear();
+  size_t piece_idx = 0, piece_offset = 0;
+  uint64_t offset = 0;
+  do{
+    size_t chunk_size = std::min<size_t>(MAX_CHUNK_SIZE, total-offset);
+    chunk_list.push_back(std::vector<uint8_t>());
+    std::vector<uint8_t>& chunk = chunk_list.back();
+    chunk.reserve(9+sizeof(uint64_t)*2+chunk_size);
+    AppendCompactSize(chunk, sizeof(uint64_t)*2+chunk_size);
+    uint64_t total_size = total;
+    chunk.insert(chunk.end(), (const uint8_t*)&total_size, (const uint8_t*)(&total_size+1));
+    chunk.insert(chunk.end(), (const uint8_t*)&offset, (const uint8_t*)(&offset+1));
+    size_t left = chunk_size;
+    while(left){
+      const std::pair<const uint8_t*, size_t>& piece = piece_list[piece_idx];
+      size_t n = std::min(left, piece.second-piece_offset);
+      chunk.insert(chunk.end(), piece.first+piece_offset, piece.first+piece_offset+n);
+      left -= n;
+      piece_offset += n;
+      if(piece_offset == piece.second){
+        piece_idx++;
+        piece_offset = 0;
+      }
+    }
+    offset += chunk_size;
+  }while(offset < total);
+}
+
+bool ambr::syn::DynastySync::DecodeResponse(const uint8_t *data, size_t size, uint32_t &start, std::vector<Dynasty> &dynasty_list){
+  uint32_t count = 0;
+  if(size < sizeof(start)+sizeof(count)){
+    return false;
+  }
+  memcpy(&start, data, sizeof(start));
+  memcpy(&count, data+sizeof(start), sizeof(count));
+  if(count > MAX_DYNASTIES_PER_RESPONSE){
+    return false;
+  }
+  dynasty_list.clear();
+  dynasty_list.resize(count);
+  size_t idx = sizeof(start)+sizeof(count);
+  for(Dynasty& dynasty:dynasty_list){
+    uint64_t len = 0;
+    if(size-idx < sizeof(len))return false;
+    memcpy(&len, data+idx, sizeof(len));
+    idx += sizeof(len);
+    if(size-idx < len)return false;
+    if(!DecodeDynasty(data+idx, len, dynasty))return false;
+    idx += len;
+  }
+  return idx == size;
+}
+
+bool ambr::syn::DynastySync::VerifyDynasties(const std::vector<Dynasty> &dynasty_list){
+  std::vector<const core::Unit*> unit_list;
+  for(const Dynasty& dynasty:dynasty_list){
+    for(const std::shared_ptr<core::Unit>& unit:dynasty){
+      unit_list.push_back(unit.get());
+    }
+  }
+  return core::Unit::ValidateBatch(unit_list, nullptr, nullptr);
+}
+
+std::vector<uint8_t> ambr::syn::DynastySync::EncodeHeaders(ambr::store::StoreManager *store, const ambr::core::UnitHash &anchor, uint32_t count){
+  count = std::min(count, MAX_HEADERS_PER_RESPONSE);
+  std::vector<std::vector<uint8_t>> unit_buf_list;
+  size_t total = anchor.bytes().size()+sizeof(count);
+  core::UnitHash validator_hash = anchor;
+  while(unit_buf_list.size() < count){
+    validator_hash = store->GetNextValidatorHash(validator_hash);
+    if(validator_hash.is_zero())break;
+    std::shared_ptr<store::ValidatorUnitStore> validator_store = store->GetValidateUnit(validator_hash);
+    if(!validator_store || !validator_store->is_validate())break;
+    std::vector<uint8_t> buf = validator_store->unit()->SerializeByte();
+    if(unit_buf_list.size() && total+sizeof(uint64_t)+buf.size() > MAX_RESPONSE_SIZE)break;
+    total += sizeof(uint64_t)+buf.size();
+    unit_buf_list.push_back(std::move(buf));
+  }
+  uint32_t sended = unit_buf_list.size();
+  std::vector<uint8_t> rtn;
+  rtn.reserve(9+total);
+  AppendCompactSize(rtn, total);
+  rtn.insert(rtn.end(), anchor.bytes().begin(), anchor.bytes().end());
+  rtn.insert(rtn.end(), (const uint8_t*)&sended, (const uint8_t*)(&sended+1));
+  for(const std::vector<uint8_t>& buf:unit_buf_list){
+    uint64_t len = buf.size();
+    rtn.insert(rtn.end(), (const uint8_t*)&len, (const uint8_t*)(&len+1));
+    rtn.insert(rtn.end(), buf.begin(), buf.end());
+  }
+  return rtn;
+}
+
+bool ambr::syn::DynastySync::DecodeHeaders(const uint8_t *data, size_t size, ambr::core::UnitHash &anchor, HeaderList &header_list){
+  uint32_t count = 0;
+  if(size < anchor.bytes().size()+sizeof(count)){
+    return false;
+  }
+  anchor.set_bytes(data, anchor.bytes().size());
+  memcpy(&count, data+anchor.bytes().size(), sizeof(count));
+  if(count > MAX_HEADERS_PER_RESPONSE){
+    return false;
+  }
+  header_list.clear();
+  size_t idx = anchor.bytes().size()+sizeof(count);
+  for(uint32_t i = 0; i < count; i++){
+    uint64_t len = 0;
+    if(size-idx < sizeof(len))return false;
+    memcpy(&len, data+idx, sizeof(len));
+    idx += sizeof(len);
+    if(size-idx < len)return false;
+    std::shared_ptr<core::ValidatorUnit> unit = std::make_shared<core::ValidatorUnit>();
+    if(!unit->DeSerializeByte(data+idx, len, nullptr))return false;
+    idx += len;
+    header_list.push_back(unit);
+  }
+  return idx == size;
+}
+
+bool ambr::syn::DynastySync::VerifyHeaders(const ambr::core::UnitHash &prev_hash, uint64_t prev_nonce, uint64_t max_nonce,
+                                           store::ValidatorSetStore& validator_set, const HeaderList &header_list, std::string *err){
+  std::vector<const core::Unit*> unit_list;
+  std::vector<std::vector<core::VoteUnit>> vote_list_list;//keep votes alive for batch verify
+  core::UnitHash last_hash = prev_hash;
+  uint64_t last_nonce = prev_nonce;
+  for(const std::shared_ptr<core::ValidatorUnit>& header:header_list){
+    if(header->type() != core::UnitType::Validator || header->prev_unit() != last_hash){
+      if(err){
+        *err = "Validator unit doesn't link to previous one";
+      }
+      return false;
+    }
+    if(header->nonce() <= last_nonce || header->nonce() > max_nonce){
+      if(err){
+        *err = "err nonce";
+      }
+      return false;
+    }
+    core::PublicKey turn_validator;
+    if(!validator_set.GetNonceTurnValidator(header->nonce(), turn_validator) || turn_validator != header->public_key()){
+      if(err){
+        *err = "err nonce or validator";
+      }
+      return false;
+    }
+    vote_list_list.push_back(header->vote_list());
+    std::unordered_set<core::PublicKey, store::PublicKeyHasher> voter_set;
+    for(core::VoteUnit& vote_unit:vote_list_list.back()){
+      if(vote_unit.validator_unit_hash() != header->prev_unit() || !voter_set.insert(vote_unit.public_key()).second){
+        if(err){
+          *err = "Vote is not for previous validator unit or duplicated";
+        }
+        return false;
+      }
+      if(!validator_set.IsValidator(vote_unit.public_key(), header->nonce())){
+        if(err){
+          *err = "One of validate's sender is not in validator_set";
+        }
+        return false;
+      }
+    }
+    //same as adding validator unit to store
+    validator_set.Update(header->nonce());
+    validator_set.set_current_nonce(header->nonce());
+    validator_set.set_current_validator(header->public_key());
+    last_hash = header->hash();
+    last_nonce = header->nonce();
+  }
+  for(size_t i = 0; i < header_list.size(); i++){
+    unit_list.push_back(header_list[i].get());
+    for(const core::VoteUnit& vote_unit:vote_list_list[i]){
+      unit_list.push_back(&vote_unit);
+    }
+  }
+  std::vector<std::string> err_list;
+  if(!core::Unit::ValidateBatch(unit_list, nullptr, &err_list)){
+    if(err){
+      for(const std::string& item:err_list){
+        if(item.size()){
+          *err = item;
+          break;
+        }
+      }
+    }
+    return false;
+  }
+  return true;
+}
+
+bool ambr::syn::DynastySync::CheckDynasty(ambr::core::ValidatorUnit &header, const Dynasty &dynasty){
+  if(dynasty.empty() || dynasty.back()->type() != core::UnitType::Validator || dynasty.back()->hash() != header.hash()){
+    return false;
+  }
+  std::unordered_set<core::UnitHash, store::UnitHashHasher> hash_set(header.check_list().begin(), header.check_list().end());
+  //dependency order, so unit is reached from check list before it's previous unit
+  for(auto iter = dynasty.rbegin()+1; iter != dynasty.rend(); iter++){
+    if(!hash_set.count((*iter)->hash())){
+      return false;
+    }
+    hash_set.insert((*iter)->prev_unit());
+  }
+  return true;
+}
+
+ambr::syn::ChunkAssembler::Result ambr::syn::ChunkAssembler::Add(const uint8_t *chunk, size_t chunk_size, const uint8_t *&data, size_t &size){
+  uint64_t total = 0, offset = 0;
+  data = nullptr;
+  size = 0;
+  if(chunk_size < sizeof(total)+sizeof(offset)){
+    return Invalid;
+  }
+  memcpy(&total, chunk, sizeof(total));
+  memcpy(&offset, chunk+sizeof(total), sizeof(offset));
+  const uint8_t* bytes = chunk+sizeof(total)+sizeof(offset);
+  size_t bytes_size = chunk_size-sizeof(total)-sizeof(offset);
+  if(total > max_size_ || offset > total || bytes_size > total-offset){
+    buf_.clear();
+    return Invalid;
+  }
+  if(offset == 0 && bytes_size == total){//the only chunk, used in place
+    buf_.clear();
+    data = bytes;
+    size = bytes_size;
+    return Complete;
+  }
+  if(offset == 0){
+    buf_.clear();
+    total_ = total;
+  }else if(offset != buf_.size() || total != total_){
+    buf_.clear();
+    return Invalid;
+  }
+  buf_.insert(buf_.end(), bytes, bytes+bytes_size);
+  if(buf_.size() < total_){
+    return Partial;
+  }
+  data = buf_.data();
+  size = buf_.size();
+  return Complete;
+}
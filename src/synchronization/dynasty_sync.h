@@ -0,0 +1,206 @@
+/**********************************************************************
+ * Copyright (c) 2018 Ambr project
+ * Distributed under the MIT software license, see the accompanying   *
+ * file COPYING or http://www.opensource.org/licenses/mit-license.php.*
+ **********************************************************************/
+#ifndef AMBR_SYN_DYNASTY_SYNC_H_
+#define AMBR_SYN_DYNASTY_SYNC_H_
+#include <stdint.h>
+#include <memory>
+#include <list>
+#include <map>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <core/unit.h>
+#include "dynasty_cache.h"
+namespace ambr {
+namespace store {
+  class StoreManager;
+  struct ValidatorSetStore;
+}
+namespace syn {
+
+//client side state of pipelined dynasty sync from several peers.
+//dynasties are addressed by position after anchor, position 0 is the dynasty of validator unit next to anchor.
+//ranges of consecutive dynasties are spread over peers, several in flight per peer, and applied strictly in position order.
+//range of a stalled peer is given to others, range of a slow peer is also requested from an idle one(stolen).
+//with headers(validator units verified first), dynasties are requested up to the last header from any peer,
+//and each one is checked against it's header when it arrives.
+//not thread safe.
+class DynastySync{
+public:
+  typedef int64_t PeerId;
+  typedef std::chrono::steady_clock Clock;
+  //units in dependency order, validator unit is the last one
+  typedef std::vector<std::shared_ptr<core::Unit>> Dynasty;
+  typedef std::vector<std::shared_ptr<core::ValidatorUnit>> HeaderList;
+  struct Range{
+    uint32_t start_;
+    uint32_t count_;
+  };
+  //dynasties of a response, bounded so responses stay far below MAX_PROTOCOL_MESSAGE_LENGTH
+  static const uint32_t MAX_DYNASTIES_PER_RESPONSE = 128;
+  static const size_t MAX_RESPONSE_SIZE = 2*1024*1024;
+  static const uint32_t MAX_HEADERS_PER_RESPONSE = 512;
+  //a response is sent in messages of at most this size, so one huge dynasty doesn't exceed message limit
+  static const size_t MAX_CHUNK_SIZE = 1024*1024;
+  //bound of an encoded dynasty in response from peer
+  static const size_t MAX_DYNASTY_SIZE = 16*1024*1024;
+  DynastySync(uint32_t window = 32, uint32_t max_in_flight = 3);
+public:
+  //forget all state and sync dynasties after anchor
+  void Start(const core::UnitHash& anchor);
+  //peer which has dynasties after anchor
+  void AddPeer(PeerId peer);
+  //ranges in flight of peer are requested from others
+  void RemovePeer(PeerId peer);
+  bool HasPeer(PeerId peer) const;
+  //ranges to request from peer now, they are in flight until answered
+  std::vector<Range> NextRequests(PeerId peer, Clock::time_point now = Clock::now());
+  //headers verified by VerifyHeaders which follow the last one, sync is in headers mode from now
+  void AddHeaders(const HeaderList& header_list);
+  //no more header, sync finishes when dynasties of all headers are applied
+  void set_headers_done(){headers_done_ = true;}
+  //dynasty_list answers range begin with start, it may be shorter than requested,
+  //empty means peer has no dynasty at start. false if peer has no range in flight begins with start,
+  //or in headers mode a dynasty doesn't match it's header, then peer is removed
+  bool OnResponse(PeerId peer, uint32_t start, std::vector<Dynasty>&& dynasty_list, Clock::time_point now = Clock::now());
+  //peers whose range is in flight longer than stall time, their ranges are requested from others,
+  //and they get no more range until added again
+  std::vector<PeerId> Expire(Clock::time_point now = Clock::now());
+  //next dynasty in order, false if it didn't arrive.
+  //sync is failed if it doesn't link to the previous one
+  bool PopReady(Dynasty& dynasty);
+  //failed, or nothing in flight or buffered and no peer can give more dynasty
+  bool finished() const;
+  bool failed() const{return failed_;}
+  bool headers_mode() const{return headers_mode_;}
+  bool headers_done() const{return headers_done_;}
+  size_t header_count() const{return header_list_.size();}
+  //last header, nullptr if none
+  std::shared_ptr<core::ValidatorUnit> last_header() const;
+  void set_stall_time(Clock::duration stall_time){stall_time_ = stall_time;}
+  void set_steal_time(Clock::duration steal_time){steal_time_ = steal_time;}
+public:
+  const core::UnitHash& anchor() const{return anchor_;}
+  //validator hash of last popped dynasty, anchor if none
+  const core::UnitHash& last_hash() const{return last_hash_;}
+  //validator hash before position, range begin with position is requested from it.
+  //zero if it's unknown, that is beyond headers or not in headers mode and not next to pop
+  core::UnitHash PrevHash(uint32_t position) const;
+  size_t in_flight_count() const{return in_flight_.size();}
+  //count of the largest range in flight to peer, 0 if none
+  uint32_t MaxInFlightCount(PeerId peer) const;
+  //bound of response size from peer for ranges in flight to it
+  size_t MaxResponseSize(PeerId peer) const;
+  uint64_t applied_dynasty_count() const{return applied_dynasty_count_;}
+  uint64_t applied_unit_count() const{return applied_unit_count_;}
+  uint64_t stolen_count() const{return stolen_count_;}
+  //per second since Start
+  double DynastyRate() const;
+  double UnitRate() const;
+  //dynasties received from peer per second while it had range in flight
+  double PeerRate(PeerId peer) const;
+public:
+  //each unit is length(uint64_t)+type(uint32_t)+unit bytes
+  static std::vector<uint8_t> EncodeDynasty(const std::list<std::shared_ptr<core::Unit>>& unit_list);
+  static bool DecodeDynasty(const uint8_t* data, size_t size, Dynasty& unit_list);
+  //encoded dynasty of validator unit through cache
+  static DynastyCache::Payload GetDynastyPayload(store::StoreManager* store, DynastyCache* cache, const core::UnitHash& hash);
+  //response of range request:start(uint32_t)+count(uint32_t)+[length(uint64_t)+dynasty]*count,
+  //dynasties are the validated ones after prev_hash, start is only returned for matching the request.
+  //it is split into chunks which are data of messages:
+  //compact size+total size(uint64_t)+offset(uint64_t)+bytes of response, see ChunkAssembler.
+  //encoded dynasties are copied from cache to chunks directly
+  static void EncodeResponse(store::StoreManager* store, DynastyCache* cache,
+                             const core::UnitHash& prev_hash, uint32_t start, uint32_t count,
+                             std::vector<std::vector<uint8_t>>& chunk_list);
+  static bool DecodeResponse(const uint8_t* data, size_t size, uint32_t& start, std::vector<Dynasty>& dynasty_list);
+  //verify hash and signature of all units in batch, verified signatures are cached for adding units later
+  static bool VerifyDynasties(const std::vector<Dynasty>& dynasty_list);
+  //response of headers request:anchor hash+count(uint32_t)+[length(uint64_t)+validator unit bytes]*count,
+  //validated validator units after anchor
+  //data of message:compact size+response
+  static std::vector<uint8_t> EncodeHeaders(store::StoreManager* store, const core::UnitHash& anchor, uint32_t count);
+  static bool DecodeHeaders(const uint8_t* data, size_t size, core::UnitHash& anchor, HeaderList& header_list);
+  //verify header chain follows prev:linked by prev_unit, nonce increases and isn't after max_nonce,
+  //hash and signature of headers and their votes, votes are for the previous header from different validators.
+  //validator_set is the one after prev, header is signed by validator of it's nonce turn and voters are in it,
+  //it's advanced to the one after last header(validators joined meanwhile are unknown until their dynasty is added).
+  //percent of votes needs balance of validators, it is checked when dynasty is added to store
+  static bool VerifyHeaders(const core::UnitHash& prev_hash, uint64_t prev_nonce, uint64_t max_nonce,
+                            store::ValidatorSetStore& validator_set, const HeaderList& header_list, std::string* err);
+  //dynasty ends with header, other units are in check list of header or previous unit of one in dynasty
+  static bool CheckDynasty(core::ValidatorUnit& header, const Dynasty& dynasty);
+private:
+  struct InFlight{
+    Range range_;
+    PeerId peer_;
+    Clock::time_point send_time_;
+    bool stolen_ = false;//also requested from another peer
+  };
+  struct Peer{
+    uint32_t exhausted_at_ = (uint32_t)-1;//peer has no dynasty from this position
+    bool stalled_ = false;
+    uint32_t in_flight_ = 0;
+    uint64_t dynasty_count_ = 0;
+    Clock::duration busy_time_ = Clock::duration::zero();
+    Clock::time_point busy_since_;//time of first request in flight
+  };
+  //positions before it may be requested from peer
+  uint32_t RequestEnd(const Peer& peer_state) const;
+  //drop the head of range which already arrived, false if nothing left
+  bool TrimRange(Range& range) const;
+  void Retry(const Range& range);
+  void SendRange(PeerId peer, Peer& peer_state, const Range& range, bool stolen, Clock::time_point now);
+  void FinishInFlight(Peer& peer_state, Clock::time_point now);
+private:
+  uint32_t window_;
+  uint32_t max_in_flight_;
+  Clock::duration stall_time_ = std::chrono::seconds(10);
+  Clock::duration steal_time_ = std::chrono::seconds(2);
+  core::UnitHash anchor_;
+  core::UnitHash last_hash_;
+  uint32_t next_pop_ = 0;//position of next dynasty to apply
+  uint32_t next_request_ = 0;//first position never requested
+  bool failed_ = false;
+  bool headers_mode_ = false;
+  bool headers_done_ = false;
+  HeaderList header_list_;//header of position i
+  std::map<PeerId, Peer> peer_map_;
+  std::list<InFlight> in_flight_;
+  std::list<Range> retry_;//ranges answered partly or taken from stalled peer, requested before new range
+  std::map<uint32_t, Dynasty> ready_;//position->dynasty arrived out of order
+  uint64_t applied_dynasty_count_ = 0;
+  uint64_t applied_unit_count_ = 0;
+  uint64_t stolen_count_ = 0;
+  Clock::time_point start_time_;
+};
+
+//joins chunks of responses from a peer, chunks of a response are sent in a row.
+//not thread safe.
+class ChunkAssembler{
+public:
+  //bound of memory for a response
+  static const size_t MAX_RESPONSE_SIZE = 64*1024*1024;
+  enum Result{
+    Invalid,//malformed, out of order or too large
+    Partial,
+    Complete
+  };
+  //when Complete, data and size are the response:chunk itself if response has only one chunk,
+  //or joined bytes valid until next Add
+  Result Add(const uint8_t* chunk, size_t chunk_size, const uint8_t*& data, size_t& size);
+  //responses with larger total size are Invalid, it's never above MAX_RESPONSE_SIZE
+  void set_max_size(size_t max_size){max_size_ = max_size < MAX_RESPONSE_SIZE?max_size:MAX_RESPONSE_SIZE;}
+private:
+  //grows as chunks arrive, total size in chunk header is not trusted for allocation
+  std::vector<uint8_t> buf_;
+  uint64_t total_ = 0;
+  size_t max_size_ = MAX_RESPONSE_SIZE;
+};
+
+}
+}
+#endif
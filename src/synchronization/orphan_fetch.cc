@@ -0,0 +1,132 @@
+/**********************************************************************
+ * Copyright (c) 2018 Ambr project
+ * Distributed under the MIT software license, see the accompanying   *
+ * file COPYING or http://www.opensource.org/licenses/mit-license.php.*
+ **********************************************************************/
+#include "orphan_fetch.h"
+#include <algorithm>
+
+ambr::syn::OrphanFetch::OrphanFetch(uint32_t max_in_flight, uint32_t max_in_flight_per_peer, Clock::duration timeout)
+  :max_in_flight_(max_in_flight?max_in_flight:1),
+   max_in_flight_per_peer_(max_in_flight_per_peer?max_in_flight_per_peer:1),
+   timeout_(timeout){
+}
+
+void ambr::syn::OrphanFetch::AddOrphan(PeerId peer, const ambr::core::UnitHash &orphan, const ambr::core::UnitHash &missing, Clock::time_point now){
+  orphan_map_.insert(std::make_pair(orphan, now));
+  //orphan is also missing by it's children
+  auto orphan_iter = missing_map_.find(orphan);
+  if(orphan_iter != missing_map_.end()){
+    FinishInFlight(orphan_iter->second);
+    missing_map_.erase(orphan_iter);
+  }
+  if(!peer){
+    return;
+  }
+  std::list<PeerId>& peer_list = missing_map_[missing].peer_list_;
+  if(std::find(peer_list.begin(), peer_list.end(), peer) == peer_list.end()){
+    peer_list.push_back(peer);
+  }
+}
+
+std::map<ambr::syn::OrphanFetch::PeerId, std::vector<ambr::core::UnitHash>> ambr::syn::OrphanFetch::NextRequests(Clock::time_point now){
+  std::map<PeerId, std::vector<core::UnitHash>> rtn;
+  for(auto iter = missing_map_.begin(); iter != missing_map_.end() && in_flight_count_ < max_in_flight_;){
+    Missing& missing = iter->second;
+    if(missing.in_flight_){
+      iter++;
+      continue;
+    }
+    //first peer which has room
+    auto peer_iter = std::find_if(missing.peer_list_.begin(), missing.peer_list_.end(), [this](PeerId peer){
+      auto count_iter = peer_in_flight_map_.find(peer);
+      return count_iter == peer_in_flight_map_.end() || count_iter->second < max_in_flight_per_peer_;
+    });
+    if(peer_iter == missing.peer_list_.end()){
+      iter++;
+      continue;
+    }
+    missing.in_flight_ = true;
+    missing.peer_ = *peer_iter;
+    missing.send_time_ = now;
+    missing.peer_list_.erase(peer_iter);
+    peer_in_flight_map_[missing.peer_]++;
+    in_flight_count_++;
+    requested_count_++;
+    rtn[missing.peer_].push_back(iter->first);
+    iter++;
+  }
+  return rtn;
+}
+
+void ambr::syn::OrphanFetch::OnAdded(const ambr::core::UnitHash &hash, Clock::time_point now){
+  auto missing_iter = missing_map_.find(hash);
+  if(missing_iter != missing_map_.end()){
+    FinishInFlight(missing_iter->second);
+    missing_map_.erase(missing_iter);
+  }
+  auto orphan_iter = orphan_map_.find(hash);
+  if(orphan_iter != orphan_map_.end()){
+    last_latency_ = now-orphan_iter->second;
+    total_latency_ += last_latency_;
+    accepted_count_++;
+    orphan_map_.erase(orphan_iter);
+  }
+}
+
+void ambr::syn::OrphanFetch::OnDropped(const ambr::core::UnitHash &hash){
+  orphan_map_.erase(hash);
+}
+
+void ambr::syn::OrphanFetch::RemovePeer(PeerId peer){
+  for(auto iter = missing_map_.begin(); iter != missing_map_.end();){
+    Missing& missing = iter->second;
+    missing.peer_list_.remove(peer);
+    if(missing.in_flight_ && missing.peer_ == peer){
+      FinishInFlight(missing);
+    }
+    if(!missing.in_flight_ && missing.peer_list_.empty()){
+      iter = missing_map_.erase(iter);
+    }else{
+      iter++;
+    }
+  }
+  peer_in_flight_map_.erase(peer);
+}
+
+void ambr::syn::OrphanFetch::Expire(Clock::time_point now){
+  for(auto iter = missing_map_.begin(); iter != missing_map_.end();){
+    Missing& missing = iter->second;
+    if(missing.in_flight_ && now-missing.send_time_ >= timeout_){
+      FinishInFlight(missing);
+    }
+    if(!missing.in_flight_ && missing.peer_list_.empty()){
+      iter = missing_map_.erase(iter);
+    }else{
+      iter++;
+    }
+  }
+  for(auto iter = orphan_map_.begin(); iter != orphan_map_.end();){
+    if(now-iter->second >= max_age_){
+      iter = orphan_map_.erase(iter);
+    }else{
+      iter++;
+    }
+  }
+}
+
+double ambr::syn::OrphanFetch::AverageLatency() const{
+  return accepted_count_?std::chrono::duration<double>(total_latency_).count()/accepted_count_:0;
+}
+
+void ambr::syn::OrphanFetch::FinishInFlight(Missing &missing){
+  if(!missing.in_flight_){
+    return;
+  }
+  missing.in_flight_ = false;
+  in_flight_count_--;
+  auto count_iter = peer_in_flight_map_.find(missing.peer_);
+  if(count_iter != peer_in_flight_map_.end() && !--count_iter->second){
+    peer_in_flight_map_.erase(count_iter);
+  }
+}
@@ -0,0 +1,74 @@
+/**********************************************************************
+ * Copyright (c) 2018 Ambr project
+ * Distributed under the MIT software license, see the accompanying   *
+ * file COPYING or http://www.opensource.org/licenses/mit-license.php.*
+ **********************************************************************/
+#ifndef AMBR_SYN_ORPHAN_FETCH_H_
+#define AMBR_SYN_ORPHAN_FETCH_H_
+#include <stdint.h>
+#include <map>
+#include <list>
+#include <vector>
+#include <chrono>
+#include <core/unit.h>
+namespace ambr {
+namespace syn {
+
+//fetch of units missing by orphans from the peers which relayed them, instead of waiting for next dynasty sync.
+//missing units are requested in one batch per peer, in flight count is bounded in total and per peer.
+//missing unit not arrived in time is requested from next peer whose orphan misses it, or dropped.
+//time from orphan's arrival to it's acceptance is measured.
+//not thread safe.
+class OrphanFetch{
+public:
+  typedef const void* PeerId;//peer of orphan passed to store buffer, it's never dereferenced
+  typedef std::chrono::steady_clock Clock;
+  OrphanFetch(uint32_t max_in_flight = 256, uint32_t max_in_flight_per_peer = 64,
+              Clock::duration timeout = std::chrono::seconds(3));
+public:
+  //orphan relayed by peer waits for missing
+  void AddOrphan(PeerId peer, const core::UnitHash& orphan, const core::UnitHash& missing, Clock::time_point now = Clock::now());
+  //missing units to request from each peer now, they are in flight until added or expired
+  std::map<PeerId, std::vector<core::UnitHash>> NextRequests(Clock::time_point now = Clock::now());
+  //unit added to store:missing unit arrived, or orphan accepted
+  void OnAdded(const core::UnitHash& hash, Clock::time_point now = Clock::now());
+  //orphan dropped by store
+  void OnDropped(const core::UnitHash& hash);
+  //units in flight from peer are requested from others
+  void RemovePeer(PeerId peer);
+  //units in flight longer than timeout are requested from others, orphans waiting longer than max age are forgotten
+  void Expire(Clock::time_point now = Clock::now());
+public:
+  size_t missing_count() const{return missing_map_.size();}
+  size_t in_flight_count() const{return in_flight_count_;}
+  uint64_t requested_count() const{return requested_count_;}
+  uint64_t accepted_count() const{return accepted_count_;}
+  //orphan to accept latency of accepted orphans
+  Clock::duration last_latency() const{return last_latency_;}
+  double AverageLatency() const;
+private:
+  struct Missing{
+    std::list<PeerId> peer_list_;//peers which may have it, front is the next to request
+    bool in_flight_ = false;
+    PeerId peer_ = nullptr;
+    Clock::time_point send_time_;
+  };
+  void FinishInFlight(Missing& missing);
+private:
+  uint32_t max_in_flight_;
+  uint32_t max_in_flight_per_peer_;
+  Clock::duration timeout_;
+  Clock::duration max_age_ = std::chrono::seconds(600);
+  std::map<core::UnitHash, Missing> missing_map_;
+  std::map<PeerId, uint32_t> peer_in_flight_map_;
+  std::map<core::UnitHash, Clock::time_point> orphan_map_;//orphan->time of arrival
+  size_t in_flight_count_ = 0;
+  uint64_t requested_count_ = 0;
+  uint64_t accepted_count_ = 0;
+  Clock::duration last_latency_ = Clock::duration::zero();
+  Clock::duration total_latency_ = Clock::duration::zero();
+};
+
+}
+}
+#endif
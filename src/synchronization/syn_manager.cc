@@ -8,6 +8,11 @@
 #include "net_processing.h"
 #include "netmessagemaker.h"
 #include "store/unit_store.h"
+#include "dynasty_cache.h"
+#include "dynasty_sync.h"
+#include "unit_relay.h"
+#include "orphan_fetch.h"
+#include "unit_ingest.h"
 
 #include <list>
 #include <sstream>
@@ -20,6 +25,7 @@
 #include "syn_manager.h"
 #define FIXED_RATE 70
 #define MAX_CONNECTIONS 12
+#define SYNC_VERIFY_THREADS 4
 /*class SynState{
 public:
   void OnTimeOut(const boost::system::error_code& ec){
@@ -45,17 +51,43 @@ public:
   bool GetIfPauseReceive(const std::string &addr);
   uint64_t GetNodeNonce(const std::string &addr);
   void RemoveNode(CNode* p_node, uint32_t second);
-  bool UnSerialize(std::vector<uint8_t>& vec_bytes);
+  //payload of message after compact size, in place
+  bool UnSerialize(const CNetMessage& netmsg, const uint8_t*& data, size_t& size);
   bool Init(const ambr::syn::SynManagerConfig& config);
-  void SendMessage(CSerializedNetMsg&& msg, CNode* p_node);
+  //false if send queue of node is full and message is dropped
+  bool SendMessage(CSerializedNetMsg&& msg, CNode* p_node);
+  bool SendMessage(CSerializedNetMsg&& msg, CNode* p_node, SendPriority priority);
+  //prefix is of this message, data is queued without copy
+  bool SendMessage(const std::string& command, std::vector<unsigned char>&& prefix, const CSendBuffer& data, CNode* p_node);
   void SetOnAccept(const std::function<void(CNode*)>& func);
   void SetOnConnected(const std::function<void(CNode*)>& func);
   void SetOnDisconnect(const std::function<void(CNode*)>& func);
   void BoardcastMessage(CSerializedNetMsg&& msg, CNode* p_node);
   bool OnReceiveNode(const CNetMessage& netmsg, CNode* p_node);
+  //announce unit added to store to peers which don't know it
+  void RelayUnit(const Ptr_Unit& p_unit);
+  bool OnInventory(const CNetMessage& netmsg, CNode* p_node);
+  bool OnGetData(const CNetMessage& netmsg, CNode* p_node);
+  void OnOrphanUnit(const Ptr_Unit& p_unit, void* peer, const ambr::core::UnitHash& missing);
+  void OnBufferHandled(const Ptr_Unit& p_unit, bool result);
+  //request missing ancestors of orphans from peers which relayed them
+  void FetchOrphanAncestors();
+  //last stage of ingest pipeline, on it's apply thread
+  void ApplyIngestedUnit(const Ptr_Unit& p_unit, UnitIngest::PeerId peer, bool valid);
+  UnitIngest::Stats GetIngestStats();
 
   void ReceiveUnit(const Ptr_Unit& p_unit, CNode* p_node);
   void ReturnUnit(const std::vector<uint8_t>& buf, CNode* p_node);
+  void OnRequestDynasties(const uint8_t* data, size_t size, CNode* p_node);
+  bool OnResponceDynasties(const uint8_t* data, size_t size, CNode* p_node);
+  void OnVerifiedDynasties(DynastySync::PeerId peer, uint32_t start,
+                           const std::shared_ptr<std::vector<DynastySync::Dynasty>>& dynasty_list, bool verified);
+  void OnRequestValidators(const uint8_t* data, size_t size, CNode* p_node);
+  bool OnResponceValidators(const uint8_t* data, size_t size, CNode* p_node);
+  void OnVerifiedValidators(DynastySync::PeerId peer, const ambr::core::UnitHash& anchor,
+                            const DynastySync::HeaderList& header_list,
+                            std::shared_ptr<ambr::store::ValidatorSetStore> validator_set,
+                            bool verified, const std::string& err);
 
 private:
   void Shutdown();
@@ -78,13 +110,19 @@ private:
   Ptr_CScheduler p_scheduler;
   //ambr::syn::SynState state_;
   Ptr_StoreManager p_storemanager_;
-  std::mutex nodes_mutex_;
+  std::mutex nodes_mutex_;//for list_in_nodes_ and list_out_nodes_, also taken by readers
   std::list<CNode*> list_in_nodes_;
   std::list<CNode*> list_out_nodes_;
   std::list<Ptr_Unit> list_ptr_unit_;
   ambr::syn::SynManagerConfig config_;
   ambr::core::UnitHash validator_hash_;
   Ptr_PeerLogicValidation p_peerLogicValidation_;
+  DynastyCache dynasty_cache_;
+  DynastySync dynasty_sync_;
+  UnitRelay unit_relay_;
+  OrphanFetch orphan_fetch_;
+  std::mutex orphan_mutex_;//for orphan_fetch_, taken after nodes_mutex_
+  std::unique_ptr<UnitIngest> unit_ingest_;//peer of unit is CNode referenced until unit is applied
 
 
 
@@ -100,31 +138,133 @@ private:
   uint32_t dynasty_timer_value_;
   boost::asio::deadline_timer sync_timer_;
   uint32_t sync_timer_value_;
-  CNode* node_sync_;
-  void StartSyn(CNode* node_sync){
-    static std::mutex mutex;
-    std::lock_guard<std::mutex> lk(mutex);
-    if(is_sync_ == true)return;
-    is_sync_ = true;
-    node_sync_ = node_sync;
-    //request sync
-    SendMessage(CNetMsgMaker(INIT_PROTO_VERSION).Make(NetMsgType::REQUESTDYNASTY, p_storemanager_->GetLastValidatedUnitHash().encode_to_hex()), node_sync);
-    LOG(WARNING)<<">>>>>>>>>>start sync:"<<p_storemanager_->GetLastValidatedUnitHash().encode_to_hex();
-    sync_timer_.expires_from_now(boost::posix_time::milliseconds(sync_timer_value_));
-    sync_timer_.async_wait(boost::bind(&ambr::syn::SynManager::Impl::OnSyncTimeOut, this, boost::asio::placeholders::error));
+  std::map<DynastySync::PeerId, CNode*> sync_node_map_;
+  std::map<DynastySync::PeerId, std::shared_ptr<ChunkAssembler>> assembler_map_;
+  DynastySync::PeerId header_peer_;//validator units are requested from, -1 if none
+  std::chrono::steady_clock::time_point header_request_time_;
+  uint64_t anchor_nonce_;
+  std::shared_ptr<ambr::store::ValidatorSetStore> header_validator_set_;//after last header, the one of store at anchor if none
+  std::mutex sync_mutex_;//for is_sync_, sync_node_map_, header_peer_, dynasty_sync_
+  boost::threadpool::pool verify_pool_;//verify signatures of responses out of network thread
+  //start sync from nodes, or add them to the sync running
+  void StartSyn(const std::list<CNode*>& node_list){
+    std::lock_guard<std::mutex> lk(sync_mutex_);
+    if(is_sync_ != true){
+      is_sync_ = true;
+      sync_node_map_.clear();
+      header_peer_ = -1;
+      dynasty_sync_.Start(p_storemanager_->GetLastValidatedUnitHash());
+      //headers first, dynasties are requested when their validator units are verified
+      dynasty_sync_.AddHeaders(DynastySync::HeaderList());
+      std::shared_ptr<ambr::store::ValidatorUnitStore> anchor_store = p_storemanager_->GetValidateUnit(dynasty_sync_.anchor());
+      anchor_nonce_ = anchor_store?anchor_store->unit()->nonce():0;
+      header_validator_set_ = p_storemanager_->GetValidatorSet();
+      LOG(WARNING)<<">>>>>>>>>>start sync:"<<dynasty_sync_.anchor().encode_to_hex()<<" from "<<node_list.size()<<" nodes";
+      sync_timer_.expires_from_now(boost::posix_time::milliseconds(sync_timer_value_));
+      sync_timer_.async_wait(boost::bind(&ambr::syn::SynManager::Impl::OnSyncTimeOut, this, boost::asio::placeholders::error));
+    }
+    for(CNode* node:node_list){
+      //stalled peer isn't added again until next sync
+      if(dynasty_sync_.HasPeer(node->GetId()))continue;
+      dynasty_sync_.AddPeer(node->GetId());
+      sync_node_map_[node->GetId()] = node;
+    }
+    if(header_peer_ == -1 && !dynasty_sync_.headers_done()){
+      RequestHeaders();
+    }
+    RequestDynasties();
   }
+  //request validator units after last verified one from the peer with newest nonce, need sync_mutex_ locked
+  void RequestHeaders(){
+    if(header_peer_ == -1 || !sync_node_map_.count(header_peer_)){
+      header_peer_ = -1;
+      uint64_t newest_nonce = 0;
+      for(const std::pair<const DynastySync::PeerId, CNode*>& item:sync_node_map_){
+        if(dynasty_sync_.HasPeer(item.first) && item.second->latest_nonce >= newest_nonce){
+          newest_nonce = item.second->latest_nonce;
+          header_peer_ = item.first;
+        }
+      }
+      if(header_peer_ == -1){
+        LOG(WARNING)<<"no peer to get validator units, stop sync";
+        OnGetSync();
+        return;
+      }
+    }
+    std::shared_ptr<ambr::core::ValidatorUnit> last_header = dynasty_sync_.last_header();
+    ambr::core::UnitHash anchor = last_header?last_header->hash():dynasty_sync_.anchor();
+    std::string str_buf((const char*)anchor.bytes().data(), anchor.bytes().size());
+    uint32_t count = DynastySync::MAX_HEADERS_PER_RESPONSE;
+    str_buf.append((const char*)&count, sizeof(count));
+    SendMessage(CNetMsgMaker(INIT_PROTO_VERSION).Make(NetMsgType::REQUESTVALIDATORS, str_buf), sync_node_map_[header_peer_]);
+    header_request_time_ = std::chrono::steady_clock::now();
+  }
+  //drop a peer which stalled or sent invalid data, need sync_mutex_ locked
+  void DropSyncPeer(DynastySync::PeerId peer, bool disconnect){
+    auto iter = sync_node_map_.find(peer);
+    if(iter == sync_node_map_.end())return;
+    if(disconnect){
+      RemoveNode(iter->second, 0);
+    }
+    dynasty_sync_.RemovePeer(peer);
+    sync_node_map_.erase(iter);
+    assembler_map_.erase(peer);
+    if(peer == header_peer_ && is_sync_ == true && !dynasty_sync_.headers_done()){
+      header_peer_ = -1;
+      RequestHeaders();
+    }
+  }
+  //send ranges of dynasty_sync_ to every peer, need sync_mutex_ locked
+  void RequestDynasties(){
+    for(const std::pair<const DynastySync::PeerId, CNode*>& item:sync_node_map_){
+      for(const DynastySync::Range& range:dynasty_sync_.NextRequests(item.first)){
+        //served from validator unit before the range, so peer doesn't walk from anchor
+        ambr::core::UnitHash prev_hash = dynasty_sync_.PrevHash(range.start_);
+        std::string str_buf((const char*)prev_hash.bytes().data(), prev_hash.bytes().size());
+        str_buf.append((const char*)&range.start_, sizeof(range.start_));
+        str_buf.append((const char*)&range.count_, sizeof(range.count_));
+        SendMessage(CNetMsgMaker(INIT_PROTO_VERSION).Make(NetMsgType::REQUESTDYNASTIES, str_buf), item.second);
+      }
+    }
+  }
+  //need sync_mutex_ locked
   void OnGetSync(){
-    LOG(INFO)<<"Get sync data";
+    LOG(INFO)<<"Get sync data, "<<dynasty_sync_.applied_dynasty_count()<<" dynasties "
+             <<dynasty_sync_.applied_unit_count()<<" units, "
+             <<dynasty_sync_.DynastyRate()<<" dynasties/s "
+             <<dynasty_sync_.UnitRate()<<" units/s, "
+             <<dynasty_sync_.stolen_count()<<" ranges stolen";
+    for(const std::pair<const DynastySync::PeerId, CNode*>& item:sync_node_map_){
+      LOG(INFO)<<"peer "<<item.first<<":"<<dynasty_sync_.PeerRate(item.first)<<" dynasties/s";
+    }
     sync_timer_.cancel();
+    sync_node_map_.clear();
+    assembler_map_.clear();
+    header_peer_ = -1;
     is_sync_ = false;
   }
+  //tick of running sync, ranges of stalled peers go to others
   void OnSyncTimeOut(const boost::system::error_code& ec){
-    LOG(WARNING)<<ec.message();
     if(ec)return;
-    LOG(WARNING)<<"<<<<<<<<<<<<sync timeout";
-    //sync_timer_.expires_from_now(boost::posix_time::milliseconds(sync_timer_value_));
-    //sync_timer_.async_wait(boost::bind(&ambr::syn::SynManager::Impl::OnSyncTimeOut, this, _1));
-    is_sync_ = false;
+    std::lock_guard<std::mutex> lk(sync_mutex_);
+    if(is_sync_ != true)return;
+    for(DynastySync::PeerId peer:dynasty_sync_.Expire()){
+      LOG(WARNING)<<"<<<<<<<<<<<<sync timeout of peer "<<peer;
+    }
+    if(header_peer_ != -1 && !dynasty_sync_.headers_done() &&
+       std::chrono::steady_clock::now()-header_request_time_ > std::chrono::seconds(10)){
+      LOG(WARNING)<<"<<<<<<<<<<<<validator units timeout of peer "<<header_peer_;
+      DropSyncPeer(header_peer_, false);
+      if(is_sync_ != true)return;
+    }
+    if(dynasty_sync_.finished()){
+      //restart from applied dynasty by next IosDenastySyn
+      OnGetSync();
+      return;
+    }
+    RequestDynasties();
+    sync_timer_.expires_from_now(boost::posix_time::milliseconds(sync_timer_value_));
+    sync_timer_.async_wait(boost::bind(&ambr::syn::SynManager::Impl::OnSyncTimeOut, this, boost::asio::placeholders::error));
   }
 };
 
@@ -152,8 +292,18 @@ ambr::syn::SynManager::Impl::Impl(Ptr_StoreManager p_store_manager)
   , dynasty_timer_(ios_)
   , dynasty_timer_value_(1000)
   , sync_timer_(ios_)
-  , sync_timer_value_(10000)
-  , node_sync_(nullptr){
+  , sync_timer_value_(1000)
+  , header_peer_(-1)
+  , anchor_nonce_(0)
+  , verify_pool_(SYNC_VERIFY_THREADS){
+  p_storemanager_->AddCallBackOrphanUnit(std::bind(&ambr::syn::SynManager::Impl::OnOrphanUnit, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+  p_storemanager_->AddBufferHandleBack(std::bind(&ambr::syn::SynManager::Impl::OnBufferHandled, this, std::placeholders::_1, std::placeholders::_3));
+  unit_ingest_.reset(new UnitIngest(
+    std::bind(&ambr::syn::SynManager::Impl::ApplyIngestedUnit, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3),
+    [](UnitIngest::PeerId peer, bool pause){
+      ambr::p2p::PauseReceive((CNode*)peer, pause);
+    },
+    SYNC_VERIFY_THREADS));
 }
 
 uint32_t ambr::syn::SynManager::Impl::GetNodeCount(){
@@ -167,6 +317,7 @@ void ambr::syn::SynManager::Impl::AddListInNode(CNode *pnode){
 }
 
 bool ambr::syn::SynManager::Impl::GetIfPauseSend(const std::string &addr){
+  std::lock_guard<std::mutex> lk(nodes_mutex_);
   for(CNode* node_item:list_in_nodes_){
     if(node_item->GetAddrName() == addr){
       return node_item->fPauseSend;
@@ -181,6 +332,7 @@ bool ambr::syn::SynManager::Impl::GetIfPauseSend(const std::string &addr){
 }
 
 bool ambr::syn::SynManager::Impl::GetIfPauseReceive(const std::string &addr){
+  std::lock_guard<std::mutex> lk(nodes_mutex_);
   for(CNode* node_item:list_in_nodes_){
     if(node_item->GetAddrName() == addr){
       return node_item->fPauseRecv;
@@ -195,6 +347,7 @@ bool ambr::syn::SynManager::Impl::GetIfPauseReceive(const std::string &addr){
 }
 
 uint64_t ambr::syn::SynManager::Impl::GetNodeNonce(const std::string &addr){
+  std::lock_guard<std::mutex> lk(nodes_mutex_);
   for(CNode* node_item:list_in_nodes_){
     if(node_item->GetAddrName() == addr){
       return node_item->latest_nonce;
@@ -214,51 +367,33 @@ void ambr::syn::SynManager::Impl::RemoveNode(CNode* p_node, uint32_t second){
   p_node->fDisconnect = true;
 }
 
-bool ambr::syn::SynManager::Impl::UnSerialize(std::vector<uint8_t>& vec_bytes){
-  size_t data_length = vec_bytes.size();size_t i = std::numeric_limits<unsigned int>::max();
+bool ambr::syn::SynManager::Impl::UnSerialize(const CNetMessage& netmsg, const uint8_t*& data, size_t& size){
+  const uint8_t* buf = (const uint8_t*)netmsg.vRecv.data();
+  size_t data_length = netmsg.vRecv.size();
   if(0 >= data_length){
     return false;
   }
-  else if(253 >= data_length){
-    uint8_t msg_size = vec_bytes[0];
-    if(data_length - 1 == msg_size){
-      auto it = vec_bytes.begin();
-      vec_bytes.erase(it);
-    }
-    else{
-      return false;
-    }
+  size_t prefix_size = 1;
+  uint64_t msg_size = buf[0];
+  if(253 == buf[0]){
+    prefix_size = 3;
+  }else if(254 == buf[0]){
+    prefix_size = 5;
+  }else if(255 == buf[0]){
+    prefix_size = 9;
   }
-  else if(std::numeric_limits<unsigned short>::max() + 3 >= data_length){
-    uint16_t msg_size = vec_bytes[2] * 256 + vec_bytes[1];
-    if(data_length - 3 == msg_size){
-      auto it = vec_bytes.begin();
-      vec_bytes.erase(it, it + 3);
-    }
-    else{
-      return false;
-    }
+  if(data_length < prefix_size){
+    return false;
   }
-  else if(i + 5 >= data_length){
-    uint32_t msg_size = vec_bytes[4] * 16777216 + vec_bytes[3] * 65536 + vec_bytes[2] * 256 + vec_bytes[1];
-    if(data_length - 5 == msg_size){
-      auto it = vec_bytes.begin();
-      vec_bytes.erase(it, it + 5);
-    }
-    else{
-      return false;
-    }
+  if(prefix_size > 1){
+    msg_size = 0;
+    memcpy(&msg_size, buf+1, prefix_size-1);
   }
-  else{
-    uint64_t msg_size = vec_bytes[8] * pow(2, 56) + vec_bytes[7] * pow(2, 48) + vec_bytes[6] * pow(2, 40) + vec_bytes[5] * 4294967296 + vec_bytes[4] * 16777216 + vec_bytes[3] * 65536 + vec_bytes[2] * 256 + vec_bytes[1];
-    if(data_length - 9 == msg_size){
-     auto it = vec_bytes.begin();
-      vec_bytes.erase(it, it + 9);
-    }
-    else{
-      return false;
-    }
+  if(data_length-prefix_size != msg_size){
+    return false;
   }
+  data = buf+prefix_size;
+  size = msg_size;
   return true;
 }
 
@@ -279,6 +414,12 @@ bool ambr::syn::SynManager::Impl::Init(const SynManagerConfig &config){
   connOptions.nMaxAddnode = MAX_ADDNODE_CONNECTIONS;
   connOptions.nLocalServices = ServiceFlags(NODE_NETWORK | NODE_WITNESS);
   connOptions.nMaxOutbound = std::min(MAX_OUTBOUND_CONNECTIONS, connOptions.nMaxConnections);
+  if(!config.socket_events_.empty() && !ParseSocketEventsMode(config.socket_events_, connOptions.socketEventsMode)){
+    LOG(WARNING) << "Unknown socket events " << config.socket_events_ << ", use select";
+  }
+  if(config.msg_handler_threads_){
+    connOptions.nMessageHandlerThreads = config.msg_handler_threads_;
+  }
 
   connOptions.DoAccept = std::bind(&ambr::syn::SynManager::Impl::OnAcceptNode, this, std::placeholders::_1);
   connOptions.DoConnect = std::bind(&ambr::syn::SynManager::Impl::OnConnectNode, this, std::placeholders::_1);
@@ -297,10 +438,25 @@ bool ambr::syn::SynManager::Impl::Init(const SynManagerConfig &config){
 
 }
 
-void ambr::syn::SynManager::Impl::SendMessage(CSerializedNetMsg&& msg, CNode* p_node){
+bool ambr::syn::SynManager::Impl::SendMessage(CSerializedNetMsg&& msg, CNode* p_node){
   if(p_node){
-     ambr::p2p::SendMessage(p_node, std::forward<CSerializedNetMsg>(msg));
+     return ambr::p2p::SendMessage(p_node, std::forward<CSerializedNetMsg>(msg));
   }
+  return false;
+}
+
+bool ambr::syn::SynManager::Impl::SendMessage(CSerializedNetMsg&& msg, CNode* p_node, SendPriority priority){
+  if(p_node){
+     return ambr::p2p::SendMessage(p_node, std::forward<CSerializedNetMsg>(msg), priority);
+  }
+  return false;
+}
+
+bool ambr::syn::SynManager::Impl::SendMessage(const std::string& command, std::vector<unsigned char>&& prefix, const CSendBuffer& data, CNode* p_node){
+  if(p_node){
+     return ambr::p2p::SendMessage(p_node, command, std::move(prefix), data);
+  }
+  return false;
 }
 
 void ambr::syn::SynManager::Impl::SetOnAccept(const std::function<void(CNode*)>& func){
@@ -319,139 +475,387 @@ void ambr::syn::SynManager::Impl::BoardcastMessage(CSerializedNetMsg&& msg, CNod
     ambr::p2p::BroadcastMessage(std::forward<CSerializedNetMsg>(msg));
 }
 
+//request:hash of validator unit before the range+start(uint32_t)+count(uint32_t)
+//responce:see DynastySync::EncodeResponse
+void ambr::syn::SynManager::Impl::OnRequestDynasties(const uint8_t* data, size_t size, CNode* p_node){
+  ambr::core::UnitHash validator_hash;
+  uint32_t start = 0, count = 0;
+  if(size != validator_hash.bytes().size()+sizeof(start)+sizeof(count)){
+    return;
+  }
+  validator_hash.set_bytes(data, validator_hash.bytes().size());
+  memcpy(&start, data+validator_hash.bytes().size(), sizeof(start));
+  memcpy(&count, data+validator_hash.bytes().size()+sizeof(start), sizeof(count));
+  std::vector<std::vector<uint8_t>> chunk_list;
+  DynastySync::EncodeResponse(p_storemanager_.get(), &dynasty_cache_, validator_hash, start, count, chunk_list);
+  for(std::vector<uint8_t>& chunk:chunk_list){
+    CSerializedNetMsg msg;
+    msg.command = NetMsgType::RESPONCEDYNASTIES;
+    msg.data.swap(chunk);
+    //rest of response is requested again by peer after it's timeout
+    if(!SendMessage(std::move(msg), p_node)){
+      LOG(WARNING)<<"send queue of "<<p_node->GetAddrName()<<" is full, dynasty response stopped";
+      break;
+    }
+  }
+}
+
+bool ambr::syn::SynManager::Impl::OnResponceDynasties(const uint8_t* data, size_t size, CNode* p_node){
+  DynastySync::PeerId peer = p_node->GetId();
+  std::shared_ptr<ChunkAssembler> assembler;
+  {
+    std::lock_guard<std::mutex> lk(sync_mutex_);
+    if(is_sync_ != true || !sync_node_map_.count(peer)){
+      return false;
+    }
+    std::shared_ptr<ChunkAssembler>& item = assembler_map_[peer];
+    if(!item){
+      item = std::make_shared<ChunkAssembler>();
+    }
+    //response can't be larger than the dynasties requested
+    item->set_max_size(dynasty_sync_.MaxResponseSize(peer));
+    assembler = item;
+  }
+  //only message thread of the peer uses it's assembler
+  const uint8_t* response = nullptr;
+  size_t response_size = 0;
+  ChunkAssembler::Result result = assembler->Add(data, size, response, response_size);
+  if(result != ChunkAssembler::Complete){
+    return result == ChunkAssembler::Partial;
+  }
+  uint32_t start = 0;
+  std::shared_ptr<std::vector<DynastySync::Dynasty>> dynasty_list = std::make_shared<std::vector<DynastySync::Dynasty>>();
+  if(!DynastySync::DecodeResponse(response, response_size, start, *dynasty_list)){
+    return false;
+  }
+  //signatures of a response are verified in batch on the pool, so the network thread keeps receiving from other peers
+  verify_pool_.schedule([this, peer, start, dynasty_list](){
+    OnVerifiedDynasties(peer, start, dynasty_list, DynastySync::VerifyDynasties(*dynasty_list));
+  });
+  return true;
+}
+
+void ambr::syn::SynManager::Impl::OnVerifiedDynasties(DynastySync::PeerId peer, uint32_t start,
+                                                      const std::shared_ptr<std::vector<DynastySync::Dynasty>>& dynasty_list, bool verified){
+  std::lock_guard<std::mutex> lk(sync_mutex_);
+  auto iter = sync_node_map_.find(peer);
+  if(is_sync_ != true || iter == sync_node_map_.end()){
+    return;
+  }
+  if(!verified){
+    LOG(WARNING)<<"peer "<<peer<<" sended invalid dynasty";
+    DropSyncPeer(peer, true);
+  }else if(!dynasty_sync_.OnResponse(peer, start, std::move(*dynasty_list))){
+    if(dynasty_sync_.HasPeer(peer)){
+      return;
+    }
+    LOG(WARNING)<<"peer "<<peer<<" sended dynasty which doesn't match validator unit";
+    DropSyncPeer(peer, true);
+  }
+  if(is_sync_ != true){
+    return;
+  }
+  //apply in order, units of dynasty are added together
+  DynastySync::Dynasty dynasty;
+  while(dynasty_sync_.PopReady(dynasty)){
+    p_storemanager_->AddUnitsToBuffer(dynasty);
+  }
+  if(dynasty_sync_.failed()){
+    LOG(WARNING)<<"dynasty doesn't link to applied one, stop sync";
+  }
+  if(dynasty_sync_.finished()){
+    OnGetSync();
+    LOG(WARNING)<<">>>>>>>>>>Receive sync:"<<p_storemanager_->GetLastValidatedUnitHash().encode_to_hex();
+  }else{
+    RequestDynasties();
+  }
+}
+
+//request:anchor hash+count(uint32_t)
+//responce:see DynastySync::EncodeHeaders
+void ambr::syn::SynManager::Impl::OnRequestValidators(const uint8_t* data, size_t size, CNode* p_node){
+  ambr::core::UnitHash validator_hash;
+  uint32_t count = 0;
+  if(size != validator_hash.bytes().size()+sizeof(count)){
+    return;
+  }
+  validator_hash.set_bytes(data, validator_hash.bytes().size());
+  memcpy(&count, data+validator_hash.bytes().size(), sizeof(count));
+  CSerializedNetMsg msg;
+  msg.command = NetMsgType::RESPONCEVALIDATORS;
+  msg.data = DynastySync::EncodeHeaders(p_storemanager_.get(), validator_hash, count);
+  SendMessage(std::move(msg), p_node);
+}
+
+bool ambr::syn::SynManager::Impl::OnResponceValidators(const uint8_t* data, size_t size, CNode* p_node){
+  ambr::core::UnitHash anchor;
+  std::shared_ptr<DynastySync::HeaderList> header_list = std::make_shared<DynastySync::HeaderList>();
+  if(!DynastySync::DecodeHeaders(data, size, anchor, *header_list)){
+    return false;
+  }
+  DynastySync::PeerId peer = p_node->GetId();
+  uint64_t prev_nonce = 0;
+  std::shared_ptr<ambr::store::ValidatorSetStore> validator_set;
+  {
+    std::lock_guard<std::mutex> lk(sync_mutex_);
+    if(is_sync_ != true || peer != header_peer_){
+      return false;
+    }
+    std::shared_ptr<ambr::core::ValidatorUnit> last_header = dynasty_sync_.last_header();
+    if(anchor != (last_header?last_header->hash():dynasty_sync_.anchor())){
+      return false;
+    }
+    prev_nonce = last_header?last_header->nonce():anchor_nonce_;
+    validator_set = std::make_shared<ambr::store::ValidatorSetStore>(*header_validator_set_);
+  }
+  uint64_t max_nonce = p_storemanager_->GetNonceByNowTime()+1;
+  verify_pool_.schedule([this, peer, anchor, prev_nonce, max_nonce, validator_set, header_list](){
+    std::string err;
+    bool verified = DynastySync::VerifyHeaders(anchor, prev_nonce, max_nonce, *validator_set, *header_list, &err);
+    OnVerifiedValidators(peer, anchor, *header_list, validator_set, verified, err);
+  });
+  return true;
+}
+
+void ambr::syn::SynManager::Impl::OnVerifiedValidators(DynastySync::PeerId peer, const ambr::core::UnitHash& anchor,
+                                                       const DynastySync::HeaderList& header_list,
+                                                       std::shared_ptr<ambr::store::ValidatorSetStore> validator_set,
+                                                       bool verified, const std::string& err){
+  std::lock_guard<std::mutex> lk(sync_mutex_);
+  if(is_sync_ != true || peer != header_peer_){
+    return;
+  }
+  std::shared_ptr<ambr::core::ValidatorUnit> last_header = dynasty_sync_.last_header();
+  if(anchor != (last_header?last_header->hash():dynasty_sync_.anchor())){
+    return;
+  }
+  if(!verified){
+    LOG(WARNING)<<"peer "<<peer<<" sended invalid validator unit:"<<err;
+    DropSyncPeer(peer, true);
+  }else if(header_list.empty()){
+    //reached peer's last validated one
+    dynasty_sync_.set_headers_done();
+    LOG(INFO)<<"Get "<<dynasty_sync_.header_count()<<" validator units";
+  }else{
+    dynasty_sync_.AddHeaders(header_list);
+    header_validator_set_ = validator_set;
+    RequestHeaders();
+  }
+  if(is_sync_ != true){
+    return;
+  }
+  if(dynasty_sync_.finished()){
+    OnGetSync();
+    LOG(WARNING)<<">>>>>>>>>>Receive sync:"<<p_storemanager_->GetLastValidatedUnitHash().encode_to_hex();
+  }else{
+    RequestDynasties();
+  }
+}
+
 bool ambr::syn::SynManager::Impl::OnReceiveNode(const CNetMessage& netmsg, CNode* p_node){
     std::string&& tmp = netmsg.hdr.GetCommand();
+    const uint8_t* data = nullptr;
+    size_t size = 0;
     if(NetMsgType::REQUESTDYNASTY == tmp){
-      std::vector<uint8_t> buf;
-      buf.assign(netmsg.vRecv.begin(), netmsg.vRecv.end());
-      if(!UnSerialize(buf)) return false;
+      if(!UnSerialize(netmsg, data, size)) return false;
       ambr::core::UnitHash validator_hash;
-      validator_hash.decode_from_hex(std::string((const char*)buf.data(), buf.size()));
+      validator_hash.decode_from_hex(std::string((const char*)data, size));
       ambr::core::UnitHash validator_hash_next_ = p_storemanager_->GetNextValidatorHash(validator_hash);
       if(validator_hash_next_.is_zero())return true;
       if(!p_storemanager_->GetValidateUnit(validator_hash_next_)->is_validate())return true;
-      std::list<std::shared_ptr<ambr::core::Unit> >unit_list = p_storemanager_->GetAllUnitByValidatorUnitHash(validator_hash_next_);
-      LOG(INFO)<<"Count of sended unit is :"<<unit_list.size();
-      std::vector<std::vector<uint8_t>> unit_list_buf;
-      //unit_list_buf.resize(unit_list.size());
-      size_t idx = 0;
-      size_t buf_count = 0;
-      for(std::shared_ptr<ambr::core::Unit> unit_item: unit_list){
-        std::vector<uint8_t> unit_buf = unit_item->SerializeByte();
-        uint32_t type = (uint32_t)unit_item->type();
-        unit_buf.insert(unit_buf.begin(), (char*)&type, (char*)(&type+1));
-        unit_list_buf.push_back(unit_buf);
-        buf_count += unit_list_buf[idx].size()+sizeof(uint64_t);
-        idx++;
-      }
-      std::string str_buf(buf_count, 0);
-      idx = 0;
-      for(const std::vector<uint8_t> &buf_item: unit_list_buf){
-        uint64_t len = buf_item.size();
-        memcpy((char*)str_buf.data()+idx, &len, sizeof(len));
-        idx += sizeof(len);
-        memcpy((char*)str_buf.data()+idx, buf_item.data(), buf_item.size());
-        idx+=buf_item.size();
-      }
-      SendMessage(CNetMsgMaker(INIT_PROTO_VERSION).Make(NetMsgType::RESPONCEDYNASTY, str_buf), p_node);
-    }else if(NetMsgType::RESPONCEDYNASTY == tmp){
-      if(p_node != node_sync_ || is_sync_ != true){
-        return false;
-      }
-
-      std::vector<uint8_t> buf;
-      buf.assign(netmsg.vRecv.begin(), netmsg.vRecv.end());
-      if(!UnSerialize(buf)) return false;
-      bool right = true;
-      uint64_t idx = 0;
-      uint32_t unit_count = 0;
-      while(right){
-        uint64_t size = 0;
-        if(buf.size() - idx < sizeof(size)){
-          LOG(INFO)<<"Count of Receive unit is :"<<unit_count;
-          OnGetSync();
-          LOG(WARNING)<<">>>>>>>>>>Receive sync:"<<p_storemanager_->GetLastValidatedUnitHash().encode_to_hex();
-          return false;
-        }
-        memcpy(&size, buf.data()+idx, sizeof(size));
-        idx+=sizeof(size);
-        if(size <= sizeof(uint32_t)){
-          return false;
-        }
-
-        uint32_t type = 0;
-        if(buf.size() - idx < sizeof(type))return true;
-        memcpy(&type, buf.data()+idx, sizeof(type));
-        idx+=sizeof(type);
-        std::shared_ptr<ambr::core::Unit> unit;
-        switch((ambr::core::UnitType)type){
-          //TODO:efficiency should improve
-          case ambr::core::UnitType::send:unit = std::make_shared<ambr::core::SendUnit>();break;
-          case ambr::core::UnitType::receive:unit = std::make_shared<ambr::core::ReceiveUnit>();break;
-          case ambr::core::UnitType::Vote:unit = std::make_shared<ambr::core::VoteUnit>();break;
-          case ambr::core::UnitType::Validator:unit = std::make_shared<ambr::core::ValidatorUnit>();break;
-          case ambr::core::UnitType::EnterValidateSet:unit = std::make_shared<ambr::core::EnterValidateSetUnit>();break;
-          case ambr::core::UnitType::LeaveValidateSet:unit = std::make_shared<ambr::core::LeaveValidateSetUnit>();break;
-          default:
-            return false;
-        }
-        std::vector<uint8_t> buf_tmp;
-        buf_tmp.resize(size-sizeof(type));
-        if(buf.size() - idx < size - sizeof(type))return true;
-        memcpy(buf_tmp.data(), buf.data()+idx, buf_tmp.size());
-        if(!unit->DeSerializeByte(buf_tmp, nullptr)){
-          return false;
-        }
-        idx+=buf_tmp.size();
-        p_storemanager_->AddUnitToBuffer(unit);
-        unit_count++;
-      }
+      //validated dynasty never changes, peers syncing at the same time share one encoded payload
+      DynastyCache::Payload payload = DynastySync::GetDynastyPayload(p_storemanager_.get(), &dynasty_cache_, validator_hash_next_);
+      //only the length prefix is per peer, payload buffer is queued as is
+      std::vector<unsigned char> prefix;
+      CVectorWriter(SER_NETWORK, INIT_PROTO_VERSION, prefix, 0) << COMPACTSIZE((uint64_t)payload->size());
+      SendMessage(NetMsgType::RESPONCEDYNASTY, std::move(prefix), payload, p_node);
+    }else if(NetMsgType::REQUESTDYNASTIES == tmp){
+      if(!UnSerialize(netmsg, data, size)) return false;
+      OnRequestDynasties(data, size, p_node);
+    }else if(NetMsgType::RESPONCEDYNASTIES == tmp){
+      if(!UnSerialize(netmsg, data, size)) return false;
+      return OnResponceDynasties(data, size, p_node);
+    }else if(NetMsgType::REQUESTVALIDATORS == tmp){
+      if(!UnSerialize(netmsg, data, size)) return false;
+      OnRequestValidators(data, size, p_node);
+    }else if(NetMsgType::RESPONCEVALIDATORS == tmp){
+      if(!UnSerialize(netmsg, data, size)) return false;
+      return OnResponceValidators(data, size, p_node);
     }else if(NetMsgType::NEWUNIT == tmp){
-      std::vector<uint8_t> buf;
-      buf.assign(netmsg.vRecv.begin(), netmsg.vRecv.end());
-      if(!UnSerialize(buf)) return false;
+      if(!UnSerialize(netmsg, data, size)) return false;
       uint32_t type = 0;
-      if(buf.size() < sizeof(type))return false;
-      memcpy(&type, buf.data(), sizeof(type));
+      if(size < sizeof(type))return false;
+      memcpy(&type, data, sizeof(type));
       std::shared_ptr<ambr::core::Unit> unit;
-      std::vector<uint8_t> buf_for_deser;
-      buf_for_deser.resize(buf.size()-sizeof(type));
-      memcpy(buf_for_deser.data(), buf.data()+sizeof(type), buf.size()-sizeof(type));
       switch((ambr::core::UnitType)type){
-        //TODO:efficiency should improve
         case ambr::core::UnitType::send:
           unit = std::make_shared<ambr::core::SendUnit>();
-          if(!unit->DeSerializeByte(buf_for_deser, nullptr))return false;
           break;
         case ambr::core::UnitType::receive:
           unit = std::make_shared<ambr::core::ReceiveUnit>();
-          if(!unit->DeSerializeByte(buf_for_deser, nullptr))return false;
           break;
         case ambr::core::UnitType::Vote:
           unit = std::make_shared<ambr::core::VoteUnit>();
-          if(!unit->DeSerializeByte(buf_for_deser, nullptr))return false;
           break;
         case ambr::core::UnitType::Validator:
           unit = std::make_shared<ambr::core::ValidatorUnit>();
-          if(!unit->DeSerializeByte(buf_for_deser, nullptr))return false;
           break;
         case ambr::core::UnitType::EnterValidateSet:
           unit = std::make_shared<ambr::core::EnterValidateSetUnit>();
-          if(!unit->DeSerializeByte(buf_for_deser, nullptr))return false;
           break;
         case ambr::core::UnitType::LeaveValidateSet:
           unit = std::make_shared<ambr::core::LeaveValidateSetUnit>();
-          if(!unit->DeSerializeByte(buf_for_deser, nullptr))return false;
           break;
         default:
           return false;
       }
-      p_storemanager_->AddUnitToBuffer(unit);
+      if(!unit->DeSerializeByte(data+sizeof(type), size-sizeof(type), nullptr))return false;
+      ambr::core::UnitHash hash = unit->hash();
+      //duplicate of unit received from another peer, hash is known only after the unit is verified
+      if(!unit_relay_.OnReceived(hash))return true;
+      //verified and added out of network thread
+      p_node->AddRef();
+      if(!unit_ingest_->Push(unit, p_node)){
+        unit_relay_.OnVerified(hash, false);
+        p_node->Release();
+      }
+    }else if(NetMsgType::INV == tmp){
+      return OnInventory(netmsg, p_node);
+    }else if(NetMsgType::GETDATA == tmp){
+      return OnGetData(netmsg, p_node);
     }
 
     return true;
 }
 
+//NEWUNIT message:compact size+type(uint32_t)+unit bytes
+static CSerializedNetMsg MakeUnitMessage(const std::shared_ptr<ambr::core::Unit>& p_unit){
+  uint32_t type = (uint32_t)p_unit->type();
+  std::vector<uint8_t> unit_buf = p_unit->SerializeByte();
+  CSerializedNetMsg msg;
+  msg.command = NetMsgType::NEWUNIT;
+  msg.data.reserve(9+sizeof(type)+unit_buf.size());
+  CVectorWriter(SER_NETWORK, INIT_PROTO_VERSION, msg.data, 0) << COMPACTSIZE((uint64_t)(sizeof(type)+unit_buf.size()));
+  msg.data.insert(msg.data.end(), (const uint8_t*)&type, (const uint8_t*)(&type+1));
+  msg.data.insert(msg.data.end(), unit_buf.begin(), unit_buf.end());
+  return msg;
+}
+
+//votes and validator units keep consensus going, they are sent ahead of other units
+static SendPriority GetUnitPriority(const std::shared_ptr<ambr::core::Unit>& p_unit){
+  if(p_unit->type() == ambr::core::UnitType::Vote || p_unit->type() == ambr::core::UnitType::Validator){
+    return SEND_PRIORITY_HIGH;
+  }
+  return SEND_PRIORITY_RELAY;
+}
+
+void ambr::syn::SynManager::Impl::RelayUnit(const Ptr_Unit& p_unit){
+  ambr::core::UnitHash hash = p_unit->hash();
+  unit_relay_.AddKnown(hash);
+  ambr::p2p::PushInventory(CInv(MSG_UNIT, UnitRelay::ToInvHash(hash)));
+}
+
+bool ambr::syn::SynManager::Impl::OnInventory(const CNetMessage& netmsg, CNode* p_node){
+  std::vector<CInv> inv_list;
+  CDataStream(netmsg.vRecv) >> inv_list;
+  if(inv_list.size() > MAX_INV_SZ)return false;
+  std::vector<ambr::core::UnitHash> hash_list;
+  for(const CInv& inv:inv_list){
+    if(inv.type != MSG_UNIT)continue;
+    p_node->AddInventoryKnown(inv);
+    ambr::core::UnitHash hash = UnitRelay::FromInvHash(inv.hash);
+    if(unit_relay_.IsKnown(hash))continue;
+    if(p_storemanager_->GetUnit(hash)){
+      unit_relay_.AddKnown(hash);
+      continue;
+    }
+    hash_list.push_back(hash);
+  }
+  std::vector<CInv> request_list;
+  for(const ambr::core::UnitHash& hash:unit_relay_.FilterRequest(hash_list)){
+    request_list.push_back(CInv(MSG_UNIT, UnitRelay::ToInvHash(hash)));
+  }
+  if(!request_list.empty()){
+    SendMessage(CNetMsgMaker(INIT_PROTO_VERSION).Make(NetMsgType::GETDATA, request_list), p_node);
+  }
+  return true;
+}
+
+bool ambr::syn::SynManager::Impl::OnGetData(const CNetMessage& netmsg, CNode* p_node){
+  std::vector<CInv> inv_list;
+  CDataStream(netmsg.vRecv) >> inv_list;
+  if(inv_list.size() > MAX_INV_SZ)return false;
+  for(const CInv& inv:inv_list){
+    if(inv.type != MSG_UNIT)continue;
+    std::shared_ptr<ambr::store::UnitStore> unit_store = p_storemanager_->GetUnit(UnitRelay::FromInvHash(inv.hash));
+    if(!unit_store)continue;
+    std::shared_ptr<ambr::core::Unit> unit = unit_store->GetUnit();
+    if(!unit)continue;
+    p_node->AddInventoryKnown(inv);
+    SendMessage(MakeUnitMessage(unit), p_node, GetUnitPriority(unit));
+  }
+  return true;
+}
+
+void ambr::syn::SynManager::Impl::OnOrphanUnit(const Ptr_Unit& p_unit, void* peer, const ambr::core::UnitHash& missing){
+  std::lock_guard<std::mutex> lk(orphan_mutex_);
+  orphan_fetch_.AddOrphan(peer, p_unit->hash(), missing);
+}
+
+void ambr::syn::SynManager::Impl::OnBufferHandled(const Ptr_Unit& p_unit, bool result){
+  std::lock_guard<std::mutex> lk(orphan_mutex_);
+  if(result){
+    orphan_fetch_.OnAdded(p_unit->hash());
+  }else{
+    orphan_fetch_.OnDropped(p_unit->hash());
+  }
+}
+
+void ambr::syn::SynManager::Impl::FetchOrphanAncestors(){
+  std::map<OrphanFetch::PeerId, std::vector<ambr::core::UnitHash>> request_map;
+  {
+    std::lock_guard<std::mutex> lk(orphan_mutex_);
+    request_map = orphan_fetch_.NextRequests();
+  }
+  if(request_map.empty())return;
+  std::lock_guard<std::mutex> lk(nodes_mutex_);
+  for(const auto& item:request_map){
+    //peer is only compared with connected nodes, it may be gone
+    CNode* p_node = nullptr;
+    for(CNode* node:list_in_nodes_){
+      if(node == item.first)p_node = node;
+    }
+    for(CNode* node:list_out_nodes_){
+      if(node == item.first)p_node = node;
+    }
+    if(!p_node){
+      std::lock_guard<std::mutex> orphan_lk(orphan_mutex_);
+      orphan_fetch_.RemovePeer(item.first);
+      continue;
+    }
+    std::vector<CInv> request_list;
+    for(const ambr::core::UnitHash& hash:item.second){
+      request_list.push_back(CInv(MSG_UNIT, UnitRelay::ToInvHash(hash)));
+    }
+    SendMessage(CNetMsgMaker(INIT_PROTO_VERSION).Make(NetMsgType::GETDATA, request_list), p_node);
+  }
+}
+
+void ambr::syn::SynManager::Impl::ApplyIngestedUnit(const Ptr_Unit& p_unit, UnitIngest::PeerId peer, bool valid){
+  CNode* p_node = (CNode*)peer;
+  unit_relay_.OnVerified(p_unit->hash(), valid);
+  if(valid){
+    p_node->AddInventoryKnown(CInv(MSG_UNIT, UnitRelay::ToInvHash(p_unit->hash())));
+    p_storemanager_->AddUnitToBuffer(p_unit, p_node);
+    FetchOrphanAncestors();
+  }
+  p_node->Release();
+}
+
+ambr::syn::UnitIngest::Stats ambr::syn::SynManager::Impl::GetIngestStats(){
+  return unit_ingest_->GetStats();
+}
+
 void ambr::syn::SynManager::Impl::ReceiveUnit(const Ptr_Unit& p_unit, CNode* p_node){
     /*if(p_unit){
       if(!p_unit->prev_unit().is_zero() && nullptr == p_storemanager_->GetUnit(p_unit->prev_unit())){
@@ -522,6 +926,7 @@ void ambr::syn::SynManager::Impl::ReturnUnit(const std::vector<uint8_t>& buf, CN
 
 void ambr::syn::SynManager::Impl::Shutdown(){
   exit_ = true;
+  unit_ingest_->Stop();
   ios_thread.join();
 }
 
@@ -544,23 +949,49 @@ void ambr::syn::SynManager::Impl::IosDenastySyn(const boost::system::error_code&
   //if(!ec)
   {
     LOG(INFO)<<"syn denasty check";
+    {
+      std::lock_guard<std::mutex> lk(orphan_mutex_);
+      orphan_fetch_.Expire();
+      if(orphan_fetch_.accepted_count()){
+        LOG(INFO)<<"orphan fetch:"<<orphan_fetch_.missing_count()<<" missing, "<<orphan_fetch_.in_flight_count()<<" in flight, "
+                 <<orphan_fetch_.requested_count()<<" requested, "<<orphan_fetch_.accepted_count()<<" accepted, latency "
+                 <<orphan_fetch_.AverageLatency()*1000<<"ms avg "
+                 <<std::chrono::duration_cast<std::chrono::milliseconds>(orphan_fetch_.last_latency()).count()<<"ms last";
+      }
+    }
+    //missing units timed out are requested from other peers
+    FetchOrphanAncestors();
+    UnitIngest::Stats ingest_stats = unit_ingest_->GetStats();
+    if(ingest_stats.verify_depth_ || ingest_stats.apply_depth_ || ingest_stats.paused_peer_count_){
+      LOG(INFO)<<"unit ingest:"<<ingest_stats.verify_depth_<<" verifying, "<<ingest_stats.apply_depth_<<" to apply, "
+               <<ingest_stats.paused_peer_count_<<" peers paused, "<<ingest_stats.applied_count_<<" applied, "
+               <<ingest_stats.invalid_count_<<" invalid, "<<ingest_stats.dropped_count_<<" dropped";
+    }
+    SendQueueStatsArray send_stats = ambr::p2p::GetSendQueueStats();
+    for(int i = 0; i < SEND_PRIORITY_COUNT; i++){
+      const CSendQueueStats& stats = send_stats[i];
+      if(stats.nQueuedBytes || stats.nDropped){
+        LOG(INFO)<<"send queue "<<GetSendPriorityName((SendPriority)i)<<":"<<stats.nQueuedBytes<<" bytes queued, "
+                 <<stats.nQueued<<" queued, "<<stats.nTaken<<" sent, "<<stats.nDropped<<" dropped, queue time "
+                 <<(stats.nTaken?stats.nQueueTimeTotal/stats.nTaken:0)<<"us avg "<<stats.nQueueTimeMax<<"us max";
+      }
+    }
     std::lock_guard<std::mutex> lk(nodes_mutex_);
-    uint64_t newest_dynasty_nonce = 0;
-    CNode* newest_node = nullptr;
+    //every node ahead of us serves part of the sync
+    uint64_t last_nonce = p_storemanager_->GetLastValidatedUnitNonce();
+    std::list<CNode*> sync_node_list;
     for(CNode* node: list_in_nodes_){
-      if(node->latest_nonce > newest_dynasty_nonce){
-        newest_dynasty_nonce = node->latest_nonce;
-        newest_node = node;
+      if(node->latest_nonce > last_nonce){
+        sync_node_list.push_back(node);
       }
     }
     for(CNode* node: list_out_nodes_){
-      if(node->latest_nonce > newest_dynasty_nonce){
-        newest_dynasty_nonce = node->latest_nonce;
-        newest_node = node;
+      if(node->latest_nonce > last_nonce){
+        sync_node_list.push_back(node);
       }
     }
-    if(newest_dynasty_nonce > p_storemanager_->GetLastValidatedUnitNonce()){
-      StartSyn(newest_node);
+    if(!sync_node_list.empty()){
+      StartSyn(sync_node_list);
     }
     dynasty_timer_.expires_from_now(boost::posix_time::milliseconds(dynasty_timer_value_));
     dynasty_timer_.async_wait(boost::bind(&ambr::syn::SynManager::Impl::IosDenastySyn, this, boost::asio::placeholders::error));
@@ -595,19 +1026,31 @@ void ambr::syn::SynManager::Impl::OnConnectNode(CNode* p_node){
     if(on_connect_node_func_){
       on_connect_node_func_(p_node);
     }
+    std::lock_guard<std::mutex> lk(nodes_mutex_);
     list_out_nodes_.remove(p_node);
     list_out_nodes_.push_back(p_node);
   }
 }
 
 void ambr::syn::SynManager::Impl::OnDisConnectNode(CNode* p_node){
-    if(p_node && on_disconnect_node_func_){
+    if(p_node){
+      //node is freed after this, forget it whether or not a hook is set
       {
         std::lock_guard<std::mutex> lk(nodes_mutex_);
         list_in_nodes_.remove(p_node);
         list_out_nodes_.remove(p_node);
       }
-      on_disconnect_node_func_(p_node);
+      {
+        std::lock_guard<std::mutex> lk(sync_mutex_);
+        DropSyncPeer(p_node->GetId(), false);
+      }
+      {
+        std::lock_guard<std::mutex> lk(orphan_mutex_);
+        orphan_fetch_.RemovePeer(p_node);
+      }
+      if(on_disconnect_node_func_){
+        on_disconnect_node_func_(p_node);
+      }
     }
     {
       std::lock_guard<std::mutex> lk(state_mutex_);
@@ -666,14 +1109,12 @@ void ambr::syn::SynManager::SetOnDisconnectNode(const std::function<void(CNode*)
 }
 
 void ambr::syn::SynManager::BoardCastNewUnit(std::shared_ptr<ambr::core::Unit> p_unit){
-  uint32_t type = (uint32_t)p_unit->type();
-  std::vector<uint8_t> unit_buf;
-  std::string buf_str;
-  unit_buf = p_unit->SerializeByte();
-  buf_str.resize(unit_buf.size()+sizeof(type));
-  memcpy((char*)buf_str.data(), &type, sizeof(type));
-  memcpy((char*)buf_str.data()+sizeof(type), unit_buf.data(), unit_buf.size());
-  ambr::p2p::BroadcastMessage(CNetMsgMaker(INIT_PROTO_VERSION).Make(NetMsgType::NEWUNIT, buf_str));
+  //peers fetch the body by GETDATA if they don't have it
+  p_impl_->RelayUnit(p_unit);
+}
+
+ambr::syn::UnitIngest::Stats ambr::syn::SynManager::GetIngestStats(){
+  return p_impl_->GetIngestStats();
 }
 
 bool ambr::syn::SynManager::GetNodeIfPauseSend(const std::string &node_addr){
@@ -8,6 +8,7 @@
 #include "net_processing.h"
 #include "netmessagemaker.h"
 #include "store/store_manager.h"
+#include "unit_ingest.h"
 
 #include <time.h>
 #include <atomic>
@@ -53,6 +54,8 @@ struct SynManagerConfig{
   bool use_natp_;
   bool use_nat_pmp_;
   std::vector<std::string> vec_seed_;
+  std::string socket_events_;//"select" or "epoll", select if empty
+  uint32_t msg_handler_threads_ = 0;//threads processing peer messages, DEFAULT_MESSAGE_HANDLER_THREADS if 0
 };
 
 
@@ -76,6 +79,8 @@ public:
   bool GetNodeIfPauseSend(const std::string& node_addr);
   bool GetNodeIfPauseReceive(const std::string& node_addr);
   uint64_t GetNodeNonce(const std::string& node_addr);
+  //queue depth and counters of received units pipeline
+  UnitIngest::Stats GetIngestStats();
 public:
   class Impl;
 private:
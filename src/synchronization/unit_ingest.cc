@@ -0,0 +1,182 @@
+/**********************************************************************
+ * Copyright (c) 2018 Ambr project
+ * Distributed under the MIT software license, see the accompanying   *
+ * file COPYING or http://www.opensource.org/licenses/mit-license.php.*
+ **********************************************************************/
+#include "unit_ingest.h"
+
+ambr::syn::UnitIngest::UnitIngest(const ApplyFunc& apply_func, const PauseFunc& pause_func,
+                                  size_t verify_threads, size_t max_depth, size_t max_depth_per_peer)
+  :apply_func_(apply_func), pause_func_(pause_func),
+   max_depth_(max_depth?max_depth:1), max_depth_per_peer_(max_depth_per_peer?max_depth_per_peer:1),
+   verify_pool_(verify_threads?verify_threads:1){
+  apply_thread_ = std::thread(&ambr::syn::UnitIngest::ApplyThread, this);
+}
+
+ambr::syn::UnitIngest::~UnitIngest(){
+  Stop();
+}
+
+bool ambr::syn::UnitIngest::Push(const std::shared_ptr<ambr::core::Unit> &unit, PeerId peer){
+  uint64_t seq;
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    if(stop_){
+      return false;
+    }
+    size_t& peer_depth = peer_depth_map_[peer];
+    if(peer_depth >= max_depth_per_peer_){
+      stats_.dropped_count_++;
+      return false;
+    }
+    seq = next_seq_++;
+    Item& item = item_map_[seq];
+    item.unit_ = unit;
+    item.peer_ = peer;
+    stats_.verify_depth_++;
+    if(++peer_depth >= max_depth_per_peer_){
+      PausePeer(peer);
+    }
+    //not only the sender, other peers would push over total bound too
+    if(item_map_.size() >= max_depth_ && paused_set_.size() < peer_depth_map_.size()){
+      for(const std::pair<const PeerId, size_t>& depth_item:peer_depth_map_){
+        PausePeer(depth_item.first);
+      }
+    }
+  }
+  verify_pool_.schedule(std::bind(&ambr::syn::UnitIngest::Verify, this, seq));
+  return true;
+}
+
+void ambr::syn::UnitIngest::WaitIdle(){
+  std::unique_lock<std::mutex> lk(mutex_);
+  cond_.wait(lk, [this](){return stop_ || (item_map_.empty() && !applying_);});
+}
+
+void ambr::syn::UnitIngest::Stop(){
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    stop_ = true;
+  }
+  cond_.notify_all();
+  if(apply_thread_.joinable()){
+    apply_thread_.join();
+  }
+  verify_pool_.wait();
+}
+
+void ambr::syn::UnitIngest::PausePeer(PeerId peer){
+  if(paused_set_.insert(peer).second){
+    stats_.paused_peer_count_++;
+    if(pause_func_){
+      pause_func_(peer, true);
+    }
+  }
+}
+
+void ambr::syn::UnitIngest::ResumePeer(std::set<PeerId>::iterator pause_iter){
+  PeerId peer = *pause_iter;
+  paused_set_.erase(pause_iter);
+  stats_.paused_peer_count_--;
+  if(pause_func_){
+    pause_func_(peer, false);
+  }
+}
+
+ambr::syn::UnitIngest::Stats ambr::syn::UnitIngest::GetStats(){
+  std::lock_guard<std::mutex> lk(mutex_);
+  return stats_;
+}
+
+size_t ambr::syn::UnitIngest::depth(PeerId peer){
+  std::lock_guard<std::mutex> lk(mutex_);
+  auto iter = peer_depth_map_.find(peer);
+  return iter == peer_depth_map_.end()?0:iter->second;
+}
+
+void ambr::syn::UnitIngest::Verify(uint64_t seq){
+  std::shared_ptr<core::Unit> unit;
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    auto iter = item_map_.find(seq);
+    if(iter == item_map_.end()){
+      return;
+    }
+    unit = iter->second.unit_;
+  }
+  //stateless, verified signature is cached so store doesn't verify it again
+  bool valid = unit->Validate(nullptr);
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    auto iter = item_map_.find(seq);
+    if(iter == item_map_.end()){
+      return;
+    }
+    iter->second.verified_ = true;
+    iter->second.valid_ = valid;
+    stats_.verify_depth_--;
+    stats_.apply_depth_++;
+  }
+  cond_.notify_all();
+}
+
+void ambr::syn::UnitIngest::ApplyThread(){
+  std::unique_lock<std::mutex> lk(mutex_);
+  while(true){
+    cond_.wait(lk, [this](){return stop_ || (!item_map_.empty() && item_map_.begin()->second.verified_);});
+    if(stop_){
+      break;
+    }
+    Item item = item_map_.begin()->second;
+    item_map_.erase(item_map_.begin());
+    stats_.apply_depth_--;
+    auto depth_iter = peer_depth_map_.find(item.peer_);
+    size_t peer_depth = --depth_iter->second;
+    if(!peer_depth){
+      peer_depth_map_.erase(depth_iter);
+    }
+    if(item_map_.size() <= max_depth_/2){
+      //peers paused by total bound are resumed together
+      for(auto pause_iter = paused_set_.begin(); pause_iter != paused_set_.end();){
+        auto paused_depth_iter = peer_depth_map_.find(*pause_iter);
+        if(paused_depth_iter == peer_depth_map_.end() || paused_depth_iter->second <= max_depth_per_peer_/2){
+          ResumePeer(pause_iter++);
+        }else{
+          pause_iter++;
+        }
+      }
+    }else if(!peer_depth){
+      auto pause_iter = paused_set_.find(item.peer_);
+      if(pause_iter != paused_set_.end()){
+        ResumePeer(pause_iter);
+      }
+    }
+    applying_ = true;
+    lk.unlock();
+    if(apply_func_){
+      apply_func_(item.unit_, item.peer_, item.valid_);
+    }
+    lk.lock();
+    applying_ = false;
+    if(item.valid_){
+      stats_.applied_count_++;
+    }else{
+      stats_.invalid_count_++;
+    }
+    cond_.notify_all();
+  }
+  //units not applied are passed as invalid, so owner can release their peers
+  std::map<uint64_t, Item> item_map;
+  item_map.swap(item_map_);
+  peer_depth_map_.clear();
+  paused_set_.clear();
+  stats_.verify_depth_ = 0;
+  stats_.apply_depth_ = 0;
+  stats_.paused_peer_count_ = 0;
+  lk.unlock();
+  for(auto& item:item_map){
+    if(apply_func_){
+      apply_func_(item.second.unit_, item.second.peer_, false);
+    }
+  }
+}
@@ -0,0 +1,91 @@
+/**********************************************************************
+ * Copyright (c) 2018 Ambr project
+ * Distributed under the MIT software license, see the accompanying   *
+ * file COPYING or http://www.opensource.org/licenses/mit-license.php.*
+ **********************************************************************/
+#ifndef AMBR_SYN_UNIT_INGEST_H_
+#define AMBR_SYN_UNIT_INGEST_H_
+#include <stdint.h>
+#include <map>
+#include <set>
+#include <mutex>
+#include <thread>
+#include <memory>
+#include <functional>
+#include <condition_variable>
+#include <boost/threadpool.hpp>
+#include <core/unit.h>
+namespace ambr {
+namespace syn {
+
+//pipeline of units received from peers, out of network thread:
+//units decoded by network thread are verified(hash and signature) in parallel on a pool,
+//then applied one by one in order of arrival on the apply thread.
+//units waiting in pipeline are bounded per peer, unit over it's peer's bound is dropped.
+//peer is paused when it reaches it's bound, and every peer with units in pipeline is paused when total bound is reached.
+//total bound isn't a hard one, so units of peers still unpaused(or sent before pause) are not dropped.
+//peer is resumed when it's units are under half of bound and total is under half, or all of it's units are applied.
+//so a peer is only paused while it has units in pipeline.
+//thread safe.
+class UnitIngest{
+public:
+  typedef void* PeerId;
+  //called on apply thread in order of Push, valid is false if verify failed
+  typedef std::function<void(const std::shared_ptr<core::Unit>& unit, PeerId peer, bool valid)> ApplyFunc;
+  //pause is true when peer reached it's bound, false when it may send again.
+  //called with lock held so pause and resume of a peer are in order, it must not call UnitIngest
+  typedef std::function<void(PeerId peer, bool pause)> PauseFunc;
+  struct Stats{
+    size_t verify_depth_ = 0;//units waiting for or under verify
+    size_t apply_depth_ = 0;//units verified, waiting for apply in order
+    size_t paused_peer_count_ = 0;
+    uint64_t applied_count_ = 0;
+    uint64_t invalid_count_ = 0;
+    uint64_t dropped_count_ = 0;//pushed when peer's units were at it's bound
+  };
+  UnitIngest(const ApplyFunc& apply_func, const PauseFunc& pause_func,
+             size_t verify_threads = 4, size_t max_depth = 4096, size_t max_depth_per_peer = 512);
+  ~UnitIngest();
+public:
+  //false if peer's units are at it's bound and unit is dropped,
+  //pause of peers is called before return if peer reached it's bound or total bound is reached
+  bool Push(const std::shared_ptr<core::Unit>& unit, PeerId peer);
+  //wait until all units pushed are applied
+  void WaitIdle();
+  //units not applied yet are passed to apply func as invalid
+  void Stop();
+  Stats GetStats();
+  size_t depth(PeerId peer);
+private:
+  struct Item{
+    std::shared_ptr<core::Unit> unit_;
+    PeerId peer_;
+    bool verified_ = false;
+    bool valid_ = false;
+  };
+  void Verify(uint64_t seq);
+  void ApplyThread();
+  //with lock held
+  void PausePeer(PeerId peer);
+  void ResumePeer(std::set<PeerId>::iterator pause_iter);
+private:
+  ApplyFunc apply_func_;
+  PauseFunc pause_func_;
+  size_t max_depth_;
+  size_t max_depth_per_peer_;
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  bool stop_ = false;
+  bool applying_ = false;
+  uint64_t next_seq_ = 0;
+  std::map<uint64_t, Item> item_map_;//seq->item, begin is the next to apply
+  std::map<PeerId, size_t> peer_depth_map_;
+  std::set<PeerId> paused_set_;
+  Stats stats_;
+  boost::threadpool::pool verify_pool_;
+  std::thread apply_thread_;
+};
+
+}
+}
+#endif
@@ -0,0 +1,71 @@
+/**********************************************************************
+ * Copyright (c) 2018 Ambr project
+ * Distributed under the MIT software license, see the accompanying   *
+ * file COPYING or http://www.opensource.org/licenses/mit-license.php.*
+ **********************************************************************/
+#include "unit_relay.h"
+
+ambr::syn::UnitRelay::UnitRelay(uint32_t known_count, Clock::duration request_timeout)
+  :known_filter_(known_count, 0.000001), request_timeout_(request_timeout){
+}
+
+void ambr::syn::UnitRelay::AddKnown(const ambr::core::UnitHash &hash){
+  std::lock_guard<std::mutex> lk(mutex_);
+  known_filter_.insert(ToInvHash(hash));
+  requested_map_.erase(hash);
+}
+
+bool ambr::syn::UnitRelay::IsKnown(const ambr::core::UnitHash &hash){
+  std::lock_guard<std::mutex> lk(mutex_);
+  return known_filter_.contains(ToInvHash(hash));
+}
+
+std::vector<ambr::core::UnitHash> ambr::syn::UnitRelay::FilterRequest(const std::vector<ambr::core::UnitHash> &hash_list, Clock::time_point now){
+  std::vector<core::UnitHash> rtn;
+  std::lock_guard<std::mutex> lk(mutex_);
+  //forget timed out requests
+  for(auto iter = requested_map_.begin(); iter != requested_map_.end();){
+    if(now-iter->second >= request_timeout_){
+      iter = requested_map_.erase(iter);
+    }else{
+      iter++;
+    }
+  }
+  for(const core::UnitHash& hash:hash_list){
+    if(known_filter_.contains(ToInvHash(hash)))continue;
+    if(!requested_map_.insert(std::make_pair(hash, now)).second)continue;
+    rtn.push_back(hash);
+  }
+  return rtn;
+}
+
+bool ambr::syn::UnitRelay::OnReceived(const ambr::core::UnitHash &hash){
+  ::uint256 inv_hash = ToInvHash(hash);
+  std::lock_guard<std::mutex> lk(mutex_);
+  requested_map_.erase(hash);
+  if(known_filter_.contains(inv_hash))return false;
+  return verifying_set_.insert(hash).second;
+}
+
+void ambr::syn::UnitRelay::OnVerified(const ambr::core::UnitHash &hash, bool valid){
+  std::lock_guard<std::mutex> lk(mutex_);
+  verifying_set_.erase(hash);
+  if(valid){
+    known_filter_.insert(ToInvHash(hash));
+  }
+}
+
+size_t ambr::syn::UnitRelay::requested_count(){
+  std::lock_guard<std::mutex> lk(mutex_);
+  return requested_map_.size();
+}
+
+::uint256 ambr::syn::UnitRelay::ToInvHash(const ambr::core::UnitHash &hash){
+  return ::uint256(std::vector<unsigned char>(hash.bytes().begin(), hash.bytes().end()));
+}
+
+ambr::core::UnitHash ambr::syn::UnitRelay::FromInvHash(const ::uint256 &hash){
+  core::UnitHash rtn;
+  rtn.set_bytes(hash.begin(), hash.size());
+  return rtn;
+}
@@ -0,0 +1,54 @@
+/**********************************************************************
+ * Copyright (c) 2018 Ambr project
+ * Distributed under the MIT software license, see the accompanying   *
+ * file COPYING or http://www.opensource.org/licenses/mit-license.php.*
+ **********************************************************************/
+#ifndef AMBR_SYN_UNIT_RELAY_H_
+#define AMBR_SYN_UNIT_RELAY_H_
+#include <stdint.h>
+#include <map>
+#include <set>
+#include <mutex>
+#include <vector>
+#include <chrono>
+#include <core/unit.h>
+#include <p2p/uint256.h>
+#include <p2p/bloom.h>
+namespace ambr {
+namespace syn {
+
+//node wide state of unit relay by inventory:new units are announced by hash(INV of MSG_UNIT),
+//and peers fetch units they don't know by GETDATA.
+//hash of unit stored or received and verified is known, announcement of it is dropped before the body is fetched.
+//unit requested from a peer isn't requested again until timeout, then another announcement may request it.
+//unit received is only deduplicated while it's verified, a forged one with the same hash doesn't hide the real one.
+//thread safe.
+class UnitRelay{
+public:
+  typedef std::chrono::steady_clock Clock;
+  //known hashes are kept in rolling bloom filter of about known_count elements
+  UnitRelay(uint32_t known_count = 120000, Clock::duration request_timeout = std::chrono::seconds(10));
+public:
+  void AddKnown(const core::UnitHash& hash);
+  bool IsKnown(const core::UnitHash& hash);
+  //hashes of announcement to request, not known and not in flight, they are in flight from now
+  std::vector<core::UnitHash> FilterRequest(const std::vector<core::UnitHash>& hash_list, Clock::time_point now = Clock::now());
+  //unit received, it's verified from now. false if it's known or being verified already
+  bool OnReceived(const core::UnitHash& hash);
+  //unit received is verified, it's known from now if valid, or it may be received again
+  void OnVerified(const core::UnitHash& hash, bool valid);
+  size_t requested_count();
+public:
+  static ::uint256 ToInvHash(const core::UnitHash& hash);
+  static core::UnitHash FromInvHash(const ::uint256& hash);
+private:
+  std::mutex mutex_;
+  CRollingBloomFilter known_filter_;
+  Clock::duration request_timeout_;
+  std::map<core::UnitHash, Clock::time_point> requested_map_;//hash->time of request
+  std::set<core::UnitHash> verifying_set_;//received, not verified yet
+};
+
+}
+}
+#endif
@@ -2,6 +2,7 @@
 #include <crypto/sha256.h>
 #include <crypto/base64.h>
 #include <crypto/base58.h>
+#include <p2p/crypto/sha256.h>
 #include <gtest/gtest.h>
 
 TEST(SHA256Test, HandleTrueReturn)
@@ -19,6 +20,36 @@ TEST(SHA256Test, HandleTrueReturn)
     EXPECT_TRUE(hex_str.size() == 64);
 }
 
+TEST(SHA256Test, Multi)
+{
+    ambr::p2p::SHA256AutoDetect();
+    //lengths around the padding boundary, counts leave 8, 4 and 1 way remainders
+    for(size_t len:{0, 55, 56, 64, 117, 300}){
+        std::vector<std::vector<uint8_t>> msg_list;
+        std::vector<const unsigned char*> input_list;
+        for(size_t i = 0; i < 13; i++){
+            std::vector<uint8_t> msg(len);
+            for(size_t j = 0; j < len; j++){
+                msg[j] = (uint8_t)(i*31+j*7);
+            }
+            msg_list.push_back(msg);
+        }
+        for(const std::vector<uint8_t>& msg:msg_list){
+            input_list.push_back(msg.data());
+        }
+        std::vector<uint8_t> output(input_list.size()*32);
+        ambr::p2p::SHA256Multi(output.data(), input_list.data(), len, input_list.size());
+        for(size_t i = 0; i < msg_list.size(); i++){
+            ambr::crypto::SHA256OneByOneHasher hasher;
+            hasher.process(msg_list[i].begin(), msg_list[i].end());
+            hasher.finish();
+            uint8_t hash[32];
+            hasher.get_hash_bytes(hash, hash+32);
+            EXPECT_TRUE(std::equal(hash, hash+32, output.begin()+i*32));
+        }
+    }
+}
+
 TEST(BASE64Test, HandleTrueReturn)
 {
     std::string input = "base64 string";
@@ -29,4 +29,77 @@ return;
   bool ret2 = ambr::core::SymEncrypting(pri, "sagsgsgs", test);
   std::cout << "Sym encryption: "  << test.encode_to_hex() <<std::endl <<std::endl;
   EXPECT_TRUE(ret);
-}
\ No newline at end of file
+}
+TEST (KeyTest, SignBatch) {
+  //more than one ed25519 batch(64), with a wrong signature in the first batch
+  const size_t count = 100;
+  std::vector<ambr::core::UnitHash> msg_list;
+  std::vector<const uint8_t*> buf_list;
+  std::vector<size_t> length_list;
+  std::vector<ambr::core::PublicKey> pub_key_list;
+  std::vector<ambr::core::Signature> sign_list;
+  for(size_t i = 0; i < count; i++){
+    msg_list.push_back(ambr::core::CreateRandomPrivateKey());
+  }
+  for(size_t i = 0; i < count; i++){
+    ambr::core::PrivateKey pri = ambr::core::CreateRandomPrivateKey();
+    buf_list.push_back(msg_list[i].bytes().data());
+    length_list.push_back(msg_list[i].bytes().size());
+    pub_key_list.push_back(ambr::core::GetPublicKeyByPrivateKey(pri));
+    sign_list.push_back(ambr::core::GetSignByPrivateKey(buf_list[i], length_list[i], pri));
+  }
+  std::vector<bool> valid_list;
+  EXPECT_TRUE(ambr::core::SignIsValidateBatch(buf_list, length_list, pub_key_list, sign_list, &valid_list));
+  ASSERT_EQ(valid_list.size(), count);
+  for(size_t i = 0; i < count; i++){
+    EXPECT_TRUE(valid_list[i]);
+  }
+
+  std::swap(sign_list[10], sign_list[11]);
+  EXPECT_FALSE(ambr::core::SignIsValidateBatch(buf_list, length_list, pub_key_list, sign_list, &valid_list));
+  for(size_t i = 0; i < count; i++){
+    EXPECT_EQ(valid_list[i], i != 10 && i != 11);
+  }
+}
+TEST (KeyTest, SignMalleated) {
+  //S+L and S+2L verify as S in ed25519 batch, they must be refused by single and batch alike
+  const uint8_t group_order[32] = {
+    0xed, 0xd3, 0xf5, 0x5c, 0x1a, 0x63, 0x12, 0x58, 0xd6, 0x9c, 0xf7, 0xa2, 0xde, 0xf9, 0xde, 0x14,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10};
+  const size_t count = 8;
+  std::vector<ambr::core::UnitHash> msg_list;
+  std::vector<const uint8_t*> buf_list;
+  std::vector<size_t> length_list;
+  std::vector<ambr::core::PublicKey> pub_key_list;
+  std::vector<ambr::core::Signature> sign_list;
+  for(size_t i = 0; i < count; i++){
+    msg_list.push_back(ambr::core::CreateRandomPrivateKey());
+  }
+  for(size_t i = 0; i < count; i++){
+    ambr::core::PrivateKey pri = ambr::core::CreateRandomPrivateKey();
+    buf_list.push_back(msg_list[i].bytes().data());
+    length_list.push_back(msg_list[i].bytes().size());
+    pub_key_list.push_back(ambr::core::GetPublicKeyByPrivateKey(pri));
+    sign_list.push_back(ambr::core::GetSignByPrivateKey(buf_list[i], length_list[i], pri));
+  }
+  for(size_t times = 1; times <= 2; times++){
+    std::array<uint8_t, 64> bytes = sign_list[3].bytes();
+    for(size_t n = 0; n < times; n++){
+      unsigned int carry = 0;
+      for(size_t i = 0; i < 32; i++){
+        carry += bytes[32+i] + group_order[i];
+        bytes[32+i] = (uint8_t)carry;
+        carry >>= 8;
+      }
+    }
+    std::vector<ambr::core::Signature> malleated_list(sign_list);
+    malleated_list[3].set_bytes(bytes);
+    EXPECT_FALSE(ambr::core::SignIsValidate(buf_list[3], length_list[3], pub_key_list[3], malleated_list[3]));
+    std::vector<bool> valid_list;
+    EXPECT_FALSE(ambr::core::SignIsValidateBatch(buf_list, length_list, pub_key_list, malleated_list, &valid_list));
+    ASSERT_EQ(valid_list.size(), count);
+    for(size_t i = 0; i < count; i++){
+      EXPECT_EQ(valid_list[i], i != 3);
+    }
+  }
+}
@@ -0,0 +1,175 @@
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <netinet/tcp.h>
+
+#include <p2p/socketevents.h>
+#include <p2p/netbase.h>
+
+namespace{
+const int peer_count = 400;//server and client sockets stay under FD_SETSIZE for select
+const int message_size = 64;
+const int message_count = 20000;
+
+struct Peer{
+  SOCKET server_ = INVALID_SOCKET;//watched by the loop
+  SOCKET client_ = INVALID_SOCKET;//written by the sender
+  char buf_[message_size];
+  int len_ = 0;
+};
+
+struct Result{
+  size_t received_ = 0;
+  double cpu_us_per_msg_ = 0;
+  int64_t p50_us_ = 0;
+  int64_t p99_us_ = 0;
+  int64_t p999_us_ = 0;
+};
+
+int64_t NowNs(){
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int64_t ThreadCpuUs(){
+  struct rusage usage;
+  getrusage(RUSAGE_THREAD, &usage);
+  return (usage.ru_utime.tv_sec+usage.ru_stime.tv_sec)*1000000ll+usage.ru_utime.tv_usec+usage.ru_stime.tv_usec;
+}
+
+//loopback tcp connections, server side is non blocking like sockets of CConnman
+bool CreatePeers(std::vector<Peer>& peers){
+  SOCKET listen_socket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = 0;
+  socklen_t addr_len = sizeof(addr);
+  if(bind(listen_socket, (struct sockaddr*)&addr, sizeof(addr)) ||
+     listen(listen_socket, peer_count) ||
+     getsockname(listen_socket, (struct sockaddr*)&addr, &addr_len)){
+    CloseSocket(listen_socket);
+    return false;
+  }
+  int one = 1;
+  for(Peer& peer:peers){
+    peer.client_ = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if(peer.client_ == INVALID_SOCKET || connect(peer.client_, (struct sockaddr*)&addr, sizeof(addr))){
+      break;
+    }
+    setsockopt(peer.client_, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    peer.server_ = accept(listen_socket, nullptr, nullptr);
+    if(peer.server_ == INVALID_SOCKET){
+      break;
+    }
+    fcntl(peer.server_, F_SETFL, fcntl(peer.server_, F_GETFL, 0) | O_NONBLOCK);
+  }
+  CloseSocket(listen_socket);
+  return std::all_of(peers.begin(), peers.end(), [](const Peer& peer){return peer.server_ != INVALID_SOCKET;});
+}
+
+void ClosePeers(std::vector<Peer>& peers){
+  for(Peer& peer:peers){
+    if(peer.server_ != INVALID_SOCKET)CloseSocket(peer.server_);
+    if(peer.client_ != INVALID_SOCKET)CloseSocket(peer.client_);
+  }
+}
+
+//sender writes timestamped messages to random peers at a steady rate,
+//loop waits like ThreadSocketHandler:select is given all sockets on each pass, epoll only returns ready ones
+Result RunLoop(SocketEventsMode mode, std::vector<Peer>& peers){
+  Result rtn;
+  CSocketEvents events(mode);
+  EXPECT_TRUE(events.Init());
+  EXPECT_EQ(events.GetMode(), mode);
+  for(Peer& peer:peers){
+    EXPECT_TRUE(events.Add(peer.server_, &peer));
+    peer.len_ = 0;
+  }
+
+  std::thread sender([&peers](){
+    char message[message_size] = {0};
+    uint32_t seed = 1;
+    for(int i = 0; i < message_count; i++){
+      seed = seed*1103515245+12345;
+      Peer& peer = peers[(seed>>8)%peers.size()];
+      int64_t now = NowNs();
+      memcpy(message, &now, sizeof(now));
+      send(peer.client_, message, message_size, MSG_NOSIGNAL);
+      std::this_thread::sleep_for(std::chrono::microseconds(20));
+    }
+  });
+
+  std::vector<int64_t> latency_list;
+  latency_list.reserve(message_count);
+  int64_t start_cpu = ThreadCpuUs();
+  int64_t deadline = NowNs()+30*1000000000ll;
+  CSocketEvents::SocketList select_list;
+  std::vector<void*> ready_list;
+  char buf[4096];
+  while(latency_list.size() < (size_t)message_count && NowNs() < deadline){
+    select_list.clear();
+    if(mode == SOCKETEVENTS_SELECT){
+      for(Peer& peer:peers){
+        select_list.emplace_back(peer.server_, &peer);
+      }
+    }
+    EXPECT_TRUE(events.Wait(select_list, 50, ready_list));
+    for(void* ptr:ready_list){
+      Peer* peer = static_cast<Peer*>(ptr);
+      //read until it would block, as edge triggered socket requires
+      while(true){
+        ssize_t bytes = recv(peer->server_, buf, sizeof(buf), MSG_DONTWAIT);
+        if(bytes <= 0){
+          break;
+        }
+        int64_t now = NowNs();
+        for(ssize_t pos = 0; pos < bytes;){
+          int copy = std::min<int>(message_size-peer->len_, bytes-pos);
+          memcpy(peer->buf_+peer->len_, buf+pos, copy);
+          peer->len_ += copy;
+          pos += copy;
+          if(peer->len_ == message_size){
+            int64_t send_time;
+            memcpy(&send_time, peer->buf_, sizeof(send_time));
+            latency_list.push_back(now-send_time);
+            peer->len_ = 0;
+          }
+        }
+      }
+    }
+  }
+  int64_t use_cpu = ThreadCpuUs()-start_cpu;
+  sender.join();
+
+  rtn.received_ = latency_list.size();
+  if(!latency_list.empty()){
+    std::sort(latency_list.begin(), latency_list.end());
+    rtn.cpu_us_per_msg_ = (double)use_cpu/latency_list.size();
+    rtn.p50_us_ = latency_list[latency_list.size()*50/100]/1000;
+    rtn.p99_us_ = latency_list[latency_list.size()*99/100]/1000;
+    rtn.p999_us_ = latency_list[latency_list.size()*999/1000]/1000;
+  }
+  return rtn;
+}
+}
+
+TEST (NetBench, SocketEventsLoopback) {
+  for(SocketEventsMode mode:{SOCKETEVENTS_SELECT, SOCKETEVENTS_EPOLL}){
+    std::vector<Peer> peers(peer_count);
+    ASSERT_TRUE(CreatePeers(peers));
+    Result result = RunLoop(mode, peers);
+    ClosePeers(peers);
+    EXPECT_EQ(result.received_, (size_t)message_count);
+    std::cout<<GetSocketEventsModeName(mode)<<", "<<peer_count<<" peers, "<<result.received_<<" messages"
+             <<", cpu us/msg:"<<result.cpu_us_per_msg_
+             <<", latency us p50:"<<result.p50_us_<<" p99:"<<result.p99_us_<<" p99.9:"<<result.p999_us_<<std::endl;
+  }
+}
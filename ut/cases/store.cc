@@ -1,11 +1,61 @@
 
 #include <iostream>
+#include <algorithm>
 #include <core/node.h>
 #include <gtest/gtest.h>
 #include <glog/logging.h>
 
 #include "store/store_manager.h"
+#include "store/db.h"
 #include <boost/thread.hpp>
+namespace{
+//create count signed pairs of send unit of send_pri and receive unit of receive_pri offline, receive account should not exist
+//prev hashes and receive balance after the last pair are returned
+std::vector<std::shared_ptr<ambr::core::Unit>> CreateSendReceivePairs(
+    std::shared_ptr<ambr::store::StoreManager> manager,
+    const ambr::core::PrivateKey& send_pri,
+    const ambr::core::PrivateKey& receive_pri,
+    size_t count,
+    ambr::core::UnitHash* send_prev,
+    ambr::core::UnitHash* receive_prev,
+    ambr::core::Amount* receive_balance){
+  std::vector<std::shared_ptr<ambr::core::Unit>> rtn;
+  ambr::core::PublicKey send_pub = ambr::core::GetPublicKeyByPrivateKey(send_pri);
+  ambr::core::PublicKey receive_pub = ambr::core::GetPublicKeyByPrivateKey(receive_pri);
+  ambr::core::Amount send_balance;
+  EXPECT_TRUE(manager->GetLastUnitHashByPubKey(send_pub, *send_prev));
+  EXPECT_TRUE(manager->GetBalanceByPubKey(send_pub, send_balance));
+  for(size_t i = 0; i < count; i++){
+    std::shared_ptr<ambr::core::SendUnit> send_unit = std::make_shared<ambr::core::SendUnit>();
+    send_unit->set_version(0x00000001);
+    send_unit->set_type(ambr::core::UnitType::send);
+    send_unit->set_public_key(send_pub);
+    send_unit->set_prev_unit(*send_prev);
+    send_unit->set_dest(receive_pub);
+    send_balance.set_data(send_balance.data()-10000*manager->GetTransectionFeeBase());
+    send_unit->set_balance(send_balance);
+    send_unit->CalcHashAndFill();
+    send_unit->SignatureAndFill(send_pri);
+    *send_prev = send_unit->hash();
+    rtn.push_back(send_unit);
+
+    std::shared_ptr<ambr::core::ReceiveUnit> receive_unit = std::make_shared<ambr::core::ReceiveUnit>();
+    receive_unit->set_version(0x00000001);
+    receive_unit->set_type(ambr::core::UnitType::receive);
+    receive_unit->set_public_key(receive_pub);
+    receive_unit->set_prev_unit(*receive_prev);
+    receive_balance->set_data(receive_balance->data()+10000*manager->GetTransectionFeeBase()-manager->GetTransectionFeeCountWhenReceive(send_unit));
+    receive_unit->set_balance(*receive_balance);
+    receive_unit->set_from(send_unit->hash());
+    receive_unit->CalcHashAndFill();
+    receive_unit->SignatureAndFill(receive_pri);
+    *receive_prev = receive_unit->hash();
+    rtn.push_back(receive_unit);
+  }
+  return rtn;
+}
+}
+
 TEST (UnitTest, Store) {
   std::string root_pri_key = "25E25210DCE702D4E36B6C8A17E18DC1D02A9E4F0D1D31C4AEE77327CF1641CC";
   ambr::store::StoreManager* manager = new ambr::store::StoreManager();
@@ -23,6 +73,7 @@ TEST (UnitTest, Store) {
   ambr::core::Amount balance_used;
   ambr::core::Amount balance_remainder;
 
+  ambr::core::UnitHash send2_hash;
   size_t used_byte = 0;
   //===last_unit_hash===========================
   //test send 1----->SendToAddress
@@ -69,6 +120,7 @@ TEST (UnitTest, Store) {
     send_unit->CalcHashAndFill();
     send_unit->SignatureAndFill(root_pri_key);
     EXPECT_TRUE(manager->AddSendUnit(send_unit, nullptr));
+    send2_hash = send_unit->hash();
 
     //incorrect operate
     send_unit->set_version((uint32_t)0x00000002);
@@ -121,6 +173,25 @@ TEST (UnitTest, Store) {
     std::list<ambr::core::UnitHash> wait_list = manager->GetWaitForReceiveList(test_pub);
 
     EXPECT_TRUE(wait_list.size() == 14);
+    {//paged read with amount
+      std::list<ambr::core::UnitHash> paged_list;
+      ambr::core::UnitHash start_after;
+      for(;;){
+        std::list<std::pair<ambr::core::UnitHash, ambr::core::Amount>> page = manager->GetWaitForReceiveListWithAmount(test_pub, start_after, 5);
+        for(const std::pair<ambr::core::UnitHash, ambr::core::Amount>& item:page){
+          ambr::core::Amount amount;
+          EXPECT_TRUE(manager->GetSendAmount(item.first, amount, nullptr));
+          EXPECT_EQ(amount, item.second);
+          paged_list.push_back(item.first);
+        }
+        if(page.size() < 5)break;
+        start_after = page.back().first;
+      }
+      EXPECT_EQ(paged_list, wait_list);
+    }
+    //list is ordered by hash, leave send 2 for receive2
+    wait_list.remove(send2_hash);
+    EXPECT_TRUE(wait_list.size() == 13);
     for(size_t i = 0; i < 13; i++){
       {//incorrect operate
         EXPECT_FALSE(manager->ReceiveFromUnitHash("12345", test_pri, &test_hash, added_unit, &err));
@@ -198,3 +269,409 @@ TEST (UnitTest, Store) {
   }
 
 }
+
+TEST (UnitTest, StoreUnitTypeIndex) {
+  std::string root_pri_key = "25E25210DCE702D4E36B6C8A17E18DC1D02A9E4F0D1D31C4AEE77327CF1641CC";
+  ambr::core::PrivateKey test_pri = ambr::core::CreateRandomPrivateKey();
+  ambr::core::PublicKey test_pub = ambr::core::GetPublicKeyByPrivateKey(test_pri);
+  std::string err;
+  ambr::core::UnitHash send_hash, receive_hash, validator_hash;
+  std::shared_ptr<ambr::core::Unit> added_unit;
+
+  system("rm -fr ./unit_type_index");
+  {
+    std::shared_ptr<ambr::store::StoreManager> manager = std::make_shared<ambr::store::StoreManager>();
+    manager->Init("./unit_type_index");
+    EXPECT_TRUE(manager->SendToAddress(test_pub, 1000*manager->GetTransectionFeeBase(), root_pri_key, &send_hash, added_unit, &err));
+    EXPECT_TRUE(manager->ReceiveFromUnitHash(send_hash, test_pri, &receive_hash, added_unit, &err));
+    EXPECT_TRUE(manager->GetLastValidateUnit(validator_hash));
+  }
+  //reopen, index must be kept
+  std::shared_ptr<ambr::store::StoreManager> manager = std::make_shared<ambr::store::StoreManager>();
+  manager->Init("./unit_type_index");
+  std::shared_ptr<ambr::store::UnitStore> store;
+  ASSERT_TRUE(store = manager->GetUnit(send_hash));
+  EXPECT_EQ(store->type(), ambr::store::UnitStore::ST_SendUnit);
+  EXPECT_EQ(store->GetUnit()->hash(), send_hash);
+  ASSERT_TRUE(store = manager->GetUnit(receive_hash));
+  EXPECT_EQ(store->type(), ambr::store::UnitStore::ST_ReceiveUnit);
+  EXPECT_FALSE(manager->GetSendUnit(receive_hash));
+  ASSERT_TRUE(store = manager->GetUnit(validator_hash));
+  EXPECT_EQ(store->type(), ambr::store::UnitStore::ST_Validator);
+  EXPECT_FALSE(manager->GetUnit(send_hash+1));
+
+  //remove unit, index must be removed too
+  EXPECT_TRUE(manager->RemoveUnit(receive_hash, &err));
+  EXPECT_FALSE(manager->GetUnit(receive_hash));
+  system("rm -fr ./unit_type_index");
+}
+
+TEST (UnitTest, StoreAccountState) {
+  std::string root_pri_key = "25E25210DCE702D4E36B6C8A17E18DC1D02A9E4F0D1D31C4AEE77327CF1641CC";
+  ambr::core::PrivateKey test_pri = ambr::core::CreateRandomPrivateKey();
+  ambr::core::PublicKey test_pub = ambr::core::GetPublicKeyByPrivateKey(test_pri);
+  std::string err;
+  ambr::core::UnitHash send_hash, receive_hash;
+  std::shared_ptr<ambr::core::Unit> added_unit;
+  ambr::store::AccountState state;
+
+  system("rm -fr ./account_state");
+  {
+    std::shared_ptr<ambr::store::StoreManager> manager = std::make_shared<ambr::store::StoreManager>();
+    manager->Init("./account_state");
+    EXPECT_TRUE(manager->SendToAddress(test_pub, 1000*manager->GetTransectionFeeBase(), root_pri_key, &send_hash, added_unit, &err));
+    ASSERT_TRUE(manager->GetAccountState(test_pub, state));
+    EXPECT_TRUE(state.head_.is_zero());
+    EXPECT_EQ(state.pending_count_, 1u);
+    ambr::core::Amount balance;
+    EXPECT_FALSE(manager->GetBalanceByPubKey(test_pub, balance));
+
+    EXPECT_TRUE(manager->ReceiveFromUnitHash(send_hash, test_pri, &receive_hash, added_unit, &err));
+    ASSERT_TRUE(manager->GetAccountState(test_pub, state));
+    EXPECT_EQ(state.head_, receive_hash);
+    EXPECT_EQ(state.balance_, added_unit->balance());
+    EXPECT_EQ(state.pending_count_, 0u);
+    EXPECT_FALSE(state.validated_);
+  }
+  //reopen, state is loaded from db
+  std::shared_ptr<ambr::store::StoreManager> manager = std::make_shared<ambr::store::StoreManager>();
+  manager->Init("./account_state");
+  ambr::store::AccountState state_loaded;
+  ASSERT_TRUE(manager->GetAccountState(test_pub, state_loaded));
+  EXPECT_EQ(state_loaded.head_, state.head_);
+  EXPECT_EQ(state_loaded.balance_, state.balance_);
+  EXPECT_EQ(state_loaded.pending_count_, 0u);
+  ambr::core::UnitHash last_hash;
+  EXPECT_TRUE(manager->GetLastUnitHashByPubKey(test_pub, last_hash));
+  EXPECT_EQ(last_hash, receive_hash);
+  system("rm -fr ./account_state");
+}
+
+TEST (UnitTest, StoreUpgradeWaitForReceive) {
+  std::string root_pri_key = "25E25210DCE702D4E36B6C8A17E18DC1D02A9E4F0D1D31C4AEE77327CF1641CC";
+  ambr::core::PrivateKey test_pri = ambr::core::CreateRandomPrivateKey();
+  ambr::core::PublicKey test_pub = ambr::core::GetPublicKeyByPrivateKey(test_pri);
+  std::string err;
+  ambr::core::UnitHash send_hash;
+  std::shared_ptr<ambr::core::Unit> added_unit;
+
+  system("rm -fr ./upgrade_wait_for_receive");
+  {
+    std::shared_ptr<ambr::store::StoreManager> manager = std::make_shared<ambr::store::StoreManager>();
+    manager->Init("./upgrade_wait_for_receive");
+    EXPECT_TRUE(manager->SendToAddress(test_pub, 1000*manager->GetTransectionFeeBase(), root_pri_key, &send_hash, added_unit, &err));
+  }
+  {//write list of old format, with a send unit which is not in db
+    ambr::store::KeyValueDBInterface db;
+    std::vector<ambr::store::KeyValueDBInterface::TableHandle*> handle_list;
+    ASSERT_TRUE(db.InitDB("./upgrade_wait_for_receive",
+                          {"send_unit", "receive_unit", "account", "new_accout", "handle_wait_for_receive",
+                           "validator_unit", "enter_validator_unit", "leave_validator_unit", "validator_set",
+                           "handle_validator_balance_", "unit_type", "wait_for_receive", "dynasty_manifest"},
+                          &handle_list));
+    ambr::core::UnitHash missing_hash = send_hash+1;
+    std::string value((const char*)missing_hash.bytes().data(), missing_hash.bytes().size());
+    value.append((const char*)send_hash.bytes().data(), send_hash.bytes().size());
+    ambr::store::KeyValueDBInterface::WriteBatch batch;
+    batch.Write(handle_list[4], std::string((const char*)test_pub.bytes().data(), test_pub.bytes().size()), value);
+    batch.Delete(handle_list[4], "wait_for_receive_version");
+    ASSERT_TRUE(db.Write(batch));
+  }
+  //inconsistent entry is skipped, not fatal
+  std::shared_ptr<ambr::store::StoreManager> manager = std::make_shared<ambr::store::StoreManager>();
+  manager->Init("./upgrade_wait_for_receive");
+  std::list<ambr::core::UnitHash> wait_list = manager->GetWaitForReceiveList(test_pub);
+  ASSERT_EQ(wait_list.size(), 1u);
+  EXPECT_EQ(wait_list.front(), send_hash);
+  system("rm -fr ./upgrade_wait_for_receive");
+}
+
+TEST (UnitTest, StoreNewUnitIndex) {
+  std::string root_pri_key = "25E25210DCE702D4E36B6C8A17E18DC1D02A9E4F0D1D31C4AEE77327CF1641CC";
+  ambr::core::PublicKey root_pub = ambr::core::GetPublicKeyByPrivateKey(root_pri_key);
+  ambr::core::PrivateKey test_pri = ambr::core::CreateRandomPrivateKey();
+  ambr::core::PublicKey test_pub = ambr::core::GetPublicKeyByPrivateKey(test_pri);
+  std::string err;
+  ambr::core::UnitHash send_hash, receive_hash;
+  std::shared_ptr<ambr::core::Unit> added_unit;
+
+  system("rm -fr ./new_unit_index");
+  {
+    std::shared_ptr<ambr::store::StoreManager> manager = std::make_shared<ambr::store::StoreManager>();
+    manager->Init("./new_unit_index");
+    EXPECT_TRUE(manager->GetNewUnitMap().empty());
+    EXPECT_TRUE(manager->SendToAddress(test_pub, 1000*manager->GetTransectionFeeBase(), root_pri_key, &send_hash, added_unit, &err));
+    EXPECT_TRUE(manager->ReceiveFromUnitHash(send_hash, test_pri, &receive_hash, added_unit, &err));
+    std::unordered_map<ambr::core::PublicKey, ambr::core::UnitHash> new_unit_map = manager->GetNewUnitMap();
+    EXPECT_EQ(new_unit_map.size(), 2u);
+    EXPECT_EQ(new_unit_map[root_pub], send_hash);
+    EXPECT_EQ(new_unit_map[test_pub], receive_hash);
+    //check list of passed validator unit removes account's head
+    manager->UpdateNewUnitMap(std::vector<ambr::core::UnitHash>{send_hash});
+    new_unit_map = manager->GetNewUnitMap();
+    EXPECT_EQ(new_unit_map.size(), 1u);
+    EXPECT_EQ(new_unit_map[test_pub], receive_hash);
+  }
+  //reopen, index is loaded from db
+  std::shared_ptr<ambr::store::StoreManager> manager = std::make_shared<ambr::store::StoreManager>();
+  manager->Init("./new_unit_index");
+  std::unordered_map<ambr::core::PublicKey, ambr::core::UnitHash> new_unit_map = manager->GetNewUnitMap();
+  EXPECT_EQ(new_unit_map.size(), 1u);
+  EXPECT_EQ(new_unit_map[test_pub], receive_hash);
+  system("rm -fr ./new_unit_index");
+}
+
+TEST (UnitTest, StoreAddUnits) {
+  std::string root_pri_key = "25E25210DCE702D4E36B6C8A17E18DC1D02A9E4F0D1D31C4AEE77327CF1641CC";
+  ambr::core::PrivateKey send_pri = ambr::core::CreateRandomPrivateKey();
+  ambr::core::PublicKey send_pub = ambr::core::GetPublicKeyByPrivateKey(send_pri);
+  ambr::core::PrivateKey receive_pri = ambr::core::CreateRandomPrivateKey();
+  ambr::core::PublicKey receive_pub = ambr::core::GetPublicKeyByPrivateKey(receive_pri);
+  std::string err;
+  ambr::core::UnitHash tx_hash;
+  std::shared_ptr<ambr::core::Unit> added_unit;
+
+  system("rm -fr ./add_units");
+  std::shared_ptr<ambr::store::StoreManager> manager = std::make_shared<ambr::store::StoreManager>();
+  manager->Init("./add_units");
+  EXPECT_TRUE(manager->SendToAddress(send_pub, 100000*manager->GetTransectionFeeBase(), root_pri_key, &tx_hash, added_unit, &err));
+  EXPECT_TRUE(manager->ReceiveFromUnitHash(tx_hash, send_pri, nullptr, added_unit, &err));
+
+  //send 3 units and receive them, in one list
+  ambr::core::UnitHash send_prev, receive_prev;
+  ambr::core::Amount receive_balance;
+  std::vector<std::shared_ptr<ambr::core::Unit>> unit_list = CreateSendReceivePairs(manager, send_pri, receive_pri, 3, &send_prev, &receive_prev, &receive_balance);
+  //out of order, with a duplicate and a unit of wrong signature
+  std::reverse(unit_list.begin(), unit_list.end());
+  unit_list.push_back(unit_list.back());
+  std::shared_ptr<ambr::core::SendUnit> bad_unit = std::make_shared<ambr::core::SendUnit>(*std::dynamic_pointer_cast<ambr::core::SendUnit>(unit_list.back()));
+  bad_unit->SignatureAndFill(receive_pri);
+  unit_list.push_back(bad_unit);
+
+  std::vector<bool> result_list;
+  std::vector<std::string> err_list;
+  EXPECT_FALSE(manager->AddUnits(unit_list, &result_list, &err_list));
+  ASSERT_EQ(result_list.size(), unit_list.size());
+  ASSERT_EQ(err_list.size(), unit_list.size());
+  for(size_t i = 0; i < 6; i++){
+    EXPECT_TRUE(result_list[i]) << err_list[i];
+  }
+  EXPECT_FALSE(result_list[6]);
+  EXPECT_FALSE(result_list[7]);
+  EXPECT_FALSE(err_list[7].empty());
+
+  ambr::core::UnitHash last_hash;
+  ambr::core::Amount balance;
+  EXPECT_TRUE(manager->GetLastUnitHashByPubKey(send_pub, last_hash));
+  EXPECT_EQ(last_hash, send_prev);
+  EXPECT_TRUE(manager->GetLastUnitHashByPubKey(receive_pub, last_hash));
+  EXPECT_EQ(last_hash, receive_prev);
+  EXPECT_TRUE(manager->GetBalanceByPubKey(receive_pub, balance));
+  EXPECT_EQ(balance, receive_balance);
+  EXPECT_TRUE(manager->GetWaitForReceiveList(receive_pub).empty());
+  std::shared_ptr<ambr::store::SendUnitStore> send_store = manager->GetSendUnit(send_prev);
+  ASSERT_TRUE(send_store);
+  EXPECT_EQ(send_store->receive_unit_hash(), receive_prev);
+  system("rm -fr ./add_units");
+}
+
+TEST (UnitTest, StoreSignalOutOfLock) {
+  std::string root_pri_key = "25E25210DCE702D4E36B6C8A17E18DC1D02A9E4F0D1D31C4AEE77327CF1641CC";
+  ambr::core::PrivateKey test_pri = ambr::core::CreateRandomPrivateKey();
+  ambr::core::PublicKey test_pub = ambr::core::GetPublicKeyByPrivateKey(test_pri);
+  std::string err;
+  ambr::core::UnitHash send_hash, receive_hash;
+  std::shared_ptr<ambr::core::Unit> added_unit;
+
+  system("rm -fr ./signal_out_of_lock");
+  std::shared_ptr<ambr::store::StoreManager> manager = std::make_shared<ambr::store::StoreManager>();
+  manager->Init("./signal_out_of_lock");
+  //listener receives the send unit at once, it locks receiver's account which was locked by the send
+  boost::signals2::connection connection = manager->AddCallBackReceiveNewSendUnit(
+    [&](std::shared_ptr<ambr::core::SendUnit> unit){
+      if(unit->dest() == test_pub){
+        std::shared_ptr<ambr::core::Unit> receive_unit;
+        EXPECT_TRUE(manager->ReceiveFromUnitHash(unit->hash(), test_pri, &receive_hash, receive_unit, &err));
+      }
+    });
+  EXPECT_TRUE(manager->SendToAddress(test_pub, 1000*manager->GetTransectionFeeBase(), root_pri_key, &send_hash, added_unit, &err));
+  connection.disconnect();
+  ambr::core::UnitHash last_hash;
+  EXPECT_TRUE(manager->GetLastUnitHashByPubKey(test_pub, last_hash));
+  EXPECT_EQ(last_hash, receive_hash);
+  EXPECT_TRUE(manager->GetWaitForReceiveList(test_pub).empty());
+  system("rm -fr ./signal_out_of_lock");
+}
+
+TEST (UnitTest, StoreOrphanPool) {
+  std::string root_pri_key = "25E25210DCE702D4E36B6C8A17E18DC1D02A9E4F0D1D31C4AEE77327CF1641CC";
+  ambr::core::PrivateKey send_pri = ambr::core::CreateRandomPrivateKey();
+  ambr::core::PublicKey send_pub = ambr::core::GetPublicKeyByPrivateKey(send_pri);
+  ambr::core::PrivateKey receive_pri = ambr::core::CreateRandomPrivateKey();
+  ambr::core::PublicKey receive_pub = ambr::core::GetPublicKeyByPrivateKey(receive_pri);
+  std::string err;
+  ambr::core::UnitHash tx_hash;
+  std::shared_ptr<ambr::core::Unit> added_unit;
+
+  system("rm -fr ./orphan_pool");
+  std::shared_ptr<ambr::store::StoreManager> manager = std::make_shared<ambr::store::StoreManager>();
+  manager->Init("./orphan_pool");
+  EXPECT_TRUE(manager->SendToAddress(send_pub, 100000*manager->GetTransectionFeeBase(), root_pri_key, &tx_hash, added_unit, &err));
+  EXPECT_TRUE(manager->ReceiveFromUnitHash(tx_hash, send_pri, nullptr, added_unit, &err));
+
+  ambr::core::UnitHash send_prev, receive_prev;
+  ambr::core::Amount receive_balance;
+  std::vector<std::shared_ptr<ambr::core::Unit>> unit_list = CreateSendReceivePairs(manager, send_pri, receive_pri, 3, &send_prev, &receive_prev, &receive_balance);
+
+  //all but the first unit wait in pool, adding the first wakes the rest
+  int peer = 0;
+  std::vector<ambr::core::UnitHash> missing_list;
+  manager->AddCallBackOrphanUnit([&missing_list, &peer](std::shared_ptr<ambr::core::Unit>, void* addtion_data, const ambr::core::UnitHash& missing){
+    EXPECT_EQ(addtion_data, &peer);
+    missing_list.push_back(missing);
+  });
+  for(size_t i = unit_list.size()-1; i > 0; i--){
+    manager->AddUnitToBuffer(unit_list[i], &peer);
+    EXPECT_EQ(unit_list.size()-i, manager->GetOrphanCount());
+  }
+  manager->AddUnitToBuffer(unit_list[5], &peer);
+  EXPECT_EQ(5u, manager->GetOrphanCount());
+  ASSERT_EQ(5u, missing_list.size());
+  EXPECT_EQ(missing_list[0], unit_list[3]->hash());
+  EXPECT_EQ(missing_list[4], unit_list[0]->hash());
+  manager->AddUnitToBuffer(unit_list[0], &peer);
+  EXPECT_EQ(0u, manager->GetOrphanCount());
+  EXPECT_EQ(0u, manager->GetOrphanMemory());
+  EXPECT_EQ(5u, manager->GetOrphanWokenCount());
+  ambr::core::UnitHash last_hash;
+  EXPECT_TRUE(manager->GetLastUnitHashByPubKey(send_pub, last_hash));
+  EXPECT_EQ(last_hash, send_prev);
+  EXPECT_TRUE(manager->GetLastUnitHashByPubKey(receive_pub, last_hash));
+  EXPECT_EQ(last_hash, receive_prev);
+
+  //dependency is stored but unit is invalid, it is not kept
+  std::shared_ptr<ambr::core::SendUnit> bad_unit = std::make_shared<ambr::core::SendUnit>();
+  bad_unit->set_version(0x00000001);
+  bad_unit->set_type(ambr::core::UnitType::send);
+  bad_unit->set_public_key(send_pub);
+  bad_unit->set_prev_unit(send_prev);
+  bad_unit->set_dest(receive_pub);
+  bad_unit->set_balance(receive_balance);
+  bad_unit->CalcHashAndFill();
+  bad_unit->SignatureAndFill(send_pri);
+  manager->AddUnitToBuffer(bad_unit, &peer);
+  EXPECT_EQ(0u, manager->GetOrphanCount());
+
+  //pool limits evict the oldest unit of the peer holding most units
+  ambr::store::OrphanPool pool(4, 1024*1024, 3);
+  int peer_a = 0, peer_b = 0;
+  std::vector<ambr::store::OrphanPool::Item> evicted_list;
+  EXPECT_TRUE(pool.Add(unit_list[1], &peer_b, unit_list[0]->hash(), &evicted_list));
+  for(size_t i = 2; i < 6; i++){
+    EXPECT_TRUE(pool.Add(unit_list[i], &peer_a, unit_list[i-1]->hash(), &evicted_list));
+  }
+  EXPECT_FALSE(pool.Add(unit_list[5], &peer_a, unit_list[4]->hash(), &evicted_list));
+  ASSERT_EQ(1u, evicted_list.size());
+  EXPECT_EQ(evicted_list[0].unit_->hash(), unit_list[2]->hash());
+  EXPECT_EQ(4u, pool.size());
+  EXPECT_TRUE(pool.Contains(unit_list[1]->hash()));
+  std::vector<ambr::store::OrphanPool::Item> item_list = pool.Take(unit_list[3]->hash());
+  ASSERT_EQ(1u, item_list.size());
+  EXPECT_EQ(item_list[0].unit_->hash(), unit_list[4]->hash());
+  EXPECT_EQ(3u, pool.size());
+  EXPECT_EQ(3u, pool.Expire(std::chrono::steady_clock::now()).size());
+  EXPECT_EQ(0u, pool.size());
+  EXPECT_EQ(0u, pool.memory());
+  EXPECT_EQ(0u, pool.peer_count());
+  system("rm -fr ./orphan_pool");
+}
+
+TEST (UnitTest, StoreChainTip) {
+  std::string root_pri_key = "25E25210DCE702D4E36B6C8A17E18DC1D02A9E4F0D1D31C4AEE77327CF1641CC";
+  std::string err;
+  ambr::core::UnitHash tx_hash;
+  std::shared_ptr<ambr::core::ValidatorUnit> validator_unit;
+  std::shared_ptr<ambr::core::VoteUnit> vote_unit;
+
+  system("rm -fr ./chain_tip");
+  {
+    std::shared_ptr<ambr::store::StoreManager> manager = std::make_shared<ambr::store::StoreManager>();
+    manager->Init("./chain_tip");
+    std::shared_ptr<const ambr::store::ChainTip> tip = manager->GetChainTip();
+    std::shared_ptr<ambr::store::ValidatorUnitStore> last_store = manager->GetLastestValidateUnit();
+    ASSERT_TRUE(last_store != nullptr);
+    EXPECT_EQ(tip->last_validator_hash_, last_store->unit()->hash());
+    EXPECT_EQ(tip->last_validator_nonce_, last_store->unit()->nonce());
+    EXPECT_EQ(manager->GetLastValidatedUnitHash(), last_store->unit()->hash());
+    EXPECT_EQ(manager->GetLastValidatedUnitNonce(), last_store->unit()->nonce());
+
+    boost::this_thread::sleep(boost::posix_time::millisec(manager->GetValidateUnitInterval()));
+    EXPECT_TRUE(manager->PublishValidator(root_pri_key, &tx_hash, validator_unit, &err));
+    ambr::core::UnitHash first_hash = validator_unit->hash();
+    EXPECT_EQ(manager->GetChainTip()->last_validator_hash_, first_hash);
+    EXPECT_EQ(manager->GetLastValidatedUnitNonce(), validator_unit->nonce());
+    EXPECT_TRUE(manager->PublishVote(root_pri_key, true, vote_unit, &err));
+
+    boost::this_thread::sleep(boost::posix_time::millisec(manager->GetValidateUnitInterval()));
+    EXPECT_TRUE(manager->PublishValidator(root_pri_key, &tx_hash, validator_unit, &err));
+    tip = manager->GetChainTip();
+    EXPECT_EQ(tip->last_validator_hash_, validator_unit->hash());
+    //first one passed by votes carried in second one
+    EXPECT_EQ(tip->last_confirmed_hash_, first_hash);
+    EXPECT_TRUE(manager->GetValidateUnit(first_hash)->is_validate());
+  }
+  //reload from db
+  std::shared_ptr<ambr::store::StoreManager> manager = std::make_shared<ambr::store::StoreManager>();
+  manager->Init("./chain_tip");
+  std::shared_ptr<const ambr::store::ChainTip> tip = manager->GetChainTip();
+  EXPECT_EQ(tip->last_validator_hash_, validator_unit->hash());
+  EXPECT_EQ(tip->last_validator_nonce_, validator_unit->nonce());
+  EXPECT_EQ(tip->last_confirmed_hash_, manager->GetValidateUnit(validator_unit->prev_unit())->unit()->hash());
+  system("rm -fr ./chain_tip");
+}
+
+TEST (UnitTest, StoreDynastyManifest) {
+  std::string root_pri_key = "25E25210DCE702D4E36B6C8A17E18DC1D02A9E4F0D1D31C4AEE77327CF1641CC";
+  ambr::core::PrivateKey user_pri = ambr::core::CreateRandomPrivateKey();
+  ambr::core::PublicKey user_pub = ambr::core::GetPublicKeyByPrivateKey(user_pri);
+  std::string err;
+  ambr::core::UnitHash tx_hash, send_hash, receive_hash, back_hash;
+  std::shared_ptr<ambr::core::Unit> added_unit;
+  std::shared_ptr<ambr::core::ValidatorUnit> validator_unit;
+  std::shared_ptr<ambr::core::VoteUnit> vote_unit;
+
+  system("rm -fr ./dynasty_manifest");
+  std::shared_ptr<ambr::store::StoreManager> manager = std::make_shared<ambr::store::StoreManager>();
+  manager->Init("./dynasty_manifest");
+  EXPECT_TRUE(manager->SendToAddress(user_pub, 100000*manager->GetTransectionFeeBase(), root_pri_key, &send_hash, added_unit, &err));
+  EXPECT_TRUE(manager->ReceiveFromUnitHash(send_hash, user_pri, &receive_hash, added_unit, &err));
+  EXPECT_TRUE(manager->SendToAddress(ambr::core::GetPublicKeyByPrivateKey(root_pri_key), 1000*manager->GetTransectionFeeBase(), user_pri, &back_hash, added_unit, &err));
+
+  boost::this_thread::sleep(boost::posix_time::millisec(manager->GetValidateUnitInterval()));
+  EXPECT_TRUE(manager->PublishValidator(root_pri_key, &tx_hash, validator_unit, &err));
+  ambr::core::UnitHash first_hash = validator_unit->hash();
+  std::vector<ambr::core::UnitHash> manifest;
+  EXPECT_FALSE(manager->GetDynastyManifest(first_hash, manifest));
+  EXPECT_TRUE(manager->PublishVote(root_pri_key, true, vote_unit, &err));
+  boost::this_thread::sleep(boost::posix_time::millisec(manager->GetValidateUnitInterval()));
+  EXPECT_TRUE(manager->PublishValidator(root_pri_key, &tx_hash, validator_unit, &err));
+
+  //written when first validator unit was passed
+  ASSERT_TRUE(manager->GetDynastyManifest(first_hash, manifest));
+  ASSERT_EQ(manifest.size(), 4u);
+  EXPECT_EQ(manifest.back(), first_hash);
+  auto pos = [&manifest](const ambr::core::UnitHash& hash){
+    return std::find(manifest.begin(), manifest.end(), hash)-manifest.begin();
+  };
+  EXPECT_LT(pos(send_hash), pos(receive_hash));
+  EXPECT_LT(pos(receive_hash), pos(back_hash));
+  EXPECT_LT(pos(back_hash), 3);
+
+  std::list<std::shared_ptr<ambr::core::Unit>> unit_list = manager->GetAllUnitByValidatorUnitHash(first_hash);
+  ASSERT_EQ(unit_list.size(), manifest.size());
+  size_t idx = 0;
+  for(std::shared_ptr<ambr::core::Unit> unit:unit_list){
+    EXPECT_EQ(unit->hash(), manifest[idx++]);
+  }
+  system("rm -fr ./dynasty_manifest");
+}
@@ -0,0 +1,251 @@
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <glog/logging.h>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include "store/store_manager.h"
+
+namespace{
+const std::string root_pri_key = "25E25210DCE702D4E36B6C8A17E18DC1D02A9E4F0D1D31C4AEE77327CF1641CC";
+
+//create signed send unit chain of account offline, so only ingest is timed
+std::vector<std::shared_ptr<ambr::core::SendUnit>> CreateSendChain(
+    std::shared_ptr<ambr::store::StoreManager> manager,
+    const ambr::core::PrivateKey& pri_key,
+    const ambr::core::PublicKey& dest,
+    size_t count){
+  std::vector<std::shared_ptr<ambr::core::SendUnit>> rtn;
+  ambr::core::PublicKey pub_key = ambr::core::GetPublicKeyByPrivateKey(pri_key);
+  ambr::core::UnitHash prev_hash;
+  ambr::core::Amount balance;
+  EXPECT_TRUE(manager->GetLastUnitHashByPubKey(pub_key, prev_hash));
+  EXPECT_TRUE(manager->GetBalanceByPubKey(pub_key, balance));
+  for(size_t i = 0; i < count; i++){
+    std::shared_ptr<ambr::core::SendUnit> unit = std::make_shared<ambr::core::SendUnit>();
+    unit->set_version(0x00000001);
+    unit->set_type(ambr::core::UnitType::send);
+    unit->set_public_key(pub_key);
+    unit->set_prev_unit(prev_hash);
+    unit->set_dest(dest);
+    ambr::core::Amount amount = 1000*manager->GetTransectionFeeBase();
+    balance.set_data(balance.data()-amount.data());
+    unit->set_balance(balance);
+    unit->CalcHashAndFill();
+    unit->SignatureAndFill(pri_key);
+    prev_hash = unit->hash();
+    rtn.push_back(unit);
+  }
+  return rtn;
+}
+
+//create signed receive units of account for send_list offline, account should not exist
+std::vector<std::shared_ptr<ambr::core::ReceiveUnit>> CreateReceiveChain(
+    std::shared_ptr<ambr::store::StoreManager> manager,
+    const ambr::core::PrivateKey& pri_key,
+    const std::vector<std::shared_ptr<ambr::core::SendUnit>>& send_list){
+  std::vector<std::shared_ptr<ambr::core::ReceiveUnit>> rtn;
+  ambr::core::PublicKey pub_key = ambr::core::GetPublicKeyByPrivateKey(pri_key);
+  ambr::core::UnitHash prev_hash;
+  ambr::core::Amount balance;
+  for(std::shared_ptr<ambr::core::SendUnit> send_unit:send_list){
+    std::shared_ptr<ambr::core::ReceiveUnit> unit = std::make_shared<ambr::core::ReceiveUnit>();
+    unit->set_version(0x00000001);
+    unit->set_type(ambr::core::UnitType::receive);
+    unit->set_public_key(pub_key);
+    unit->set_prev_unit(prev_hash);
+    balance.set_data(balance.data()+1000*manager->GetTransectionFeeBase()-manager->GetTransectionFeeCountWhenReceive(send_unit));
+    unit->set_balance(balance);
+    unit->set_from(send_unit->hash());
+    unit->CalcHashAndFill();
+    unit->SignatureAndFill(pri_key);
+    prev_hash = unit->hash();
+    rtn.push_back(unit);
+  }
+  return rtn;
+}
+
+//ingest chains by thread_count threads, every thread own one account, return units per second
+double IngestChains(std::shared_ptr<ambr::store::StoreManager> manager,
+                    const std::vector<std::vector<std::shared_ptr<ambr::core::SendUnit>>>& chain_list){
+  std::atomic<size_t> failed(0);
+  size_t all_count = 0;
+  std::vector<std::thread> thread_list;
+  boost::posix_time::ptime start = boost::posix_time::microsec_clock::local_time();
+  for(const std::vector<std::shared_ptr<ambr::core::SendUnit>>& chain:chain_list){
+    all_count += chain.size();
+    thread_list.push_back(std::thread([&manager, &chain, &failed](){
+      for(std::shared_ptr<ambr::core::SendUnit> unit:chain){
+        std::string err;
+        if(!manager->AddSendUnit(unit, &err)){
+          failed++;
+        }
+      }
+    }));
+  }
+  for(std::thread& item:thread_list){
+    item.join();
+  }
+  int64_t use_us = (boost::posix_time::microsec_clock::local_time()-start).total_microseconds();
+  EXPECT_EQ(failed, 0u);
+  return all_count*1000000.0/(use_us?use_us:1);
+}
+}
+
+TEST (StoreBench, MultiThreadIngest) {
+  const size_t thread_count = 8;
+  const size_t unit_count = 500;//per account
+  std::shared_ptr<ambr::store::StoreManager> manager = std::make_shared<ambr::store::StoreManager>();
+  system("rm -fr ./store_bench");
+  manager->Init("./store_bench");
+
+  //fund accounts
+  std::vector<ambr::core::PrivateKey> pri_key_list;
+  for(size_t i = 0; i < thread_count*2; i++){
+    ambr::core::PrivateKey pri_key = ambr::core::CreateRandomPrivateKey();
+    ambr::core::UnitHash tx_hash;
+    std::shared_ptr<ambr::core::Unit> unit;
+    std::string err;
+    ASSERT_TRUE(manager->SendToAddress(ambr::core::GetPublicKeyByPrivateKey(pri_key),
+                                       (ambr::core::Amount)((boost::multiprecision::uint128_t)100000000*1000),
+                                       root_pri_key, &tx_hash, unit, &err)) << err;
+    ASSERT_TRUE(manager->ReceiveFromUnitHash(tx_hash, pri_key, nullptr, unit, &err)) << err;
+    pri_key_list.push_back(pri_key);
+  }
+
+  //single thread: one account
+  std::vector<std::vector<std::shared_ptr<ambr::core::SendUnit>>> single_chain;
+  single_chain.push_back(CreateSendChain(manager, pri_key_list[0],
+                                         ambr::core::GetPublicKeyByPrivateKey(pri_key_list[1]), unit_count*thread_count));
+  double single_speed = IngestChains(manager, single_chain);
+
+  //multi thread: one account per thread, send to each other
+  std::vector<std::vector<std::shared_ptr<ambr::core::SendUnit>>> multi_chain;
+  for(size_t i = 0; i < thread_count; i++){
+    multi_chain.push_back(CreateSendChain(manager, pri_key_list[thread_count+i],
+                                          ambr::core::GetPublicKeyByPrivateKey(pri_key_list[thread_count+(i+1)%thread_count]), unit_count));
+  }
+  double multi_speed = IngestChains(manager, multi_chain);
+
+  std::cout<<"ingest units/s, 1 thread:"<<single_speed<<", "<<thread_count<<" threads:"<<multi_speed<<std::endl;
+  system("rm -fr ./store_bench");
+}
+
+TEST (StoreBench, UnitCacheReadPath) {
+  const size_t account_count = 16;
+  const size_t unit_count = 100;//per account
+  const size_t replay_count = 20;
+  std::shared_ptr<ambr::store::StoreManager> manager = std::make_shared<ambr::store::StoreManager>();
+  system("rm -fr ./store_bench");
+  manager->Init("./store_bench");
+
+  std::vector<ambr::core::PublicKey> pub_key_list;
+  for(size_t i = 0; i < account_count; i++){
+    ambr::core::PrivateKey pri_key = ambr::core::CreateRandomPrivateKey();
+    ambr::core::UnitHash tx_hash;
+    std::shared_ptr<ambr::core::Unit> unit;
+    std::string err;
+    ASSERT_TRUE(manager->SendToAddress(ambr::core::GetPublicKeyByPrivateKey(pri_key),
+                                       (ambr::core::Amount)((boost::multiprecision::uint128_t)100000000*1000),
+                                       root_pri_key, &tx_hash, unit, &err)) << err;
+    ASSERT_TRUE(manager->ReceiveFromUnitHash(tx_hash, pri_key, nullptr, unit, &err)) << err;
+    for(std::shared_ptr<ambr::core::SendUnit> send_unit:CreateSendChain(manager, pri_key, pub_key_list.size()?pub_key_list.back():ambr::core::PublicKey(), unit_count)){
+      ASSERT_TRUE(manager->AddSendUnit(send_unit, &err)) << err;
+    }
+    pub_key_list.push_back(ambr::core::GetPublicKeyByPrivateKey(pri_key));
+  }
+
+  //replay: walk every account's chain and read balance, as rpc and validator do
+  auto replay = [&]()->double{
+    size_t read_count = 0;
+    boost::posix_time::ptime start = boost::posix_time::microsec_clock::local_time();
+    for(size_t i = 0; i < replay_count; i++){
+      for(const ambr::core::PublicKey& pub_key:pub_key_list){
+        ambr::core::Amount balance;
+        EXPECT_TRUE(manager->GetBalanceByPubKey(pub_key, balance));
+        read_count += manager->GetTradeHistoryByPubKey(pub_key, unit_count).size()+1;
+      }
+    }
+    int64_t use_us = (boost::posix_time::microsec_clock::local_time()-start).total_microseconds();
+    return read_count*1000000.0/(use_us?use_us:1);
+  };
+
+  manager->SetUnitCacheCapacity(0);
+  double uncached_speed = replay();
+  manager->SetUnitCacheCapacity(64*1024*1024);
+  uint64_t hit_before = manager->GetUnitCacheHitCount();
+  uint64_t miss_before = manager->GetUnitCacheMissCount();
+  double cached_speed = replay();
+  uint64_t hit = manager->GetUnitCacheHitCount()-hit_before;
+  uint64_t miss = manager->GetUnitCacheMissCount()-miss_before;
+  EXPECT_GT(hit, miss);
+
+  std::cout<<"unit reads/s, no cache:"<<uncached_speed<<", cache:"<<cached_speed
+           <<", hit:"<<hit<<", miss:"<<miss<<std::endl;
+  system("rm -fr ./store_bench");
+}
+
+TEST (StoreBench, BatchIngest) {
+  const size_t account_count = 5;
+  const size_t unit_count = 1000;//send and receive per account pair
+  std::vector<ambr::core::PrivateKey> send_key_list, receive_key_list;
+  for(size_t i = 0; i < account_count; i++){
+    send_key_list.push_back(ambr::core::CreateRandomPrivateKey());
+    receive_key_list.push_back(ambr::core::CreateRandomPrivateKey());
+  }
+  //same funding in both db, so units created on one are valid on the other
+  auto create_manager = [&](const std::string& path)->std::shared_ptr<ambr::store::StoreManager>{
+    std::shared_ptr<ambr::store::StoreManager> manager = std::make_shared<ambr::store::StoreManager>();
+    system((std::string("rm -fr ")+path).c_str());
+    manager->Init(path);
+    for(const ambr::core::PrivateKey& pri_key:send_key_list){
+      ambr::core::UnitHash tx_hash;
+      std::shared_ptr<ambr::core::Unit> unit;
+      std::string err;
+      EXPECT_TRUE(manager->SendToAddress(ambr::core::GetPublicKeyByPrivateKey(pri_key),
+                                         (ambr::core::Amount)((boost::multiprecision::uint128_t)100000000*1000),
+                                         root_pri_key, &tx_hash, unit, &err)) << err;
+      EXPECT_TRUE(manager->ReceiveFromUnitHash(tx_hash, pri_key, nullptr, unit, &err)) << err;
+    }
+    return manager;
+  };
+  std::shared_ptr<ambr::store::StoreManager> single_manager = create_manager("./store_bench");
+  std::shared_ptr<ambr::store::StoreManager> batch_manager = create_manager("./store_bench_batch");
+
+  std::vector<std::shared_ptr<ambr::core::Unit>> unit_list;
+  for(size_t i = 0; i < account_count; i++){
+    std::vector<std::shared_ptr<ambr::core::SendUnit>> send_list = CreateSendChain(
+          single_manager, send_key_list[i], ambr::core::GetPublicKeyByPrivateKey(receive_key_list[i]), unit_count);
+    std::vector<std::shared_ptr<ambr::core::ReceiveUnit>> receive_list = CreateReceiveChain(
+          single_manager, receive_key_list[i], send_list);
+    unit_list.insert(unit_list.end(), send_list.begin(), send_list.end());
+    unit_list.insert(unit_list.end(), receive_list.begin(), receive_list.end());
+  }
+
+  boost::posix_time::ptime start = boost::posix_time::microsec_clock::local_time();
+  for(std::shared_ptr<ambr::core::Unit> unit:unit_list){
+    std::string err;
+    EXPECT_TRUE(single_manager->AddUnit(unit, &err)) << err;
+  }
+  int64_t single_us = (boost::posix_time::microsec_clock::local_time()-start).total_microseconds();
+
+  //receive units first, batch orders them by dependency
+  std::reverse(unit_list.begin(), unit_list.end());
+  std::vector<bool> result_list;
+  start = boost::posix_time::microsec_clock::local_time();
+  EXPECT_TRUE(batch_manager->AddUnits(unit_list, &result_list, nullptr));
+  int64_t batch_us = (boost::posix_time::microsec_clock::local_time()-start).total_microseconds();
+
+  for(const ambr::core::PrivateKey& pri_key:receive_key_list){
+    ambr::core::Amount single_balance, batch_balance;
+    EXPECT_TRUE(single_manager->GetBalanceByPubKey(ambr::core::GetPublicKeyByPrivateKey(pri_key), single_balance));
+    EXPECT_TRUE(batch_manager->GetBalanceByPubKey(ambr::core::GetPublicKeyByPrivateKey(pri_key), batch_balance));
+    EXPECT_EQ(single_balance, batch_balance);
+  }
+  std::cout<<unit_list.size()<<" units ingest units/s, AddUnit:"<<unit_list.size()*1000000.0/(single_us?single_us:1)
+           <<", AddUnits:"<<unit_list.size()*1000000.0/(batch_us?batch_us:1)<<std::endl;
+  system("rm -fr ./store_bench ./store_bench_batch");
+}
@@ -7,6 +7,11 @@
 #include "store/store_manager.h"
 #include "store/unit_store.h"
 #include <synchronization/syn_manager.h>
+#include <synchronization/dynasty_cache.h>
+#include <synchronization/dynasty_sync.h>
+#include <synchronization/unit_relay.h>
+#include <synchronization/orphan_fetch.h>
+#include <synchronization/unit_ingest.h>
 #include <utils/validator_auto.h>
 #include <boost/thread.hpp>
 
@@ -331,7 +336,6 @@ protected:
 
       last_nonce = now_nonce;
       ambr::core::PublicKey test_pub = ambr::core::GetPublicKeyByPrivateKey(root_pri_key);
-      LockGrade lk(store_client->GetMutex());
       ambr::core::PublicKey now_pub_key;
       auto validator_set_list  = store_server->GetValidatorSet();
       EXPECT_TRUE (validator_set_list->IsValidator(test_pub));
@@ -349,3 +353,696 @@ protected:
       EXPECT_TRUE(store_client->PublishVote(root_pri_key, true, vote_unit, &err)) << err  << std::endl;
   }
 
+TEST (DynastyCacheTest, SharedPayload) {
+  ambr::syn::DynastyCache cache(1000);
+  std::atomic<uint32_t> encode_count(0);
+  auto encode_func = [&encode_count](size_t size){
+    return [&encode_count, size](){
+      encode_count++;
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+      return std::make_shared<const std::vector<uint8_t>>(size, 1);
+    };
+  };
+  ambr::core::UnitHash hash1("C4F5BF9CABF57BBB1EB49420F5FAEC8E66BE5166E80EA3F93F417C124423230C");
+  ambr::core::UnitHash hash2("1EB49420F5FAEC8E66BE5166E80EA3F93F417C124423230CC4F5BF9CABF57BBB");
+  //peers request the same dynasty at the same time
+  std::vector<ambr::syn::DynastyCache::Payload> payload_list(8);
+  std::vector<std::thread> thread_list;
+  for(size_t i = 0; i < payload_list.size(); i++){
+    thread_list.push_back(std::thread([&, i](){
+      payload_list[i] = cache.Get(hash1, encode_func(600));
+    }));
+  }
+  for(std::thread& item:thread_list){
+    item.join();
+  }
+  EXPECT_EQ(encode_count, 1u);
+  for(const ambr::syn::DynastyCache::Payload& payload:payload_list){
+    EXPECT_EQ(payload.get(), payload_list[0].get());
+  }
+  EXPECT_EQ(cache.usage(), 600u);
+  EXPECT_EQ(cache.miss_count(), 1u);
+  EXPECT_EQ(cache.hit_count(), 7u);
+
+  //evict hash1 by charge, payload still valid for holders
+  cache.Get(hash2, encode_func(500));
+  EXPECT_EQ(cache.usage(), 500u);
+  EXPECT_EQ(payload_list[0]->size(), 600u);
+  cache.Get(hash1, encode_func(600));
+  EXPECT_EQ(encode_count, 3u);
+
+  //too large to cache
+  cache.SetCapacity(100);
+  EXPECT_EQ(cache.usage(), 0u);
+  cache.Get(hash2, encode_func(500));
+  cache.Get(hash2, encode_func(500));
+  EXPECT_EQ(encode_count, 5u);
+}
+
+//chain of dynasties after anchor, each is a send unit and it's validator unit signed by one key
+static std::vector<ambr::syn::DynastySync::Dynasty> MakeDynastyChain(const ambr::core::UnitHash& anchor, uint64_t count,
+                                                                      const ambr::core::PrivateKey& pri_key = ambr::core::CreateRandomPrivateKey()){
+  std::vector<ambr::syn::DynastySync::Dynasty> chain;
+  ambr::core::UnitHash prev = anchor;
+  for(uint64_t i = 0; i < count; i++){
+    std::shared_ptr<ambr::core::SendUnit> send_unit = std::make_shared<ambr::core::SendUnit>();
+    send_unit->set_type(ambr::core::UnitType::send);
+    send_unit->set_balance(i);
+    send_unit->CalcHashAndFill();
+    std::shared_ptr<ambr::core::ValidatorUnit> validator_unit = std::make_shared<ambr::core::ValidatorUnit>();
+    validator_unit->set_type(ambr::core::UnitType::Validator);
+    validator_unit->set_public_key(ambr::core::GetPublicKeyByPrivateKey(pri_key));
+    validator_unit->set_prev_unit(prev);
+    validator_unit->set_nonce(i+1);
+    validator_unit->add_check_list(send_unit->hash());
+    validator_unit->CalcHashAndFill();
+    validator_unit->SignatureAndFill(pri_key);
+    prev = validator_unit->hash();
+    chain.push_back(ambr::syn::DynastySync::Dynasty{send_unit, validator_unit});
+  }
+  return chain;
+}
+
+TEST (DynastySyncTest, Pipeline) {
+  ambr::core::UnitHash anchor("C4F5BF9CABF57BBB1EB49420F5FAEC8E66BE5166E80EA3F93F417C124423230C");
+  std::vector<ambr::syn::DynastySync::Dynasty> chain = MakeDynastyChain(anchor, 10);
+  auto slice = [&chain](uint32_t start, uint32_t count){
+    return std::vector<ambr::syn::DynastySync::Dynasty>(chain.begin()+start, chain.begin()+start+count);
+  };
+
+  ambr::syn::DynastySync sync(4, 2);
+  sync.Start(anchor);
+  sync.AddPeer(1);
+  std::vector<ambr::syn::DynastySync::Range> request = sync.NextRequests(1);
+  ASSERT_EQ(request.size(), 2u);
+  EXPECT_EQ(request[0].start_, 0u);
+  EXPECT_EQ(request[1].start_, 4u);
+  EXPECT_TRUE(sync.NextRequests(1).empty());
+
+  //second range arrives first, nothing to apply
+  ambr::syn::DynastySync::Dynasty dynasty;
+  EXPECT_TRUE(sync.OnResponse(1, 4, slice(4, 4)));
+  EXPECT_FALSE(sync.PopReady(dynasty));
+  EXPECT_FALSE(sync.OnResponse(1, 4, slice(4, 4)));
+  //first range answered partly, the rest is requested again before new range
+  EXPECT_TRUE(sync.OnResponse(1, 0, slice(0, 3)));
+  for(size_t i = 0; i < 3; i++){
+    ASSERT_TRUE(sync.PopReady(dynasty));
+    EXPECT_EQ(dynasty.back()->hash(), chain[i].back()->hash());
+  }
+  EXPECT_FALSE(sync.PopReady(dynasty));
+  //without headers, only hash before the next one to pop is known
+  EXPECT_EQ(sync.PrevHash(0), anchor);
+  EXPECT_EQ(sync.PrevHash(3), chain[2].back()->hash());
+  EXPECT_TRUE(sync.PrevHash(8).is_zero());
+  request = sync.NextRequests(1);
+  ASSERT_EQ(request.size(), 2u);
+  EXPECT_EQ(request[0].start_, 3u);
+  EXPECT_EQ(request[0].count_, 1u);
+  EXPECT_EQ(request[1].start_, 8u);
+  EXPECT_TRUE(sync.OnResponse(1, 3, slice(3, 1)));
+  //peer has only 10 dynasties
+  EXPECT_TRUE(sync.OnResponse(1, 8, slice(8, 2)));
+  while(sync.PopReady(dynasty));
+  EXPECT_EQ(sync.last_hash(), chain.back().back()->hash());
+  EXPECT_FALSE(sync.finished());
+  request = sync.NextRequests(1);
+  ASSERT_EQ(request.size(), 2u);
+  EXPECT_EQ(request[0].start_, 10u);
+  EXPECT_TRUE(sync.OnResponse(1, 10, {}));
+  EXPECT_FALSE(sync.finished());
+  EXPECT_TRUE(sync.OnResponse(1, 12, {}));
+  EXPECT_TRUE(sync.finished());
+  EXPECT_FALSE(sync.failed());
+  EXPECT_EQ(sync.applied_dynasty_count(), 10u);
+  EXPECT_EQ(sync.applied_unit_count(), 20u);
+
+  //dynasty not linked to anchor fails sync
+  sync.Start(anchor);
+  sync.AddPeer(1);
+  request = sync.NextRequests(1);
+  EXPECT_TRUE(sync.OnResponse(1, 0, slice(1, 4)));
+  EXPECT_FALSE(sync.PopReady(dynasty));
+  EXPECT_TRUE(sync.failed());
+  EXPECT_TRUE(sync.finished());
+
+  //encode and decode
+  std::list<std::shared_ptr<ambr::core::Unit>> unit_list(chain[0].begin(), chain[0].end());
+  std::vector<uint8_t> buf = ambr::syn::DynastySync::EncodeDynasty(unit_list);
+  dynasty.clear();
+  ASSERT_TRUE(ambr::syn::DynastySync::DecodeDynasty(buf.data(), buf.size(), dynasty));
+  ASSERT_EQ(dynasty.size(), 2u);
+  EXPECT_EQ(dynasty[0]->hash(), chain[0][0]->hash());
+  EXPECT_EQ(dynasty[1]->hash(), chain[0][1]->hash());
+  dynasty.clear();
+  EXPECT_FALSE(ambr::syn::DynastySync::DecodeDynasty(buf.data(), buf.size()-1, dynasty));
+}
+
+TEST (DynastySyncTest, MultiPeer) {
+  ambr::core::UnitHash anchor("C4F5BF9CABF57BBB1EB49420F5FAEC8E66BE5166E80EA3F93F417C124423230C");
+  std::vector<ambr::syn::DynastySync::Dynasty> chain = MakeDynastyChain(anchor, 60);
+  //simulated peers:1 fast, 2 slow, 3 never answers, 4 fast but has only 20 dynasties
+  struct SimPeer{
+    uint32_t latency_;
+    uint32_t height_;
+    std::list<std::pair<ambr::syn::DynastySync::Range, uint32_t>> queue_;//range and tick of answer
+  };
+  std::map<ambr::syn::DynastySync::PeerId, SimPeer> peer_map;
+  peer_map[1] = SimPeer{1, 60, {}};
+  peer_map[2] = SimPeer{5, 60, {}};
+  peer_map[3] = SimPeer{(uint32_t)-1, 60, {}};
+  peer_map[4] = SimPeer{1, 20, {}};
+
+  ambr::syn::DynastySync sync(4, 3);
+  sync.set_stall_time(std::chrono::seconds(10));
+  sync.set_steal_time(std::chrono::seconds(2));
+  sync.Start(anchor);
+  for(auto& item:peer_map){
+    sync.AddPeer(item.first);
+  }
+  ambr::syn::DynastySync::Clock::time_point begin = ambr::syn::DynastySync::Clock::now();
+  std::vector<ambr::syn::DynastySync::PeerId> expired;
+  ambr::syn::DynastySync::Dynasty dynasty;
+  uint32_t tick = 0;
+  for(; tick < 200 && !sync.finished(); tick++){
+    ambr::syn::DynastySync::Clock::time_point now = begin+std::chrono::seconds(tick);
+    for(auto& item:peer_map){
+      SimPeer& peer = item.second;
+      while(!peer.queue_.empty() && peer.queue_.front().second <= tick){
+        ambr::syn::DynastySync::Range range = peer.queue_.front().first;
+        peer.queue_.pop_front();
+        uint32_t end = std::min(range.start_+range.count_, peer.height_);
+        std::vector<ambr::syn::DynastySync::Dynasty> dynasty_list;
+        if(range.start_ < end){
+          dynasty_list.assign(chain.begin()+range.start_, chain.begin()+end);
+        }
+        sync.OnResponse(item.first, range.start_, std::move(dynasty_list), now);
+      }
+    }
+    for(ambr::syn::DynastySync::PeerId peer:sync.Expire(now)){
+      expired.push_back(peer);
+    }
+    for(auto& item:peer_map){
+      for(const ambr::syn::DynastySync::Range& range:sync.NextRequests(item.first, now)){
+        uint32_t due = item.second.latency_ == (uint32_t)-1?item.second.latency_:tick+item.second.latency_;
+        item.second.queue_.push_back(std::make_pair(range, due));
+      }
+    }
+    while(sync.PopReady(dynasty));
+  }
+  EXPECT_TRUE(sync.finished());
+  EXPECT_FALSE(sync.failed());
+  EXPECT_EQ(sync.applied_dynasty_count(), 60u);
+  EXPECT_EQ(sync.last_hash(), chain.back().back()->hash());
+  //stalled peer is dropped, ranges of slow and stalled peer are taken by idle ones
+  ASSERT_EQ(expired.size(), 1u);
+  EXPECT_EQ(expired[0], 3);
+  EXPECT_GT(sync.stolen_count(), 0u);
+  EXPECT_GT(sync.PeerRate(1), sync.PeerRate(2));
+  EXPECT_TRUE(sync.NextRequests(3, begin+std::chrono::seconds(tick)).empty());
+
+  //removed peer's ranges go to the other
+  sync.Start(anchor);
+  sync.AddPeer(1);
+  sync.AddPeer(2);
+  std::vector<ambr::syn::DynastySync::Range> request = sync.NextRequests(1, begin);
+  ASSERT_EQ(request.size(), 3u);
+  EXPECT_EQ(sync.NextRequests(2, begin).size(), 3u);
+  sync.RemovePeer(1);
+  EXPECT_FALSE(sync.HasPeer(1));
+  EXPECT_FALSE(sync.OnResponse(1, request[0].start_, {}, begin));
+  EXPECT_TRUE(sync.OnResponse(2, 12, std::vector<ambr::syn::DynastySync::Dynasty>(chain.begin()+12, chain.begin()+16), begin));
+  request = sync.NextRequests(2, begin);
+  ASSERT_EQ(request.size(), 1u);
+  EXPECT_EQ(request[0].start_, 0u);
+}
+
+TEST (DynastySyncTest, Headers) {
+  ambr::core::UnitHash anchor("C4F5BF9CABF57BBB1EB49420F5FAEC8E66BE5166E80EA3F93F417C124423230C");
+  ambr::core::PrivateKey pri_key = ambr::core::CreateRandomPrivateKey();
+  std::vector<ambr::syn::DynastySync::Dynasty> chain = MakeDynastyChain(anchor, 12, pri_key);
+  ambr::syn::DynastySync::HeaderList header_list;
+  for(const ambr::syn::DynastySync::Dynasty& dynasty:chain){
+    header_list.push_back(std::dynamic_pointer_cast<ambr::core::ValidatorUnit>(dynasty.back()));
+  }
+  //the only validator signs every header, and last header has it's vote for the previous one
+  ambr::store::ValidatorSetStore validator_set;
+  ambr::store::ValidatorItem validator_item;
+  validator_item.validator_public_key_ = ambr::core::GetPublicKeyByPrivateKey(pri_key);
+  validator_item.enter_nonce_ = 0;
+  validator_item.leave_nonce_ = 0;
+  validator_set.JoinValidator(validator_item);
+  validator_set.set_current_nonce(0);
+  validator_set.set_current_validator(validator_item.validator_public_key_);
+  std::string err;
+  auto verify_headers = [&anchor, &validator_set, &err](uint64_t prev_nonce, uint64_t max_nonce,
+                                                        const ambr::syn::DynastySync::HeaderList& header_list){
+    ambr::store::ValidatorSetStore validator_set_tmp = validator_set;
+    return ambr::syn::DynastySync::VerifyHeaders(anchor, prev_nonce, max_nonce, validator_set_tmp, header_list, &err);
+  };
+  ambr::core::PrivateKey vote_key = pri_key;
+  ambr::core::PrivateKey other_key = ambr::core::CreateRandomPrivateKey();
+  ambr::core::VoteUnit vote_unit;
+  vote_unit.set_type(ambr::core::UnitType::Vote);
+  vote_unit.set_public_key(ambr::core::GetPublicKeyByPrivateKey(vote_key));
+  vote_unit.set_validator_unit_hash(header_list[10]->hash());
+  vote_unit.set_accept(1);
+  vote_unit.CalcHashAndFill();
+  vote_unit.SignatureAndFill(vote_key);
+  auto set_vote_list = [&header_list, &pri_key](const std::vector<ambr::core::VoteUnit>& vote_list){
+    header_list.back()->set_vote_list(vote_list);
+    header_list.back()->CalcHashAndFill();
+    header_list.back()->SignatureAndFill(pri_key);
+  };
+  set_vote_list({vote_unit});
+
+  EXPECT_TRUE(verify_headers(0, 12, header_list));
+  //not linked, nonce after max nonce, nonce not increased
+  EXPECT_FALSE(verify_headers(0, 12,
+      ambr::syn::DynastySync::HeaderList(header_list.begin()+1, header_list.end())));
+  EXPECT_FALSE(verify_headers(0, 11, header_list));
+  EXPECT_FALSE(verify_headers(1, 12, header_list));
+  //duplicated vote, vote for other unit, bad signature of vote
+  set_vote_list({vote_unit, vote_unit});
+  EXPECT_FALSE(verify_headers(0, 12, header_list));
+  ambr::core::VoteUnit other_vote_unit = vote_unit;
+  other_vote_unit.set_validator_unit_hash(header_list[9]->hash());
+  other_vote_unit.CalcHashAndFill();
+  other_vote_unit.SignatureAndFill(vote_key);
+  set_vote_list({other_vote_unit});
+  EXPECT_FALSE(verify_headers(0, 12, header_list));
+  other_vote_unit = vote_unit;
+  other_vote_unit.SignatureAndFill(other_key);
+  set_vote_list({other_vote_unit});
+  EXPECT_FALSE(verify_headers(0, 12, header_list));
+  //voter not in validator set
+  other_vote_unit = vote_unit;
+  other_vote_unit.set_public_key(ambr::core::GetPublicKeyByPrivateKey(other_key));
+  other_vote_unit.CalcHashAndFill();
+  other_vote_unit.SignatureAndFill(other_key);
+  set_vote_list({other_vote_unit});
+  EXPECT_FALSE(verify_headers(0, 12, header_list));
+  EXPECT_EQ(std::string("One of validate's sender is not in validator_set"), err);
+  //vote is hashed into validator unit
+  set_vote_list({vote_unit});
+  header_list.back()->set_vote_list(std::vector<ambr::core::VoteUnit>());
+  EXPECT_FALSE(verify_headers(0, 12, header_list));
+  set_vote_list({vote_unit});
+  EXPECT_TRUE(verify_headers(0, 12, header_list));
+  //validator set is advanced to the last header
+  ambr::store::ValidatorSetStore validator_set_after = validator_set;
+  EXPECT_TRUE(ambr::syn::DynastySync::VerifyHeaders(anchor, 0, 12, validator_set_after,
+      ambr::syn::DynastySync::HeaderList(header_list.begin(), header_list.begin()+5), &err));
+  EXPECT_EQ(validator_set_after.current_nonce(), 5u);
+  EXPECT_TRUE(ambr::syn::DynastySync::VerifyHeaders(header_list[4]->hash(), 5, 12, validator_set_after,
+      ambr::syn::DynastySync::HeaderList(header_list.begin()+5, header_list.end()), &err));
+  //header not signed by validator of it's nonce turn
+  validator_item.validator_public_key_ = ambr::core::GetPublicKeyByPrivateKey(other_key);
+  validator_set.JoinValidator(validator_item);
+  EXPECT_FALSE(verify_headers(0, 12, header_list));
+  EXPECT_EQ(std::string("err nonce or validator"), err);
+
+  //dynasty against header
+  EXPECT_TRUE(ambr::syn::DynastySync::CheckDynasty(*header_list[0], chain[0]));
+  EXPECT_FALSE(ambr::syn::DynastySync::CheckDynasty(*header_list[0], chain[1]));
+  ambr::syn::DynastySync::Dynasty dynasty{chain[1][0], chain[0][0], chain[0][1]};
+  EXPECT_FALSE(ambr::syn::DynastySync::CheckDynasty(*header_list[0], dynasty));
+
+  //dynasties are requested up to last header, from any peer
+  ambr::syn::DynastySync sync(4, 2);
+  sync.Start(anchor);
+  sync.AddHeaders(ambr::syn::DynastySync::HeaderList());
+  sync.AddPeer(1);
+  sync.AddPeer(2);
+  EXPECT_TRUE(sync.NextRequests(1).empty());
+  EXPECT_FALSE(sync.finished());
+  sync.AddHeaders(ambr::syn::DynastySync::HeaderList(header_list.begin(), header_list.begin()+6));
+  std::vector<ambr::syn::DynastySync::Range> request = sync.NextRequests(1);
+  ASSERT_EQ(request.size(), 2u);
+  EXPECT_EQ(request[1].start_, 4u);
+  EXPECT_EQ(request[1].count_, 2u);
+  //ranges are requested from header before them
+  EXPECT_EQ(sync.PrevHash(0), anchor);
+  EXPECT_EQ(sync.PrevHash(4), header_list[3]->hash());
+  EXPECT_EQ(sync.PrevHash(6), header_list[5]->hash());
+  EXPECT_TRUE(sync.PrevHash(7).is_zero());
+  EXPECT_TRUE(sync.NextRequests(2).empty());
+  EXPECT_TRUE(sync.OnResponse(1, 0, std::vector<ambr::syn::DynastySync::Dynasty>(chain.begin(), chain.begin()+4)));
+  //dynasty not matching header drops peer, it's range goes to the other
+  EXPECT_FALSE(sync.OnResponse(1, 4, std::vector<ambr::syn::DynastySync::Dynasty>(chain.begin()+5, chain.begin()+7)));
+  EXPECT_FALSE(sync.HasPeer(1));
+  request = sync.NextRequests(2);
+  ASSERT_EQ(request.size(), 1u);
+  EXPECT_EQ(request[0].start_, 4u);
+  EXPECT_TRUE(sync.OnResponse(2, 4, std::vector<ambr::syn::DynastySync::Dynasty>(chain.begin()+4, chain.begin()+6)));
+  sync.AddHeaders(ambr::syn::DynastySync::HeaderList(header_list.begin()+6, header_list.end()));
+  request = sync.NextRequests(2);
+  ASSERT_EQ(request.size(), 2u);
+  EXPECT_TRUE(sync.OnResponse(2, 6, std::vector<ambr::syn::DynastySync::Dynasty>(chain.begin()+6, chain.begin()+10)));
+  EXPECT_TRUE(sync.OnResponse(2, 10, std::vector<ambr::syn::DynastySync::Dynasty>(chain.begin()+10, chain.end())));
+  while(sync.PopReady(dynasty));
+  EXPECT_EQ(sync.last_hash(), header_list.back()->hash());
+  //more headers may come
+  EXPECT_FALSE(sync.finished());
+  sync.set_headers_done();
+  EXPECT_TRUE(sync.finished());
+  EXPECT_FALSE(sync.failed());
+}
+
+TEST (DynastySyncTest, Chunks) {
+  std::vector<uint8_t> response(100);
+  for(size_t i = 0; i < response.size(); i++){
+    response[i] = (uint8_t)i;
+  }
+  auto make_chunk = [&response](uint64_t total, uint64_t offset, size_t size){
+    std::vector<uint8_t> chunk((const uint8_t*)&total, (const uint8_t*)(&total+1));
+    chunk.insert(chunk.end(), (const uint8_t*)&offset, (const uint8_t*)(&offset+1));
+    chunk.insert(chunk.end(), response.begin()+offset, response.begin()+offset+size);
+    return chunk;
+  };
+  ambr::syn::ChunkAssembler assembler;
+  const uint8_t* data = nullptr;
+  size_t size = 0;
+  //single chunk is used in place
+  std::vector<uint8_t> chunk = make_chunk(100, 0, 100);
+  ASSERT_EQ(assembler.Add(chunk.data(), chunk.size(), data, size), ambr::syn::ChunkAssembler::Complete);
+  EXPECT_EQ(data, chunk.data()+16);
+  EXPECT_EQ(size, 100u);
+  //chunks are joined
+  chunk = make_chunk(100, 0, 40);
+  EXPECT_EQ(assembler.Add(chunk.data(), chunk.size(), data, size), ambr::syn::ChunkAssembler::Partial);
+  chunk = make_chunk(100, 40, 40);
+  EXPECT_EQ(assembler.Add(chunk.data(), chunk.size(), data, size), ambr::syn::ChunkAssembler::Partial);
+  chunk = make_chunk(100, 80, 20);
+  ASSERT_EQ(assembler.Add(chunk.data(), chunk.size(), data, size), ambr::syn::ChunkAssembler::Complete);
+  EXPECT_EQ(std::vector<uint8_t>(data, data+size), response);
+  //out of order, beyond total, too large
+  chunk = make_chunk(100, 0, 40);
+  EXPECT_EQ(assembler.Add(chunk.data(), chunk.size(), data, size), ambr::syn::ChunkAssembler::Partial);
+  chunk = make_chunk(100, 80, 20);
+  EXPECT_EQ(assembler.Add(chunk.data(), chunk.size(), data, size), ambr::syn::ChunkAssembler::Invalid);
+  chunk = make_chunk(50, 40, 20);
+  EXPECT_EQ(assembler.Add(chunk.data(), chunk.size(), data, size), ambr::syn::ChunkAssembler::Invalid);
+  chunk = make_chunk(ambr::syn::ChunkAssembler::MAX_RESPONSE_SIZE+1, 0, 10);
+  EXPECT_EQ(assembler.Add(chunk.data(), chunk.size(), data, size), ambr::syn::ChunkAssembler::Invalid);
+  EXPECT_EQ(assembler.Add(chunk.data(), 15, data, size), ambr::syn::ChunkAssembler::Invalid);
+  //larger than requested
+  assembler.set_max_size(99);
+  chunk = make_chunk(100, 0, 40);
+  EXPECT_EQ(assembler.Add(chunk.data(), chunk.size(), data, size), ambr::syn::ChunkAssembler::Invalid);
+  assembler.set_max_size(100);
+  EXPECT_EQ(assembler.Add(chunk.data(), chunk.size(), data, size), ambr::syn::ChunkAssembler::Partial);
+
+  //bound by the largest range in flight to peer
+  ambr::syn::DynastySync sync(4, 2);
+  sync.Start(ambr::core::UnitHash());
+  sync.AddPeer(1);
+  EXPECT_EQ(sync.MaxResponseSize(1), sizeof(uint32_t)*2);
+  ASSERT_EQ(sync.NextRequests(1).size(), 2u);
+  EXPECT_EQ(sync.MaxInFlightCount(1), 4u);
+  EXPECT_EQ(sync.MaxResponseSize(1), sizeof(uint32_t)*2+4*(sizeof(uint64_t)+ambr::syn::DynastySync::MAX_DYNASTY_SIZE));
+  EXPECT_EQ(sync.MaxInFlightCount(2), 0u);
+}
+
+TEST (UnitRelayTest, Inventory) {
+  typedef ambr::syn::UnitRelay::Clock Clock;
+  ambr::syn::UnitRelay relay(1000, std::chrono::seconds(10));
+  std::vector<ambr::core::UnitHash> hash_list;
+  for(int i = 1; i <= 4; i++){
+    hash_list.push_back(ambr::core::UnitHash(i));
+  }
+  EXPECT_EQ(ambr::syn::UnitRelay::FromInvHash(ambr::syn::UnitRelay::ToInvHash(hash_list[1])), hash_list[1]);
+  Clock::time_point now = Clock::now();
+  //known hash is never requested
+  relay.AddKnown(hash_list[0]);
+  EXPECT_TRUE(relay.IsKnown(hash_list[0]));
+  EXPECT_EQ(relay.FilterRequest(hash_list, now), std::vector<ambr::core::UnitHash>(hash_list.begin()+1, hash_list.end()));
+  EXPECT_EQ(relay.requested_count(), 3u);
+  //in flight from another peer
+  EXPECT_TRUE(relay.FilterRequest(hash_list, now+std::chrono::seconds(1)).empty());
+  //duplicates of received units are dropped, they are known when verified
+  EXPECT_TRUE(relay.OnReceived(hash_list[1]));
+  EXPECT_FALSE(relay.OnReceived(hash_list[1]));
+  EXPECT_FALSE(relay.OnReceived(hash_list[0]));
+  EXPECT_FALSE(relay.IsKnown(hash_list[1]));
+  relay.OnVerified(hash_list[1], true);
+  EXPECT_TRUE(relay.IsKnown(hash_list[1]));
+  EXPECT_FALSE(relay.OnReceived(hash_list[1]));
+  EXPECT_EQ(relay.requested_count(), 2u);
+  //timed out requests are requested again
+  EXPECT_EQ(relay.FilterRequest(hash_list, now+std::chrono::seconds(10)), std::vector<ambr::core::UnitHash>(hash_list.begin()+2, hash_list.end()));
+}
+
+TEST (UnitRelayTest, ForgedFirst) {
+  ambr::core::UnitHash anchor("C4F5BF9CABF57BBB1EB49420F5FAEC8E66BE5166E80EA3F93F417C124423230C");
+  std::vector<ambr::syn::DynastySync::Dynasty> chain = MakeDynastyChain(anchor, 1);
+  std::shared_ptr<ambr::core::Unit> unit = chain[0][1];
+  //same hash as the real one, but it's body is changed
+  std::shared_ptr<ambr::core::ValidatorUnit> forged_unit = std::make_shared<ambr::core::ValidatorUnit>(*std::dynamic_pointer_cast<ambr::core::ValidatorUnit>(unit));
+  forged_unit->set_nonce(100);
+  ASSERT_EQ(forged_unit->hash(), unit->hash());
+
+  int peer_a, peer_b;
+  ambr::syn::UnitRelay relay(1000, std::chrono::seconds(10));
+  std::vector<std::pair<ambr::syn::UnitIngest::PeerId, bool>> applied_list;
+  ambr::syn::UnitIngest ingest(
+    [&](const std::shared_ptr<ambr::core::Unit>& unit, ambr::syn::UnitIngest::PeerId peer, bool valid){
+      relay.OnVerified(unit->hash(), valid);
+      applied_list.push_back(std::make_pair(peer, valid));
+    },
+    nullptr, 2);
+  //forged one arrives first and is dropped by verify, the real one is still taken
+  EXPECT_TRUE(relay.OnReceived(forged_unit->hash()));
+  EXPECT_TRUE(ingest.Push(forged_unit, &peer_a));
+  ingest.WaitIdle();
+  EXPECT_FALSE(relay.IsKnown(unit->hash()));
+  EXPECT_EQ(relay.FilterRequest({unit->hash()}).size(), 1u);
+  EXPECT_TRUE(relay.OnReceived(unit->hash()));
+  EXPECT_TRUE(ingest.Push(unit, &peer_b));
+  ingest.WaitIdle();
+  ASSERT_EQ(applied_list.size(), 2u);
+  EXPECT_EQ(applied_list[0], std::make_pair((ambr::syn::UnitIngest::PeerId)&peer_a, false));
+  EXPECT_EQ(applied_list[1], std::make_pair((ambr::syn::UnitIngest::PeerId)&peer_b, true));
+  EXPECT_TRUE(relay.IsKnown(unit->hash()));
+  EXPECT_FALSE(relay.OnReceived(unit->hash()));
+}
+
+TEST (OrphanFetchTest, Ancestors) {
+  typedef ambr::syn::OrphanFetch::Clock Clock;
+  typedef std::vector<ambr::core::UnitHash> HashList;
+  int peer_a, peer_b;
+  ambr::syn::OrphanFetch fetch(256, 2, std::chrono::seconds(3));
+  ambr::core::UnitHash orphan1(1), orphan2(2), orphan3(3), orphan4(4);
+  ambr::core::UnitHash missing1(11), missing2(12), missing3(13);
+  Clock::time_point now = Clock::now();
+  fetch.AddOrphan(&peer_a, orphan1, missing1, now);
+  fetch.AddOrphan(&peer_b, orphan2, missing1, now);
+  fetch.AddOrphan(&peer_a, orphan3, missing2, now);
+  fetch.AddOrphan(&peer_a, orphan4, missing3, now);
+  EXPECT_EQ(fetch.missing_count(), 3u);
+  //one batch per peer, bounded per peer
+  auto request_map = fetch.NextRequests(now);
+  ASSERT_EQ(request_map.size(), 1u);
+  EXPECT_EQ(request_map[&peer_a], HashList({missing1, missing2}));
+  EXPECT_EQ(fetch.in_flight_count(), 2u);
+  EXPECT_TRUE(fetch.NextRequests(now).empty());
+  //missing unit arrives, room for the next one
+  fetch.OnAdded(missing2, now+std::chrono::milliseconds(100));
+  fetch.OnAdded(orphan3, now+std::chrono::milliseconds(100));
+  EXPECT_EQ(fetch.accepted_count(), 1u);
+  EXPECT_EQ(fetch.last_latency(), std::chrono::milliseconds(100));
+  request_map = fetch.NextRequests(now);
+  ASSERT_EQ(request_map.size(), 1u);
+  EXPECT_EQ(request_map[&peer_a], HashList({missing3}));
+  //timed out units are requested from other peers which relayed orphans missing them, or dropped
+  fetch.Expire(now+std::chrono::seconds(3));
+  EXPECT_EQ(fetch.in_flight_count(), 0u);
+  EXPECT_EQ(fetch.missing_count(), 1u);
+  request_map = fetch.NextRequests(now+std::chrono::seconds(3));
+  ASSERT_EQ(request_map.size(), 1u);
+  EXPECT_EQ(request_map[&peer_b], HashList({missing1}));
+  //in flight of removed peer
+  fetch.RemovePeer(&peer_b);
+  EXPECT_EQ(fetch.missing_count(), 0u);
+  EXPECT_EQ(fetch.in_flight_count(), 0u);
+  EXPECT_EQ(fetch.requested_count(), 4u);
+  //orphan which is missing by others arrived
+  fetch.AddOrphan(&peer_a, orphan1, missing1, now);
+  fetch.AddOrphan(&peer_b, missing1, missing2, now);
+  request_map = fetch.NextRequests(now);
+  ASSERT_EQ(request_map.size(), 1u);
+  EXPECT_EQ(request_map[&peer_b], HashList({missing2}));
+}
+
+TEST (UnitIngestTest, Pipeline) {
+  ambr::core::UnitHash anchor("C4F5BF9CABF57BBB1EB49420F5FAEC8E66BE5166E80EA3F93F417C124423230C");
+  std::vector<ambr::syn::DynastySync::Dynasty> chain = MakeDynastyChain(anchor, 20);
+  int peer_a, peer_b;
+  std::mutex mutex;
+  std::condition_variable cond;
+  bool blocked = false, entered = false;
+  std::vector<std::pair<ambr::core::UnitHash, bool>> applied_list;
+  std::vector<std::pair<ambr::syn::UnitIngest::PeerId, bool>> pause_list;
+  ambr::syn::UnitIngest ingest(
+    [&](const std::shared_ptr<ambr::core::Unit>& unit, ambr::syn::UnitIngest::PeerId, bool valid){
+      std::unique_lock<std::mutex> lk(mutex);
+      entered = true;
+      cond.notify_all();
+      cond.wait(lk, [&blocked](){return !blocked;});
+      applied_list.push_back(std::make_pair(unit->hash(), valid));
+    },
+    [&](ambr::syn::UnitIngest::PeerId peer, bool pause){
+      std::lock_guard<std::mutex> lk(mutex);
+      pause_list.push_back(std::make_pair(peer, pause));
+    },
+    4, 8, 4);
+  //applied in order of push, unit with wrong hash is invalid
+  for(size_t i = 0; i < chain.size(); i++){
+    EXPECT_TRUE(ingest.Push(chain[i][1], i%2?&peer_a:&peer_b));
+    if(i%4 == 3)ingest.WaitIdle();
+  }
+  std::shared_ptr<ambr::core::ValidatorUnit> bad_unit = std::make_shared<ambr::core::ValidatorUnit>(*std::dynamic_pointer_cast<ambr::core::ValidatorUnit>(chain[0][1]));
+  bad_unit->set_nonce(100);
+  EXPECT_TRUE(ingest.Push(bad_unit, &peer_a));
+  ingest.WaitIdle();
+  ASSERT_EQ(applied_list.size(), 21u);
+  for(size_t i = 0; i < chain.size(); i++){
+    EXPECT_EQ(applied_list[i], std::make_pair(chain[i][1]->hash(), true));
+  }
+  EXPECT_EQ(applied_list[20], std::make_pair(bad_unit->hash(), false));
+  EXPECT_TRUE(pause_list.empty());
+
+  //peer is paused at it's bound and resumed at half of it
+  {
+    std::lock_guard<std::mutex> lk(mutex);
+    blocked = true;
+    entered = false;
+    applied_list.clear();
+  }
+  EXPECT_TRUE(ingest.Push(chain[0][1], &peer_a));
+  {
+    std::unique_lock<std::mutex> lk(mutex);
+    cond.wait(lk, [&entered](){return entered;});
+  }
+  for(size_t i = 1; i < 6; i++){
+    EXPECT_EQ(ingest.Push(chain[i][1], &peer_a), i < 5);
+  }
+  EXPECT_EQ(ingest.depth(&peer_a), 4u);
+  {
+    std::lock_guard<std::mutex> lk(mutex);
+    ASSERT_EQ(pause_list.size(), 1u);
+    EXPECT_EQ(pause_list[0], std::make_pair((ambr::syn::UnitIngest::PeerId)&peer_a, true));
+  }
+  ambr::syn::UnitIngest::Stats stats = ingest.GetStats();
+  EXPECT_EQ(stats.paused_peer_count_, 1u);
+  EXPECT_EQ(stats.dropped_count_, 1u);
+  EXPECT_EQ(stats.verify_depth_+stats.apply_depth_, 4u);
+  {
+    std::lock_guard<std::mutex> lk(mutex);
+    blocked = false;
+  }
+  cond.notify_all();
+  ingest.WaitIdle();
+  ASSERT_EQ(pause_list.size(), 2u);
+  EXPECT_EQ(pause_list[1], std::make_pair((ambr::syn::UnitIngest::PeerId)&peer_a, false));
+  EXPECT_EQ(applied_list.size(), 5u);
+  stats = ingest.GetStats();
+  EXPECT_EQ(stats.paused_peer_count_, 0u);
+  EXPECT_EQ(stats.applied_count_, 25u);
+  EXPECT_EQ(stats.invalid_count_, 1u);
+  EXPECT_EQ(ingest.depth(&peer_a), 0u);
+}
+
+TEST (UnitIngestTest, TotalBound) {
+  ambr::core::UnitHash anchor("C4F5BF9CABF57BBB1EB49420F5FAEC8E66BE5166E80EA3F93F417C124423230C");
+  std::vector<ambr::syn::DynastySync::Dynasty> chain = MakeDynastyChain(anchor, 40);
+  int peer_list[4];
+  std::mutex mutex;
+  std::condition_variable cond;
+  bool blocked = true;
+  size_t applied_count = 0;
+  std::map<ambr::syn::UnitIngest::PeerId, bool> paused_map;
+  size_t pause_count = 0;
+  ambr::syn::UnitIngest ingest(
+    [&](const std::shared_ptr<ambr::core::Unit>&, ambr::syn::UnitIngest::PeerId, bool valid){
+      std::unique_lock<std::mutex> lk(mutex);
+      cond.wait(lk, [&blocked](){return !blocked;});
+      EXPECT_TRUE(valid);
+      applied_count++;
+    },
+    [&](ambr::syn::UnitIngest::PeerId peer, bool pause){
+      std::lock_guard<std::mutex> lk(mutex);
+      EXPECT_NE(paused_map[peer], pause);
+      paused_map[peer] = pause;
+      if(pause)pause_count++;
+      cond.notify_all();
+    },
+    4, 8, 4);
+  auto is_paused = [&](size_t peer_idx){
+    std::lock_guard<std::mutex> lk(mutex);
+    return paused_map[&peer_list[peer_idx]];
+  };
+  //peers send in turn while they're not paused, none reaches it's own bound before total bound
+  size_t pushed = 0;
+  for(size_t turn = 0; pushed < 12; turn++){
+    size_t peer_idx = turn%4;
+    if(is_paused(peer_idx))continue;
+    EXPECT_TRUE(ingest.Push(chain[pushed][1], &peer_list[peer_idx]));
+    pushed++;
+    if(is_paused(0) && is_paused(1) && is_paused(2) && is_paused(3))break;
+  }
+  //every peer is paused at total bound, not only the one whose unit reached it
+  {
+    std::lock_guard<std::mutex> lk(mutex);
+    EXPECT_EQ(pause_count, 4u);
+  }
+  ambr::syn::UnitIngest::Stats stats = ingest.GetStats();
+  EXPECT_EQ(stats.paused_peer_count_, 4u);
+  EXPECT_EQ(stats.dropped_count_, 0u);
+  EXPECT_LE(stats.verify_depth_+stats.apply_depth_, 8u);
+
+  //resumed under half, the rest is sent by peers following pause
+  {
+    std::lock_guard<std::mutex> lk(mutex);
+    blocked = false;
+  }
+  cond.notify_all();
+  for(size_t turn = 0; pushed < chain.size(); turn++){
+    size_t peer_idx = turn%4;
+    if(is_paused(peer_idx)){
+      std::unique_lock<std::mutex> lk(mutex);
+      cond.wait_for(lk, std::chrono::milliseconds(10), [&](){return !paused_map[&peer_list[peer_idx]];});
+      continue;
+    }
+    EXPECT_TRUE(ingest.Push(chain[pushed][1], &peer_list[peer_idx]));
+    pushed++;
+  }
+  ingest.WaitIdle();
+  stats = ingest.GetStats();
+  EXPECT_EQ(stats.dropped_count_, 0u);
+  EXPECT_EQ(stats.paused_peer_count_, 0u);
+  EXPECT_EQ(stats.applied_count_, chain.size());
+  std::lock_guard<std::mutex> lk(mutex);
+  EXPECT_EQ(applied_count, chain.size());
+  for(const std::pair<const ambr::syn::UnitIngest::PeerId, bool>& item:paused_map){
+    EXPECT_FALSE(item.second);
+  }
+}
+
+TEST (SynManagerTest, DisconnectWithoutHook) {
+  system("rm -fr ./disconnect");
+  std::shared_ptr<ambr::store::StoreManager> store = std::make_shared<ambr::store::StoreManager>();
+  store->Init("./disconnect");
+  ambr::syn::SynManager manager(store);
+  CAddress addr;
+  std::shared_ptr<CNode> node = std::make_shared<CNode>(0, NODE_NONE, 0, INVALID_SOCKET, addr, 0, 0, addr, "127.0.0.1:10111", false);
+  node->latest_nonce = 5;
+  manager.OnConnectNode(node.get());
+  EXPECT_EQ(manager.GetNodeNonce("127.0.0.1:10111"), 5u);
+  //no hook is registered, node is still forgotten before it's freed
+  manager.OnDisConnectNode(node.get());
+  node.reset();
+  EXPECT_EQ(manager.GetNodeNonce("127.0.0.1:10111"), 0u);
+  EXPECT_FALSE(manager.GetNodeIfPauseSend("127.0.0.1:10111"));
+  system("rm -fr ./disconnect");
+}
@@ -6,6 +6,7 @@
 #include <core/unit.h>
 #include <store/unit_store.h>
 #include <crypto/random.h>
+#include <crypto/sha256.h>
 #include <glog/logging.h>
 #define SERIALIZE_EQ_TEST(unit_for_test) \
 {\
@@ -78,6 +79,33 @@ TEST (UnitTest, SendUnit_and_SendUnitStore) {
 
 }
 
+TEST (UnitTest, DeSerializeByteInPlace) {
+  ambr::core::PrivateKey pri_key = ambr::core::CreateRandomPrivateKey();
+  ambr::core::PublicKey pub_key = ambr::core::GetPublicKeyByPrivateKey(pri_key);
+  ambr::core::UnitHash unit_hash_rand;
+  unit_hash_rand.set_bytes(ambr::crypto::Random::CreateRandomArray<256/8>());
+  ambr::core::Amount amount;
+  amount.set_data(123123123);
+
+  ambr::core::SendUnit unit1;
+  unit1.set_version(0x00000001);
+  unit1.set_type(ambr::core::UnitType::send);
+  unit1.set_public_key(pub_key);
+  unit1.set_prev_unit(unit_hash_rand);
+  unit1.set_balance(amount);
+  unit1.set_dest(pub_key);
+  unit1.CalcHashAndFill();
+  unit1.SignatureAndFill(pri_key);
+  //parse bytes in place, inside a larger buffer
+  std::vector<uint8_t> unit_buf = unit1.SerializeByte();
+  std::vector<uint8_t> message_buf(3, 0);
+  message_buf.insert(message_buf.end(), unit_buf.begin(), unit_buf.end());
+  ambr::core::SendUnit unit2;
+  EXPECT_TRUE(unit2.DeSerializeByte(message_buf.data()+3, unit_buf.size()));
+  EXPECT_EQ(unit2.hash(), unit1.hash());
+  EXPECT_TRUE(unit2.Validate(nullptr));
+}
+
 TEST (UnitTest, ReceiveUnit_and_ReceiveUnitStore) {
   ambr::core::PrivateKey pri_key = ambr::core::CreateRandomPrivateKey();
   ambr::core::PublicKey pub_key = ambr::core::GetPublicKeyByPrivateKey(pri_key);
@@ -323,3 +351,157 @@ TEST (UnitTest, ValidatorSetStore) {
   SERIALIZE_EQ_TEST_VALUE(unit1, validator_list, list_tmp);
 
 }
+
+TEST (UnitTest, CalcHashBatch) {
+  ambr::core::PrivateKey pri_key = ambr::core::CreateRandomPrivateKey();
+  ambr::core::PublicKey pub_key = ambr::core::GetPublicKeyByPrivateKey(pri_key);
+  std::vector<std::shared_ptr<ambr::core::Unit>> unit_list;
+  std::vector<ambr::core::UnitHash> expect_list;
+  for(size_t i = 0; i < 21; i++){
+    ambr::core::UnitHash prev;
+    prev.set_bytes(ambr::crypto::Random::CreateRandomArray<256/8>());
+    ambr::core::Amount balance;
+    balance.set_data(i*1000);
+    std::shared_ptr<ambr::core::SendUnit> send_unit = std::make_shared<ambr::core::SendUnit>();
+    send_unit->set_version(0x00000001);
+    send_unit->set_type(ambr::core::UnitType::send);
+    send_unit->set_public_key(pub_key);
+    send_unit->set_prev_unit(prev);
+    send_unit->set_balance(balance);
+    send_unit->set_dest(pub_key);
+    send_unit->CalcHashAndFill();
+    send_unit->SignatureAndFill(pri_key);
+    //same bytes as the former SHA256OneByOneHasher based CalcHash
+    ambr::crypto::SHA256OneByOneHasher hasher;
+    hasher.process(send_unit->version());
+    hasher.process(send_unit->type());
+    hasher.process(send_unit->public_key());
+    hasher.process(send_unit->prev_unit());
+    hasher.process(send_unit->balance());
+    hasher.process(send_unit->dest());
+    hasher.finish();
+    ambr::core::UnitHash::ArrayType array;
+    hasher.get_hash_bytes(array.begin(), array.end());
+    EXPECT_EQ(ambr::core::UnitHash(array), send_unit->hash());
+    unit_list.push_back(send_unit);
+    expect_list.push_back(send_unit->hash());
+    if(i%3 == 0){
+      std::shared_ptr<ambr::core::ReceiveUnit> receive_unit = std::make_shared<ambr::core::ReceiveUnit>();
+      receive_unit->set_version(0x00000001);
+      receive_unit->set_type(ambr::core::UnitType::receive);
+      receive_unit->set_public_key(pub_key);
+      receive_unit->set_prev_unit(send_unit->hash());
+      receive_unit->set_balance(balance);
+      receive_unit->set_from(send_unit->hash());
+      receive_unit->CalcHashAndFill();
+      receive_unit->SignatureAndFill(pri_key);
+      unit_list.push_back(receive_unit);
+      expect_list.push_back(receive_unit->hash());
+    }
+  }
+  std::vector<const ambr::core::Unit*> ptr_list;
+  for(std::shared_ptr<ambr::core::Unit> unit:unit_list){
+    ptr_list.push_back(unit.get());
+  }
+  std::vector<ambr::core::UnitHash> hash_list;
+  ambr::core::Unit::CalcHashBatch(ptr_list, &hash_list);
+  EXPECT_EQ(expect_list, hash_list);
+
+  std::vector<bool> valid_list;
+  EXPECT_TRUE(ambr::core::Unit::ValidateBatch(ptr_list, &valid_list, nullptr));
+  unit_list[4]->set_balance(ambr::core::Amount());
+  std::vector<std::string> err_list;
+  EXPECT_FALSE(ambr::core::Unit::ValidateBatch(ptr_list, &valid_list, &err_list));
+  EXPECT_FALSE(valid_list[4]);
+  EXPECT_EQ(std::string("error hash"), err_list[4]);
+}
+
+TEST (UnitTest, SignatureCache) {
+  ambr::core::PrivateKey pri_key = ambr::core::CreateRandomPrivateKey();
+  ambr::core::PublicKey pub_key = ambr::core::GetPublicKeyByPrivateKey(pri_key);
+  std::shared_ptr<ambr::core::SendUnit> unit = std::make_shared<ambr::core::SendUnit>();
+  unit->set_version(0x00000001);
+  unit->set_type(ambr::core::UnitType::send);
+  unit->set_public_key(pub_key);
+  unit->set_dest(pub_key);
+  unit->CalcHashAndFill();
+  unit->SignatureAndFill(pri_key);
+
+  ambr::core::SignatureCache& cache = ambr::core::Unit::signature_cache();
+  uint64_t hit_count = cache.hit_count();
+  EXPECT_TRUE(unit->Validate(nullptr));
+  EXPECT_EQ(hit_count, cache.hit_count());
+  EXPECT_TRUE(unit->Validate(nullptr));
+  EXPECT_EQ(hit_count+1, cache.hit_count());
+  std::vector<const ambr::core::Unit*> ptr_list = {unit.get()};
+  EXPECT_TRUE(ambr::core::Unit::ValidateBatch(ptr_list, nullptr, nullptr));
+  EXPECT_EQ(hit_count+2, cache.hit_count());
+
+  //other signature of the same hash is not trusted
+  ambr::core::Signature sign = unit->sign();
+  unit->set_sign(ambr::core::Signature());
+  std::string err;
+  EXPECT_FALSE(unit->Validate(&err));
+  EXPECT_EQ(std::string("error signature"), err);
+  unit->set_sign(sign);
+
+  //bounded by capacity
+  ambr::core::SignatureCache small_cache(16, 4);
+  for(uint32_t i = 0; i < 100; i++){
+    ambr::core::UnitHash hash;
+    hash.set_bytes(ambr::crypto::Random::CreateRandomArray<256/8>());
+    small_cache.Insert(hash, pub_key, sign);
+    EXPECT_TRUE(small_cache.Contains(hash, pub_key, sign));
+  }
+  EXPECT_EQ(16u, small_cache.size());
+  small_cache.SetCapacity(0);
+  EXPECT_EQ(0u, small_cache.size());
+}
+
+TEST (UnitTest, MalleatedSignatureNotCached) {
+  ambr::core::PrivateKey pri_key = ambr::core::CreateRandomPrivateKey();
+  ambr::core::PublicKey pub_key = ambr::core::GetPublicKeyByPrivateKey(pri_key);
+  std::vector<std::shared_ptr<ambr::core::Unit>> unit_list;
+  std::vector<const ambr::core::Unit*> ptr_list;
+  //enough units for ed25519 batch verification
+  for(size_t i = 0; i < 8; i++){
+    ambr::core::UnitHash prev;
+    prev.set_bytes(ambr::crypto::Random::CreateRandomArray<256/8>());
+    std::shared_ptr<ambr::core::SendUnit> unit = std::make_shared<ambr::core::SendUnit>();
+    unit->set_version(0x00000001);
+    unit->set_type(ambr::core::UnitType::send);
+    unit->set_public_key(pub_key);
+    unit->set_prev_unit(prev);
+    unit->set_dest(pub_key);
+    unit->CalcHashAndFill();
+    unit->SignatureAndFill(pri_key);
+    unit_list.push_back(unit);
+    ptr_list.push_back(unit.get());
+  }
+  //S+L of a valid signature
+  const uint8_t group_order[32] = {
+    0xed, 0xd3, 0xf5, 0x5c, 0x1a, 0x63, 0x12, 0x58, 0xd6, 0x9c, 0xf7, 0xa2, 0xde, 0xf9, 0xde, 0x14,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10};
+  std::array<uint8_t, 64> bytes = unit_list[5]->sign().bytes();
+  unsigned int carry = 0;
+  for(size_t i = 0; i < 32; i++){
+    carry += bytes[32+i] + group_order[i];
+    bytes[32+i] = (uint8_t)carry;
+    carry >>= 8;
+  }
+  ambr::core::Signature sign;
+  sign.set_bytes(bytes);
+  unit_list[5]->set_sign(sign);
+
+  std::vector<bool> valid_list;
+  std::vector<std::string> err_list;
+  EXPECT_FALSE(ambr::core::Unit::ValidateBatch(ptr_list, &valid_list, &err_list));
+  for(size_t i = 0; i < ptr_list.size(); i++){
+    EXPECT_EQ(valid_list[i], i != 5);
+  }
+  EXPECT_EQ(std::string("error signature"), err_list[5]);
+  EXPECT_FALSE(ambr::core::Unit::signature_cache().Contains(unit_list[5]->hash(), pub_key, sign));
+  std::string err;
+  EXPECT_FALSE(unit_list[5]->Validate(&err));
+  EXPECT_EQ(std::string("error signature"), err);
+}